@@ -0,0 +1,39 @@
+/**
+ * @file    cmsis_compiler.h
+ * @author  Deadline039
+ * @brief   主机测试的CMSIS编译器适配
+ * @version 1.0
+ * @date    2026-10-17
+ * @note    先包含真正的cmsis_compiler.h, 再把会生成ARM指令的内核函数换成
+ *          主机实现. 原来的内联函数没有被调用, 不会生成代码.
+ *          core_cm4.h用双引号包含同目录下的cmsis_compiler.h, 所以由Makefile
+ *          用-include在最前面包含本文件
+ */
+
+#ifndef __HOST_CMSIS_COMPILER_H
+#define __HOST_CMSIS_COMPILER_H
+
+#include_next "cmsis_compiler.h"
+
+#include <stdint.h>
+
+void host_disable_irq(void);
+void host_enable_irq(void);
+uint32_t host_get_primask(void);
+void host_set_primask(uint32_t primask);
+
+#define __disable_irq()     host_disable_irq()
+#define __enable_irq()      host_enable_irq()
+#define __get_PRIMASK()     host_get_primask()
+#define __set_PRIMASK(x)    host_set_primask(x)
+#define __get_IPSR()        (0U)
+#define __DSB()             __COMPILER_BARRIER()
+#define __ISB()             __COMPILER_BARRIER()
+#define __DMB()             __COMPILER_BARRIER()
+/* 这两个在cmsis_gcc.h中是宏 */
+#undef __NOP
+#undef __WFI
+#define __NOP()             __COMPILER_BARRIER()
+#define __WFI()             __COMPILER_BARRIER()
+
+#endif /* __HOST_CMSIS_COMPILER_H */
@@ -0,0 +1,169 @@
+/**
+ * @file    host.c
+ * @author  Deadline039
+ * @brief   主机测试运行环境
+ * @version 1.0
+ * @date    2026-10-17
+ * @note    在芯片的地址上映射内部Flash, 外设寄存器区和内核外设区,
+ *          固件里直接访问寄存器或BKPSRAM的代码可以原样运行.
+ *          HAL函数都是弱定义, 测试需要模拟硬件行为时重新定义
+ */
+
+#include "test.h"
+
+#include "stm32f4xx_hal.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+
+/* 内部Flash, 2MB */
+#define HOST_FLASH_BASE 0x08000000UL
+#define HOST_FLASH_SIZE 0x00200000UL
+/* APB1到AHB2 */
+#define HOST_PERIPH_SIZE 0x10100000UL
+/* 内核外设 */
+#define HOST_SCS_BASE 0xE0000000UL
+#define HOST_SCS_SIZE 0x00100000UL
+
+uint32_t test_failed;
+volatile uint32_t host_tick;
+static uint32_t host_primask;
+
+/**
+ * @brief 在固定地址映射一块内存
+ *
+ * @param base 地址
+ * @param size 大小
+ * @param fill 填充值
+ */
+static void host_map(uintptr_t base, size_t size, uint8_t fill) {
+    void *p = mmap((void *)base, size, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE |
+                       MAP_NORESERVE,
+                   -1, 0);
+
+    if (p != (void *)base) {
+        printf("Cannot map 0x%08lX. \r\n", (unsigned long)base);
+        exit(2);
+    }
+    if (fill != 0x00) {
+        memset(p, fill, size);
+    }
+}
+
+/**
+ * @brief 在main之前映射地址空间
+ *
+ */
+__attribute__((constructor)) static void host_init(void) {
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    host_map(HOST_FLASH_BASE, HOST_FLASH_SIZE, 0xFF);
+    host_map(PERIPH_BASE, HOST_PERIPH_SIZE, 0x00);
+    host_map(HOST_SCS_BASE, HOST_SCS_SIZE, 0x00);
+}
+
+/**
+ * @brief 打印测试结果
+ *
+ * @param name 测试名
+ * @return 进程返回值, 0表示通过
+ */
+int test_report(const char *name) {
+    printf("%s: %s (%u failed)\r\n", name, test_failed ? "FAIL" : "PASS",
+           (unsigned int)test_failed);
+    return test_failed ? 1 : 0;
+}
+
+/**
+ * @brief 主机周期计数
+ *
+ * @return x86上为TSC, 其它平台为纳秒
+ */
+uint64_t host_cycles(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    return __builtin_ia32_rdtsc();
+#else  /* __x86_64__ */
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+#endif /* __x86_64__ */
+}
+
+/**
+ * @brief 可重复的伪随机数, xorshift32
+ *
+ * @param seed 种子, 不能为0
+ * @return 随机数
+ */
+uint32_t host_rand(uint32_t *seed) {
+    uint32_t x = *seed;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *seed = x;
+    return x;
+}
+
+/**
+ * @brief 开中断, 关中断期间挂起的中断在这里执行
+ *
+ */
+__weak void host_irq_unmasked(void) {
+}
+
+void host_disable_irq(void) {
+    host_primask = 1;
+}
+
+void host_enable_irq(void) {
+    host_primask = 0;
+    host_irq_unmasked();
+}
+
+uint32_t host_get_primask(void) {
+    return host_primask;
+}
+
+void host_set_primask(uint32_t primask) {
+    host_primask = primask;
+    if (primask == 0) {
+        host_irq_unmasked();
+    }
+}
+
+__weak uint32_t HAL_GetTick(void) {
+    return host_tick;
+}
+
+__weak void HAL_Delay(uint32_t delay) {
+    host_tick += delay;
+}
+
+__weak void HAL_GPIO_Init(GPIO_TypeDef *port, GPIO_InitTypeDef *init) {
+    UNUSED(port);
+    UNUSED(init);
+}
+
+__weak void HAL_GPIO_WritePin(GPIO_TypeDef *port, uint16_t pin,
+                              GPIO_PinState state) {
+    if (state == GPIO_PIN_SET) {
+        port->ODR |= pin;
+    } else {
+        port->ODR &= ~(uint32_t)pin;
+    }
+}
+
+__weak GPIO_PinState HAL_GPIO_ReadPin(GPIO_TypeDef *port, uint16_t pin) {
+    return (port->IDR & pin) ? GPIO_PIN_SET : GPIO_PIN_RESET;
+}
+
+__weak void HAL_PWR_EnableBkUpAccess(void) {
+}
+
+__weak HAL_StatusTypeDef HAL_PWREx_EnableBkUpReg(void) {
+    return HAL_OK;
+}
@@ -0,0 +1,626 @@
+/**
+ * @file    w25q_sim.c
+ * @author  Deadline039
+ * @brief   主机测试的W25Qxx模拟器
+ * @version 1.0
+ * @date    2026-10-17
+ * @note    代替spi_bus.c, 每个事务按片选找到芯片, 解码W25Qxx的命令.
+ *          芯片内容存放在文件中(MAP_SHARED), fork出的进程看到同一份内容,
+ *          出错时可以保留文件检查.
+ *
+ *          时间只由SPI传输和`w25q_sim_advance`推进: 每个事务加上固定开销和
+ *          按SPI时钟计算的传输时间. 编程和擦除发出时立即修改内容, 到时间后
+ *          芯片才空闲; 忙时只接受读状态寄存器和暂停擦除, 其他命令记为违例.
+ *
+ *          掉电: 第N个事务执行前掉电, 正在进行的编程只清除了一部分位,
+ *          正在进行的擦除只有一部分字节变为0xFF, 其余字节随机置1,
+ *          完成的比例按已经过的时间计算. 之后longjmp回到测试.
+ *
+ *          所有事务都立即执行, DMA读取在提交时完成并调用回调.
+ *          在`w25q_sim_command_callback`中调用`spi_bus_abort`时, 当前事务
+ *          被结束, 编程命令只写入随机长度的前一部分
+ */
+
+#include "test.h"
+#include "w25q_sim.h"
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+/* W25Qxx命令 */
+#define SIM_CMD_WRITE_ENABLE  0x06
+#define SIM_CMD_READ_SR1      0x05
+#define SIM_CMD_READ_SR2      0x35
+#define SIM_CMD_READ_SR3      0x15
+#define SIM_CMD_READ_DATA     0x03
+#define SIM_CMD_PAGE_PROGRAM  0x02
+#define SIM_CMD_SECTOR_ERASE  0x20
+#define SIM_CMD_ERASE_SUSPEND 0x75
+#define SIM_CMD_RELEASE_PD    0xAB
+#define SIM_CMD_DEVICE_ID     0x90
+#define SIM_CMD_ENABLE_4BYTE  0xB7
+
+/* 芯片正在进行的操作 */
+#define SIM_OP_NONE           0
+#define SIM_OP_PROGRAM        1
+#define SIM_OP_ERASE          2
+#define SIM_OP_SUSPEND        3
+
+/**
+ * @brief 一片模拟的芯片
+ */
+typedef struct {
+    GPIO_TypeDef *cs_port; /*!< 片选端口, NULL表示未使用 */
+    uint16_t cs_pin;       /*!< 片选引脚 */
+    uint16_t id;           /*!< 芯片ID */
+    uint32_t capacity;     /*!< 容量(byte) */
+    uint8_t *mem;          /*!< 芯片内容 */
+    int fd;                /*!< 文件, -1表示匿名共享内存 */
+    char path[256];        /*!< 文件路径 */
+
+    uint8_t wel; /*!< 写使能 */
+    uint8_t ads; /*!< 4字节地址模式 */
+    uint8_t sus; /*!< 擦除已暂停 */
+
+    uint8_t op;        /*!< 正在进行的操作 */
+    uint32_t op_addr;  /*!< 操作的起始地址 */
+    uint32_t op_len;   /*!< 操作的长度 */
+    uint64_t op_start; /*!< 开始时间 */
+    uint64_t op_end;   /*!< 结束时间 */
+    uint8_t pre[W25QXX_SECTOR_SIZE]; /*!< 操作前的内容 */
+} sim_chip_t;
+
+/* 模拟时间(ns) */
+uint64_t w25q_sim_time;
+/* SPI时钟(Hz) */
+uint32_t w25q_sim_clock = 22500000;
+/* 掉电和结束编程时的随机数种子 */
+uint32_t w25q_sim_seed = 0x25512345;
+w25q_sim_stats_t w25q_sim_stats;
+
+static sim_chip_t sim_chip[W25Q_SIM_CHIP_NUM];
+
+/* 掉电倒计数, 0为不掉电 */
+static uint32_t sim_countdown;
+static jmp_buf *sim_cut_env;
+
+/* 正在执行命令回调的事务, 和它是否被结束 */
+static spi_trans_t *sim_current;
+static uint8_t sim_aborted;
+
+/**
+ * @brief 挂上一片芯片
+ *
+ * @param chip 芯片序号
+ * @param cs_port 片选端口
+ * @param cs_pin 片选引脚
+ * @param id 芯片ID, `W25Q16` ~ `W25Q256`
+ * @param path 存放内容的文件, NULL时用匿名共享内存
+ * @return 0-成功, 1-失败
+ * @note 内容初始化为全0xFF
+ */
+uint8_t w25q_sim_attach(uint32_t chip, GPIO_TypeDef *cs_port, uint16_t cs_pin,
+                        uint16_t id, const char *path) {
+    sim_chip_t *c = &sim_chip[chip];
+    int flags = MAP_SHARED;
+
+    memset(c, 0, sizeof(*c));
+    c->id = id;
+    c->capacity = 1UL << ((id & 0xFF) + 1);
+    c->fd = -1;
+
+    if (path != NULL) {
+        snprintf(c->path, sizeof(c->path), "%s", path);
+        c->fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if ((c->fd < 0) || (ftruncate(c->fd, c->capacity) != 0)) {
+            printf("Cannot create %s. \r\n", path);
+            return 1;
+        }
+    } else {
+        flags |= MAP_ANONYMOUS;
+    }
+
+    c->mem = mmap(NULL, c->capacity, PROT_READ | PROT_WRITE, flags, c->fd, 0);
+    if (c->mem == MAP_FAILED) {
+        printf("Cannot map chip %u. \r\n", (unsigned int)chip);
+        return 1;
+    }
+    memset(c->mem, 0xFF, c->capacity);
+
+    c->cs_port = cs_port;
+    c->cs_pin = cs_pin;
+    return 0;
+}
+
+/**
+ * @brief 取下芯片
+ *
+ * @param chip 芯片序号
+ * @param keep 是否保留文件
+ */
+void w25q_sim_detach(uint32_t chip, uint8_t keep) {
+    sim_chip_t *c = &sim_chip[chip];
+
+    if (c->cs_port == NULL) {
+        return;
+    }
+
+    munmap(c->mem, c->capacity);
+    if (c->fd >= 0) {
+        close(c->fd);
+        if (!keep) {
+            unlink(c->path);
+        }
+    }
+    c->cs_port = NULL;
+}
+
+/**
+ * @brief 芯片内容
+ *
+ * @param chip 芯片序号
+ * @return 内容, 按地址排列
+ */
+uint8_t *w25q_sim_data(uint32_t chip) {
+    return sim_chip[chip].mem;
+}
+
+/**
+ * @brief 到时间的操作结束
+ *
+ * @param c 芯片
+ */
+static void sim_settle(sim_chip_t *c) {
+    if ((c->op != SIM_OP_NONE) && (w25q_sim_time >= c->op_end)) {
+        if (c->op == SIM_OP_SUSPEND) {
+            c->sus = 1;
+        }
+        c->op = SIM_OP_NONE;
+    }
+}
+
+/**
+ * @brief 推进时间, 模拟CPU不访问Flash的时间
+ *
+ * @param ns 时间(ns)
+ */
+void w25q_sim_advance(uint64_t ns) {
+    w25q_sim_time += ns;
+}
+
+/**
+ * @brief 芯片是否正在编程或擦除, 不产生SPI传输
+ *
+ * @param chip 芯片序号
+ * @return 0-空闲, 1-忙
+ */
+uint8_t w25q_sim_busy(uint32_t chip) {
+    sim_settle(&sim_chip[chip]);
+    return sim_chip[chip].op != SIM_OP_NONE;
+}
+
+/**
+ * @brief 随机清除一部分要清除的位, 或随机置位, 模拟没有完成的操作
+ *
+ * @param c 芯片
+ * @param done 完成的比例, 0 ~ 65536
+ * @note 每个字节以完成的比例变为目标值, 否则编程时只清除部分位,
+ *       擦除时在原内容上随机置位
+ */
+static void sim_partial(sim_chip_t *c, uint32_t done) {
+    uint8_t *mem = c->mem + c->op_addr;
+    uint8_t rnd;
+
+    for (uint32_t i = 0; i < c->op_len; ++i) {
+        if ((host_rand(&w25q_sim_seed) & 0xFFFF) < done) {
+            continue;
+        }
+        rnd = (uint8_t)host_rand(&w25q_sim_seed);
+        if (c->op == SIM_OP_PROGRAM) {
+            mem[i] = c->pre[i] & (mem[i] | rnd);
+        } else {
+            mem[i] = c->pre[i] | rnd;
+        }
+    }
+}
+
+/**
+ * @brief 已经过的时间占操作时间的比例
+ *
+ * @param c 芯片
+ * @return 0 ~ 65536
+ */
+static uint32_t sim_progress(sim_chip_t *c) {
+    if (w25q_sim_time >= c->op_end) {
+        return 65536;
+    }
+    return (uint32_t)((w25q_sim_time - c->op_start) * 65536 /
+                      (c->op_end - c->op_start));
+}
+
+/**
+ * @brief 设置掉电位置
+ *
+ * @param n 再执行几个事务后掉电, 第n个事务不执行; 0为不掉电
+ * @param env 掉电后longjmp的位置
+ * @return 之前剩余的事务数, 用来暂停后恢复
+ */
+uint32_t w25q_sim_cut_at(uint32_t n, jmp_buf *env) {
+    uint32_t left = sim_countdown;
+
+    sim_countdown = n;
+    if (env != NULL) {
+        sim_cut_env = env;
+    }
+    return left;
+}
+
+/**
+ * @brief 掉电, 正在进行的编程和擦除只完成一部分
+ *
+ * @note 对每个被打断的操作调用`w25q_sim_cut_callback`
+ */
+void w25q_sim_power_off(void) {
+    sim_chip_t *c;
+
+    for (uint32_t i = 0; i < W25Q_SIM_CHIP_NUM; ++i) {
+        c = &sim_chip[i];
+        if (c->cs_port == NULL) {
+            continue;
+        }
+        sim_settle(c);
+        if ((c->op == SIM_OP_PROGRAM) || (c->op == SIM_OP_ERASE)) {
+            sim_partial(c, sim_progress(c));
+            w25q_sim_cut_callback(i, c->op_addr, c->op == SIM_OP_ERASE);
+        }
+        c->op = SIM_OP_NONE;
+    }
+    sim_countdown = 0;
+}
+
+/**
+ * @brief 上电, 状态寄存器复位
+ *
+ */
+void w25q_sim_power_on(void) {
+    for (uint32_t i = 0; i < W25Q_SIM_CHIP_NUM; ++i) {
+        sim_chip[i].wel = 0;
+        sim_chip[i].ads = 0;
+        sim_chip[i].sus = 0;
+        sim_chip[i].op = SIM_OP_NONE;
+    }
+    sim_current = NULL;
+    sim_aborted = 0;
+    w25q_sim_time = 0;
+}
+
+/**
+ * @brief 解码地址, 检查地址长度
+ *
+ * @param c 芯片
+ * @param trans 事务
+ * @param[out] addr 地址
+ * @return 0-成功, 1-地址长度和地址模式不符
+ */
+static uint8_t sim_addr(sim_chip_t *c, const spi_trans_t *trans,
+                        uint32_t *addr) {
+    uint32_t len = (c->ads ? 4 : 3);
+
+    if (trans->cmd_len != len + 1) {
+        w25q_sim_stats.violations++;
+        return 1;
+    }
+
+    *addr = 0;
+    for (uint32_t i = 1; i <= len; ++i) {
+        *addr = (*addr << 8) | trans->cmd[i];
+    }
+    *addr %= c->capacity;
+    return 0;
+}
+
+/**
+ * @brief 开始编程或擦除, 保存操作前的内容
+ *
+ * @param c 芯片
+ * @param op 操作
+ * @param addr 地址
+ * @param len 长度
+ * @param time 操作时间
+ */
+static void sim_begin(sim_chip_t *c, uint8_t op, uint32_t addr, uint32_t len,
+                      uint64_t time) {
+    c->op = op;
+    c->op_addr = addr;
+    c->op_len = len;
+    c->op_start = w25q_sim_time;
+    c->op_end = w25q_sim_time + time;
+    c->wel = 0;
+    memcpy(c->pre, c->mem + addr, len);
+}
+
+/**
+ * @brief 页编程
+ *
+ * @param chip 芯片序号
+ * @param trans 事务
+ * @param len 片选拉高前收到的数据长度
+ */
+static void sim_program(uint32_t chip, const spi_trans_t *trans, uint32_t len) {
+    sim_chip_t *c = &sim_chip[chip];
+    const uint8_t *data = (const uint8_t *)trans->tx_data;
+    uint32_t addr;
+
+    if ((c->op != SIM_OP_NONE) || !c->wel || (sim_addr(c, trans, &addr) != 0) ||
+        (trans->data_len > W25QXX_PAGE_SIZE - addr % W25QXX_PAGE_SIZE)) {
+        w25q_sim_stats.violations++;
+        return;
+    }
+    if (len == 0) {
+        c->wel = 0;
+        return;
+    }
+
+    sim_begin(c, SIM_OP_PROGRAM, addr, len, W25Q_SIM_T_PP);
+    for (uint32_t i = 0; i < len; ++i) {
+        c->mem[addr + i] &= data[i];
+    }
+    w25q_sim_stats.programs++;
+    w25q_sim_program_callback(chip, addr, data, len);
+}
+
+/**
+ * @brief 执行一个事务
+ *
+ * @param chip 芯片序号
+ * @param trans 事务
+ */
+static void sim_execute(uint32_t chip, spi_trans_t *trans) {
+    sim_chip_t *c = &sim_chip[chip];
+    uint8_t *rx = (uint8_t *)trans->rx_data;
+    uint8_t busy = (c->op != SIM_OP_NONE);
+    uint8_t value = 0xFF;
+    uint32_t addr;
+
+    switch (trans->cmd[0]) {
+        case SIM_CMD_READ_SR1: {
+            value = (uint8_t)(busy | (c->wel << 1));
+            w25q_sim_stats.polls++;
+        } break;
+
+        case SIM_CMD_READ_SR2: {
+            value = (uint8_t)(c->sus << 7);
+        } break;
+
+        case SIM_CMD_READ_SR3: {
+            value = c->ads;
+        } break;
+
+        case SIM_CMD_DEVICE_ID: {
+            if (rx != NULL) {
+                for (uint32_t i = 0; i < trans->data_len; ++i) {
+                    rx[i] = (i % 2) ? (uint8_t)c->id : (uint8_t)(c->id >> 8);
+                }
+            }
+            return;
+        }
+
+        case SIM_CMD_ERASE_SUSPEND: {
+            if (c->op == SIM_OP_ERASE) {
+                /* 擦除停在当前的进度, 暂停生效前芯片仍然忙 */
+                sim_partial(c, sim_progress(c));
+                c->op = SIM_OP_SUSPEND;
+                c->op_end = w25q_sim_time + W25Q_SIM_T_SUS;
+                w25q_sim_stats.suspends++;
+            }
+        } break;
+
+        case SIM_CMD_RELEASE_PD: {
+        } break;
+
+        case SIM_CMD_WRITE_ENABLE: {
+            if (busy) {
+                w25q_sim_stats.violations++;
+            } else {
+                c->wel = 1;
+            }
+        } break;
+
+        case SIM_CMD_ENABLE_4BYTE: {
+            if (busy || (c->id != W25Q256)) {
+                w25q_sim_stats.violations++;
+            } else {
+                c->ads = 1;
+            }
+        } break;
+
+        case SIM_CMD_READ_DATA: {
+            if (busy || (sim_addr(c, trans, &addr) != 0)) {
+                w25q_sim_stats.violations++;
+                break;
+            }
+            for (uint32_t i = 0; (rx != NULL) && (i < trans->data_len); ++i) {
+                rx[i] = c->mem[(addr + i) % c->capacity];
+            }
+        } break;
+
+        case SIM_CMD_PAGE_PROGRAM: {
+            sim_program(chip, trans, trans->data_len);
+        } break;
+
+        case SIM_CMD_SECTOR_ERASE: {
+            if (busy || c->sus || !c->wel ||
+                (sim_addr(c, trans, &addr) != 0)) {
+                w25q_sim_stats.violations++;
+                break;
+            }
+            addr &= ~(W25QXX_SECTOR_SIZE - 1);
+            sim_begin(c, SIM_OP_ERASE, addr, W25QXX_SECTOR_SIZE,
+                      W25Q_SIM_T_SE);
+            memset(c->mem + addr, 0xFF, W25QXX_SECTOR_SIZE);
+            w25q_sim_stats.erases++;
+            w25q_sim_erase_callback(chip, addr);
+        } break;
+
+        default: {
+            w25q_sim_stats.violations++;
+        } break;
+    }
+
+    /* 读寄存器的命令持续输出寄存器的值 */
+    if ((trans->cmd[0] != SIM_CMD_READ_DATA) && (rx != NULL)) {
+        memset(rx, value, trans->data_len);
+    }
+}
+
+/**
+ * @brief 执行一个事务, 推进时间, 到达掉电位置时掉电
+ *
+ * @param trans 事务
+ */
+static void sim_transfer(spi_trans_t *trans) {
+    spi_trans_t *outer = sim_current;
+    uint8_t outer_aborted = sim_aborted;
+    uint8_t aborted;
+    uint32_t chip;
+
+    if ((sim_countdown != 0) && (--sim_countdown == 0)) {
+        w25q_sim_power_off();
+        longjmp(*sim_cut_env, 1);
+    }
+
+    /* 回调中可能发起新的事务, 模拟中断打断当前事务 */
+    sim_current = trans;
+    sim_aborted = 0;
+    w25q_sim_command_callback(trans);
+    aborted = sim_aborted;
+    sim_current = outer;
+    sim_aborted = outer_aborted;
+    if (aborted) {
+        return;
+    }
+
+    w25q_sim_time += W25Q_SIM_T_TRANS +
+                     (uint64_t)(trans->cmd_len + trans->data_len) * 8 *
+                         1000000000ULL / w25q_sim_clock;
+    w25q_sim_stats.commands++;
+    w25q_sim_stats.bytes += trans->cmd_len + trans->data_len;
+
+    for (chip = 0; chip < W25Q_SIM_CHIP_NUM; ++chip) {
+        if ((sim_chip[chip].cs_port == trans->cs_port) &&
+            (sim_chip[chip].cs_pin == trans->cs_pin)) {
+            break;
+        }
+    }
+    if (chip == W25Q_SIM_CHIP_NUM) {
+        /* 总线上的其他设备 */
+        if (trans->rx_data != NULL) {
+            memset(trans->rx_data, 0xFF, trans->data_len);
+        }
+        return;
+    }
+
+    sim_settle(&sim_chip[chip]);
+    sim_execute(chip, trans);
+}
+
+uint8_t spi_bus_submit(spi_bus_t *bus, spi_trans_t *trans) {
+    UNUSED(bus);
+
+    if ((trans->state == SPI_TRANS_QUEUED) ||
+        (trans->state == SPI_TRANS_RUNNING)) {
+        return 1;
+    }
+
+    trans->state = SPI_TRANS_RUNNING;
+    sim_transfer(trans);
+    if (trans->state == SPI_TRANS_RUNNING) {
+        trans->state = SPI_TRANS_DONE;
+    }
+    if ((trans->state == SPI_TRANS_DONE) && (trans->callback != NULL)) {
+        trans->callback(trans);
+    }
+
+    return 0;
+}
+
+uint8_t spi_bus_transfer(spi_bus_t *bus, spi_trans_t *trans) {
+    if (spi_bus_submit(bus, trans) != 0) {
+        return 1;
+    }
+    return (trans->state == SPI_TRANS_DONE) ? 0 : 1;
+}
+
+/**
+ * @brief 结束当前事务
+ *
+ * @param bus 总线
+ * @note 只在命令回调中有效. 页编程已收到的数据长度随机, 芯片仍然编程
+ *       这一部分
+ */
+void spi_bus_abort(spi_bus_t *bus) {
+    spi_trans_t *trans = sim_current;
+    uint32_t chip;
+
+    UNUSED(bus);
+
+    if ((trans == NULL) || sim_aborted) {
+        return;
+    }
+    sim_aborted = 1;
+    trans->state = SPI_TRANS_ERROR;
+
+    if ((trans->cmd[0] != SIM_CMD_PAGE_PROGRAM) || (trans->data_len == 0)) {
+        return;
+    }
+    for (chip = 0; chip < W25Q_SIM_CHIP_NUM; ++chip) {
+        if ((sim_chip[chip].cs_port == trans->cs_port) &&
+            (sim_chip[chip].cs_pin == trans->cs_pin)) {
+            sim_settle(&sim_chip[chip]);
+            sim_program(chip, trans,
+                        host_rand(&w25q_sim_seed) % (trans->data_len + 1));
+            w25q_sim_stats.aborts++;
+            break;
+        }
+    }
+}
+
+void spi_bus_get_stats(spi_bus_t *bus, spi_bus_stats_t *stats) {
+    UNUSED(bus);
+
+    memset(stats, 0, sizeof(*stats));
+    stats->trans = (uint32_t)w25q_sim_stats.commands;
+}
+
+uint32_t spi_get_clock(SPI_HandleTypeDef *hspi) {
+    UNUSED(hspi);
+
+    return w25q_sim_clock;
+}
+
+__weak void w25q_sim_program_callback(uint32_t chip, uint32_t addr,
+                                      const uint8_t *data, uint32_t len) {
+    UNUSED(chip);
+    UNUSED(addr);
+    UNUSED(data);
+    UNUSED(len);
+}
+
+__weak void w25q_sim_erase_callback(uint32_t chip, uint32_t addr) {
+    UNUSED(chip);
+    UNUSED(addr);
+}
+
+__weak void w25q_sim_cut_callback(uint32_t chip, uint32_t addr,
+                                  uint8_t erase) {
+    UNUSED(chip);
+    UNUSED(addr);
+    UNUSED(erase);
+}
+
+__weak void w25q_sim_command_callback(spi_trans_t *trans) {
+    UNUSED(trans);
+}
@@ -0,0 +1,62 @@
+/**
+ * @file    w25q_sim.h
+ * @author  Deadline039
+ * @brief   主机测试的W25Qxx模拟器
+ * @version 1.0
+ * @date    2026-10-17
+ */
+
+#ifndef __W25Q_SIM_H
+#define __W25Q_SIM_H
+
+#include "w25qxx.h"
+
+#include <setjmp.h>
+
+/* 最多模拟的芯片数 */
+#define W25Q_SIM_CHIP_NUM 2
+
+/* 时序(ns), 数据手册的典型值 */
+#define W25Q_SIM_T_PP     700000ULL   /* 页编程 */
+#define W25Q_SIM_T_SE     45000000ULL /* 扇区擦除 */
+#define W25Q_SIM_T_SUS    20000ULL    /* 暂停擦除生效 */
+#define W25Q_SIM_T_TRANS  2000ULL     /* 每个事务的片选和软件开销 */
+
+/**
+ * @brief 模拟器统计
+ */
+typedef struct {
+    uint64_t commands;   /*!< 执行的事务数 */
+    uint64_t bytes;      /*!< 传输的字节数 */
+    uint64_t polls;      /*!< 读状态寄存器次数 */
+    uint64_t programs;   /*!< 页编程次数 */
+    uint64_t erases;     /*!< 扇区擦除次数 */
+    uint64_t suspends;   /*!< 暂停擦除次数 */
+    uint64_t aborts;     /*!< 被结束的编程 */
+    uint64_t violations; /*!< 芯片忙或没有写使能时的命令, 地址长度错误等 */
+} w25q_sim_stats_t;
+
+extern uint64_t w25q_sim_time;
+extern uint32_t w25q_sim_clock;
+extern uint32_t w25q_sim_seed;
+extern w25q_sim_stats_t w25q_sim_stats;
+
+uint8_t w25q_sim_attach(uint32_t chip, GPIO_TypeDef *cs_port, uint16_t cs_pin,
+                        uint16_t id, const char *path);
+void w25q_sim_detach(uint32_t chip, uint8_t keep);
+uint8_t *w25q_sim_data(uint32_t chip);
+
+void w25q_sim_advance(uint64_t ns);
+uint8_t w25q_sim_busy(uint32_t chip);
+
+uint32_t w25q_sim_cut_at(uint32_t n, jmp_buf *env);
+void w25q_sim_power_off(void);
+void w25q_sim_power_on(void);
+
+void w25q_sim_program_callback(uint32_t chip, uint32_t addr,
+                               const uint8_t *data, uint32_t len);
+void w25q_sim_erase_callback(uint32_t chip, uint32_t addr);
+void w25q_sim_cut_callback(uint32_t chip, uint32_t addr, uint8_t erase);
+void w25q_sim_command_callback(spi_trans_t *trans);
+
+#endif /* __W25Q_SIM_H */
@@ -0,0 +1,39 @@
+/**
+ * @file    test.h
+ * @author  Deadline039
+ * @brief   主机测试公共定义
+ * @version 1.0
+ * @date    2026-10-17
+ * @note    测试在PC上用gcc编译, 与固件使用同一份源文件. 内部Flash,
+ *          外设寄存器区和内核外设区由`stub/host.c`映射到与芯片相同的地址,
+ *          HAL函数由弱定义的桩函数代替, 测试可以重新定义
+ */
+
+#ifndef __TEST_H
+#define __TEST_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+/**
+ * @brief 检查条件, 不满足时打印位置和信息, 记一次失败
+ */
+#define TEST_CHECK(cond, ...)                                                 \
+    do {                                                                      \
+        if (!(cond)) {                                                        \
+            printf("%s:%d: ", __FILE__, __LINE__);                            \
+            printf(__VA_ARGS__);                                              \
+            printf("\r\n");                                                   \
+            ++test_failed;                                                    \
+        }                                                                     \
+    } while (0)
+
+extern uint32_t test_failed;
+extern volatile uint32_t host_tick;
+
+int test_report(const char *name);
+uint64_t host_cycles(void);
+uint32_t host_rand(uint32_t *seed);
+void host_irq_unmasked(void);
+
+#endif /* __TEST_H */
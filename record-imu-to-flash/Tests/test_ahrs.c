@@ -0,0 +1,377 @@
+/**
+ * @file    test_ahrs.c
+ * @author  Deadline039
+ * @brief   姿态解算的主机测试
+ * @version 1.0
+ * @date    2026-10-17
+ * @note    固件的单精度实现与同一算法的双精度参考实现输入相同的采样,
+ *          比较两者的姿态差, 以及与真实姿态的误差, 并统计每次更新的周期数.
+ *          默认用合成的数据: 已知的角速度积分出真实姿态, 由此生成带噪声的
+ *          陀螺仪, 加速度计和磁力计原始值. 也可以给出记录的数据文件,
+ *          每行为时间(us)和加速度, 角速度, 磁场的9个原始值, 此时只比较
+ *          单精度与双精度
+ */
+
+#include "test.h"
+
+#include "ahrs.h"
+#include "calib.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+/* 合成数据的时长(s) */
+#define TEST_TIME     120
+/* 收敛时间(s), 之后才统计与真实姿态的误差 */
+#define TEST_SETTLE   5
+/* 单精度与双精度的最大姿态差(度) */
+#define TEST_MAX_DIFF 0.01
+/* 与真实姿态的最大误差(度) */
+#define TEST_MAX_ERR  3.0
+
+/* 原始值的量程, 与ahrs.c相同 */
+#define GYRO_SCALE  ((250 << MPU9250_GYRO_FS) / 32768.0 * M_PI / 180.0)
+#define ACCEL_SCALE (16384 >> MPU9250_ACCEL_FS)
+#define MAG_RADIUS  330.0
+
+static uint32_t seed = 0x0A450065;
+
+uint8_t eeprom_read(uint16_t key, void *buf, uint16_t len) {
+    return 1;
+}
+
+uint8_t eeprom_write(uint16_t key, const void *data, uint16_t len) {
+    return 0;
+}
+
+uint8_t recorder_write(uint8_t type, uint8_t channel, const void *data,
+                       uint32_t len) {
+    return 0;
+}
+
+/**
+ * @brief 双精度参考实现
+ */
+static struct {
+    double q[4];
+    double integral[3];
+    uint32_t last_time;
+    uint8_t started;
+} ref;
+
+/**
+ * @brief 标准正态分布
+ */
+static double gauss(void) {
+    double u = ((host_rand(&seed) >> 8) + 1.0) / 16777217.0;
+    double v = (host_rand(&seed) >> 8) / 16777216.0;
+
+    return sqrt(-2.0 * log(u)) * cos(2.0 * M_PI * v);
+}
+
+/**
+ * @brief 归一化向量
+ */
+static void normalize(double *v, uint32_t n) {
+    double norm = 0.0;
+
+    for (uint32_t i = 0; i < n; ++i) {
+        norm += v[i] * v[i];
+    }
+    norm = sqrt(norm);
+    for (uint32_t i = 0; i < n; ++i) {
+        v[i] /= norm;
+    }
+}
+
+#if (AHRS_ALGORITHM == 0)
+
+/**
+ * @brief Mahony更新, 与ahrs.c的公式相同
+ */
+static void ref_filter(double g[3], double a[3], const double m[3],
+                       double dt) {
+    double *q = ref.q, e[3], v[3];
+    double q0 = q[0], q1 = q[1], q2 = q[2], q3 = q[3];
+
+    normalize(a, 3);
+    v[0] = q1 * q3 - q0 * q2;
+    v[1] = q0 * q1 + q2 * q3;
+    v[2] = q0 * q0 - 0.5 + q3 * q3;
+    e[0] = a[1] * v[2] - a[2] * v[1];
+    e[1] = a[2] * v[0] - a[0] * v[2];
+    e[2] = a[0] * v[1] - a[1] * v[0];
+
+    if (m != NULL) {
+        double mm[3] = {m[0], m[1], m[2]}, hx, hy, bx, bz, w[3];
+
+        normalize(mm, 3);
+        hx = 2.0 * (mm[0] * (0.5 - q2 * q2 - q3 * q3) +
+                    mm[1] * (q1 * q2 - q0 * q3) + mm[2] * (q1 * q3 + q0 * q2));
+        hy = 2.0 * (mm[0] * (q1 * q2 + q0 * q3) +
+                    mm[1] * (0.5 - q1 * q1 - q3 * q3) +
+                    mm[2] * (q2 * q3 - q0 * q1));
+        bz = 2.0 * (mm[0] * (q1 * q3 - q0 * q2) + mm[1] * (q2 * q3 + q0 * q1) +
+                    mm[2] * (0.5 - q1 * q1 - q2 * q2));
+        bx = sqrt(hx * hx + hy * hy);
+
+        w[0] = bx * (0.5 - q2 * q2 - q3 * q3) + bz * (q1 * q3 - q0 * q2);
+        w[1] = bx * (q1 * q2 - q0 * q3) + bz * (q0 * q1 + q2 * q3);
+        w[2] = bx * (q0 * q2 + q1 * q3) + bz * (0.5 - q1 * q1 - q2 * q2);
+        e[0] += mm[1] * w[2] - mm[2] * w[1];
+        e[1] += mm[2] * w[0] - mm[0] * w[2];
+        e[2] += mm[0] * w[1] - mm[1] * w[0];
+    }
+
+    for (uint32_t i = 0; i < 3; ++i) {
+        ref.integral[i] += 2.0 * AHRS_MAHONY_KI / 1000.0 * e[i] * dt;
+        g[i] += ref.integral[i] + 2.0 * AHRS_MAHONY_KP / 100.0 * e[i];
+        g[i] *= 0.5 * dt;
+    }
+    q[0] = q0 + (-q1 * g[0] - q2 * g[1] - q3 * g[2]);
+    q[1] = q1 + (q0 * g[0] + q2 * g[2] - q3 * g[1]);
+    q[2] = q2 + (q0 * g[1] - q1 * g[2] + q3 * g[0]);
+    q[3] = q3 + (q0 * g[2] + q1 * g[1] - q2 * g[0]);
+}
+
+#else  /* AHRS_ALGORITHM == 0 */
+
+/**
+ * @brief Madgwick更新, 与ahrs.c的公式相同
+ */
+static void ref_filter(double g[3], double a[3], const double m[3],
+                       double dt) {
+    double *q = ref.q, d[4], s[4], ea[3];
+    double q0 = q[0], q1 = q[1], q2 = q[2], q3 = q[3];
+
+    d[0] = 0.5 * (-q1 * g[0] - q2 * g[1] - q3 * g[2]);
+    d[1] = 0.5 * (q0 * g[0] + q2 * g[2] - q3 * g[1]);
+    d[2] = 0.5 * (q0 * g[1] - q1 * g[2] + q3 * g[0]);
+    d[3] = 0.5 * (q0 * g[2] + q1 * g[1] - q2 * g[0]);
+
+    normalize(a, 3);
+    ea[0] = 2.0 * (q1 * q3 - q0 * q2) - a[0];
+    ea[1] = 2.0 * (q0 * q1 + q2 * q3) - a[1];
+    ea[2] = 1.0 - 2.0 * (q1 * q1 + q2 * q2) - a[2];
+    s[0] = -2.0 * q2 * ea[0] + 2.0 * q1 * ea[1];
+    s[1] = 2.0 * q3 * ea[0] + 2.0 * q0 * ea[1] - 4.0 * q1 * ea[2];
+    s[2] = -2.0 * q0 * ea[0] + 2.0 * q3 * ea[1] - 4.0 * q2 * ea[2];
+    s[3] = 2.0 * q1 * ea[0] + 2.0 * q2 * ea[1];
+
+    if (m != NULL) {
+        double mm[3] = {m[0], m[1], m[2]}, hx, hy, bx, bz, em[3];
+
+        normalize(mm, 3);
+        hx = 2.0 * (mm[0] * (0.5 - q2 * q2 - q3 * q3) +
+                    mm[1] * (q1 * q2 - q0 * q3) + mm[2] * (q1 * q3 + q0 * q2));
+        hy = 2.0 * (mm[0] * (q1 * q2 + q0 * q3) +
+                    mm[1] * (0.5 - q1 * q1 - q3 * q3) +
+                    mm[2] * (q2 * q3 - q0 * q1));
+        bz = 2.0 * (mm[0] * (q1 * q3 - q0 * q2) + mm[1] * (q2 * q3 + q0 * q1) +
+                    mm[2] * (0.5 - q1 * q1 - q2 * q2));
+        bx = sqrt(hx * hx + hy * hy);
+
+        em[0] = bx * (0.5 - q2 * q2 - q3 * q3) + bz * (q1 * q3 - q0 * q2) -
+                mm[0];
+        em[1] = bx * (q1 * q2 - q0 * q3) + bz * (q0 * q1 + q2 * q3) - mm[1];
+        em[2] = bx * (q0 * q2 + q1 * q3) + bz * (0.5 - q1 * q1 - q2 * q2) -
+                mm[2];
+        s[0] += -bz * q2 * em[0] + (-bx * q3 + bz * q1) * em[1] +
+                bx * q2 * em[2];
+        s[1] += bz * q3 * em[0] + (bx * q2 + bz * q0) * em[1] +
+                (bx * q3 - 2.0 * bz * q1) * em[2];
+        s[2] += (-2.0 * bx * q2 - bz * q0) * em[0] +
+                (bx * q1 + bz * q3) * em[1] + (bx * q0 - 2.0 * bz * q2) * em[2];
+        s[3] += (-2.0 * bx * q3 + bz * q1) * em[0] +
+                (-bx * q0 + bz * q2) * em[1] + bx * q1 * em[2];
+    }
+
+    normalize(s, 4);
+    for (uint32_t i = 0; i < 4; ++i) {
+        q[i] += (d[i] - AHRS_MADGWICK_BETA / 1000.0 * s[i]) * dt;
+    }
+}
+
+#endif /* AHRS_ALGORITHM == 0 */
+
+/**
+ * @brief 参考实现处理一个采样, 与`ahrs_update`相同的预处理
+ */
+static void ref_update(const mpu9250_sample_t *sample) {
+    uint32_t interval = sample->time - ref.last_time;
+    double g[3], a[3], m[3], dt;
+
+    dt = (!ref.started || (sample->flags & MPU9250_FLAG_GAP) ||
+          (interval == 0) || (interval > 100000))
+             ? (1 + MPU9250_SMPLRT_DIV) * 0.001
+             : interval * 1e-6;
+    ref.last_time = sample->time;
+    ref.started = 1;
+
+    for (uint32_t i = 0; i < 3; ++i) {
+        a[i] = sample->accel[i];
+        g[i] = sample->gyro[i] * GYRO_SCALE;
+    }
+    m[0] = sample->mag[1];
+    m[1] = sample->mag[0];
+    m[2] = -sample->mag[2];
+
+    ref_filter(g, a, (AHRS_USE_MAG == 1) ? m : NULL, dt);
+    normalize(ref.q, 4);
+}
+
+/**
+ * @brief 两个姿态之间的转角(度)
+ */
+static double angle(const double a[4], const double b[4]) {
+    double dot = 0.0, na = 0.0, nb = 0.0;
+
+    /* 快速平方根倒数使固件的四元数长度约小5e-6, 先归一化 */
+    for (uint32_t i = 0; i < 4; ++i) {
+        dot += a[i] * b[i];
+        na += a[i] * a[i];
+        nb += b[i] * b[i];
+    }
+    dot = fabs(dot) / sqrt(na * nb);
+
+    return 2.0 * acos(fmin(1.0, dot)) * 180.0 / M_PI;
+}
+
+/**
+ * @brief 用四元数把参考系的向量转到机体系
+ */
+static void to_body(const double q[4], const double v[3], double out[3]) {
+    double q0 = q[0], q1 = q[1], q2 = q[2], q3 = q[3];
+
+    out[0] = (1 - 2 * (q2 * q2 + q3 * q3)) * v[0] +
+             2 * (q1 * q2 + q0 * q3) * v[1] + 2 * (q1 * q3 - q0 * q2) * v[2];
+    out[1] = 2 * (q1 * q2 - q0 * q3) * v[0] +
+             (1 - 2 * (q1 * q1 + q3 * q3)) * v[1] +
+             2 * (q2 * q3 + q0 * q1) * v[2];
+    out[2] = 2 * (q1 * q3 + q0 * q2) * v[0] + 2 * (q2 * q3 - q0 * q1) * v[1] +
+             (1 - 2 * (q1 * q1 + q2 * q2)) * v[2];
+}
+
+/**
+ * @brief 合成一个采样, 真实姿态按角速度积分
+ *
+ * @param n 采样序号
+ * @param truth 真实姿态
+ * @param[out] sample 原始值
+ */
+static void synth(uint32_t n, double truth[4], mpu9250_sample_t *sample) {
+    static const double gravity[3] = {0.0, 0.0, 1.0};
+    static const double field[3] = {0.55, 0.0, -0.83};
+    const double dt = (1 + MPU9250_SMPLRT_DIV) * 0.001;
+    double w[3], a[3], m[3], t = n * dt;
+
+    /* 几个频率的转动叠加, 最大约300dps */
+    w[0] = 2.0 * sin(2.0 * M_PI * 0.31 * t) + 1.5 * sin(2.0 * M_PI * 2.1 * t);
+    w[1] = 1.8 * sin(2.0 * M_PI * 0.17 * t + 1.0) +
+           0.8 * sin(2.0 * M_PI * 3.3 * t);
+    w[2] = 1.2 * sin(2.0 * M_PI * 0.07 * t + 2.0) +
+           1.0 * sin(2.0 * M_PI * 1.3 * t);
+
+    /* 真实姿态以10个子步积分 */
+    for (uint32_t k = 0; k < 10; ++k) {
+        double h = 0.5 * dt / 10.0, q0 = truth[0], q1 = truth[1],
+               q2 = truth[2], q3 = truth[3];
+
+        truth[0] += h * (-q1 * w[0] - q2 * w[1] - q3 * w[2]);
+        truth[1] += h * (q0 * w[0] + q2 * w[2] - q3 * w[1]);
+        truth[2] += h * (q0 * w[1] - q1 * w[2] + q3 * w[0]);
+        truth[3] += h * (q0 * w[2] + q1 * w[1] - q2 * w[0]);
+        normalize(truth, 4);
+    }
+
+    to_body(truth, gravity, a);
+    to_body(truth, field, m);
+    sample->time = n * (uint32_t)(dt * 1e6);
+    sample->flags = MPU9250_FLAG_MAG;
+    for (uint32_t i = 0; i < 3; ++i) {
+        sample->gyro[i] = (int16_t)lround(w[i] / GYRO_SCALE + 1.5 * gauss());
+        sample->accel[i] = (int16_t)lround(a[i] * ACCEL_SCALE + 4.0 * gauss());
+    }
+    sample->mag[0] = (int16_t)lround(m[1] * MAG_RADIUS + gauss());
+    sample->mag[1] = (int16_t)lround(m[0] * MAG_RADIUS + gauss());
+    sample->mag[2] = (int16_t)lround(-m[2] * MAG_RADIUS + gauss());
+}
+
+int main(int argc, char *argv[]) {
+    mpu9250_sample_t sample = {0};
+    double truth[4] = {1.0, 0.0, 0.0, 0.0}, q[4];
+    double diff = 0.0, err = 0.0, err_sum = 0.0;
+    uint64_t cycles = 0, start;
+    uint32_t updates = 0, settled = 0;
+    FILE *fp = NULL;
+    float qf[4];
+
+    if (argc > 1) {
+        fp = fopen(argv[1], "r");
+        if (fp == NULL) {
+            printf("Cannot open %s. \r\n", argv[1]);
+            return 2;
+        }
+    }
+
+    calib_init();
+    ahrs_init();
+    ref.q[0] = 1.0;
+
+    for (;;) {
+        if (fp != NULL) {
+            int v[10];
+
+            if (fscanf(fp, "%d %d %d %d %d %d %d %d %d %d", &v[0], &v[1],
+                       &v[2], &v[3], &v[4], &v[5], &v[6], &v[7], &v[8],
+                       &v[9]) != 10) {
+                break;
+            }
+            sample.time = (uint32_t)v[0];
+            for (uint32_t i = 0; i < 3; ++i) {
+                sample.accel[i] = (int16_t)v[1 + i];
+                sample.gyro[i] = (int16_t)v[4 + i];
+                sample.mag[i] = (int16_t)v[7 + i];
+            }
+        } else if (updates < TEST_TIME * 1000 / (1 + MPU9250_SMPLRT_DIV)) {
+            synth(updates, truth, &sample);
+        } else {
+            break;
+        }
+
+        start = host_cycles();
+        ahrs_update(&sample);
+        cycles += host_cycles() - start;
+        ref_update(&sample);
+        updates++;
+
+        ahrs_get_quat(qf);
+        for (uint32_t i = 0; i < 4; ++i) {
+            q[i] = qf[i];
+        }
+        diff = fmax(diff, angle(q, ref.q));
+        if ((fp == NULL) &&
+            (updates > TEST_SETTLE * 1000 / (1 + MPU9250_SMPLRT_DIV))) {
+            double e = angle(q, truth);
+
+            err = fmax(err, e);
+            err_sum += e;
+            settled++;
+        }
+    }
+
+    printf("%u updates, %.0f host cycles per update\r\n",
+           (unsigned int)updates, (double)cycles / updates);
+    printf("Single vs double: max %.5f deg\r\n", diff);
+    TEST_CHECK(diff < TEST_MAX_DIFF, "single precision drifted %.5f deg",
+               diff);
+    if (fp == NULL) {
+        printf("Against truth: mean %.3f deg, max %.3f deg\r\n",
+               err_sum / settled, err);
+        TEST_CHECK(err < TEST_MAX_ERR, "error %.3f deg", err);
+    } else {
+        fclose(fp);
+    }
+
+    return test_report("ahrs");
+}
@@ -0,0 +1,209 @@
+/**
+ * @file    test_calib.c
+ * @author  Deadline039
+ * @brief   传感器校准的主机测试
+ * @version 1.0
+ * @date    2026-10-17
+ * @note    用已知的零偏, 比例和椭球生成采样, 走一遍串口命令的校准流程,
+ *          检查校准后的结果. 磁力计的硬铁偏移包括大于地磁半径的情况
+ */
+
+#include "test.h"
+
+#include "calib.h"
+#include "query.h"
+
+#include <math.h>
+
+/* 地磁场半径(LSB) */
+#define MAG_RADIUS 330.0
+
+static uint32_t seed = 0x2026A017;
+
+uint8_t eeprom_read(uint16_t key, void *buf, uint16_t len) {
+    return 1;
+}
+
+uint8_t eeprom_write(uint16_t key, const void *data, uint16_t len) {
+    return 0;
+}
+
+uint8_t recorder_write(uint8_t type, uint8_t channel, const void *data,
+                       uint32_t len) {
+    return 0;
+}
+
+/**
+ * @brief [0, 1)均匀分布
+ */
+static double uniform(void) {
+    return (double)(host_rand(&seed) >> 8) / 16777216.0;
+}
+
+/**
+ * @brief 标准正态分布
+ */
+static double gauss(void) {
+    double u = uniform() + 1e-12, v = uniform();
+
+    return sqrt(-2.0 * log(u)) * cos(2.0 * M_PI * v);
+}
+
+/**
+ * @brief 球面上均匀分布的方向
+ */
+static void direction(double u[3]) {
+    double z = 2.0 * uniform() - 1.0, phi = 2.0 * M_PI * uniform();
+    double s = sqrt(1.0 - z * z);
+
+    u[0] = s * cos(phi);
+    u[1] = s * sin(phi);
+    u[2] = z;
+}
+
+/**
+ * @brief 软铁和硬铁畸变后的磁场
+ */
+static void mag_distort(const double soft[3][3], const double center[3],
+                        const double u[3], double noise,
+                        mpu9250_sample_t *sample) {
+    for (uint32_t i = 0; i < 3; ++i) {
+        double v = center[i] + noise * gauss();
+
+        for (uint32_t j = 0; j < 3; ++j) {
+            v += soft[i][j] * MAG_RADIUS * u[j];
+        }
+        sample->mag[i] = (int16_t)lround(v);
+    }
+    sample->flags = MPU9250_FLAG_MAG;
+}
+
+/**
+ * @brief 一个硬铁偏移下的磁力计校准
+ *
+ * @param center 硬铁偏移
+ */
+static void test_mag(const double center[3]) {
+    static const double soft[3][3] = {
+        {1.10, 0.05, 0.02}, {0.05, 0.90, -0.03}, {0.02, -0.03, 1.05}};
+    mpu9250_sample_t sample = {0};
+    float accel[3], gyro[3], mag[3];
+    double u[3], r, r_min = 1e9, r_max = 0.0, r_sum = 0.0;
+
+    query_command_callback("cal clear");
+    query_command_callback("cal mag");
+    for (uint32_t n = 0; n < 3000; ++n) {
+        direction(u);
+        mag_distort(soft, center, u, 1.0, &sample);
+        calib_input(&sample);
+    }
+    query_command_callback("cal done");
+
+    for (uint32_t n = 0; n < 2000; ++n) {
+        direction(u);
+        mag_distort(soft, center, u, 0.0, &sample);
+        calib_apply(&sample, accel, gyro, mag);
+        r = sqrt((double)mag[0] * mag[0] + (double)mag[1] * mag[1] +
+                 (double)mag[2] * mag[2]);
+        r_min = fmin(r_min, r);
+        r_max = fmax(r_max, r);
+        r_sum += r;
+    }
+    r = r_sum / 2000.0;
+    printf("Center %4d %4d %4d: radius %.2f..%.2f\r\n", (int)center[0],
+           (int)center[1], (int)center[2], r_min, r_max);
+    TEST_CHECK((r_max - r) < 0.003 * r && (r - r_min) < 0.003 * r,
+               "mag fit off by more than 0.3%%");
+}
+
+/**
+ * @brief 加速度计六面校准
+ */
+static void test_accel(void) {
+    static const double scale[3][3] = {
+        {1.02, 0.01, -0.02}, {0.015, 0.98, 0.01}, {-0.01, 0.02, 1.01}};
+    static const double bias[3] = {60.0, -40.0, 90.0};
+    static const int8_t dirs[6][3] = {{1, 0, 0},  {-1, 0, 0}, {0, 1, 0},
+                                      {0, -1, 0}, {0, 0, 1},  {0, 0, -1}};
+    const double g = 4096.0;
+    mpu9250_sample_t sample = {0};
+    float accel[3], gyro[3], mag[3];
+    double err = 0.0;
+
+    query_command_callback("cal clear");
+    for (uint32_t f = 0; f < 6; ++f) {
+        query_command_callback("cal accel");
+        for (uint32_t n = 0; n < 2100; ++n) {
+            for (uint32_t i = 0; i < 3; ++i) {
+                double v = bias[i] + 8.0 * gauss();
+
+                for (uint32_t j = 0; j < 3; ++j) {
+                    v += scale[i][j] * g * dirs[f][j];
+                }
+                sample.accel[i] = (int16_t)lround(v);
+                sample.gyro[i] = (int16_t)lround(5.0 + 2.0 * gauss());
+            }
+            host_tick++;
+            calib_input(&sample);
+        }
+    }
+
+    for (uint32_t f = 0; f < 6; ++f) {
+        for (uint32_t i = 0; i < 3; ++i) {
+            double v = bias[i];
+
+            for (uint32_t j = 0; j < 3; ++j) {
+                v += scale[i][j] * g * dirs[f][j];
+            }
+            sample.accel[i] = (int16_t)lround(v);
+        }
+        calib_apply(&sample, accel, gyro, mag);
+        for (uint32_t i = 0; i < 3; ++i) {
+            err = fmax(err, fabs(accel[i] - g * dirs[f][i]));
+        }
+    }
+    printf("Accel: max error %.2f LSB\r\n", err);
+    TEST_CHECK(err < 2.0, "accel error %.2f LSB", err);
+}
+
+/**
+ * @brief 陀螺仪零偏
+ */
+static void test_gyro(void) {
+    mpu9250_sample_t sample = {0};
+    float accel[3], gyro[3], mag[3];
+
+    query_command_callback("cal clear");
+    query_command_callback("cal gyro");
+    for (uint32_t n = 0; n < 6000; ++n) {
+        for (uint32_t i = 0; i < 3; ++i) {
+            sample.gyro[i] = (int16_t)lround(10.0 * (i + 1) + 2.0 * gauss());
+        }
+        host_tick++;
+        calib_input(&sample);
+    }
+
+    sample.gyro[0] = 10;
+    sample.gyro[1] = 20;
+    sample.gyro[2] = 30;
+    calib_apply(&sample, accel, gyro, mag);
+    for (uint32_t i = 0; i < 3; ++i) {
+        TEST_CHECK(fabsf(gyro[i]) < 0.1f, "gyro bias %.3f", (double)gyro[i]);
+    }
+}
+
+int main(void) {
+    static const double centers[][3] = {
+        {50.0, -60.0, 80.0},    {150.0, -150.0, 150.0},
+        {150.0, -220.0, 300.0}, {-300.0, 100.0, 250.0},
+        {600.0, -400.0, 200.0}};
+
+    calib_init();
+    test_gyro();
+    test_accel();
+    for (uint32_t i = 0; i < sizeof(centers) / sizeof(centers[0]); ++i) {
+        test_mag(centers[i]);
+    }
+
+    return test_report("calib");
+}
@@ -0,0 +1,149 @@
+/**
+ * @file    test_dod.c
+ * @author  Deadline039
+ * @brief   时间戳二阶差分编码的主机测试
+ * @version 1.0
+ * @date    2026-10-17
+ * @note    随机生成等间隔, 抖动, 跳变和回绕的时间戳序列, 分段写入多个
+ *          缓冲区, 再逐段解码, 必须逐个相同; 每个时间戳的位数与`dod_cost`
+ *          一致, 缓冲区满时状态不变
+ */
+
+#include "test.h"
+
+#include "dod.h"
+
+#include <string.h>
+
+#define TEST_SEQUENCES 100000
+#define TEST_TIME_MAX  256
+#define TEST_SEG_MAX   8
+
+static uint32_t seed = 0x0D0D0072;
+
+/**
+ * @brief 生成一串时间戳
+ *
+ * @param time 时间戳
+ * @param num 个数
+ * @return 基准时间戳
+ */
+static uint32_t fill_times(uint32_t *time, uint32_t num) {
+    uint32_t shape = host_rand(&seed) % 5;
+    uint32_t t = host_rand(&seed), interval = 1 + host_rand(&seed) % 20000;
+    uint32_t base = t - interval;
+
+    if (shape == 4) {
+        /* 从回绕点附近开始 */
+        t = 0xFFFFFFFFU - host_rand(&seed) % (num * interval + 1);
+        base = t - interval;
+    }
+
+    for (uint32_t i = 0; i < num; ++i) {
+        time[i] = t;
+        switch (shape) {
+            case 1: {
+                /* 小抖动 */
+                t += interval + host_rand(&seed) % 64 - 32;
+            } break;
+
+            case 2: {
+                /* 偶尔丢失几个采样 */
+                t += interval * (((host_rand(&seed) & 15) == 0)
+                                     ? 1 + host_rand(&seed) % 8
+                                     : 1);
+            } break;
+
+            case 3: {
+                /* 完全随机 */
+                t = host_rand(&seed);
+            } break;
+
+            default: {
+                t += interval;
+            } break;
+        }
+    }
+
+    return base;
+}
+
+int main(void) {
+    static uint32_t time[TEST_TIME_MAX], got;
+    static uint8_t buf[TEST_SEG_MAX][64];
+    uint32_t seg_len[TEST_SEG_MAX], seg_num[TEST_SEG_MAX];
+    uint64_t total = 0, bytes = 0;
+
+    for (uint32_t n = 0; n < TEST_SEQUENCES; ++n) {
+        uint32_t num = 1 + host_rand(&seed) % TEST_TIME_MAX;
+        uint32_t base = fill_times(time, num);
+        uint32_t seg = 0, i = 0;
+        dod_t dod;
+
+        /* 编码, 缓冲区满时换下一段 */
+        dod_init(&dod, base);
+        while ((i < num) && (seg < TEST_SEG_MAX)) {
+            uint32_t size = 1 + host_rand(&seed) % sizeof(buf[0]);
+
+            dod_set_buffer(&dod, buf[seg], size);
+            seg_num[seg] = 0;
+            while (i < num) {
+                uint32_t pos = dod.pos, cost = dod_cost(&dod, time[i]);
+                dod_t saved = dod;
+
+                if (dod_put(&dod, time[i]) != 0) {
+                    TEST_CHECK(memcmp(&saved, &dod, sizeof(dod)) == 0,
+                               "sequence %u: state changed on full buffer",
+                               (unsigned int)n);
+                    TEST_CHECK(pos + cost > size * 8,
+                               "sequence %u: rejected with room left",
+                               (unsigned int)n);
+                    break;
+                }
+                TEST_CHECK(dod.pos - pos == cost,
+                           "sequence %u: cost %u, wrote %u", (unsigned int)n,
+                           (unsigned int)cost, (unsigned int)(dod.pos - pos));
+                seg_num[seg]++;
+                i++;
+            }
+            seg_len[seg] = dod_size(&dod);
+            seg++;
+        }
+
+        /* 解码 */
+        dod_init(&dod, base);
+        i = 0;
+        for (uint32_t s = 0; s < seg; ++s) {
+            dod_set_buffer(&dod, buf[s], seg_len[s]);
+            for (uint32_t k = 0; k < seg_num[s]; ++k, ++i) {
+                TEST_CHECK(dod_get(&dod, &got) == 0 && got == time[i],
+                           "sequence %u: time %u differs", (unsigned int)n,
+                           (unsigned int)i);
+            }
+            bytes += seg_len[s];
+        }
+        total += i;
+        if (test_failed > 10) {
+            break;
+        }
+    }
+
+    /* 等间隔每个时间戳1位 */
+    {
+        uint8_t out[16];
+        dod_t dod;
+
+        dod_init(&dod, 0);
+        dod_set_buffer(&dod, out, sizeof(out));
+        for (uint32_t i = 1; i <= 100; ++i) {
+            dod_put(&dod, i * 1000);
+        }
+        /* 第一个间隔1000需要16位 */
+        TEST_CHECK(dod.pos == 16 + 99, "regular series took %u bits",
+                   (unsigned int)dod.pos);
+    }
+
+    printf("%u times, %.2f bytes each\r\n", (unsigned int)total,
+           (double)bytes / (double)total);
+    return test_report("dod");
+}
@@ -0,0 +1,101 @@
+/**
+ * @file    test_fft.c
+ * @author  Deadline039
+ * @brief   实数FFT的主机测试
+ * @version 1.0
+ * @date    2026-10-17
+ * @note    与双精度直接DFT对比, 随机信号和正弦信号, N从8到2048.
+ *          误差按频谱最大幅值归一化, 单精度累加的误差随log(N)增长
+ */
+
+#include "test.h"
+
+#include "fft.h"
+
+#include <math.h>
+
+#define TEST_N_MAX  2048
+#define TEST_ROUNDS 20
+
+/* 允许的归一化误差 */
+#define TEST_TOLERANCE 2e-6
+
+static uint32_t seed = 0x0FF70068;
+
+/**
+ * @brief [-1, 1]均匀分布
+ */
+static double uniform(void) {
+    return (double)(host_rand(&seed) >> 8) / 8388608.0 - 1.0;
+}
+
+/**
+ * @brief 一种点数的对比
+ *
+ * @param n 点数
+ * @return 最大归一化误差
+ */
+static double test_size(uint16_t n) {
+    static float twiddle[3 * TEST_N_MAX / 4], buf[TEST_N_MAX];
+    static double x[TEST_N_MAX], re[TEST_N_MAX / 2 + 1], im[TEST_N_MAX / 2 + 1];
+    double worst = 0.0;
+    fft_real_t fft;
+
+    TEST_CHECK(fft_real_init(&fft, twiddle, n) == 0, "N = %u rejected",
+               (unsigned int)n);
+
+    for (uint32_t r = 0; r < TEST_ROUNDS; ++r) {
+        double peak = 0.0, err = 0.0;
+        uint32_t bin = host_rand(&seed) % (n / 2 + 1);
+
+        for (uint32_t i = 0; i < n; ++i) {
+            /* 一半是噪声, 一半是落在频点上的正弦加小噪声 */
+            x[i] = (r & 1) ? uniform()
+                           : cos(2.0 * M_PI * bin * i / n + 0.3) +
+                                 0.01 * uniform();
+            buf[i] = (float)x[i];
+            x[i] = buf[i];
+        }
+
+        for (uint32_t k = 0; k <= n / 2U; ++k) {
+            re[k] = 0.0;
+            im[k] = 0.0;
+            for (uint32_t i = 0; i < n; ++i) {
+                double phase = 2.0 * M_PI * (double)((k * i) % n) / n;
+
+                re[k] += x[i] * cos(phase);
+                im[k] -= x[i] * sin(phase);
+            }
+            peak = fmax(peak, hypot(re[k], im[k]));
+        }
+
+        fft_real(&fft, buf);
+
+        err = fmax(fabs(buf[0] - re[0]), fabs(buf[1] - re[n / 2]));
+        for (uint32_t k = 1; k < n / 2U; ++k) {
+            err = fmax(err, hypot(buf[2 * k] - re[k], buf[2 * k + 1] - im[k]));
+        }
+        worst = fmax(worst, err / peak);
+    }
+
+    printf("N = %4u: max error %.2e\r\n", (unsigned int)n, worst);
+    TEST_CHECK(worst < TEST_TOLERANCE, "N = %u: error %.2e", (unsigned int)n,
+               worst);
+    return worst;
+}
+
+int main(void) {
+    static float twiddle[3 * TEST_N_MAX / 4];
+    static const uint16_t bad[] = {4, 16, 64, 100, 256, 1024};
+    fft_real_t fft;
+
+    for (uint16_t n = 8; n <= TEST_N_MAX; n *= 4) {
+        test_size(n);
+    }
+    for (uint32_t i = 0; i < sizeof(bad) / sizeof(bad[0]); ++i) {
+        TEST_CHECK(fft_real_init(&fft, twiddle, bad[i]) != 0,
+                   "N = %u accepted", (unsigned int)bad[i]);
+    }
+
+    return test_report("fft");
+}
@@ -0,0 +1,992 @@
+/**
+ * @file    test_mpu9250.c
+ * @author  Deadline039
+ * @brief   MPU9250驱动的主机测试
+ * @version 1.0
+ * @date    2026-10-17
+ * @note    模拟MPU9250的寄存器, FIFO, 内部I2C主机和AK8963, 接在I2C的HAL函数
+ *          或SPI总线的桩函数上. 每次读写寄存器时检查接口的时序要求, 初始化
+ *          后检查最终的配置. 之后逐个产生采样和数据就绪边沿, 按捕获分频
+ *          产生中断, 驱动输出的采样要和产生的数据逐字节相同,
+ *          两种接口的输出因此也相同. 没有注入错误时检查每个采样平均的
+ *          中断和读取次数.
+ *          传输完成的回调在采样之间执行, 可以推迟或改为传输错误,
+ *          检查出错和FIFO溢出后的采样仍然正确, 丢失处带有GAP标志.
+ *          接口和FIFO的配置由Makefile改写mpu9250.h后各编译一次
+ */
+
+#include "test.h"
+
+#include "mpu9250.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* MPU9250寄存器, 与mpu9250.c相同 */
+#define MPU9250_SMPLRT_DIV_REG 0x19
+#define MPU9250_CONFIG         0x1A
+#define MPU9250_GYRO_CONFIG    0x1B
+#define MPU9250_ACCEL_CONFIG   0x1C
+#define MPU9250_ACCEL_CONFIG2  0x1D
+#define MPU9250_FIFO_EN        0x23
+#define MPU9250_I2C_MST_CTRL   0x24
+#define MPU9250_I2C_SLV0_ADDR  0x25
+#define MPU9250_I2C_SLV0_REG   0x26
+#define MPU9250_I2C_SLV0_CTRL  0x27
+#define MPU9250_INT_PIN_CFG    0x37
+#define MPU9250_INT_ENABLE     0x38
+#define MPU9250_ACCEL_XOUT_H   0x3B
+#define MPU9250_EXT_SENS_DATA  0x49
+#define MPU9250_EXT_SENS_END   0x60
+#define MPU9250_I2C_SLV0_DO    0x63
+#define MPU9250_USER_CTRL      0x6A
+#define MPU9250_PWR_MGMT_1     0x6B
+#define MPU9250_FIFO_COUNTH    0x72
+#define MPU9250_FIFO_COUNTL    0x73
+#define MPU9250_FIFO_R_W       0x74
+#define MPU9250_WHO_AM_I       0x75
+
+#define MPU9250_I2C_MST_EN     0x20
+#define MPU9250_I2C_IF_DIS     0x10
+#define MPU9250_FIFO_ENABLE    0x40
+#define MPU9250_FIFO_RST       0x04
+#define MPU9250_FIFO_MODE      0x40
+#define MPU9250_FIFO_ALL       0xF9
+#define MPU9250_SLV_EN         0x80
+#define MPU9250_SLV_READ       0x80
+#define MPU9250_RAW_RDY_EN     0x01
+#define MPU9250_H_RESET        0x80
+#define MPU9250_SPI_READ       0x80
+
+/* AK8963寄存器 */
+#define AK8963_I2C_ADDR        0x0C
+#define AK8963_WIA             0x00
+#define AK8963_ST1             0x02
+#define AK8963_HXL             0x03
+#define AK8963_ST2             0x09
+#define AK8963_CNTL1           0x0A
+#define AK8963_CNTL2           0x0B
+#define AK8963_REG_NUM         0x13
+
+/* 传感器数据: 加速度6, 温度2, 角速度6 */
+#define MOCK_DATA_LEN          14
+/* 从机0每次从ST1读到ST2 */
+#define MOCK_SLV0_LEN          8
+/* 复位后寄存器不可访问的时间(ms) */
+#define MOCK_RESET_MS          11
+/* SPI5时钟 */
+#define MOCK_SPI_CLOCK         90000000
+/* 产生的采样数上限, 磁场的序号不能超过int16_t */
+#define MOCK_SAMPLES           (1 << 18)
+/* 使用FIFO时推算的采样时间与真实时间的最大误差(us) */
+#define MOCK_TIME_TOL          10
+
+#if (MPU9250_USE_SPI == 1)
+#define MOCK_BUS "spi"
+#else  /* MPU9250_USE_SPI == 1 */
+#define MOCK_BUS "i2c"
+#endif /* MPU9250_USE_SPI == 1 */
+
+#if (MPU9250_USE_FIFO == 1)
+#define MOCK_NAME  "mpu9250 " MOCK_BUS " fifo"
+/* 还留在FIFO中没有读出的采样数 */
+#define MOCK_BATCH MPU9250_FIFO_BATCH
+/* 捕获分频, 每8个边沿一次中断 */
+#define MOCK_PSC   TIM_ICPSC_DIV8
+/* n个采样最多的读取次数, 每批一次 */
+#define MOCK_READS(n) ((n) / MOCK_BATCH + 1)
+#else  /* MPU9250_USE_FIFO == 1 */
+#define MOCK_NAME  "mpu9250 " MOCK_BUS
+#define MOCK_BATCH 1
+#define MOCK_PSC   TIM_ICPSC_DIV1
+/* 每个采样一次, 磁场为100Hz, 十分之一的采样再读一次磁场 */
+#define MOCK_READS(n) ((n) + (n) / 10 + 1)
+#endif /* MPU9250_USE_FIFO == 1 */
+
+/**
+ * @brief 产生的一个采样
+ */
+typedef struct {
+    uint8_t data[MOCK_DATA_LEN]; /*!< 加速度, 温度, 角速度, 高字节在前 */
+    int32_t mag;                 /*!< 本次读到的新磁场序号, -1表示没有 */
+    int32_t mag_last;            /*!< 到本次为止最新的磁场序号 */
+    uint32_t time;               /*!< 数据就绪中断的时间(us) */
+} mock_sample_t;
+
+/**
+ * @brief 还没有执行完成回调的传输
+ */
+typedef enum {
+    MOCK_NONE = 0U, /* 没有 */
+    MOCK_I2C_TX,    /* I2C发送完成 */
+    MOCK_I2C_RX,    /* I2C接收完成 */
+    MOCK_I2C_ERR,   /* I2C传输错误 */
+    MOCK_SPI        /* SPI事务结束 */
+} mock_pending_t;
+
+static struct {
+    uint8_t reg[128];             /* MPU9250寄存器 */
+    uint8_t ak[AK8963_REG_NUM];   /* AK8963寄存器 */
+    uint8_t fifo[512];            /* FIFO */
+    uint32_t fifo_len;            /* FIFO中的字节数 */
+    uint8_t who;                  /* WHO_AM_I的值 */
+    uint8_t ak_absent;            /* AK8963没有应答 */
+    uint8_t resetting;            /* 复位后还不能访问 */
+    uint32_t reset_tick;          /* 复位的时间(ms) */
+    uint32_t resets;              /* 复位次数 */
+    uint32_t accesses;            /* 寄存器访问次数 */
+    uint8_t if_dis_first;         /* SPI的第一次访问是关闭I2C接口 */
+    uint8_t who_read;             /* 读过WHO_AM_I */
+    uint32_t capture;             /* 捕获分频, 0为还没有开始捕获 */
+    uint32_t edges;               /* 开始捕获后的数据就绪边沿数 */
+    uint32_t captures;            /* 捕获中断次数 */
+    uint32_t now;                 /* 当前时间(us) */
+    uint32_t ak_ticks;            /* AK8963进入连续测量后的采样数 */
+    int32_t mag_num;              /* AK8963的测量次数 */
+    int32_t mag_last;             /* 最近一次读到的新磁场序号 */
+    uint32_t tick;                /* 产生的采样数 */
+
+    mock_pending_t pending;       /* 等待完成回调的传输 */
+    uint32_t due;                 /* 完成回调的采样序号 */
+    uint8_t seq;                  /* I2C已发送寄存器地址, 等待重复起始 */
+    uint8_t i2c_reg;              /* I2C读取的寄存器地址 */
+    uint8_t write_reg;            /* 异步写的寄存器, 完成时写入 */
+    uint8_t write_value;          /* 异步写的值 */
+    uint8_t write_pending;        /* 有异步写 */
+    spi_trans_t *trans;           /* 等待完成的SPI事务 */
+
+    uint32_t error_rate;          /* 传输错误的概率, 1/n, 0为不出错 */
+    uint32_t delay_rate;          /* 推迟完成回调的概率, 1/n */
+    uint32_t delay_max;           /* 推迟的最大采样数 */
+    uint32_t stall_rate;          /* 长时间推迟的概率, 1/n */
+    uint32_t stall;               /* 长时间推迟的采样数 */
+    uint32_t errors;              /* 注入的错误数 */
+} mock;
+
+static mock_sample_t expect[MOCK_SAMPLES];
+static uint32_t seed = 0x0A450063;
+
+I2C_HandleTypeDef i2c2_handle;
+spi_bus_t spi5_bus;
+
+/**
+ * @brief 复位后寄存器的值
+ *
+ */
+static void mock_reg_reset(void) {
+    memset(mock.reg, 0, sizeof(mock.reg));
+    mock.reg[MPU9250_PWR_MGMT_1] = 0x01;
+    mock.reg[MPU9250_WHO_AM_I] = mock.who;
+    mock.fifo_len = 0;
+}
+
+/**
+ * @brief AK8963复位
+ *
+ */
+static void ak_reset(void) {
+    memset(mock.ak, 0, sizeof(mock.ak));
+    mock.ak[AK8963_WIA] = 0x48;
+    mock.ak_ticks = 0;
+}
+
+/**
+ * @brief 上电
+ *
+ * @param who WHO_AM_I的值
+ * @param ak_absent AK8963没有应答
+ */
+static void mock_power_on(uint8_t who, uint8_t ak_absent) {
+    memset(&mock, 0, sizeof(mock));
+    mock.who = who;
+    mock.ak_absent = ak_absent;
+    mock.mag_last = -1;
+    mock_reg_reset();
+    ak_reset();
+    GPIOH->ODR = 0;
+}
+
+/**
+ * @brief 每次访问寄存器前检查接口状态
+ *
+ * @param reg 寄存器地址
+ * @param write 是否写入
+ * @param value 写入的值
+ */
+static void mock_access(uint8_t reg, uint8_t write, uint8_t value) {
+    if (mock.resetting && (host_tick - mock.reset_tick >= MOCK_RESET_MS)) {
+        mock.resetting = 0;
+    }
+    TEST_CHECK(!mock.resetting, "register 0x%02X accessed %u ms after reset",
+               reg, (unsigned int)(host_tick - mock.reset_tick));
+
+#if (MPU9250_USE_SPI == 1)
+    if (mock.accesses == 0) {
+        mock.if_dis_first = write && (reg == MPU9250_USER_CTRL) &&
+                            (value & MPU9250_I2C_IF_DIS);
+    }
+    /* I2C接口没有关闭时SPI通信可能被当成I2C, 复位后只允许先设置时钟 */
+    TEST_CHECK((mock.reg[MPU9250_USER_CTRL] & MPU9250_I2C_IF_DIS) ||
+                   (write && (reg == MPU9250_PWR_MGMT_1)) ||
+                   (write && (reg == MPU9250_USER_CTRL) &&
+                    (value & MPU9250_I2C_IF_DIS)),
+               "SPI access to 0x%02X with the I2C interface enabled", reg);
+#endif /* MPU9250_USE_SPI == 1 */
+
+    mock.accesses++;
+}
+
+/**
+ * @brief 写MPU9250寄存器
+ *
+ * @param reg 寄存器地址
+ * @param value 写入的值
+ */
+static void mock_write(uint8_t reg, uint8_t value) {
+    mock_access(reg, 1, value);
+
+    TEST_CHECK(!((reg >= MPU9250_ACCEL_XOUT_H) &&
+                 (reg <= MPU9250_EXT_SENS_END)) &&
+                   (reg != MPU9250_WHO_AM_I) &&
+                   (reg != MPU9250_FIFO_COUNTH) &&
+                   (reg != MPU9250_FIFO_COUNTL) && (reg != MPU9250_FIFO_R_W),
+               "write to read-only register 0x%02X", reg);
+
+    switch (reg) {
+        case MPU9250_PWR_MGMT_1: {
+            if (value & MPU9250_H_RESET) {
+                mock_reg_reset();
+                mock.resetting = 1;
+                mock.reset_tick = host_tick;
+                mock.resets++;
+                return;
+            }
+        } break;
+
+        case MPU9250_USER_CTRL: {
+            if (value & MPU9250_FIFO_RST) {
+                mock.fifo_len = 0;
+            }
+            /* 复位位自动清零 */
+            value &= (uint8_t)~MPU9250_FIFO_RST;
+        } break;
+
+        default: {
+        } break;
+    }
+
+    mock.reg[reg] = value;
+}
+
+/**
+ * @brief 读MPU9250寄存器, 地址自动递增, FIFO_R_W除外
+ *
+ * @param reg 起始寄存器
+ * @param[out] buf 读出的值
+ * @param len 长度
+ */
+static void mock_read(uint8_t reg, uint8_t *buf, uint32_t len) {
+    mock_access(reg, 0, 0);
+
+    if (reg == MPU9250_WHO_AM_I) {
+        mock.who_read = 1;
+    }
+
+    for (uint32_t i = 0; i < len; ++i) {
+        if (reg == MPU9250_FIFO_R_W) {
+            TEST_CHECK(mock.fifo_len != 0, "FIFO read while empty");
+            buf[i] = mock.fifo[0];
+            if (mock.fifo_len != 0) {
+                memmove(mock.fifo, mock.fifo + 1, --mock.fifo_len);
+            }
+            continue;
+        }
+
+        if (reg == MPU9250_FIFO_COUNTH) {
+            buf[i] = (uint8_t)(mock.fifo_len >> 8);
+        } else if (reg == MPU9250_FIFO_COUNTL) {
+            buf[i] = (uint8_t)mock.fifo_len;
+        } else {
+            buf[i] = mock.reg[reg];
+        }
+        reg = (reg + 1) & 0x7F;
+    }
+}
+
+/**
+ * @brief 内部I2C主机从AK8963读一个寄存器
+ *
+ * @param reg 寄存器地址
+ * @return 寄存器的值
+ * @note 读ST2后清除数据就绪和溢出
+ */
+static uint8_t ak_read(uint8_t reg) {
+    uint8_t value;
+
+    TEST_CHECK(reg < AK8963_REG_NUM, "AK8963 read of 0x%02X", reg);
+    if (reg >= AK8963_REG_NUM) {
+        return 0;
+    }
+
+    value = mock.ak[reg];
+    if (reg == AK8963_ST2) {
+        mock.ak[AK8963_ST1] = 0;
+    }
+    return value;
+}
+
+/**
+ * @brief 内部I2C主机写AK8963寄存器
+ *
+ * @param reg 寄存器地址
+ * @param value 写入的值
+ */
+static void ak_write(uint8_t reg, uint8_t value) {
+    switch (reg) {
+        case AK8963_CNTL1: {
+            mock.ak[AK8963_CNTL1] = value;
+            mock.ak_ticks = 0;
+        } break;
+
+        case AK8963_CNTL2: {
+            if (value & 0x01) {
+                ak_reset();
+            }
+        } break;
+
+        default: {
+            TEST_CHECK(0, "AK8963 write of 0x%02X", reg);
+        } break;
+    }
+}
+
+/**
+ * @brief 一个采样周期内从机0的传输
+ *
+ * @return 读到的新磁场序号, -1表示没有
+ */
+static int32_t mock_slave(void) {
+    uint8_t addr = mock.reg[MPU9250_I2C_SLV0_ADDR];
+    uint8_t reg = mock.reg[MPU9250_I2C_SLV0_REG];
+    uint8_t ctrl = mock.reg[MPU9250_I2C_SLV0_CTRL];
+    uint32_t len = ctrl & 0x0F;
+    int32_t mag = -1;
+
+    if (!(mock.reg[MPU9250_USER_CTRL] & MPU9250_I2C_MST_EN) ||
+        !(ctrl & MPU9250_SLV_EN)) {
+        return -1;
+    }
+
+    TEST_CHECK((addr & 0x7F) == AK8963_I2C_ADDR, "slave 0 address 0x%02X",
+               addr);
+    /* AK8963没有应答时EXT_SENS_DATA保持不变 */
+    if (mock.ak_absent) {
+        return -1;
+    }
+
+    if (!(addr & MPU9250_SLV_READ)) {
+        TEST_CHECK(len == 1, "slave 0 write of %u bytes", (unsigned int)len);
+        ak_write(reg, mock.reg[MPU9250_I2C_SLV0_DO]);
+        return -1;
+    }
+
+    if ((reg == AK8963_ST1) && (mock.ak[AK8963_ST1] & 0x01)) {
+        mag = mock.mag_num - 1;
+    }
+    for (uint32_t i = 0; i < len; ++i) {
+        mock.reg[MPU9250_EXT_SENS_DATA + i] = ak_read((uint8_t)(reg + i));
+    }
+
+    return mag;
+}
+
+/**
+ * @brief 第m次测量的磁场
+ *
+ * @param m 测量序号
+ * @param[out] mag 磁场
+ */
+static void mock_mag_value(int32_t m, int16_t mag[3]) {
+    if (m < 0) {
+        mag[0] = mag[1] = mag[2] = 0;
+        return;
+    }
+    mag[0] = (int16_t)(m + 1);
+    mag[1] = (int16_t)-(m + 1);
+    mag[2] = (int16_t)((m + 1) * 3);
+}
+
+/**
+ * @brief 产生一个采样
+ *
+ * @return 采样序号
+ * @note 加速度X为序号的低15位, 用来找到驱动输出的采样对应哪一个
+ */
+static uint32_t mock_tick(void) {
+    uint32_t n = mock.tick++;
+    mock_sample_t *sample = &expect[n % MOCK_SAMPLES];
+    int16_t mag[3];
+    uint8_t *p;
+
+    /* AK8963连续测量模式2, 100Hz */
+    if ((mock.ak[AK8963_CNTL1] & 0x0F) == 0x06) {
+        if (++mock.ak_ticks % 10 == 0) {
+            mock.ak[AK8963_ST1] |= (mock.ak[AK8963_ST1] & 0x01) ? 0x03 : 0x01;
+            mock_mag_value(mock.mag_num++, mag);
+            for (uint32_t i = 0; i < 3; ++i) {
+                mock.ak[AK8963_HXL + i * 2] = (uint8_t)mag[i];
+                mock.ak[AK8963_HXL + i * 2 + 1] = (uint8_t)(mag[i] >> 8);
+            }
+            mock.ak[AK8963_ST2] = 0x10;
+        }
+    }
+
+    p = &mock.reg[MPU9250_ACCEL_XOUT_H];
+    for (uint32_t i = 0; i < MOCK_DATA_LEN; ++i) {
+        p[i] = (uint8_t)host_rand(&seed);
+    }
+    p[0] = (uint8_t)((n >> 8) & 0x7F);
+    p[1] = (uint8_t)n;
+
+    sample->mag = mock_slave();
+    if (sample->mag >= 0) {
+        mock.mag_last = sample->mag;
+    }
+    sample->mag_last = mock.mag_last;
+    memcpy(sample->data, p, MOCK_DATA_LEN);
+    /* 采样时间带有几微秒的抖动 */
+    sample->time = n * 1000 + host_rand(&seed) % 5;
+
+    if ((mock.reg[MPU9250_USER_CTRL] & MPU9250_FIFO_ENABLE) &&
+        (mock.reg[MPU9250_FIFO_EN] == MPU9250_FIFO_ALL)) {
+        TEST_CHECK(mock.reg[MPU9250_CONFIG] & MPU9250_FIFO_MODE,
+                   "FIFO would overwrite old samples");
+        /* FIFO满后不再写入, 最后一个采样可能不完整 */
+        for (uint32_t i = 0; (i < MOCK_DATA_LEN + MOCK_SLV0_LEN) &&
+                             (mock.fifo_len < sizeof(mock.fifo));
+             ++i) {
+            mock.fifo[mock.fifo_len++] = p[i];
+        }
+    }
+
+    return n;
+}
+
+/**
+ * @brief 按配置的概率决定传输是否出错
+ *
+ * @return 1表示出错
+ */
+static uint8_t mock_fail(void) {
+    if ((mock.error_rate != 0) && (host_rand(&seed) % mock.error_rate == 0)) {
+        mock.errors++;
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief 开始一次异步传输, 决定完成回调推迟几个采样
+ *
+ * @param pending 完成时的回调
+ */
+static void mock_start(mock_pending_t pending) {
+    TEST_CHECK(mock.pending == MOCK_NONE, "transfer started while busy");
+
+    mock.pending = pending;
+    mock.due = mock.tick;
+    if ((mock.stall_rate != 0) && (host_rand(&seed) % mock.stall_rate == 0)) {
+        mock.due += mock.stall;
+    } else if ((mock.delay_rate != 0) &&
+               (host_rand(&seed) % mock.delay_rate == 0)) {
+        mock.due += 1 + host_rand(&seed) % mock.delay_max;
+    }
+}
+
+/**
+ * @brief 完成到期的异步传输, 回调中开始的下一段也在到期时完成
+ *
+ */
+static void mock_run(void) {
+    while ((mock.pending != MOCK_NONE) && (mock.due <= mock.tick)) {
+        mock_pending_t pending = mock.pending;
+
+        mock.pending = MOCK_NONE;
+        if (mock.write_pending) {
+            mock.write_pending = 0;
+            if (pending != MOCK_I2C_ERR) {
+                mock_write(mock.write_reg, mock.write_value);
+            }
+        }
+
+        switch (pending) {
+#if (MPU9250_USE_SPI == 1)
+            case MOCK_SPI: {
+                spi_trans_t *trans = mock.trans;
+
+                mock.trans = NULL;
+                trans->callback(trans);
+            } break;
+#else  /* MPU9250_USE_SPI == 1 */
+            case MOCK_I2C_TX: {
+                HAL_I2C_MasterTxCpltCallback(&i2c2_handle);
+            } break;
+
+            case MOCK_I2C_RX: {
+                HAL_I2C_MasterRxCpltCallback(&i2c2_handle);
+            } break;
+
+            case MOCK_I2C_ERR: {
+                HAL_I2C_ErrorCallback(&i2c2_handle);
+            } break;
+#endif /* MPU9250_USE_SPI == 1 */
+
+            default: {
+            } break;
+        }
+    }
+}
+
+#if (MPU9250_USE_SPI == 1)
+
+/**
+ * @brief 检查SPI事务的片选, 时钟模式和速度
+ *
+ * @param bus SPI总线
+ * @param trans 事务
+ * @param fast 是否为读取传感器数据的高速事务
+ */
+static void mock_spi_check(spi_bus_t *bus, spi_trans_t *trans, uint8_t fast) {
+    uint8_t reg = trans->cmd[0] & 0x7F;
+    uint32_t div = 2U << ((trans->mode & SPI_CR1_BR) >> SPI_CR1_BR_Pos);
+    uint32_t freq = MOCK_SPI_CLOCK / div;
+
+    TEST_CHECK(bus == &spi5_bus, "wrong SPI bus");
+    TEST_CHECK((trans->cs_port == GPIOH) && (trans->cs_pin == GPIO_PIN_11),
+               "wrong chip select");
+    TEST_CHECK(GPIOH->ODR & GPIO_PIN_11, "chip select not idle high");
+    TEST_CHECK((trans->mode & SPI_CR1_CPOL) && (trans->mode & SPI_CR1_CPHA),
+               "SPI mode is not 3");
+    TEST_CHECK(trans->prio == SPI_BUS_PRIO_HIGH, "SPI priority %d",
+               (int)trans->prio);
+
+    if (!(trans->cmd[0] & MPU9250_SPI_READ)) {
+        TEST_CHECK((trans->cmd_len == 2) && (trans->data_len == 0),
+                   "register write with %u + %u bytes",
+                   (unsigned int)trans->cmd_len,
+                   (unsigned int)trans->data_len);
+        TEST_CHECK(freq <= 1000000, "write of 0x%02X at %u Hz", reg,
+                   (unsigned int)freq);
+        return;
+    }
+
+    TEST_CHECK((trans->cmd_len == 1) && (trans->rx_data != NULL) &&
+                   (trans->data_len != 0),
+               "malformed register read");
+    /* 只有传感器数据和FIFO可以用20MHz读取 */
+    if ((reg >= MPU9250_ACCEL_XOUT_H) && (reg <= MPU9250_EXT_SENS_END)) {
+        TEST_CHECK(freq <= 20000000, "read of 0x%02X at %u Hz", reg,
+                   (unsigned int)freq);
+    } else if ((reg == MPU9250_FIFO_COUNTH) || (reg == MPU9250_FIFO_R_W)) {
+        TEST_CHECK(freq <= 20000000, "read of 0x%02X at %u Hz", reg,
+                   (unsigned int)freq);
+    } else {
+        TEST_CHECK(freq <= 1000000, "read of 0x%02X at %u Hz", reg,
+                   (unsigned int)freq);
+    }
+    if (fast) {
+        TEST_CHECK(freq >= 10000000, "sample read of 0x%02X at %u Hz", reg,
+                   (unsigned int)freq);
+    }
+}
+
+uint8_t spi_bus_transfer(spi_bus_t *bus, spi_trans_t *trans) {
+    mock_spi_check(bus, trans, 0);
+    TEST_CHECK(mock.pending == MOCK_NONE, "blocking transfer while busy");
+
+    if (trans->cmd[0] & MPU9250_SPI_READ) {
+        mock_read(trans->cmd[0] & 0x7F, trans->rx_data, trans->data_len);
+    } else {
+        mock_write(trans->cmd[0], trans->cmd[1]);
+    }
+    trans->state = SPI_TRANS_DONE;
+    return 0;
+}
+
+uint8_t spi_bus_submit(spi_bus_t *bus, spi_trans_t *trans) {
+    uint8_t error = mock_fail();
+
+    mock_spi_check(bus, trans, (trans->cmd[0] & MPU9250_SPI_READ) != 0);
+    TEST_CHECK(trans->callback != NULL, "submitted without a callback");
+    TEST_CHECK((trans->state != SPI_TRANS_QUEUED) &&
+                   (trans->state != SPI_TRANS_RUNNING),
+               "transaction reused while pending");
+
+    if (trans->cmd[0] & MPU9250_SPI_READ) {
+        if (!error) {
+            mock_read(trans->cmd[0] & 0x7F, trans->rx_data, trans->data_len);
+        }
+    } else {
+        mock.write_reg = trans->cmd[0];
+        mock.write_value = trans->cmd[1];
+        mock.write_pending = !error;
+    }
+
+    trans->state = error ? SPI_TRANS_ERROR : SPI_TRANS_QUEUED;
+    mock.trans = trans;
+    mock_start(MOCK_SPI);
+    if (!error) {
+        trans->state = SPI_TRANS_DONE;
+    }
+    return 0;
+}
+
+#else  /* MPU9250_USE_SPI == 1 */
+
+/**
+ * @brief 检查I2C句柄和地址
+ *
+ * @param hi2c I2C句柄
+ * @param addr 器件地址
+ */
+static void mock_i2c_check(I2C_HandleTypeDef *hi2c, uint16_t addr) {
+    TEST_CHECK(hi2c == &i2c2_handle, "wrong I2C handle");
+    TEST_CHECK(addr == (0x68 << 1), "I2C address 0x%02X", addr);
+}
+
+HAL_StatusTypeDef HAL_I2C_Mem_Write(I2C_HandleTypeDef *hi2c, uint16_t addr,
+                                    uint16_t reg, uint16_t reg_size,
+                                    uint8_t *data, uint16_t len,
+                                    uint32_t timeout) {
+    mock_i2c_check(hi2c, addr);
+    TEST_CHECK(reg_size == I2C_MEMADD_SIZE_8BIT, "16-bit register address");
+    TEST_CHECK(mock.pending == MOCK_NONE, "blocking write while busy");
+
+    for (uint16_t i = 0; i < len; ++i) {
+        mock_write((uint8_t)(reg + i), data[i]);
+    }
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2C_Mem_Read(I2C_HandleTypeDef *hi2c, uint16_t addr,
+                                   uint16_t reg, uint16_t reg_size,
+                                   uint8_t *data, uint16_t len,
+                                   uint32_t timeout) {
+    mock_i2c_check(hi2c, addr);
+    TEST_CHECK(reg_size == I2C_MEMADD_SIZE_8BIT, "16-bit register address");
+    TEST_CHECK(mock.pending == MOCK_NONE, "blocking read while busy");
+
+    mock_read((uint8_t)reg, data, len);
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2C_Master_Seq_Transmit_IT(I2C_HandleTypeDef *hi2c,
+                                                 uint16_t addr, uint8_t *data,
+                                                 uint16_t len,
+                                                 uint32_t options) {
+    mock_i2c_check(hi2c, addr);
+    /* 发送寄存器地址后不产生停止位, 由接收重复起始 */
+    TEST_CHECK((len == 1) && (options == I2C_FIRST_FRAME),
+               "register address sent as %u bytes, options 0x%X",
+               (unsigned int)len, (unsigned int)options);
+
+    if (mock_fail()) {
+        return HAL_BUSY;
+    }
+
+    mock.seq = 1;
+    mock.i2c_reg = data[0];
+    mock_start(mock_fail() ? MOCK_I2C_ERR : MOCK_I2C_TX);
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2C_Master_Seq_Receive_DMA(I2C_HandleTypeDef *hi2c,
+                                                 uint16_t addr, uint8_t *data,
+                                                 uint16_t len,
+                                                 uint32_t options) {
+    mock_i2c_check(hi2c, addr);
+    TEST_CHECK(mock.seq && (options == I2C_LAST_FRAME),
+               "receive without a preceding register address");
+
+    mock.seq = 0;
+    if (mock_fail()) {
+        mock_start(MOCK_I2C_ERR);
+        return HAL_OK;
+    }
+
+    /* DMA开始后立即读出, 完成回调可以推迟 */
+    mock_read(mock.i2c_reg, data, len);
+    mock_start(MOCK_I2C_RX);
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2C_Master_Transmit_IT(I2C_HandleTypeDef *hi2c,
+                                             uint16_t addr, uint8_t *data,
+                                             uint16_t len) {
+    mock_i2c_check(hi2c, addr);
+    TEST_CHECK(len == 2, "register write of %u bytes", (unsigned int)len);
+
+    mock.seq = 0;
+    if (mock_fail()) {
+        return HAL_BUSY;
+    }
+
+    /* 写入在完成时生效, 出错时不写入 */
+    mock.write_reg = data[0];
+    mock.write_value = data[1];
+    mock.write_pending = 1;
+    mock_start(mock_fail() ? MOCK_I2C_ERR : MOCK_I2C_TX);
+    return HAL_OK;
+}
+
+#endif /* MPU9250_USE_SPI == 1 */
+
+void timer_ts_capture_start(uint32_t polarity, uint32_t prescaler) {
+    TEST_CHECK(polarity == TIM_ICPOLARITY_RISING, "capture polarity %u",
+               (unsigned int)polarity);
+    TEST_CHECK(prescaler == MOCK_PSC, "capture prescaler 0x%X",
+               (unsigned int)prescaler);
+    mock.capture = 1U << (prescaler >> TIM_CCMR1_IC1PSC_Pos);
+    mock.edges = 0;
+}
+
+uint32_t timer_ts_now(void) {
+    return mock.now;
+}
+
+void HAL_Delay(uint32_t delay) {
+    /* 等待期间MPU9250照常采样, 从机0照常传输 */
+    for (uint32_t i = 0; i < delay; ++i) {
+        host_tick++;
+        mock_tick();
+    }
+}
+
+/**
+ * @brief 产生一个采样, 触发数据就绪中断, 执行到期的完成回调
+ *
+ */
+static void mock_step(void) {
+    uint32_t n;
+
+    host_tick++;
+    n = mock_tick();
+    /* 中断在边沿之后几微秒开始执行 */
+    mock.now = expect[n % MOCK_SAMPLES].time + 20;
+    /* 分频时每组的最后一个边沿才锁存时间并产生中断 */
+    if (mock.capture && (mock.reg[MPU9250_INT_ENABLE] & MPU9250_RAW_RDY_EN) &&
+        (++mock.edges % mock.capture == 0)) {
+        mock.captures++;
+        timer_ts_capture_callback(expect[n % MOCK_SAMPLES].time);
+    }
+    mock_run();
+}
+
+/**
+ * @brief 初始化失败和初始化后的配置
+ *
+ */
+static void test_init(void) {
+    uint8_t user_ctrl = MPU9250_I2C_MST_EN;
+
+    mock_power_on(0x70, 0);
+    TEST_CHECK(mpu9250_init() != 0, "accepted WHO_AM_I 0x70");
+    TEST_CHECK(mock.resets == 0, "reset an unknown device");
+
+    mock_power_on(0x71, 1);
+    TEST_CHECK(mpu9250_init() != 0, "accepted a missing AK8963");
+
+    mock_power_on(0x71, 0);
+    TEST_CHECK(mpu9250_init() == 0, "init failed");
+    TEST_CHECK(mock.who_read, "WHO_AM_I not checked");
+    TEST_CHECK(mock.resets == 1, "%u resets", (unsigned int)mock.resets);
+    TEST_CHECK(mock.capture, "capture not started");
+#if (MPU9250_USE_SPI == 1)
+    TEST_CHECK(mock.if_dis_first, "first SPI access did not disable I2C");
+    user_ctrl |= MPU9250_I2C_IF_DIS;
+#endif /* MPU9250_USE_SPI == 1 */
+
+#if (MPU9250_USE_FIFO == 1)
+    user_ctrl |= MPU9250_FIFO_ENABLE;
+    TEST_CHECK(mock.reg[MPU9250_CONFIG] == (MPU9250_FIFO_MODE | MPU9250_DLPF),
+               "CONFIG 0x%02X", mock.reg[MPU9250_CONFIG]);
+    TEST_CHECK(mock.reg[MPU9250_FIFO_EN] == MPU9250_FIFO_ALL, "FIFO_EN 0x%02X",
+               mock.reg[MPU9250_FIFO_EN]);
+#else  /* MPU9250_USE_FIFO == 1 */
+    TEST_CHECK(mock.reg[MPU9250_CONFIG] == MPU9250_DLPF, "CONFIG 0x%02X",
+               mock.reg[MPU9250_CONFIG]);
+    TEST_CHECK(mock.reg[MPU9250_FIFO_EN] == 0, "FIFO_EN 0x%02X",
+               mock.reg[MPU9250_FIFO_EN]);
+#endif /* MPU9250_USE_FIFO == 1 */
+
+    TEST_CHECK(mock.reg[MPU9250_USER_CTRL] == user_ctrl, "USER_CTRL 0x%02X",
+               mock.reg[MPU9250_USER_CTRL]);
+    TEST_CHECK(mock.reg[MPU9250_PWR_MGMT_1] == 0x01, "PWR_MGMT_1 0x%02X",
+               mock.reg[MPU9250_PWR_MGMT_1]);
+    TEST_CHECK(mock.reg[MPU9250_SMPLRT_DIV_REG] == 0, "SMPLRT_DIV %u",
+               mock.reg[MPU9250_SMPLRT_DIV_REG]);
+    TEST_CHECK(mock.reg[MPU9250_GYRO_CONFIG] == (MPU9250_GYRO_FS << 3),
+               "GYRO_CONFIG 0x%02X", mock.reg[MPU9250_GYRO_CONFIG]);
+    TEST_CHECK(mock.reg[MPU9250_ACCEL_CONFIG] == (MPU9250_ACCEL_FS << 3),
+               "ACCEL_CONFIG 0x%02X", mock.reg[MPU9250_ACCEL_CONFIG]);
+    TEST_CHECK(mock.reg[MPU9250_ACCEL_CONFIG2] == MPU9250_DLPF,
+               "ACCEL_CONFIG2 0x%02X", mock.reg[MPU9250_ACCEL_CONFIG2]);
+    TEST_CHECK(mock.reg[MPU9250_I2C_MST_CTRL] == 0x4D, "I2C_MST_CTRL 0x%02X",
+               mock.reg[MPU9250_I2C_MST_CTRL]);
+    TEST_CHECK((mock.reg[MPU9250_I2C_SLV0_ADDR] ==
+                (AK8963_I2C_ADDR | MPU9250_SLV_READ)) &&
+                   (mock.reg[MPU9250_I2C_SLV0_REG] == AK8963_ST1) &&
+                   (mock.reg[MPU9250_I2C_SLV0_CTRL] ==
+                    (MPU9250_SLV_EN | MOCK_SLV0_LEN)),
+               "slave 0 does not read ST1 to ST2");
+    TEST_CHECK(mock.reg[MPU9250_INT_PIN_CFG] == 0, "INT_PIN_CFG 0x%02X",
+               mock.reg[MPU9250_INT_PIN_CFG]);
+    TEST_CHECK(mock.reg[MPU9250_INT_ENABLE] == MPU9250_RAW_RDY_EN,
+               "INT_ENABLE 0x%02X", mock.reg[MPU9250_INT_ENABLE]);
+    TEST_CHECK(mock.ak[AK8963_CNTL1] == MPU9250_MAG_MODE, "CNTL1 0x%02X",
+               mock.ak[AK8963_CNTL1]);
+}
+
+/**
+ * @brief 产生采样, 逐个检查驱动输出的采样
+ *
+ * @param num 采样数
+ * @param strict 为1时不能有丢失, 磁场和时间必须精确
+ */
+static void test_samples(uint32_t num, uint8_t strict) {
+    static uint32_t last;
+    static int32_t mag_last = -1;
+    static uint8_t started;
+    mpu9250_sample_t s;
+    mpu9250_stats_t stats;
+    uint32_t count = 0, gaps = 0;
+    uint32_t captures = mock.captures, reads;
+
+    mpu9250_get_stats(&stats);
+    reads = stats.reads;
+    for (uint32_t k = 0; k < num; ++k) {
+        mock_step();
+
+        while (mpu9250_read(&s) == 0) {
+            uint32_t lo = (uint16_t)s.accel[0];
+            uint32_t idx;
+            const mock_sample_t *e;
+            int16_t mag[3];
+            int32_t m;
+
+            /* 第一个采样是最近产生的采样中低15位相同的那一个 */
+            if (!started) {
+                last = mock.tick - 1 - ((mock.tick - 1 - lo) & 0x7FFF) - 1;
+                started = 1;
+            }
+            idx = last + 1 + ((lo - (last + 1)) & 0x7FFF);
+            e = &expect[idx % MOCK_SAMPLES];
+            count++;
+
+            TEST_CHECK(idx < mock.tick, "sample %u from the future",
+                       (unsigned int)idx);
+            if (idx != last + 1) {
+                gaps++;
+                TEST_CHECK(!strict, "lost samples before %u",
+                           (unsigned int)idx);
+                TEST_CHECK(s.flags & MPU9250_FLAG_GAP,
+                           "samples %u..%u lost without a gap flag",
+                           (unsigned int)(last + 1), (unsigned int)(idx - 1));
+            } else if (strict) {
+                TEST_CHECK(!(s.flags & MPU9250_FLAG_GAP),
+                           "gap flag on sample %u", (unsigned int)idx);
+            }
+            last = idx;
+
+            for (uint32_t i = 0; i < 3; ++i) {
+                TEST_CHECK(s.accel[i] == (int16_t)((e->data[i * 2] << 8) |
+                                                   e->data[i * 2 + 1]),
+                           "sample %u accel mismatch", (unsigned int)idx);
+                TEST_CHECK(s.gyro[i] == (int16_t)((e->data[8 + i * 2] << 8) |
+                                                  e->data[9 + i * 2]),
+                           "sample %u gyro mismatch", (unsigned int)idx);
+            }
+            TEST_CHECK(s.temp == (int16_t)((e->data[6] << 8) | e->data[7]),
+                       "sample %u temp mismatch", (unsigned int)idx);
+
+            /* 带MAG标志的采样就是读到新磁场的那一个 */
+            TEST_CHECK(((s.flags & MPU9250_FLAG_MAG) != 0) == (e->mag >= 0),
+                       "sample %u mag flag 0x%X", (unsigned int)idx,
+                       (unsigned int)s.flags);
+            TEST_CHECK(!(s.flags & MPU9250_FLAG_MAG_GAP),
+                       "sample %u mag gap", (unsigned int)idx);
+            m = (s.mag[0] == 0) ? -1 : ((uint16_t)s.mag[0] - 1);
+            mock_mag_value(m, mag);
+            TEST_CHECK(memcmp(mag, s.mag, sizeof(mag)) == 0,
+                       "sample %u mag is not a measurement", (unsigned int)idx);
+            if (strict || (s.flags & MPU9250_FLAG_MAG)) {
+                TEST_CHECK(m == e->mag_last, "sample %u mag %d, expected %d",
+                           (unsigned int)idx, (int)m, (int)e->mag_last);
+            } else {
+                TEST_CHECK((m >= mag_last) && (m <= e->mag_last),
+                           "sample %u mag %d out of order", (unsigned int)idx,
+                           (int)m);
+            }
+            mag_last = m;
+
+#if (MPU9250_USE_FIFO == 1)
+            TEST_CHECK(abs((int32_t)(s.time - e->time)) <= MOCK_TIME_TOL,
+                       "sample %u time %u, expected %u", (unsigned int)idx,
+                       (unsigned int)s.time, (unsigned int)e->time);
+#else  /* MPU9250_USE_FIFO == 1 */
+            TEST_CHECK(s.time == e->time, "sample %u time %u, expected %u",
+                       (unsigned int)idx, (unsigned int)s.time,
+                       (unsigned int)e->time);
+#endif /* MPU9250_USE_FIFO == 1 */
+
+            if (test_failed > 20) {
+                exit(test_report(MOCK_NAME));
+            }
+        }
+    }
+
+    mpu9250_get_stats(&stats);
+    captures = mock.captures - captures;
+    reads = stats.reads - reads;
+    if (strict) {
+        TEST_CHECK((stats.errors == 0) && (stats.dropped == 0) &&
+                       (stats.overrun == 0) && (stats.overflow == 0),
+                   "errors %u, dropped %u, overrun %u, overflow %u",
+                   (unsigned int)stats.errors, (unsigned int)stats.dropped,
+                   (unsigned int)stats.overrun, (unsigned int)stats.overflow);
+        TEST_CHECK(count + MOCK_BATCH >= num, "%u of %u samples",
+                   (unsigned int)count, (unsigned int)num);
+        TEST_CHECK(captures <= num / mock.capture + 1,
+                   "%u interrupts for %u samples", (unsigned int)captures,
+                   (unsigned int)num);
+        TEST_CHECK(reads <= MOCK_READS(num), "%u reads for %u samples",
+                   (unsigned int)reads, (unsigned int)num);
+        printf("%u samples, %u interrupts, %u reads\r\n", (unsigned int)count,
+               (unsigned int)captures, (unsigned int)reads);
+    } else {
+        TEST_CHECK(stats.errors != 0, "no transfer errors");
+        printf("%u samples, %u gaps, %u errors injected, %u overrun, "
+               "%u overflow\r\n",
+               (unsigned int)count, (unsigned int)gaps,
+               (unsigned int)mock.errors, (unsigned int)stats.overrun,
+               (unsigned int)stats.overflow);
+    }
+}
+
+int main(void) {
+    test_init();
+
+    test_samples(20000, 1);
+
+    mock.error_rate = 50;
+    mock.delay_rate = 20;
+    mock.delay_max = 3;
+#if (MPU9250_USE_FIFO == 1)
+    /* 读取推迟时间过长, FIFO溢出 */
+    mock.stall_rate = 500;
+    mock.stall = 30;
+#endif /* MPU9250_USE_FIFO == 1 */
+    test_samples(200000, 0);
+
+    return test_report(MOCK_NAME);
+}
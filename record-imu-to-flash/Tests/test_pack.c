@@ -0,0 +1,122 @@
+/**
+ * @file    test_pack.c
+ * @author  Deadline039
+ * @brief   差分位压缩的主机测试
+ * @version 1.0
+ * @date    2026-10-17
+ * @note    随机生成各种形状的多列数据, 编码后解码必须逐位相同,
+ *          长度不超过`PACK_MAX_SIZE`; 缓冲区小一字节时编码失败,
+ *          数据少一字节时解码失败
+ */
+
+#include "test.h"
+
+#include "pack.h"
+
+#include <string.h>
+
+#define TEST_BLOCKS  200000
+#define TEST_COL_MAX 10
+#define TEST_NUM_MAX 64
+
+static uint32_t seed = 0x0A5C0071;
+
+/**
+ * @brief 生成一列数据
+ *
+ * @param col 列
+ * @param num 值数
+ */
+static void fill_column(int16_t *col, uint32_t num) {
+    uint32_t shape = host_rand(&seed) % 6;
+    int32_t v = (int16_t)host_rand(&seed), step = 0;
+    uint32_t amp = 1U << (host_rand(&seed) % 16);
+
+    for (uint32_t i = 0; i < num; ++i) {
+        switch (shape) {
+            case 0: {
+                /* 常数 */
+            } break;
+
+            case 1: {
+                /* 等间隔, 如采样时间 */
+                step = (step == 0) ? (int32_t)(host_rand(&seed) % 2000) : step;
+                v += step;
+            } break;
+
+            case 2: {
+                /* 随机游走 */
+                v += (int32_t)(host_rand(&seed) % (2 * amp + 1)) - (int32_t)amp;
+            } break;
+
+            case 3: {
+                /* 二阶平滑, 加速度缓慢变化 */
+                step += (int32_t)(host_rand(&seed) % 5) - 2;
+                v += step;
+            } break;
+
+            case 4: {
+                /* 等间隔偶尔抖动 */
+                step = (step == 0) ? 1000 : step;
+                v += step + (((host_rand(&seed) & 7) == 0)
+                                 ? (int32_t)(host_rand(&seed) % 41) - 20
+                                 : 0);
+            } break;
+
+            default: {
+                /* 满量程随机 */
+                v = (int16_t)host_rand(&seed);
+            } break;
+        }
+        col[i] = (int16_t)v;
+    }
+}
+
+int main(void) {
+    static int16_t data[TEST_COL_MAX * TEST_NUM_MAX * 2];
+    static int16_t out[TEST_COL_MAX * TEST_NUM_MAX * 2];
+    static uint8_t buf[PACK_MAX_SIZE(TEST_COL_MAX, TEST_NUM_MAX)];
+    uint64_t raw = 0, packed = 0;
+
+    for (uint32_t n = 0; n < TEST_BLOCKS; ++n) {
+        uint32_t col_num = 1 + host_rand(&seed) % TEST_COL_MAX;
+        uint32_t num = 1 + host_rand(&seed) % TEST_NUM_MAX;
+        uint32_t stride = num + host_rand(&seed) % (TEST_NUM_MAX + 1);
+        uint32_t len;
+
+        for (uint32_t c = 0; c < col_num; ++c) {
+            fill_column(&data[c * stride], num);
+        }
+
+        len = pack_encode(data, stride, col_num, num, buf, sizeof(buf));
+        TEST_CHECK(len != 0 && len <= PACK_MAX_SIZE(col_num, num),
+                   "block %u: length %u", (unsigned int)n, (unsigned int)len);
+        if (len == 0) {
+            continue;
+        }
+        raw += col_num * num * sizeof(int16_t);
+        packed += len;
+
+        memset(out, 0x55, sizeof(out));
+        TEST_CHECK(pack_decode(buf, len, out, stride, col_num, num) == 0,
+                   "block %u: decode failed", (unsigned int)n);
+        for (uint32_t c = 0; c < col_num; ++c) {
+            TEST_CHECK(memcmp(&data[c * stride], &out[c * stride],
+                              num * sizeof(int16_t)) == 0,
+                       "block %u: column %u differs", (unsigned int)n,
+                       (unsigned int)c);
+        }
+
+        TEST_CHECK(pack_encode(data, stride, col_num, num, buf, len - 1) == 0,
+                   "block %u: encoded into a short buffer", (unsigned int)n);
+        TEST_CHECK(pack_decode(buf, len - 1, out, stride, col_num, num) != 0,
+                   "block %u: decoded truncated data", (unsigned int)n);
+        if (test_failed > 10) {
+            break;
+        }
+    }
+
+    printf("%u blocks, ratio %.2f\r\n", TEST_BLOCKS,
+           (double)raw / (double)packed);
+    return test_report("pack");
+}
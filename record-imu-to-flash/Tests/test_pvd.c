@@ -0,0 +1,676 @@
+/**
+ * @file    test_pvd.c
+ * @author  Deadline039
+ * @brief   掉电刷写测试
+ * @version 1.0
+ * @date    2026-10-17
+ * @note    记录器和之前的姿态, 频谱, 统计, 抽取, 触发, Flash日志,
+ *          W25Qxx驱动和备份SRAM使用固件源文件, MPU9250换成按模拟时间产生的
+ *          1kHz采样, SPI总线换成w25q_sim.c中的模拟芯片. 在随机位置调用
+ *          PVD中断: 任意一个SPI事务开始时(可能打断DMA预读, 编程, 擦除,
+ *          等待芯片空闲和采样块分成多条记录写入的中间), 或主循环读取采样时.
+ *          关中断时推迟到开中断后. 中断结束当前的SPI事务, 被结束的页编程
+ *          只写入随机长度的一部分.
+ *
+ *          中断停在等待电压恢复时检查:
+ *          - 芯片空闲, 没有发出擦除, 编程的页数不超过预算
+ *          - 日志中的页都有效, 序号连续, 记录完整, 触发时暂存页中的数据已写入
+ *          - 抽取通道, 磁场和姿态的时间连续, 没有重复, 磁场和产生时相同;
+ *            只有掉电刷写的页数用完时才能缺少触发前已处理的采样
+ *          每次测试在子进程中运行, 都从空白芯片开始.
+ *          make test_pvd ARGS="次数 [种子]"
+ */
+
+#include "test.h"
+
+#include "ahrs.h"
+#include "attitude.h"
+#include "decimate.h"
+#include "dod.h"
+#include "pack.h"
+#include "quat.h"
+#include "recorder.h"
+#include "rtc.h"
+#include "timer.h"
+#include "trigger.h"
+#include "w25q_sim.h"
+
+#include <setjmp.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+/* 默认的测试次数 */
+#define TEST_TRIALS     200
+/* 触发位置的范围(次数), 按2的幂随机选上限, 挂载后很快触发的更多.
+   采样和SPI事务每毫秒至少一次, 页编程几十毫秒一次 */
+#define TEST_PVD_BITS         13
+#define TEST_PVD_BITS_PROGRAM 8
+/* 挂载后最多运行的时间(ms) */
+#define TEST_STEPS_MAX  20000
+/* 采样周期(us), 每隔几个采样有磁场, 平均每隔几个采样有一次冲击 */
+#define TEST_IMU_PERIOD 1000
+#define TEST_MAG_DIV    10
+#define TEST_SHOCK_RATE 64
+/* 每次测试最多打印的错误数 */
+#define TEST_MSG_MAX    10
+
+/* 触发位置 */
+#define PVD_AT_SAMPLE    0 /* 读取采样 */
+#define PVD_AT_SPI       1 /* SPI事务 */
+#define PVD_AT_PROGRAM   2 /* 页编程的事务 */
+#define PVD_AT_NUM       3
+
+/* 检查时间的数据 */
+#define PVD_STREAM_TRIGGER  0 /* 触发通道的采样 */
+#define PVD_STREAM_IMU      1 /* 抽取通道的采样 */
+#define PVD_STREAM_MAG      2 /* 磁场 */
+#define PVD_STREAM_ATTITUDE 3 /* 姿态 */
+#define PVD_STREAM_NUM      4
+
+/**
+ * @brief 各次测试共享的结果
+ */
+typedef struct {
+    uint32_t failed;    /*!< 失败次数 */
+    uint32_t trials;    /*!< 测试次数 */
+    uint32_t fired[PVD_AT_NUM]; /*!< 在各个位置触发的次数 */
+    uint32_t deferred;  /*!< 关中断时挂起的次数 */
+    uint32_t aborted;   /*!< 结束了页编程的次数 */
+    uint32_t suspended; /*!< 暂停了擦除的次数 */
+    uint32_t exhausted; /*!< 刷写页数用完的次数 */
+    uint32_t max_pages; /*!< 掉电后最多编程的页数 */
+    uint64_t max_time;  /*!< 掉电后最长的时间(ns) */
+    uint64_t entries;   /*!< 检查的采样, 磁场和姿态数 */
+} pvd_result_t;
+
+/**
+ * @brief 一种数据的时间
+ */
+typedef struct {
+    const char *name; /*!< 名称 */
+    uint32_t step;    /*!< 间隔(us), 0表示只要求递增 */
+    uint32_t lag;     /*!< 比输入的采样晚的时间(us) */
+    uint32_t first;   /*!< 第一个的时间 */
+    uint32_t next;    /*!< 下一个的时间 */
+    uint32_t num;     /*!< 已检查的个数 */
+} pvd_stream_t;
+
+spi_bus_t spi5_bus;
+
+static pvd_result_t *result;
+static uint32_t seed;
+static jmp_buf parked;
+static FILE *report;
+
+/* 下一个采样的时间(us)和序号, 产生过的采样和磁场. 等待Flash的时间也在
+   产生采样, 采样数会超过运行的毫秒数 */
+static uint32_t imu_time;
+static uint32_t imu_count;
+static int16_t imu_gen[2 * TEST_STEPS_MAX][6];
+static int16_t mag_gen[2 * TEST_STEPS_MAX / TEST_MAG_DIV][3];
+
+/* 第几次到达触发位置时触发, 关中断时挂起到开中断 */
+static uint8_t pvd_at;
+static uint32_t pvd_countdown;
+static uint8_t pvd_pending;
+static uint8_t pvd_fired;
+
+static pvd_stream_t stream[PVD_STREAM_NUM] = {
+    [PVD_STREAM_TRIGGER] = {"IMU channel 0", 0},
+    [PVD_STREAM_IMU] = {"IMU channel 1",
+                        DECIMATE_CH1_FACTOR * TEST_IMU_PERIOD,
+                        (DECIMATE_CH1_TAPS - 1) / 2 * TEST_IMU_PERIOD},
+    [PVD_STREAM_MAG] = {"mag", TEST_MAG_DIV * TEST_IMU_PERIOD},
+    [PVD_STREAM_ATTITUDE] = {"attitude", ATTITUDE_DIVIDER * TEST_IMU_PERIOD},
+};
+
+/* 触发时的状态 */
+static struct {
+    uint64_t time;     /*!< 时间 */
+    uint64_t programs; /*!< 编程次数 */
+    uint64_t erases;   /*!< 擦除次数 */
+    uint64_t aborts;   /*!< 结束的编程 */
+    uint64_t suspends; /*!< 暂停的擦除 */
+    uint32_t imu_time; /*!< 下一个采样的时间 */
+    uint32_t seq;      /*!< 暂存页的序号 */
+    uint32_t len;      /*!< 暂存页的数据长度 */
+    uint8_t data[FLASH_LOG_DATA_SIZE]; /*!< 暂存页的数据 */
+} snap;
+
+/**
+ * @brief 检查条件, 不满足时记一次失败, 只打印前几条
+ */
+#define PVD_CHECK(cond, ...)                                                  \
+    do {                                                                      \
+        if (!(cond)) {                                                        \
+            if (result->failed++ < TEST_MSG_MAX) {                            \
+                fprintf(report, "%s:%d: ", __FILE__, __LINE__);               \
+                fprintf(report, __VA_ARGS__);                                 \
+                fprintf(report, "\r\n");                                      \
+            }                                                                 \
+        }                                                                     \
+    } while (0)
+
+uint32_t HAL_GetTick(void) {
+    return (uint32_t)(w25q_sim_time / 1000000);
+}
+
+void HAL_Delay(uint32_t delay) {
+    w25q_sim_advance((uint64_t)delay * 1000000);
+}
+
+struct tm *rtc_get_time(void) {
+    static struct tm now = {.tm_year = 126, .tm_mon = 9, .tm_mday = 17};
+
+    return &now;
+}
+
+void pvd_init(uint32_t level) {
+    UNUSED(level);
+}
+
+/**
+ * @brief 中断等待电压恢复时回到测试
+ *
+ * @return 不返回
+ */
+uint8_t pvd_is_low(void) {
+    longjmp(parked, 1);
+}
+
+uint32_t timer_ts_get_freq(void) {
+    return TIMER_TS_FREQ;
+}
+
+void mpu9250_get_stats(mpu9250_stats_t *stats) {
+    memset(stats, 0, sizeof(*stats));
+}
+
+void assert_failed(uint8_t *file, uint32_t line) {
+    PVD_CHECK(0, "assert failed at %s:%u", (const char *)file,
+              (unsigned int)line);
+}
+
+/* 没有调用eeprom_init, 校准参数读不到, 也不会写入 */
+HAL_StatusTypeDef HAL_FLASH_Unlock(void) {
+    return HAL_ERROR;
+}
+
+HAL_StatusTypeDef HAL_FLASH_Lock(void) {
+    return HAL_ERROR;
+}
+
+HAL_StatusTypeDef HAL_FLASH_Program(uint32_t type, uint32_t addr,
+                                    uint64_t data) {
+    UNUSED(type);
+    UNUSED(addr);
+    UNUSED(data);
+
+    return HAL_ERROR;
+}
+
+HAL_StatusTypeDef HAL_FLASHEx_Erase(FLASH_EraseInitTypeDef *init,
+                                    uint32_t *error) {
+    UNUSED(init);
+    UNUSED(error);
+
+    return HAL_ERROR;
+}
+
+/**
+ * @brief 执行PVD中断
+ *
+ */
+static void pvd_fire(void) {
+    flash_log_t *log = recorder_get_log();
+
+    pvd_pending = 0;
+    pvd_fired = 1;
+    snap.time = w25q_sim_time;
+    snap.programs = w25q_sim_stats.programs;
+    snap.erases = w25q_sim_stats.erases;
+    snap.aborts = w25q_sim_stats.aborts;
+    snap.suspends = w25q_sim_stats.suspends;
+    snap.imu_time = imu_time;
+    snap.seq = log->seq;
+    snap.len = log->buf_len;
+    memcpy(snap.data, log->page.data, snap.len);
+
+    HAL_PWR_PVDCallback();
+    PVD_CHECK(0, "PVD handler returned");
+}
+
+/**
+ * @brief 到达一个可以触发的位置
+ *
+ * @param at 触发位置
+ */
+static void pvd_point(uint8_t at) {
+    if (pvd_fired || pvd_pending || (at != pvd_at) ||
+        (pvd_countdown == 0) || (--pvd_countdown != 0)) {
+        return;
+    }
+
+    result->fired[at]++;
+    pvd_pending = 1;
+    if (host_get_primask() == 0) {
+        pvd_fire();
+    } else {
+        result->deferred++;
+    }
+}
+
+void host_irq_unmasked(void) {
+    if (pvd_pending) {
+        pvd_fire();
+    }
+}
+
+void w25q_sim_command_callback(spi_trans_t *trans) {
+    pvd_point(PVD_AT_SPI);
+    if (trans->cmd[0] == 0x02) {
+        pvd_point(PVD_AT_PROGRAM);
+    }
+}
+
+/**
+ * @brief 按模拟时间产生采样
+ *
+ * @param[out] sample 采样
+ * @return 0-有采样, 1-没有到采样时间
+ * @note 静止加噪声, 冲击时触发, 触发通道的采样压缩不下, 采样块要分成
+ *       多条记录写入
+ */
+uint8_t mpu9250_read(mpu9250_sample_t *sample) {
+    uint8_t shock;
+
+    if ((uint32_t)(w25q_sim_time / 1000) - imu_time > 0x80000000U) {
+        return 1;
+    }
+    pvd_point(PVD_AT_SAMPLE);
+
+    shock = (host_rand(&seed) % TEST_SHOCK_RATE == 0);
+    memset(sample, 0, sizeof(*sample));
+    sample->time = imu_time;
+    for (uint32_t i = 0; i < 3; ++i) {
+        sample->accel[i] = (int16_t)((i == 2 ? 16384 : 0) +
+                                     (int16_t)(host_rand(&seed) % 64) - 32);
+        sample->gyro[i] = (int16_t)((int16_t)(host_rand(&seed) % 32) - 16);
+        if (shock) {
+            sample->accel[i] = (int16_t)host_rand(&seed);
+            sample->gyro[i] = (int16_t)host_rand(&seed);
+        }
+        sample->mag[i] = (int16_t)(100 * i + host_rand(&seed) % 8);
+    }
+    sample->temp = 2000;
+    if (imu_count < sizeof(imu_gen) / sizeof(imu_gen[0])) {
+        memcpy(&imu_gen[imu_count][0], sample->accel, sizeof(sample->accel));
+        memcpy(&imu_gen[imu_count][3], sample->gyro, sizeof(sample->gyro));
+    }
+    if ((imu_count % TEST_MAG_DIV == 0) &&
+        (imu_count / TEST_MAG_DIV < sizeof(mag_gen) / sizeof(mag_gen[0]))) {
+        sample->flags |= MPU9250_FLAG_MAG;
+        memcpy(mag_gen[imu_count / TEST_MAG_DIV], sample->mag,
+               sizeof(sample->mag));
+    }
+
+    imu_time += TEST_IMU_PERIOD;
+    imu_count++;
+    return 0;
+}
+
+/**
+ * @brief 检查日志中的下一个时间
+ *
+ * @param s 数据
+ * @param time 时间(us)
+ * @param p 所在的页号
+ */
+static void pvd_stream_put(pvd_stream_t *s, uint32_t time, uint32_t p) {
+    if (s->step == 0) {
+        PVD_CHECK((s->num == 0) || (time > s->next),
+                  "page %u has %s at %u us after %u us", (unsigned int)p,
+                  s->name, (unsigned int)time, (unsigned int)s->next);
+        s->next = time;
+        s->num++;
+        result->entries++;
+        return;
+    }
+
+    /* 抽取滤波器刚开始时的输出都是第一个采样的时间, 之后的相位不定 */
+    if (s->num == 0) {
+        s->first = time;
+        s->next = time;
+    } else if ((s->lag != 0) && (s->next == s->first + s->step)) {
+        if (time == s->first) {
+            return;
+        }
+        s->next = time;
+    }
+
+    PVD_CHECK(time == s->next,
+              "page %u has %s at %u us after %u us", (unsigned int)p, s->name,
+              (unsigned int)time, (unsigned int)(s->next - s->step));
+    s->next = time + s->step;
+    s->num++;
+    result->entries++;
+}
+
+/**
+ * @brief 检查一条IMU采样块记录
+ *
+ * @param hdr 记录头
+ * @param data 记录数据
+ * @param p 所在的页号
+ */
+static void pvd_check_imu(const record_hdr_t *hdr, const uint8_t *data,
+                          uint32_t p) {
+    static int16_t column[IMU_COLUMN_NUM][RECORDER_IMU_BLOCK];
+    record_imu_block_t block;
+    uint32_t time, index;
+
+    memcpy(&block, data, sizeof(block));
+    if ((hdr->channel >= DECIMATE_CHANNEL_NUM) ||
+        (block.num > RECORDER_IMU_BLOCK)) {
+        return;
+    }
+
+    if (hdr->type == RECORD_TYPE_IMU_PACKED) {
+        PVD_CHECK(pack_decode(data + sizeof(block), hdr->len - sizeof(block),
+                              &column[0][0], RECORDER_IMU_BLOCK,
+                              IMU_COLUMN_NUM, block.num) == 0,
+                  "page %u has a broken IMU block", (unsigned int)p);
+    } else {
+        for (uint32_t c = 0; c < IMU_COLUMN_NUM; ++c) {
+            memcpy(&column[c][0],
+                   data + sizeof(block) + c * block.stride * sizeof(int16_t),
+                   block.num * sizeof(int16_t));
+        }
+    }
+
+    for (uint32_t i = 0; i < block.num; ++i) {
+        time = block.base + i * block.step +
+               (uint32_t)(int32_t)column[IMU_COLUMN_TIME][i];
+        if (hdr->channel == 1) {
+            pvd_stream_put(&stream[PVD_STREAM_IMU], time, p);
+            continue;
+        }
+
+        /* 触发通道记录原始采样 */
+        pvd_stream_put(&stream[PVD_STREAM_TRIGGER], time, p);
+        index = time / TEST_IMU_PERIOD;
+        PVD_CHECK((index < sizeof(imu_gen) / sizeof(imu_gen[0])) &&
+                      (column[IMU_COLUMN_AX][i] == imu_gen[index][0]) &&
+                      (column[IMU_COLUMN_AZ][i] == imu_gen[index][2]) &&
+                      (column[IMU_COLUMN_GX][i] == imu_gen[index][3]) &&
+                      (column[IMU_COLUMN_GZ][i] == imu_gen[index][5]),
+                  "page %u has a sample at %u us never sampled",
+                  (unsigned int)p, (unsigned int)time);
+    }
+}
+
+/**
+ * @brief 检查一条磁场或姿态块记录
+ *
+ * @param hdr 记录头
+ * @param data 记录数据
+ * @param p 所在的页号
+ */
+static void pvd_check_block(const record_hdr_t *hdr, const uint8_t *data,
+                            uint32_t p) {
+    record_mag_t mag;
+    record_attitude_t attitude;
+    uint32_t base, num, offset, time, index;
+    pvd_stream_t *s;
+    dod_t dod;
+
+    if (hdr->type == RECORD_TYPE_MAG) {
+        memcpy(&mag, data, sizeof(mag));
+        s = &stream[PVD_STREAM_MAG];
+        base = mag.base;
+        num = mag.num;
+        offset = sizeof(mag) + num * sizeof(mag_gen[0]);
+    } else {
+        memcpy(&attitude, data, sizeof(attitude));
+        s = &stream[PVD_STREAM_ATTITUDE];
+        base = attitude.base;
+        num = attitude.num;
+        offset = sizeof(attitude) + num * QUAT_SIZE(attitude.bits);
+    }
+    if (offset > hdr->len) {
+        PVD_CHECK(0, "page %u has a broken %s block", (unsigned int)p,
+                  s->name);
+        return;
+    }
+
+    dod_init(&dod, base);
+    dod_set_buffer(&dod, (void *)(data + offset), hdr->len - offset);
+    for (uint32_t i = 0; i < num; ++i) {
+        if (dod_get(&dod, &time) != 0) {
+            PVD_CHECK(0, "page %u has a broken %s block", (unsigned int)p,
+                      s->name);
+            return;
+        }
+        pvd_stream_put(s, time, p);
+
+        index = time / s->step;
+        if (hdr->type == RECORD_TYPE_MAG) {
+            PVD_CHECK((index < sizeof(mag_gen) / sizeof(mag_gen[0])) &&
+                          (memcmp(data + sizeof(mag) + i * sizeof(mag_gen[0]),
+                                  mag_gen[index], sizeof(mag_gen[0])) == 0),
+                      "page %u has mag at %u us never sampled",
+                      (unsigned int)p, (unsigned int)time);
+        }
+    }
+}
+
+/**
+ * @brief 中断停下后检查日志
+ *
+ */
+static void pvd_verify(void) {
+    static flash_log_page_t page;
+    flash_log_t *log = recorder_get_log();
+    record_hdr_t hdr;
+    uint32_t offset, last_seq = 0, staged = 0, exhausted;
+    uint32_t pages = (uint32_t)(w25q_sim_stats.programs - snap.programs -
+                                (w25q_sim_stats.aborts - snap.aborts));
+    uint64_t time = w25q_sim_time - snap.time;
+    pvd_stream_t *s;
+
+    PVD_CHECK(!w25q_sim_busy(0), "flash still busy when parked");
+    PVD_CHECK(w25q_sim_stats.erases == snap.erases, "erase issued after PVD");
+    PVD_CHECK(w25q_sim_stats.violations == 0,
+              "%u commands the chip would ignore",
+              (unsigned int)w25q_sim_stats.violations);
+
+    /* 预算按每页(编程时间 + 传输时间)计算, 被打断的页重新编程占一页,
+       被结束的编程不计 */
+    PVD_CHECK(pages <= RECORDER_PVD_FLUSH_PAGES + 1,
+              "%u pages programmed after PVD", (unsigned int)pages);
+    if (pages > result->max_pages) {
+        result->max_pages = pages;
+    }
+    if (time > result->max_time) {
+        result->max_time = time;
+    }
+    result->aborted += (w25q_sim_stats.aborts != snap.aborts);
+    result->suspended += (w25q_sim_stats.suspends != snap.suspends);
+
+    for (uint32_t p = log->tail; p != log->head; p = (p + 1) % log->page_num) {
+        if (flash_log_read_page(log, p, &page) != 0) {
+            PVD_CHECK(0, "page %u is invalid", (unsigned int)p);
+            continue;
+        }
+        PVD_CHECK((last_seq == 0) || (page.hdr.seq == last_seq + 1),
+                  "page %u seq %u after seq %u", (unsigned int)p,
+                  (unsigned int)page.hdr.seq, (unsigned int)last_seq);
+        last_seq = page.hdr.seq;
+
+        if ((page.hdr.seq == snap.seq) && (page.hdr.len >= snap.len) &&
+            (memcmp(page.data, snap.data, snap.len) == 0)) {
+            staged = 1;
+        }
+
+        for (offset = 0; offset + sizeof(hdr) <= page.hdr.len;
+             offset += sizeof(hdr) + hdr.len) {
+            memcpy(&hdr, page.data + offset, sizeof(hdr));
+            if ((hdr.type >= RECORD_TYPE_NUM) ||
+                (offset + sizeof(hdr) + hdr.len > page.hdr.len)) {
+                break;
+            }
+
+            if ((hdr.type == RECORD_TYPE_IMU_PACKED) ||
+                (hdr.type == RECORD_TYPE_IMU_BLOCK)) {
+                pvd_check_imu(&hdr, page.data + offset + sizeof(hdr), p);
+            } else if ((hdr.type == RECORD_TYPE_MAG) ||
+                       (hdr.type == RECORD_TYPE_ATTITUDE)) {
+                pvd_check_block(&hdr, page.data + offset + sizeof(hdr), p);
+            }
+        }
+        PVD_CHECK(offset == page.hdr.len, "page %u has a broken record at %u",
+                  (unsigned int)p, (unsigned int)offset);
+    }
+    PVD_CHECK(log->buf_len == 0, "%u bytes left in the staging page",
+              (unsigned int)log->buf_len);
+    PVD_CHECK((snap.len == 0) || staged,
+              "staging page seq %u with %u bytes not written",
+              (unsigned int)snap.seq, (unsigned int)snap.len);
+
+    /* 触发时可能正在处理上一个采样, 更早的都应写入,
+       只有刷写页数用完时才能缺少. 触发缓冲区中的采样掉电时不写入 */
+    exhausted = (log->seq - snap.seq >= RECORDER_PVD_FLUSH_PAGES) ||
+                (log->head == log->emergency_end);
+    for (uint32_t i = 0; i < PVD_STREAM_NUM; ++i) {
+        s = &stream[i];
+        if ((s->step == 0) || (s->num == 0) ||
+            (s->next + s->lag + TEST_IMU_PERIOD >= snap.imu_time)) {
+            continue;
+        }
+        PVD_CHECK(exhausted, "%s after %u us lost, PVD at %u us", s->name,
+                  (unsigned int)(s->next - s->step),
+                  (unsigned int)snap.imu_time);
+        result->exhausted++;
+        break;
+    }
+}
+
+/**
+ * @brief 一次测试, 在子进程中运行
+ *
+ */
+static void pvd_trial(void) {
+    uint32_t bits;
+
+    /* 固件的打印不输出 */
+    report = fdopen(dup(STDOUT_FILENO), "w");
+    setvbuf(report, NULL, _IOLBF, 0);
+    if (freopen("/dev/null", "w", stdout) == NULL) {
+        exit(2);
+    }
+
+    if (w25q_sim_attach(0, W25QXX_CS_GPIO_PORT, W25QXX_CS_GPIO_PIN, W25Q16,
+                        NULL) != 0) {
+        exit(2);
+    }
+    w25q_sim_seed = host_rand(&seed);
+    w25q_sim_clock = 22500000;
+    w25q_sim_power_on();
+
+    if (setjmp(parked) != 0) {
+        pvd_verify();
+        return;
+    }
+
+    backup_init();
+    recorder_init();
+#if (CALIB_ENABLE == 1)
+    calib_init();
+#endif /* CALIB_ENABLE == 1 */
+    ahrs_init();
+#if (ATTITUDE_ENABLE == 1)
+    attitude_init();
+#endif /* ATTITUDE_ENABLE == 1 */
+    decimate_init();
+#if (SPECTRUM_ENABLE == 1)
+    spectrum_init();
+#endif /* SPECTRUM_ENABLE == 1 */
+#if (TRIGGER_ENABLE == 1)
+    trigger_init();
+#endif /* TRIGGER_ENABLE == 1 */
+#if (SUMMARY_ENABLE == 1)
+    summary_init();
+#endif /* SUMMARY_ENABLE == 1 */
+
+    pvd_at = host_rand(&seed) % PVD_AT_NUM;
+    bits = (pvd_at == PVD_AT_PROGRAM) ? TEST_PVD_BITS_PROGRAM : TEST_PVD_BITS;
+    pvd_countdown =
+        1 + host_rand(&seed) % (1U << (host_rand(&seed) % (bits + 1)));
+
+    for (uint32_t step = 0; step < TEST_STEPS_MAX; ++step) {
+        recorder_poll();
+        w25q_sim_advance(1000000);
+    }
+
+    PVD_CHECK(0, "PVD never triggered");
+}
+
+int main(int argc, char *argv[]) {
+    uint32_t trials = TEST_TRIALS;
+    int status;
+
+    report = stdout;
+    seed = 0x7A2E0051;
+    if (argc > 1) {
+        trials = (uint32_t)strtoul(argv[1], NULL, 0);
+    }
+    if (argc > 2) {
+        seed = (uint32_t)strtoul(argv[2], NULL, 0);
+    }
+
+    result = mmap(NULL, sizeof(pvd_result_t), PROT_READ | PROT_WRITE,
+                  MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (result == MAP_FAILED) {
+        return 2;
+    }
+    memset(result, 0, sizeof(*result));
+
+    for (uint32_t n = 0; (n < trials) && (result->failed == 0); ++n) {
+        seed = host_rand(&seed);
+        if (fork() == 0) {
+            pvd_trial();
+            exit(0);
+        }
+        if ((wait(&status) < 0) || !WIFEXITED(status) ||
+            (WEXITSTATUS(status) != 0)) {
+            PVD_CHECK(0, "trial %u crashed", (unsigned int)n);
+        }
+        result->trials++;
+        if (result->failed != 0) {
+            printf("trial %u failed\r\n", (unsigned int)n);
+        }
+    }
+
+    printf("%u trials, fired %u times reading samples, %u in SPI "
+           "commands, %u in page programs\r\n",
+           (unsigned int)result->trials,
+           (unsigned int)result->fired[PVD_AT_SAMPLE],
+           (unsigned int)result->fired[PVD_AT_SPI],
+           (unsigned int)result->fired[PVD_AT_PROGRAM]);
+    printf("%u deferred until interrupts were enabled, "
+           "%llu samples, mags and attitudes checked\r\n",
+           (unsigned int)result->deferred,
+           (unsigned long long)result->entries);
+    printf("%u programs aborted, %u erases suspended, %u out of budget\r\n",
+           (unsigned int)result->aborted, (unsigned int)result->suspended,
+           (unsigned int)result->exhausted);
+    printf("at most %u pages and %.2f ms after PVD\r\n",
+           (unsigned int)result->max_pages, (double)result->max_time / 1e6);
+
+    test_failed = result->failed;
+    return test_report("test_pvd");
+}
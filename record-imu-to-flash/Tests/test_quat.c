@@ -0,0 +1,154 @@
+/**
+ * @file    test_quat.c
+ * @author  Deadline039
+ * @brief   四元数压缩的主机测试
+ * @version 1.0
+ * @date    2026-10-17
+ * @note    每种位数编码球面上均匀分布的随机姿态和边界情况, 按quat.h中的
+ *          格式用双精度独立解码, 与`quat_decode`对比; 解码后与原姿态的转角
+ *          不超过`quat_max_error`. q和-q的编码相同, 无效编码被拒绝
+ */
+
+#include "test.h"
+
+#include "quat.h"
+
+#include <math.h>
+#include <string.h>
+
+#define TEST_QUATS 200000
+
+static uint32_t seed = 0x0A710073;
+
+/**
+ * @brief 标准正态分布
+ */
+static double gauss(void) {
+    double u = ((host_rand(&seed) >> 8) + 1.0) / 16777217.0;
+    double v = (host_rand(&seed) >> 8) / 16777216.0;
+
+    return sqrt(-2.0 * log(u)) * cos(2.0 * M_PI * v);
+}
+
+/**
+ * @brief 按格式说明解码, 双精度
+ *
+ * @param in 编码
+ * @param bits 每个分量的位数
+ * @param[out] q 四元数
+ */
+static void ref_decode(const uint8_t *in, uint32_t bits, double q[4]) {
+    uint32_t pos = 2, largest = in[0] & 0x03;
+    double sum = 0.0, max = (double)((1U << bits) - 1);
+
+    for (uint32_t i = 0; i < 4; ++i) {
+        uint32_t n = 0;
+
+        if (i == largest) {
+            continue;
+        }
+        for (uint32_t b = 0; b < bits; ++b, ++pos) {
+            n |= (uint32_t)((in[pos / 8] >> (pos % 8)) & 1) << b;
+        }
+        q[i] = (n / max * 2.0 - 1.0) * sqrt(0.5);
+        sum += q[i] * q[i];
+    }
+    q[largest] = sqrt(fmax(0.0, 1.0 - sum));
+}
+
+/**
+ * @brief 两个姿态之间的转角
+ */
+static double angle(const double a[4], const double b[4]) {
+    double dot = 0.0, na = 0.0, nb = 0.0;
+
+    for (uint32_t i = 0; i < 4; ++i) {
+        dot += a[i] * b[i];
+        na += a[i] * a[i];
+        nb += b[i] * b[i];
+    }
+    dot = fabs(dot) / sqrt(na * nb);
+
+    return 2.0 * acos(fmin(1.0, dot));
+}
+
+/**
+ * @brief 编码再解码一个姿态
+ *
+ * @param q 姿态
+ * @param bits 每个分量的位数
+ * @return 转角(rad)
+ */
+static double round_trip(const double q[4], uint32_t bits) {
+    uint8_t code[QUAT_SIZE(QUAT_BITS_MAX)], neg[QUAT_SIZE(QUAT_BITS_MAX)];
+    float in[4], out[4];
+    double got[4], ref[4], err;
+
+    for (uint32_t i = 0; i < 4; ++i) {
+        in[i] = (float)q[i];
+    }
+    quat_encode(in, bits, code);
+
+    TEST_CHECK(quat_decode(code, bits, out) == 0, "%u bits: decode failed",
+               (unsigned int)bits);
+    ref_decode(code, bits, ref);
+    for (uint32_t i = 0; i < 4; ++i) {
+        got[i] = out[i];
+        TEST_CHECK(fabs(got[i] - ref[i]) < 1e-6,
+                   "%u bits: component %u is %f, format says %f",
+                   (unsigned int)bits, (unsigned int)i, got[i], ref[i]);
+    }
+
+    /* 两个最大分量相等时-q可能去掉另一个分量, 此时只检查误差 */
+    for (uint32_t i = 0; i < 4; ++i) {
+        in[i] = -in[i];
+    }
+    quat_encode(in, bits, neg);
+    if ((code[0] & 0x03) == (neg[0] & 0x03)) {
+        TEST_CHECK(memcmp(code, neg, QUAT_SIZE(bits)) == 0,
+                   "%u bits: q and -q differ", (unsigned int)bits);
+    }
+
+    err = angle(q, got);
+    TEST_CHECK(err <= quat_max_error(bits),
+               "%u bits: error %.6f > bound %.6f", (unsigned int)bits, err,
+               (double)quat_max_error(bits));
+    return err;
+}
+
+int main(void) {
+    const double h = sqrt(0.5);
+    const double edge[][4] = {
+        {1.0, 0.0, 0.0, 0.0},  {0.0, 0.0, 0.0, -1.0}, {0.5, 0.5, 0.5, 0.5},
+        {-0.5, 0.5, -0.5, 0.5}, {h, h, 0.0, 0.0},     {0.0, -h, 0.0, h},
+        {0.6, 0.0, 0.8, 0.0},  {2.0, 0.0, 0.0, 0.0},  {0.1, -3.0, 0.2, 0.0},
+    };
+
+    for (uint32_t bits = QUAT_BITS_MIN; bits <= QUAT_BITS_MAX; ++bits) {
+        double q[4], worst = 0.0;
+        uint8_t code[QUAT_SIZE(QUAT_BITS_MAX)];
+        float out[4];
+
+        for (uint32_t i = 0; i < sizeof(edge) / sizeof(edge[0]); ++i) {
+            worst = fmax(worst, round_trip(edge[i], bits));
+        }
+        for (uint32_t n = 0; n < TEST_QUATS; ++n) {
+            for (uint32_t i = 0; i < 4; ++i) {
+                q[i] = gauss();
+            }
+            worst = fmax(worst, round_trip(q, bits));
+        }
+
+        /* 其余分量都取最大值时平方和为3 / 2, 不是有效的编码 */
+        memset(code, 0xFF, sizeof(code));
+        TEST_CHECK(quat_decode(code, bits, out) != 0,
+                   "%u bits: invalid code accepted", (unsigned int)bits);
+
+        printf("%2u bits, %u bytes: max error %.4f deg, bound %.4f deg\r\n",
+               (unsigned int)bits, (unsigned int)QUAT_SIZE(bits),
+               worst * 180.0 / M_PI,
+               (double)quat_max_error(bits) * 180.0 / M_PI);
+    }
+
+    return test_report("quat");
+}
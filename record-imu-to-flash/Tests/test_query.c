@@ -0,0 +1,586 @@
+/**
+ * @file    test_query.c
+ * @author  Deadline039
+ * @brief   日志检索测试
+ * @version 1.0
+ * @date    2026-10-17
+ * @note    检索, 记录器和之前的姿态, 频谱, 统计, 抽取, 触发, Flash日志,
+ *          W25Qxx驱动和备份SRAM使用固件源文件, MPU9250换成按模拟时间产生的
+ *          1kHz采样, 不时有持续几十毫秒的转动和冲击, SPI总线换成w25q_sim.c
+ *          中的模拟芯片, 命令串口换成缓冲区.
+ *
+ *          记录一段时间后先检查抽取通道: 除刷写时提交的最后一块外都是满的,
+ *          时间连续. 然后从串口发送按加速度, 角速度模检索的命令, 检索期间
+ *          继续记录. 结果和逐条解码日志中全部IMU采样记录得到的比较:
+ *          - 页摘要和块头中模的最大值不小于页内, 块内的每个采样
+ *          - 输出的记录, 满足的采样数和第一个满足的采样的时间相同
+ *          - 有页和块根据模的最大值跳过, 没有解码
+ *          make test_query ARGS="记录时间(s) [种子]"
+ */
+
+#include "test.h"
+
+#include "ahrs.h"
+#include "attitude.h"
+#include "decimate.h"
+#include "pack.h"
+#include "query.h"
+#include "recorder.h"
+#include "rtc.h"
+#include "timer.h"
+#include "trigger.h"
+#include "w25q_sim.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* 默认的记录时间(s) */
+#define TEST_SECONDS     60
+/* 采样周期(us), 每隔几个采样有磁场 */
+#define TEST_IMU_PERIOD  1000
+#define TEST_MAG_DIV     10
+/* 平均每多少个采样开始一次转动或冲击, 最长持续的采样数 */
+#define TEST_EVENT_RATE  1500
+#define TEST_EVENT_LEN   80
+/* 检索最多运行的时间(ms) */
+#define TEST_QUERY_STEPS 60000
+/* 每次检索最多的结果数 */
+#define TEST_EXPECT_MAX  4096
+/* 串口输出缓冲区大小 */
+#define TEST_OUT_SIZE    (1024 * 1024)
+
+/* 能解码的最大采样块, 同检索的上限 */
+#define TEST_BLOCK_MAX   64
+
+/**
+ * @brief 逐条检查得到的一条结果
+ */
+typedef struct {
+    uint32_t hits;  /*!< 满足的采样数 */
+    uint32_t first; /*!< 第一个满足的采样的时间(us) */
+} expect_t;
+
+/* 检索命令 */
+static const char *const test_cmds[] = {
+    "find gyro>500",
+    "find accel>4000",
+    "find accel>2500 gyro>300",
+    "find gyro>200 ch=1",
+};
+
+UART_HandleTypeDef usart1_handle = {.Instance = USART1,
+                                    .gState = HAL_UART_STATE_READY};
+spi_bus_t spi5_bus;
+
+static uint32_t seed;
+
+/* 下一个采样的时间(us)和正在进行的转动或冲击 */
+static uint32_t imu_time;
+static uint32_t event_left;
+static int16_t event_accel[3];
+static int16_t event_gyro[3];
+
+/* 串口收到的命令和发出的结果 */
+static const char *cmd_ptr;
+static char out_buf[TEST_OUT_SIZE];
+static uint32_t out_len;
+
+/* 逐条检查的结果 */
+static expect_t expect[TEST_EXPECT_MAX];
+static uint32_t expect_num;
+static uint32_t expect_blocks;
+static uint32_t expect_pages;
+
+uint32_t HAL_GetTick(void) {
+    return (uint32_t)(w25q_sim_time / 1000000);
+}
+
+void HAL_Delay(uint32_t delay) {
+    w25q_sim_advance((uint64_t)delay * 1000000);
+}
+
+struct tm *rtc_get_time(void) {
+    static struct tm now = {.tm_year = 126, .tm_mon = 9, .tm_mday = 17};
+
+    return &now;
+}
+
+void pvd_init(uint32_t level) {
+    UNUSED(level);
+}
+
+uint8_t pvd_is_low(void) {
+    return 1;
+}
+
+uint32_t timer_ts_get_freq(void) {
+    return TIMER_TS_FREQ;
+}
+
+void mpu9250_get_stats(mpu9250_stats_t *stats) {
+    memset(stats, 0, sizeof(*stats));
+}
+
+void assert_failed(uint8_t *file, uint32_t line) {
+    TEST_CHECK(0, "assert failed at %s:%u", (const char *)file,
+               (unsigned int)line);
+}
+
+/* 没有调用eeprom_init, 校准参数读不到, 也不会写入 */
+HAL_StatusTypeDef HAL_FLASH_Unlock(void) {
+    return HAL_ERROR;
+}
+
+HAL_StatusTypeDef HAL_FLASH_Lock(void) {
+    return HAL_ERROR;
+}
+
+HAL_StatusTypeDef HAL_FLASH_Program(uint32_t type, uint32_t addr,
+                                    uint64_t data) {
+    UNUSED(type);
+    UNUSED(addr);
+    UNUSED(data);
+
+    return HAL_ERROR;
+}
+
+HAL_StatusTypeDef HAL_FLASHEx_Erase(FLASH_EraseInitTypeDef *init,
+                                    uint32_t *error) {
+    UNUSED(init);
+    UNUSED(error);
+
+    return HAL_ERROR;
+}
+
+uint32_t uart_dmatx_write(UART_HandleTypeDef *huart, const void *data,
+                          size_t len) {
+    UNUSED(huart);
+
+    if (out_len + len >= sizeof(out_buf)) {
+        len = sizeof(out_buf) - 1 - out_len;
+    }
+    memcpy(out_buf + out_len, data, len);
+    out_len += (uint32_t)len;
+    out_buf[out_len] = '\0';
+
+    return (uint32_t)len;
+}
+
+uint32_t uart_dmatx_send(UART_HandleTypeDef *huart) {
+    UNUSED(huart);
+
+    return 0;
+}
+
+uint32_t uart_dmarx_read(UART_HandleTypeDef *huart, void *buf, size_t len) {
+    UNUSED(huart);
+
+    if ((cmd_ptr == NULL) || (*cmd_ptr == '\0') || (len == 0)) {
+        return 0;
+    }
+    *(char *)buf = *cmd_ptr++;
+
+    return 1;
+}
+
+/**
+ * @brief 按模拟时间产生采样
+ *
+ * @param[out] sample 采样
+ * @return 0-有采样, 1-没有到采样时间
+ * @note 静止加噪声, 转动和冲击时各轴为固定的随机值
+ */
+uint8_t mpu9250_read(mpu9250_sample_t *sample) {
+    if ((uint32_t)(w25q_sim_time / 1000) - imu_time > 0x80000000U) {
+        return 1;
+    }
+
+    if ((event_left == 0) && (host_rand(&seed) % TEST_EVENT_RATE == 0)) {
+        event_left = 1 + host_rand(&seed) % TEST_EVENT_LEN;
+        for (uint32_t i = 0; i < 3; ++i) {
+            event_accel[i] = (int16_t)((int32_t)(host_rand(&seed) % 40000) -
+                                       20000);
+            event_gyro[i] = (int16_t)((int32_t)(host_rand(&seed) % 20000) -
+                                      10000);
+        }
+    }
+
+    memset(sample, 0, sizeof(*sample));
+    sample->time = imu_time;
+    for (uint32_t i = 0; i < 3; ++i) {
+        sample->accel[i] =
+            (int16_t)((i == 2 ? (16384 >> MPU9250_ACCEL_FS) : 0) +
+                      (int16_t)(host_rand(&seed) % 64) - 32);
+        sample->gyro[i] = (int16_t)((int16_t)(host_rand(&seed) % 32) - 16);
+        if (event_left != 0) {
+            sample->accel[i] = event_accel[i];
+            sample->gyro[i] = event_gyro[i];
+        }
+        sample->mag[i] = (int16_t)(100 * i);
+    }
+    if (event_left != 0) {
+        event_left--;
+    }
+    sample->temp = 2000;
+    if ((imu_time / TEST_IMU_PERIOD) % TEST_MAG_DIV == 0) {
+        sample->flags |= MPU9250_FLAG_MAG;
+    }
+
+    imu_time += TEST_IMU_PERIOD;
+    return 0;
+}
+
+/**
+ * @brief 三个分量的平方和
+ *
+ * @param column 解码的采样块
+ * @param c 第一个分量的列
+ * @param i 采样序号
+ * @return 平方和
+ */
+static uint32_t test_sum2(int16_t (*column)[TEST_BLOCK_MAX], uint32_t c,
+                          uint32_t i) {
+    uint32_t sum = 0;
+
+    for (uint32_t k = 0; k < 3; ++k) {
+        sum += (uint32_t)(column[c + k][i] * column[c + k][i]);
+    }
+    return sum;
+}
+
+/**
+ * @brief 解码一条IMU采样块记录
+ *
+ * @param hdr 记录头
+ * @param data 记录数据
+ * @param p 所在的页号
+ * @param[out] block 块头
+ * @param[out] column 解码的采样
+ * @return 0-成功, 1-块损坏
+ */
+static uint8_t test_decode(const record_hdr_t *hdr, const uint8_t *data,
+                           uint32_t p, record_imu_block_t *block,
+                           int16_t (*column)[TEST_BLOCK_MAX]) {
+    memcpy(block, data, sizeof(*block));
+    TEST_CHECK((block->num != 0) && (block->num <= TEST_BLOCK_MAX),
+               "page %u has an IMU block of %u samples", (unsigned int)p,
+               (unsigned int)block->num);
+    if ((block->num == 0) || (block->num > TEST_BLOCK_MAX)) {
+        return 1;
+    }
+
+    if (hdr->type == RECORD_TYPE_IMU_PACKED) {
+        if (pack_decode(data + sizeof(*block), hdr->len - sizeof(*block),
+                        &column[0][0], TEST_BLOCK_MAX, IMU_COLUMN_NUM,
+                        block->num) != 0) {
+            TEST_CHECK(0, "page %u has a broken IMU block", (unsigned int)p);
+            return 1;
+        }
+    } else {
+        for (uint32_t c = 0; c < IMU_COLUMN_NUM; ++c) {
+            memcpy(&column[c][0],
+                   data + sizeof(*block) + c * block->stride * sizeof(int16_t),
+                   block->num * sizeof(int16_t));
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief 逐条检查一条IMU采样记录
+ *
+ * @param query 检索条件
+ * @param hdr 记录头
+ * @param data 记录数据
+ * @param p 所在的页号
+ * @param[out] peak 页内加速度和角速度模的平方的最大值
+ */
+static void test_check_imu(const query_t *query, const record_hdr_t *hdr,
+                           const uint8_t *data, uint32_t p, uint32_t peak[2]) {
+    static int16_t column[IMU_COLUMN_NUM][TEST_BLOCK_MAX];
+    float accel = (float)query->accel * (float)(16384 >> MPU9250_ACCEL_FS) /
+                  1000.0f;
+    float gyro =
+        (float)query->gyro * 32768.0f / (float)(250 << MPU9250_GYRO_FS);
+    record_imu_block_t block;
+    uint32_t sum[2], hits = 0, first = 0;
+
+    if (test_decode(hdr, data, p, &block, column) != 0) {
+        return;
+    }
+    expect_blocks++;
+
+    for (uint32_t i = 0; i < block.num; ++i) {
+        sum[0] = test_sum2(column, IMU_COLUMN_AX, i);
+        sum[1] = test_sum2(column, IMU_COLUMN_GX, i);
+        TEST_CHECK(((uint32_t)block.accel_peak * block.accel_peak >=
+                    sum[0]) &&
+                       ((uint32_t)block.gyro_peak * block.gyro_peak >=
+                        sum[1]),
+                   "page %u: sample above the block peak %u %u",
+                   (unsigned int)p, (unsigned int)block.accel_peak,
+                   (unsigned int)block.gyro_peak);
+        peak[0] = (sum[0] > peak[0]) ? sum[0] : peak[0];
+        peak[1] = (sum[1] > peak[1]) ? sum[1] : peak[1];
+
+        if (((query->accel == 0) || ((float)sum[0] > accel * accel)) &&
+            ((query->gyro == 0) || ((float)sum[1] > gyro * gyro))) {
+            if (hits++ == 0) {
+                first = block.base + i * block.step +
+                        (uint32_t)(int32_t)column[IMU_COLUMN_TIME][i];
+            }
+        }
+    }
+
+    if ((hits != 0) && (expect_num < TEST_EXPECT_MAX) &&
+        (query->types & (1U << hdr->type)) &&
+        (query->channels & (1U << (hdr->channel < 7 ? hdr->channel : 7)))) {
+        expect[expect_num].hits = hits;
+        expect[expect_num].first = first;
+        expect_num++;
+    }
+}
+
+/**
+ * @brief 逐页逐条检查日志中到写入位置为止的IMU采样记录
+ *
+ * @param query 检索条件
+ */
+static void test_expect(const query_t *query) {
+    static flash_log_page_t page;
+    flash_log_t *log = recorder_get_log();
+    record_meta_t meta;
+    record_hdr_t hdr;
+    uint32_t peak[2];
+
+    expect_num = 0;
+    expect_blocks = 0;
+    expect_pages = 0;
+
+    for (uint32_t p = log->tail; p != log->head; p = (p + 1) % log->page_num) {
+        if (flash_log_read_page(log, p, &page) != 0) {
+            continue;
+        }
+        expect_pages++;
+
+        peak[0] = 0;
+        peak[1] = 0;
+        for (uint32_t offset = 0; offset + sizeof(hdr) <= page.hdr.len;
+             offset += sizeof(hdr) + hdr.len) {
+            memcpy(&hdr, page.data + offset, sizeof(hdr));
+            if ((hdr.type == RECORD_TYPE_IMU_BLOCK) ||
+                (hdr.type == RECORD_TYPE_IMU_PACKED)) {
+                test_check_imu(query, &hdr, page.data + offset + sizeof(hdr),
+                               p, peak);
+            }
+        }
+
+        memcpy(&meta, page.hdr.meta, sizeof(meta));
+        TEST_CHECK(((uint32_t)meta.accel_peak * meta.accel_peak >= peak[0]) &&
+                       ((uint32_t)meta.gyro_peak * meta.gyro_peak >= peak[1]),
+                   "page %u: sample above the page peak %u %u",
+                   (unsigned int)p, (unsigned int)meta.accel_peak,
+                   (unsigned int)meta.gyro_peak);
+    }
+}
+
+/**
+ * @brief 检查抽取通道的采样块
+ *
+ * @note 记录后刷写一次, 只有最后一块可以不满. 拆分写入的几段记录
+ *       合起来算一块. 采样的时间间隔都是抽取后的采样周期. 滤波器启动时
+ *       输出的时间减去群延迟后不足0, 不规则, 这些采样所在的块不检查
+ */
+static void test_blocks(void) {
+    static flash_log_page_t page;
+    static int16_t column[IMU_COLUMN_NUM][TEST_BLOCK_MAX];
+    const uint32_t step = DECIMATE_CH1_FACTOR * TEST_IMU_PERIOD;
+    const uint32_t lag = (DECIMATE_CH1_TAPS - 1) / 2 * TEST_IMU_PERIOD;
+    flash_log_t *log = recorder_get_log();
+    uint32_t blocks = 0, partial = 0, samples = 0, num = 0, next = 0;
+    uint32_t start = 0;
+    uint32_t time;
+    record_imu_block_t block;
+    record_hdr_t hdr;
+
+    recorder_flush();
+    flash_log_sync(log);
+
+    for (uint32_t p = log->tail; p != log->head; p = (p + 1) % log->page_num) {
+        if (flash_log_read_page(log, p, &page) != 0) {
+            continue;
+        }
+        for (uint32_t offset = 0; offset + sizeof(hdr) <= page.hdr.len;
+             offset += sizeof(hdr) + hdr.len) {
+            memcpy(&hdr, page.data + offset, sizeof(hdr));
+            if (((hdr.type != RECORD_TYPE_IMU_BLOCK) &&
+                 (hdr.type != RECORD_TYPE_IMU_PACKED)) ||
+                (hdr.channel != 1) ||
+                (test_decode(&hdr, page.data + offset + sizeof(hdr), p,
+                             &block, column) != 0)) {
+                continue;
+            }
+
+            for (uint32_t i = 0; i < block.num; ++i) {
+                time = block.base + i * block.step +
+                       (uint32_t)(int32_t)column[IMU_COLUMN_TIME][i];
+                TEST_CHECK((samples == 0) || (time < lag) || (time == next),
+                           "page %u: channel 1 sample at %u us, expected %u",
+                           (unsigned int)p, (unsigned int)time,
+                           (unsigned int)next);
+                next = time + step;
+                samples++;
+            }
+
+            if ((num != 0) && (num + block.num <= RECORDER_IMU_BLOCK)) {
+                num += block.num;
+                continue;
+            }
+            if ((num != 0) && (num < RECORDER_IMU_BLOCK) && (start >= lag)) {
+                partial++;
+            }
+            num = block.num;
+            start = block.base;
+            blocks++;
+        }
+    }
+
+    printf("channel 1: %u samples in %u blocks of %u\r\n",
+           (unsigned int)samples, (unsigned int)blocks,
+           (unsigned int)RECORDER_IMU_BLOCK);
+    TEST_CHECK((blocks > 1) && (partial == 0),
+               "channel 1: %u of %u blocks not full", (unsigned int)partial,
+               (unsigned int)blocks);
+}
+
+/**
+ * @brief 记录, 同时检索, 比较结果
+ *
+ * @param cmd 检索命令
+ */
+static void test_query(const char *cmd) {
+    static char line_cmd[64];
+    unsigned int pages = 0, skipped = 0, blocks = 0, pruned = 0, matches = 0;
+    unsigned int hits, first;
+    uint32_t n = 0;
+    query_t query;
+    char *line, *next, *done = NULL;
+
+    TEST_CHECK(query_parse(cmd, &query) == 0, "%s: parse failed", cmd);
+
+    /* 提交正在填充的块后逐条检查, 检索开始时不再有新的记录 */
+    recorder_flush();
+    flash_log_sync(recorder_get_log());
+    test_expect(&query);
+
+    snprintf(line_cmd, sizeof(line_cmd), "%s\r\n", cmd);
+    cmd_ptr = line_cmd;
+    out_len = 0;
+    out_buf[0] = '\0';
+
+    /* 检索期间继续记录 */
+    query_poll();
+    for (uint32_t step = 0; step < TEST_QUERY_STEPS; ++step) {
+        done = strstr(out_buf, "Query done");
+        if (done != NULL) {
+            break;
+        }
+        recorder_poll();
+        query_poll();
+        w25q_sim_advance(1000000);
+    }
+    TEST_CHECK(done != NULL, "%s: no result within %u ms", cmd,
+               TEST_QUERY_STEPS);
+    if (done == NULL) {
+        return;
+    }
+
+    for (line = out_buf; line < done; line = next + 1) {
+        next = strchr(line, '\n');
+        *next = '\0';
+        line = strstr(line, "ms L");
+        TEST_CHECK((line != NULL) &&
+                       (sscanf(line, "ms L%*u: %u hits, first %uus", &hits,
+                               &first) == 2),
+                   "%s: result %u cannot be parsed", cmd, (unsigned int)n);
+        if (line == NULL) {
+            continue;
+        }
+        TEST_CHECK((n < expect_num) && (expect[n].hits == hits) &&
+                       (expect[n].first == first),
+                   "%s: result %u is %u hits at %u us, expected %u at %u",
+                   cmd, (unsigned int)n, hits, first,
+                   (unsigned int)((n < expect_num) ? expect[n].hits : 0),
+                   (unsigned int)((n < expect_num) ? expect[n].first : 0));
+        n++;
+    }
+
+    TEST_CHECK(sscanf(done,
+                      "Query done: %u pages, %u skipped, %u blocks decoded, "
+                      "%u skipped, %u matches",
+                      &pages, &skipped, &blocks, &pruned, &matches) == 5,
+               "%s: summary cannot be parsed", cmd);
+    TEST_CHECK((n == expect_num) && (matches == expect_num),
+               "%s: %u results, expected %u", cmd, (unsigned int)n,
+               (unsigned int)expect_num);
+    TEST_CHECK((skipped != 0) && (pruned != 0) && (blocks < expect_blocks),
+               "%s: nothing pruned", cmd);
+
+    printf("%s: %u matches, %u of %u pages skipped, %u blocks decoded, "
+           "%u skipped, %u in the log\r\n",
+           cmd, matches, skipped, pages, blocks, pruned,
+           (unsigned int)expect_blocks);
+}
+
+int main(int argc, char *argv[]) {
+    uint32_t seconds = TEST_SECONDS;
+
+    seed = 0x9E3779B9;
+    if (argc > 1) {
+        seconds = (uint32_t)strtoul(argv[1], NULL, 0);
+    }
+    if (argc > 2) {
+        seed = (uint32_t)strtoul(argv[2], NULL, 0);
+    }
+
+    if (w25q_sim_attach(0, W25QXX_CS_GPIO_PORT, W25QXX_CS_GPIO_PIN, W25Q16,
+                        NULL) != 0) {
+        return 2;
+    }
+    w25q_sim_clock = 22500000;
+    w25q_sim_power_on();
+
+    backup_init();
+    recorder_init();
+#if (CALIB_ENABLE == 1)
+    calib_init();
+#endif /* CALIB_ENABLE == 1 */
+    ahrs_init();
+#if (ATTITUDE_ENABLE == 1)
+    attitude_init();
+#endif /* ATTITUDE_ENABLE == 1 */
+    decimate_init();
+#if (SPECTRUM_ENABLE == 1)
+    spectrum_init();
+#endif /* SPECTRUM_ENABLE == 1 */
+#if (TRIGGER_ENABLE == 1)
+    trigger_init();
+#endif /* TRIGGER_ENABLE == 1 */
+#if (SUMMARY_ENABLE == 1)
+    summary_init();
+#endif /* SUMMARY_ENABLE == 1 */
+
+    for (uint32_t step = 0; step < seconds * 1000; ++step) {
+        recorder_poll();
+        w25q_sim_advance(1000000);
+    }
+    test_blocks();
+
+    for (uint32_t i = 0; i < sizeof(test_cmds) / sizeof(test_cmds[0]); ++i) {
+        test_query(test_cmds[i]);
+    }
+
+    return test_report("test_query");
+}
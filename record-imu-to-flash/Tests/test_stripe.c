@@ -0,0 +1,169 @@
+/**
+ * @file    test_stripe.c
+ * @author  Deadline039
+ * @brief   Flash日志写入吞吐量测试
+ * @version 1.0
+ * @date    2026-10-17
+ * @note    Flash日志, W25Qxx驱动和备份域使用固件源文件, SPI总线换成
+ *          w25q_sim.c中的模拟芯片, 按数据手册的典型时序计时. 数据来得
+ *          比Flash写得快, 连续写满暂存页并刷写, 测量模拟时间内写入的数据量:
+ *          - 连续写入: 每个扇区开头的页要等预擦除完成
+ *          - 扇区内写入: 不计每个扇区开头等待擦除的页
+ *          和按时序估算的吞吐量比较, 一片时每页是传输时间加编程时间,
+ *          两片时一片编程的同时向另一片传输, 每页只需要一半的时间,
+ *          但不能少于传输时间. 一片和两片Flash各编译一次.
+ *          make test_stripe ARGS="扇区数"
+ */
+
+#include "test.h"
+
+#include "flash_log.h"
+#include "w25q_sim.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* 默认写入的扇区数 */
+#define TEST_SECTORS    64
+/* SPI时钟(Hz) */
+#define TEST_SPI_CLOCK  22500000
+/* 实测不能低于估算值的比例(%) */
+#define TEST_MIN_RATIO  90
+
+spi_bus_t spi5_bus;
+
+static w25qxx_t flash_dev[FLASH_LOG_CHIP_NUM] = {
+    {.bus = &spi5_bus,
+     .cs_port = W25QXX_CS_GPIO_PORT,
+     .cs_pin = W25QXX_CS_GPIO_PIN},
+#if (FLASH_LOG_CHIP_NUM == 2)
+    {.bus = &spi5_bus,
+     .cs_port = W25QXX_CS2_GPIO_PORT,
+     .cs_pin = W25QXX_CS2_GPIO_PIN},
+#endif /* FLASH_LOG_CHIP_NUM == 2 */
+};
+static flash_log_t log_handle;
+
+uint32_t HAL_GetTick(void) {
+    return (uint32_t)(w25q_sim_time / 1000000);
+}
+
+void HAL_Delay(uint32_t delay) {
+    w25q_sim_advance((uint64_t)delay * 1000000);
+}
+
+void assert_failed(uint8_t *file, uint32_t line) {
+    TEST_CHECK(0, "assert failed at %s:%u", (const char *)file,
+               (unsigned int)line);
+}
+
+/**
+ * @brief 按时序估算每页的写入时间
+ *
+ * @return 时间(ns)
+ * @note 传输时间含写使能和页编程两个事务
+ */
+static double stripe_page_model(void) {
+    double xfer = (double)(1 + 4 + W25QXX_PAGE_SIZE) * 8 * 1e9 /
+                      TEST_SPI_CLOCK +
+                  2 * (double)W25Q_SIM_T_TRANS;
+    double page = (xfer + (double)W25Q_SIM_T_PP) / FLASH_LOG_CHIP_NUM;
+
+    return (page > xfer) ? page : xfer;
+}
+
+/**
+ * @brief 吞吐量
+ *
+ * @param bytes 字节数
+ * @param ns 时间(ns)
+ * @return KB/s
+ */
+static double stripe_rate(double bytes, double ns) {
+    return bytes / 1024 / (ns / 1e9);
+}
+
+int main(int argc, char *argv[]) {
+    GPIO_TypeDef *cs_port[2] = {W25QXX_CS_GPIO_PORT, W25QXX_CS2_GPIO_PORT};
+    uint16_t cs_pin[2] = {W25QXX_CS_GPIO_PIN, W25QXX_CS2_GPIO_PIN};
+    uint32_t sectors = TEST_SECTORS;
+    uint32_t pages, head, burst_pages = 0;
+    uint64_t start, last, burst_time = 0;
+    double page_model, burst_model, sustained_model;
+    double burst, sustained;
+
+    if (argc > 1) {
+        sectors = (uint32_t)strtoul(argv[1], NULL, 0);
+    }
+
+    w25q_sim_clock = TEST_SPI_CLOCK;
+    for (uint32_t i = 0; i < FLASH_LOG_CHIP_NUM; ++i) {
+        if (w25q_sim_attach(i, cs_port[i], cs_pin[i], W25Q16, NULL) != 0) {
+            return 1;
+        }
+    }
+    w25q_sim_power_on();
+    backup_init();
+
+    for (uint32_t i = 0; i < FLASH_LOG_CHIP_NUM; ++i) {
+        if (w25qxx_init(&flash_dev[i]) != 0) {
+            return 1;
+        }
+    }
+    if (flash_log_init(&log_handle, flash_dev, 0, flash_dev[0].capacity) !=
+        0) {
+        return 1;
+    }
+    /* 空芯片从第0页开始写, 保证从扇区开头开始计时 */
+    if (sectors * FLASH_LOG_PAGES_PER_SECTOR >= log_handle.page_num) {
+        sectors = log_handle.page_num / FLASH_LOG_PAGES_PER_SECTOR - 1;
+    }
+
+    pages = sectors * FLASH_LOG_PAGES_PER_SECTOR;
+    start = w25q_sim_time;
+    last = start;
+    for (uint32_t n = 0; n < pages; ++n) {
+        head = log_handle.head;
+        memset(flash_log_reserve(&log_handle, FLASH_LOG_DATA_SIZE),
+               (int)(n & 0xFF), FLASH_LOG_DATA_SIZE);
+        flash_log_commit(&log_handle, FLASH_LOG_DATA_SIZE);
+        flash_log_flush(&log_handle);
+
+        /* 每片在扇区中的第一页等待预擦除 */
+        if (head % FLASH_LOG_PAGES_PER_SECTOR >= FLASH_LOG_CHIP_NUM) {
+            burst_time += w25q_sim_time - last;
+            burst_pages++;
+        }
+        last = w25q_sim_time;
+    }
+    flash_log_sync(&log_handle);
+
+    page_model = stripe_page_model();
+    burst_model = stripe_rate(FLASH_LOG_DATA_SIZE, page_model);
+    sustained_model =
+        stripe_rate((double)FLASH_LOG_DATA_SIZE * FLASH_LOG_PAGES_PER_SECTOR,
+                    page_model * FLASH_LOG_PAGES_PER_SECTOR +
+                        (double)W25Q_SIM_T_SE);
+    burst = stripe_rate((double)FLASH_LOG_DATA_SIZE * burst_pages,
+                        (double)burst_time);
+    sustained = stripe_rate((double)FLASH_LOG_DATA_SIZE * pages,
+                            (double)(w25q_sim_time - start));
+
+    printf("%u chip(s), %u pages at %.1f MHz: %.1f KB/s within a sector "
+           "(model %.1f), %.1f KB/s sustained (model %.1f)\r\n",
+           (unsigned int)FLASH_LOG_CHIP_NUM, (unsigned int)pages,
+           TEST_SPI_CLOCK / 1e6, burst, burst_model,
+           sustained, sustained_model);
+
+    TEST_CHECK(w25q_sim_stats.violations == 0,
+               "%u commands the chip would ignore",
+               (unsigned int)w25q_sim_stats.violations);
+    TEST_CHECK(burst * 100 >= burst_model * TEST_MIN_RATIO,
+               "%.1f KB/s within a sector, model %.1f KB/s", burst,
+               burst_model);
+    TEST_CHECK(sustained * 100 >= sustained_model * TEST_MIN_RATIO,
+               "%.1f KB/s sustained, model %.1f KB/s", sustained,
+               sustained_model);
+
+    return test_report("test_stripe");
+}
@@ -0,0 +1,59 @@
+/**
+ * @file    ahrs.h
+ * @author  Deadline039
+ * @brief   姿态解算
+ * @version 1.0
+ * @date    2026-10-17
+ */
+
+#ifndef __AHRS_H
+#define __AHRS_H
+
+#include "mpu9250.h"
+
+// <<< Use Configuration Wizard in Context Menu >>>
+
+//  <o AHRS_ALGORITHM> 解算算法
+//      <0=>Mahony
+//      <1=>Madgwick
+//  <i> Mahony为互补滤波加PI修正, 运算量最小; Madgwick为梯度下降
+#define AHRS_ALGORITHM 0
+
+//  <q> 融合磁场
+//  <i> 关闭时只用加速度计修正横滚和俯仰, 航向只靠陀螺仪积分
+#define AHRS_USE_MAG   1
+
+#if (AHRS_ALGORITHM == 0)
+
+//  <o> Mahony比例增益Kp(x0.01) <0-1000>
+#define AHRS_MAHONY_KP 100
+//  <o> Mahony积分增益Ki(x0.001) <0-1000>
+//  <i> 用于估计陀螺仪零偏, 0为不估计
+#define AHRS_MAHONY_KI 0
+
+#else  /* AHRS_ALGORITHM == 0 */
+
+//  <o> Madgwick增益beta(x0.001) <0-1000>
+#define AHRS_MADGWICK_BETA 41
+
+#endif /* AHRS_ALGORITHM == 0 */
+
+// <<< end of configuration section >>>
+
+/**
+ * @brief 解算统计
+ */
+typedef struct {
+    uint32_t updates;    /*!< 更新次数 */
+    uint32_t cycles_avg; /*!< 每次更新的平均周期数 */
+    uint32_t cycles_max; /*!< 每次更新的最大周期数 */
+} ahrs_stats_t;
+
+void ahrs_init(void);
+void ahrs_update(const mpu9250_sample_t *sample);
+
+void ahrs_get_quat(float q[4]);
+void ahrs_get_euler(float euler[3]);
+void ahrs_get_stats(ahrs_stats_t *stats);
+
+#endif /* __AHRS_H */
@@ -0,0 +1,45 @@
+/**
+ * @file    attitude.h
+ * @author  Deadline039
+ * @brief   姿态记录
+ * @version 1.0
+ * @date    2026-10-17
+ */
+
+#ifndef __ATTITUDE_H
+#define __ATTITUDE_H
+
+#include "mpu9250.h"
+
+// <<< Use Configuration Wizard in Context Menu >>>
+
+// <e> 姿态记录
+// ==================
+// <i> 每隔几次解算记录一次姿态四元数, 压缩为最小三分量格式后按块写入.
+// <i> 每个四元数4到6字节, 不压缩时为16字节
+
+#define ATTITUDE_ENABLE 1
+
+#if (ATTITUDE_ENABLE == 1)
+
+//  <o> 记录分频 <1-1000>
+//  <i> 每N次解算记录一次, 采样率1kHz时10即100Hz
+#define ATTITUDE_DIVIDER 10
+//  <o> 分量位数 <10-15>
+//  <i> 10位4字节, 误差不超过0.27度; 12位5字节, 0.07度; 15位6字节, 0.009度
+#define ATTITUDE_BITS    12
+//  <o> 每块的四元数数 <1-64>
+//  <i> 块满或刷写时写入, 超过一页时分成多条记录
+#define ATTITUDE_BLOCK   32
+
+#endif /* ATTITUDE_ENABLE == 1 */
+
+// </e>
+
+// <<< end of configuration section >>>
+
+void attitude_init(void);
+void attitude_input(const mpu9250_sample_t *sample);
+uint8_t attitude_flush(void);
+
+#endif /* __ATTITUDE_H */
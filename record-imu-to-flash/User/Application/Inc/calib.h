@@ -0,0 +1,71 @@
+/**
+ * @file    calib.h
+ * @author  Deadline039
+ * @brief   传感器校准
+ * @version 1.0
+ * @date    2026-10-17
+ */
+
+#ifndef __CALIB_H
+#define __CALIB_H
+
+#include "mpu9250.h"
+
+// <<< Use Configuration Wizard in Context Menu >>>
+
+// <e> 传感器校准
+// ==================
+// <i> 陀螺仪静止平均, 加速度计六面校准, 磁力计椭球拟合. 参数保存在EEPROM中,
+// <i> 姿态解算前对每个传感器乘3x3矩阵再加偏移. 记录的仍是原始采样
+
+#define CALIB_ENABLE 1
+
+#if (CALIB_ENABLE == 1)
+
+//  <o> EEPROM键 <0-29>
+//  <i> 占用连续3个键, 依次为加速度计, 陀螺仪, 磁力计
+#define CALIB_EEPROM_KEY 0
+//  <o> 陀螺仪平均时间(ms) <100-60000>
+#define CALIB_GYRO_TIME  5000
+//  <o> 加速度计每个朝向的平均时间(ms) <100-10000>
+#define CALIB_ACCEL_TIME 2000
+//  <o> 静止阈值(dps) <1-50>
+//  <i> 平均期间角速度偏离均值超过该值时认为在运动, 重新开始
+#define CALIB_STILL_DPS  3
+//  <o> 磁力计拟合最少采样数 <20-10000>
+//  <i> 只计入有新磁场的采样. 拟合期间需要把板子转到各个方向
+#define CALIB_MAG_MIN    200
+
+#endif /* CALIB_ENABLE == 1 */
+
+// </e>
+
+// <<< end of configuration section >>>
+
+/**
+ * @brief 传感器
+ */
+typedef enum {
+    CALIB_ACCEL = 0U, /*!< 加速度计 */
+    CALIB_GYRO,       /*!< 陀螺仪 */
+    CALIB_MAG,        /*!< 磁力计, AK8963自身的坐标系 */
+    CALIB_SENSOR_NUM  /*!< 传感器数 */
+} calib_sensor_t;
+
+/**
+ * @brief 一个传感器的校准参数
+ * @note 校准后的值为matrix * 原始值 + offset, 单位仍为原始值的LSB.
+ *       加速度计校准后1g为标称的LSB数, 磁力计校准后为半径不变的球面
+ */
+typedef struct {
+    float matrix[3][3]; /*!< 比例, 轴间耦合和软铁矩阵 */
+    float offset[3];    /*!< 偏移 */
+} calib_param_t;
+
+void calib_init(void);
+void calib_input(const mpu9250_sample_t *sample);
+void calib_apply(const mpu9250_sample_t *sample, float accel[3],
+                 float gyro[3], float mag[3]);
+void calib_get(calib_sensor_t sensor, calib_param_t *param);
+
+#endif /* __CALIB_H */
@@ -0,0 +1,51 @@
+/**
+ * @file    decimate.h
+ * @author  Deadline039
+ * @brief   IMU多速率抽取
+ * @version 1.0
+ * @date    2026-10-17
+ */
+
+#ifndef __DECIMATE_H
+#define __DECIMATE_H
+
+#include "dsp.h"
+#include "mpu9250.h"
+
+// <<< Use Configuration Wizard in Context Menu >>>
+
+// <h> 通道0
+// ==================
+//  <o> 抽取倍数 <1-100>
+//  <i> 输出采样率为IMU采样率 / 抽取倍数, 1为原始采样率, 不滤波
+#define DECIMATE_CH0_FACTOR 1
+//  <o> 抗混叠滤波器抽头数 <1-255>
+//  <i> 奇数. 抽取倍数为M时约需16 * M个抽头, 使0.6倍输出采样率以上的分量
+//  <i> 衰减50dB以上, 混叠只落在0.4倍输出采样率以上
+#define DECIMATE_CH0_TAPS   1
+//  <q> 上电开始输出
+//  <i> 关闭时作为突发通道, 需要时调用`decimate_enable`打开
+#define DECIMATE_CH0_START  0
+// </h>
+
+// <h> 通道1
+// ==================
+//  <o> 抽取倍数 <1-100>
+#define DECIMATE_CH1_FACTOR 10
+//  <o> 抗混叠滤波器抽头数 <1-255>
+#define DECIMATE_CH1_TAPS   161
+//  <q> 上电开始输出
+#define DECIMATE_CH1_START  1
+// </h>
+
+// <<< end of configuration section >>>
+
+/* 通道数, 即记录中的IMU通道号0 ~ DECIMATE_CHANNEL_NUM - 1 */
+#define DECIMATE_CHANNEL_NUM 2
+
+void decimate_init(void);
+uint32_t decimate_input(const mpu9250_sample_t *sample,
+                        mpu9250_sample_t out[DECIMATE_CHANNEL_NUM]);
+void decimate_enable(uint8_t channel, uint8_t enable);
+
+#endif /* __DECIMATE_H */
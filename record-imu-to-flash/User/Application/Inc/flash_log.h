@@ -0,0 +1,143 @@
+/**
+ * @file    flash_log.h
+ * @author  Deadline039
+ * @brief   SPI Flash循环日志
+ * @version 1.0
+ * @date    2026-10-17
+ */
+
+#ifndef __FLASH_LOG_H
+#define __FLASH_LOG_H
+
+#include "backup.h"
+#include "w25qxx.h"
+
+// <<< Use Configuration Wizard in Context Menu >>>
+
+// <q> 启用备份域日志
+// <i> 把暂存页中尚未写入Flash的数据和写入位置同步到备份域,
+// <i> 复位后写回Flash, 挂载时不需要扫描整个日志区
+#define FLASH_LOG_USE_JOURNAL 1
+
+//  <o FLASH_LOG_CHIP_NUM> Flash芯片数量
+//      <1=>1
+//      <2=>2
+//  <i> 两片时页交替写入两片Flash, 一片编程的同时向另一片传输数据
+#define FLASH_LOG_CHIP_NUM    1
+
+//  <o> 顺序读取时预读的页数 <0-16>
+//  <i> 连续读取相邻的页时, 用DMA在后台读取之后的页, 0为不预读.
+//  <i> 每页占用256字节内存
+#define FLASH_LOG_READ_AHEAD  4
+
+//  <o> 页摘要长度(byte) <4-32:4>
+//  <i> 页头中留给使用者的摘要, 写入Flash前由`flash_log_meta_callback`填写.
+//  <i> 检索时只读页头就可以跳过不相关的页
+#define FLASH_LOG_META_SIZE   16
+
+// <<< end of configuration section >>>
+
+/**
+ * @brief 页头
+ */
+typedef struct {
+    uint32_t seq;  /*!< 页序号, 从1开始递增, 全1表示空页 */
+    uint8_t len;   /*!< 页内数据长度 */
+    uint8_t flags; /*!< 页标志 */
+    uint16_t crc;  /*!< 页头和数据的CRC16, 同时作为提交标记 */
+
+    uint8_t meta[FLASH_LOG_META_SIZE]; /*!< 页摘要, 也在CRC范围内 */
+} flash_log_page_hdr_t;
+
+/* 每页可存放的数据长度 */
+#define FLASH_LOG_DATA_SIZE                                                    \
+    (W25QXX_PAGE_SIZE - sizeof(flash_log_page_hdr_t))
+
+/* 每个扇区的页数, 多片时为各片同一扇区的页数之和 */
+#define FLASH_LOG_PAGES_PER_SECTOR                                             \
+    (W25QXX_SECTOR_SIZE / W25QXX_PAGE_SIZE * FLASH_LOG_CHIP_NUM)
+
+/* 页标志: 掉电时提前提交的页 */
+#define FLASH_LOG_FLAG_POWER_LOSS 0x01
+
+/**
+ * @brief 备份域日志头, 后面紧跟暂存页数据
+ */
+typedef struct {
+    uint32_t head;  /*!< 下一个写入的页 */
+    uint32_t tail;  /*!< 最旧的页 */
+    uint32_t seq;   /*!< 下一页的序号 */
+    uint16_t len;   /*!< 已同步的暂存页数据长度 */
+    uint16_t check; /*!< head, tail, seq的CRC16 */
+} flash_log_journal_t;
+
+/* 备份域中可以同步的暂存页数据长度 */
+#define FLASH_LOG_JOURNAL_DATA_SIZE                                            \
+    ((BACKUP_SIZE - sizeof(flash_log_journal_t)) < FLASH_LOG_DATA_SIZE         \
+         ? (BACKUP_SIZE - sizeof(flash_log_journal_t))                         \
+         : FLASH_LOG_DATA_SIZE)
+
+/**
+ * @brief 一页日志
+ */
+typedef struct {
+    flash_log_page_hdr_t hdr;
+    uint8_t data[FLASH_LOG_DATA_SIZE];
+} flash_log_page_t;
+
+/**
+ * @brief 日志句柄
+ */
+typedef struct {
+    w25qxx_t *dev[FLASH_LOG_CHIP_NUM]; /*!< Flash设备 */
+    uint32_t base;     /*!< 日志区在每片中的起始地址, 扇区对齐 */
+    uint32_t page_num; /*!< 日志区总页数, 扇区页数的整数倍 */
+
+    uint32_t head; /*!< 下一个写入的页 */
+    uint32_t tail; /*!< 最旧的页 */
+    uint32_t seq;  /*!< 下一页的序号 */
+
+    flash_log_page_t page;    /*!< 页暂存缓冲区 */
+    __IO uint32_t buf_len;    /*!< 暂存缓冲区中已提交的数据长度 */
+    __IO uint8_t programming; /*!< 暂存页已发出编程命令, 尚未切换到下一页 */
+    __IO uint8_t emergency;   /*!< 掉电刷写模式 */
+
+    __IO uint32_t ahead_sector; /*!< 已发出预擦除命令的扇区 */
+    uint32_t emergency_end;     /*!< 掉电刷写模式下不可写入的第一页 */
+
+#if (FLASH_LOG_USE_JOURNAL == 1)
+    /* 已发出编程命令, 尚未在备份域中确认写入的页数, 每片最多一页 */
+    __IO uint8_t journal_pending;
+#endif /* FLASH_LOG_USE_JOURNAL == 1 */
+
+#if (FLASH_LOG_READ_AHEAD > 0)
+    flash_log_page_t ra_buf[FLASH_LOG_READ_AHEAD]; /*!< 预读环形缓冲区 */
+
+    uint32_t ra_last;        /*!< 上一次读取的页 */
+    uint32_t ra_page;        /*!< 缓冲区中第一页的页号 */
+    uint32_t ra_start;       /*!< 第一页所在的缓冲区 */
+    __IO uint32_t ra_issued; /*!< 已发出读取的页数, 含已完成的 */
+    __IO uint32_t ra_ready;  /*!< 已读取完成的页数 */
+    __IO uint8_t ra_active;  /*!< 是否正在预读 */
+#endif /* FLASH_LOG_READ_AHEAD > 0 */
+} flash_log_t;
+
+uint8_t flash_log_init(flash_log_t *log, w25qxx_t *dev, uint32_t base,
+                       uint32_t size);
+
+uint32_t flash_log_space(flash_log_t *log);
+uint8_t *flash_log_reserve(flash_log_t *log, uint32_t len);
+void flash_log_commit(flash_log_t *log, uint32_t len);
+uint8_t flash_log_flush(flash_log_t *log);
+void flash_log_sync(flash_log_t *log);
+
+uint8_t flash_log_read_page(flash_log_t *log, uint32_t page,
+                            flash_log_page_t *buf);
+uint8_t flash_log_read_hdr(flash_log_t *log, uint32_t page,
+                           flash_log_page_hdr_t *hdr);
+
+void flash_log_meta_callback(flash_log_t *log, flash_log_page_t *page);
+
+void flash_log_emergency_begin(flash_log_t *log);
+
+#endif /* __FLASH_LOG_H */
@@ -9,6 +9,15 @@
 #ifndef __INCLUDES_H
 #define __INCLUDES_H
 
+#include "ahrs.h"
+#include "attitude.h"
 #include "bsp.h"
+#include "calib.h"
+#include "decimate.h"
+#include "query.h"
+#include "recorder.h"
+#include "spectrum.h"
+#include "summary.h"
+#include "trigger.h"
 
 #endif /* __INCLUDES_H */
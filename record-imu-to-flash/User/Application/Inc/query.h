@@ -0,0 +1,57 @@
+/**
+ * @file    query.h
+ * @author  Deadline039
+ * @brief   日志检索
+ * @version 1.0
+ * @date    2026-10-17
+ */
+
+#ifndef __QUERY_H
+#define __QUERY_H
+
+#include "recorder.h"
+#include "uart.h"
+
+// <<< Use Configuration Wizard in Context Menu >>>
+
+//  <o> 字节序列最大长度(byte)
+#define QUERY_PATTERN_MAX    16
+
+//  <o> 每次轮询最多读取的页数
+//  <i> 只读页头的页也计算在内. 限制每次轮询占用的时间, 检索时不影响记录
+#define QUERY_PAGES_PER_POLL 4
+
+//  <o> 每条结果最多输出的数据长度(byte)
+#define QUERY_DUMP_MAX       32
+
+// <<< end of configuration section >>>
+
+/* 命令和结果使用的串口, 需要启用该串口的发送DMA和接收DMA */
+#define QUERY_UART_HANDLE usart1_handle
+
+/**
+ * @brief 检索条件, 同时满足的记录才输出
+ */
+typedef struct {
+    uint8_t types;    /*!< 记录类型位图 */
+    uint8_t channels; /*!< 通道位图, 通道号大于7的都对应bit7 */
+    uint32_t from;    /*!< 开始时间(RTC, s) */
+    uint32_t to;      /*!< 结束时间(RTC, s) */
+    uint32_t max;     /*!< 最多输出的记录数, 0为不限 */
+
+    uint8_t pattern[QUERY_PATTERN_MAX]; /*!< 数据中包含的字节序列 */
+    uint8_t pattern_len;                /*!< 字节序列长度, 0为不限 */
+
+    uint16_t accel; /*!< 有加速度模大于该值(mg)的采样, 0为不限 */
+    uint16_t gyro;  /*!< 有角速度模大于该值(dps)的采样, 0为不限 */
+} query_t;
+
+uint8_t query_parse(const char *cmd, query_t *query);
+uint8_t query_start(const query_t *query);
+void query_stop(void);
+void query_poll(void);
+
+uint8_t query_printf(const char *__format, ...);
+uint8_t query_command_callback(const char *cmd);
+
+#endif /* __QUERY_H */
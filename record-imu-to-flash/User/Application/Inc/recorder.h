@@ -0,0 +1,262 @@
+/**
+ * @file    recorder.h
+ * @author  Deadline039
+ * @brief   IMU数据记录
+ * @version 1.0
+ * @date    2026-10-17
+ */
+
+#ifndef __RECORDER_H
+#define __RECORDER_H
+
+#include "attitude.h"
+#include "calib.h"
+#include "decimate.h"
+#include "flash_log.h"
+#include "mpu9250.h"
+#include "pvd.h"
+#include "spectrum.h"
+#include "summary.h"
+
+// <<< Use Configuration Wizard in Context Menu >>>
+
+//  <o> 日志区起始地址
+//  <i> 必须扇区(4K)对齐, 之前的空间留给其他用途
+#define RECORDER_LOG_BASE 0
+
+// <e> 掉电刷写
+// ==================
+// <i> 电源跌落到PVD阈值时提交正在填充的采样块, 磁场块和姿态块,
+// <i> 把暂存页写入Flash
+
+#define RECORDER_USE_PVD  1
+
+#if (RECORDER_USE_PVD == 1)
+
+//  <o RECORDER_PVD_LEVEL> PVD阈值
+//      <PWR_PVDLEVEL_0=>2.0V
+//      <PWR_PVDLEVEL_1=>2.1V
+//      <PWR_PVDLEVEL_2=>2.3V
+//      <PWR_PVDLEVEL_3=>2.5V
+//      <PWR_PVDLEVEL_4=>2.6V
+//      <PWR_PVDLEVEL_5=>2.7V
+//      <PWR_PVDLEVEL_6=>2.8V
+//      <PWR_PVDLEVEL_7=>2.9V
+#define RECORDER_PVD_LEVEL       PWR_PVDLEVEL_7
+
+//  <o> 掉电时最多写入的页数 <1-64>
+//  <i> 达到后只接受当前页放得下的记录, 最后再写入暂存页. 每页编程典型
+//  <i> 0.7ms, 最长3ms. 需要保证3.3V跌落到阈值后, 储能电容能维持
+//  <i> (页数 + 1) * 3ms + 20us, 默认4页为15ms
+#define RECORDER_PVD_FLUSH_PAGES 4
+
+#endif /* RECORDER_USE_PVD == 1 */
+
+// </e>
+
+// <e> IMU按列存储
+// ==================
+// <i> 缓存多个采样, 每个通道连续存放, 整块写成一条记录
+// <i> 便于差分压缩和上位机向量化解析; 关闭时每个采样单独一条记录
+
+#define RECORDER_IMU_COLUMNAR 1
+
+#if (RECORDER_IMU_COLUMNAR == 1)
+
+//  <o> 每块的采样数 <1-64>
+//  <i> 每个通道在内存中缓存一块. 不压缩时整块写成一条记录, 不能超过一页,
+//  <i> 最多13个, 配置更大时按13个处理
+#define RECORDER_IMU_BLOCK 32
+//  <q> 差分压缩
+//  <i> 每列一阶或二阶预测, 残差按位宽紧密排列, 或按二阶差分变长编码, 无损
+//  <i> 压缩后超过一页时分成多条记录
+#define RECORDER_IMU_PACK  1
+
+#endif /* RECORDER_IMU_COLUMNAR == 1 */
+
+// </e>
+
+//  <o> 每块的磁场数 <1-64>
+//  <i> 磁场只在AK8963有新数据时记录, 不在IMU采样块中. 时间按二阶差分编码
+//  <i> 一页放不下时分成多条记录
+#define RECORDER_MAG_BLOCK 32
+
+// <<< end of configuration section >>>
+
+/* IMU通道数, 每个抽取通道一个, 记录头中的通道号 */
+#define RECORDER_IMU_CHANNEL_NUM  DECIMATE_CHANNEL_NUM
+
+/* 记录类型 */
+#define RECORD_TYPE_SESSION       0x00 /* 上电, 数据为RTC时间(time_t) */
+#define RECORD_TYPE_IMU           0x01 /* 单个IMU采样, 数据为imu_sample_t */
+#define RECORD_TYPE_IMU_BLOCK     0x02 /* IMU采样块, 数据为块头加各列 */
+#define RECORD_TYPE_SPECTRUM      0x03 /* 频谱摘要, 数据为record_spectrum_t */
+#define RECORD_TYPE_SPECTRUM_BINS 0x04 /* 功率谱, 数据为频点头加各频点 */
+#define RECORD_TYPE_SUMMARY       0x05 /* 窗口统计, 数据为record_summary_t */
+#define RECORD_TYPE_IMU_PACKED    0x06 /* 压缩的IMU采样块, 数据为块头加编码 */
+#define RECORD_TYPE_ATTITUDE      0x07 /* 姿态块, 数据为块头加编码 */
+#define RECORD_TYPE_CALIB         0x08 /* 校准参数, 数据为calib_param_t */
+#define RECORD_TYPE_MAG           0x09 /* 磁场块, 数据为块头加磁场和时间 */
+#define RECORD_TYPE_NUM           0x0A /* 记录类型数量 */
+
+/**
+ * @brief 记录头, 每条记录前都有
+ */
+typedef struct {
+    uint8_t type;    /*!< 记录类型 */
+    uint8_t channel; /*!< 通道 */
+    uint16_t len;    /*!< 数据长度, 不含记录头 */
+    uint32_t time;   /*!< 时间戳(ms) */
+} record_hdr_t;
+
+/* 页摘要中的时间未知, 例如复位后写回的上次上电的数据 */
+#define RECORD_TIME_UNKNOWN 0xFFFFFFFF
+
+/**
+ * @brief 页摘要, 存放在日志页头中, 检索时用来跳过不相关的页
+ * @note 模的最大值只统计IMU采样记录, 页内没有时为0
+ */
+typedef struct {
+    uint32_t time;       /*!< 页内第一条记录的RTC时间(s) */
+    uint32_t tick;       /*!< 页内第一条记录的时间戳(ms) */
+    uint16_t span;       /*!< 最后一条记录与第一条相差的时间(s), 向上取整 */
+    uint8_t types;       /*!< 页内记录类型的位图 */
+    uint8_t channels;    /*!< 页内通道的位图, 通道号大于7的都记在bit7 */
+    uint16_t accel_peak; /*!< 加速度模的最大值(LSB), 向上取整 */
+    uint16_t gyro_peak;  /*!< 角速度模的最大值(LSB), 向上取整 */
+} record_meta_t;
+
+/* 记录的IMU采样, 和驱动输出的原始数据相同 */
+typedef mpu9250_sample_t imu_sample_t;
+
+/**
+ * @brief IMU采样块中的列, 每列`stride`个16位数
+ */
+typedef enum {
+    IMU_COLUMN_TIME = 0U, /*!< 第i个采样与`base + i * step`的差(us) */
+    IMU_COLUMN_AX,        /*!< 加速度 */
+    IMU_COLUMN_AY,
+    IMU_COLUMN_AZ,
+    IMU_COLUMN_TEMP,      /*!< 温度 */
+    IMU_COLUMN_GX,        /*!< 角速度 */
+    IMU_COLUMN_GY,
+    IMU_COLUMN_GZ,
+    IMU_COLUMN_NUM        /*!< 列数, 磁场单独记录, 见`record_mag_t` */
+} imu_column_t;
+
+/**
+ * @brief IMU采样块头, 后面是`IMU_COLUMN_NUM`列数据
+ * @note 第c列第i个采样在块头之后`(c * stride + i) * 2`字节处, 都是int16_t.
+ *       时间按前两个采样的间隔预测, 只记录偏差, 抽取后的低速通道也能填满.
+ *       掉电, 偏差超过16位或采样有丢失时块没有填满, 只有前`num`个有效.
+ *       压缩块的`stride`等于`num`, 后面是`pack_encode`的输出, 用
+ *       `pack_decode`还原为相同的列. 检索时用模的最大值跳过不需要解码的块
+ */
+typedef struct {
+    uint32_t base;       /*!< 第一个采样的时间(us) */
+    uint32_t step;       /*!< 采样间隔(us), 只有一个采样时为0 */
+    uint16_t num;        /*!< 有效的采样数 */
+    uint8_t stride;      /*!< 每列的长度 */
+    uint8_t flags;       /*!< 第一个采样的标志, 见`MPU9250_FLAG_GAP` */
+    uint16_t accel_peak; /*!< 块内加速度模的最大值(LSB), 向上取整 */
+    uint16_t gyro_peak;  /*!< 块内角速度模的最大值(LSB), 向上取整 */
+} record_imu_block_t;
+
+#if (SPECTRUM_ENABLE == 1)
+
+/**
+ * @brief 振动频谱摘要, 每个轴一条
+ * @note 功率为加速度的均方值(LSB^2), 已去除每块的直流分量,
+ *       所有频带之和即时域的均方值. 频带b约为
+ *       [b, b + 1) * 采样率 / 2 / 频带数, 峰值按功率从大到小排列,
+ *       不足时频率和幅值为0
+ */
+typedef struct {
+    uint32_t base;     /*!< 第一个采样的时间(us) */
+    uint16_t rate;     /*!< 采样率(Hz) */
+    uint16_t fft_size; /*!< FFT点数 */
+    uint16_t blocks;   /*!< 平均的块数 */
+    uint8_t axis;      /*!< 轴, 0-2为X, Y, Z */
+    uint8_t flags;     /*!< 周期内丢弃过块时为`MPU9250_FLAG_GAP` */
+
+    float band[SPECTRUM_BAND_NUM];      /*!< 各频带功率 */
+    float peak_freq[SPECTRUM_PEAK_NUM]; /*!< 峰值频率(Hz), 抛物线插值 */
+    float peak_amp[SPECTRUM_PEAK_NUM];  /*!< 峰值幅度, 有效值(LSB) */
+} record_spectrum_t;
+
+/**
+ * @brief 功率谱频点头, 后面是`num`个int16_t, 单位0.01dB(LSB^2)
+ * @note 一个轴的功率谱分成多条记录, 用`base`和摘要对应
+ */
+typedef struct {
+    uint32_t base;  /*!< 对应摘要的时间(us) */
+    uint16_t first; /*!< 第一个频点的序号 */
+    uint8_t axis;   /*!< 轴 */
+    uint8_t num;    /*!< 频点数 */
+} record_spectrum_bins_t;
+
+#endif /* SPECTRUM_ENABLE == 1 */
+
+/**
+ * @brief 一个轴的窗口统计
+ * @note 方差为总体方差, 有效值的平方为方差加均值的平方
+ */
+typedef struct {
+    int16_t min; /*!< 最小值 */
+    int16_t max; /*!< 最大值 */
+    float mean;  /*!< 均值 */
+    float var;   /*!< 方差 */
+    float rms;   /*!< 有效值 */
+} record_summary_axis_t;
+
+/**
+ * @brief 窗口统计, 轴的顺序为加速度, 温度, 角速度, 磁场
+ */
+typedef struct {
+    uint32_t base;     /*!< 第一个采样的时间(us) */
+    uint32_t span;     /*!< 最后一个采样与第一个相差的时间(us) */
+    uint32_t count;    /*!< 采样数 */
+    uint16_t flags;    /*!< 窗口内有丢失时为`MPU9250_FLAG_GAP` */
+    uint16_t reserved; /*!< 保留 */
+
+    record_summary_axis_t axis[SUMMARY_AXIS_NUM]; /*!< 各轴统计 */
+} record_summary_t;
+
+/**
+ * @brief 姿态块头
+ * @note 后面是`num`个`quat_encode`编码的四元数, 每个`QUAT_SIZE(bits)`字节,
+ *       然后是各四元数对应的采样时间, 以`base`为基准用`dod_put`编码
+ */
+typedef struct {
+    uint32_t base; /*!< 第一个四元数的时间(us) */
+    uint16_t num;  /*!< 四元数数 */
+    uint8_t bits;  /*!< 每个分量的位数 */
+    uint8_t flags; /*!< 之前的采样有丢失时为`MPU9250_FLAG_GAP` */
+} record_attitude_t;
+
+/**
+ * @brief 磁场块头
+ * @note 后面是`num`个磁场, 每个3个int16_t, AK8963的坐标系,
+ *       然后是各磁场的采样时间, 以`base`为基准用`dod_put`编码
+ */
+typedef struct {
+    uint32_t base;     /*!< 第一个磁场的时间(us) */
+    uint16_t num;      /*!< 磁场数 */
+    uint8_t flags;     /*!< 块内有丢失时为`MPU9250_FLAG_GAP` */
+    uint8_t reserved;  /*!< 保留 */
+} record_mag_t;
+
+void recorder_init(void);
+void recorder_poll(void);
+uint8_t recorder_write(uint8_t type, uint8_t channel, const void *data,
+                       uint32_t len);
+uint8_t recorder_write_part(uint8_t type, uint8_t channel, const void *data,
+                            uint32_t len, uint16_t *sent, uint16_t value);
+
+uint8_t recorder_write_imu(uint8_t channel, const imu_sample_t *sample);
+uint8_t recorder_flush(void);
+
+void recorder_check(void);
+flash_log_t *recorder_get_log(void);
+
+#endif /* __RECORDER_H */
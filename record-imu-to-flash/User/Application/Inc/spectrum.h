@@ -0,0 +1,65 @@
+/**
+ * @file    spectrum.h
+ * @author  Deadline039
+ * @brief   振动频谱分析
+ * @version 1.0
+ * @date    2026-10-17
+ */
+
+#ifndef __SPECTRUM_H
+#define __SPECTRUM_H
+
+#include "mpu9250.h"
+
+// <<< Use Configuration Wizard in Context Menu >>>
+
+// <e> 振动频谱
+// ==================
+// <i> 原始加速度每N点做一次加窗实数FFT, 每个记录周期平均后记录频带能量
+// <i> 和峰值频率. 只需要频谱时在decimate.h中关闭各通道, 不再记录原始采样
+
+#define SPECTRUM_ENABLE 1
+
+#if (SPECTRUM_ENABLE == 1)
+
+//  <o SPECTRUM_FFT_SIZE> FFT点数
+//      <128=>128
+//      <512=>512
+//      <2048=>2048
+//  <i> 频率分辨率为采样率 / 点数, 内存约为24 * 点数字节
+#define SPECTRUM_FFT_SIZE  512
+//  <o> 记录周期(s) <1-3600>
+//  <i> 周期内的各块功率谱平均后记录一次, 不足一块时按一块
+#define SPECTRUM_PERIOD    10
+//  <o> 频带数 <1-32>
+//  <i> 0到采样率的一半等分
+#define SPECTRUM_BAND_NUM  8
+//  <o> 峰值数 <1-8>
+#define SPECTRUM_PEAK_NUM  3
+//  <q> 记录完整功率谱
+//  <i> 每个轴N / 2 + 1个频点, 数据量约为摘要的10倍
+#define SPECTRUM_SAVE_BINS 0
+
+#endif /* SPECTRUM_ENABLE == 1 */
+
+// </e>
+
+// <<< end of configuration section >>>
+
+/* 每条完整功率谱记录的频点数 */
+#define SPECTRUM_BINS_PER_RECORD 64
+
+/**
+ * @brief 分析统计
+ */
+typedef struct {
+    uint32_t blocks;     /*!< 计算的块数 */
+    uint32_t discarded;  /*!< 遇到采样丢失丢弃的块数 */
+    uint32_t cycles_max; /*!< 每块三个轴的最大周期数 */
+} spectrum_stats_t;
+
+void spectrum_init(void);
+void spectrum_input(const mpu9250_sample_t *sample);
+void spectrum_get_stats(spectrum_stats_t *stats);
+
+#endif /* __SPECTRUM_H */
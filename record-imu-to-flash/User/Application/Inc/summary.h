@@ -0,0 +1,41 @@
+/**
+ * @file    summary.h
+ * @author  Deadline039
+ * @brief   IMU窗口统计
+ * @version 1.0
+ * @date    2026-10-17
+ */
+
+#ifndef __SUMMARY_H
+#define __SUMMARY_H
+
+#include "mpu9250.h"
+
+// <<< Use Configuration Wizard in Context Menu >>>
+
+// <e> 窗口统计
+// ==================
+// <i> 每个窗口对原始采样的各轴写一条最小, 最大, 均值, 方差和有效值记录,
+// <i> 逐个采样更新, 不缓存采样. 长期趋势只需读取统计记录
+
+#define SUMMARY_ENABLE 1
+
+#if (SUMMARY_ENABLE == 1)
+
+//  <o> 窗口长度(s) <1-3600>
+//  <i> 常用1s, 10s, 60s
+#define SUMMARY_WINDOW 10
+
+#endif /* SUMMARY_ENABLE == 1 */
+
+// </e>
+
+// <<< end of configuration section >>>
+
+/* 统计的轴数: 加速度3, 温度1, 角速度3, 磁场3 */
+#define SUMMARY_AXIS_NUM 10
+
+void summary_init(void);
+void summary_input(const mpu9250_sample_t *sample);
+
+#endif /* __SUMMARY_H */
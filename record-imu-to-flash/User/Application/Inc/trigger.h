@@ -0,0 +1,80 @@
+/**
+ * @file    trigger.h
+ * @author  Deadline039
+ * @brief   IMU事件触发记录
+ * @version 1.0
+ * @date    2026-10-17
+ */
+
+#ifndef __TRIGGER_H
+#define __TRIGGER_H
+
+#include "decimate.h"
+
+// <<< Use Configuration Wizard in Context Menu >>>
+
+// <e> 事件触发记录
+// ==================
+// <i> 触发通道的采样先存入内存中的环形缓冲区, 满足条件时写入触发前的采样,
+// <i> 之后持续记录到保持时间结束. 其他通道照常记录
+
+#define TRIGGER_ENABLE 1
+
+#if (TRIGGER_ENABLE == 1)
+
+//  <o> 触发通道 <0-1>
+//  <i> decimate.h中的通道, 初始化时打开
+#define TRIGGER_CHANNEL   0
+//  <o> 触发前时间(ms) <1-10000>
+//  <i> 缓冲区每个采样24字节, 放在CCM时不能超过64KB
+#define TRIGGER_PRE_TIME  2000
+//  <o> 保持时间(ms) <1-60000>
+//  <i> 条件不再满足后继续记录的时间, 期间再次满足时重新计时
+#define TRIGGER_HOLD_TIME 3000
+//  <q> 缓冲区放在CCM
+//  <i> F429的64KB CCM只有CPU能访问, 不占用主SRAM
+#define TRIGGER_USE_CCM   1
+
+// <h> 触发条件
+// ==================
+//  <o> 加速度模长(mg) <0-16000>
+//  <i> 超过时触发, 静止时为1000mg, 0为不使用
+#define TRIGGER_ACCEL     2000
+//  <o> 角速度模长(dps) <0-2000>
+//  <i> 0为不使用
+#define TRIGGER_GYRO      500
+//  <o> 加加速度模长(g/s) <0-10000>
+//  <i> 相邻两个采样加速度之差除以间隔, 0为不使用
+#define TRIGGER_JERK      0
+//  <o TRIGGER_KEY> 手动触发按键
+//      <0=>不使用
+//      <3=>KEY2
+//      <4=>WK_UP
+#define TRIGGER_KEY       3
+// </h>
+
+#endif /* TRIGGER_ENABLE == 1 */
+
+// </e>
+
+// <<< end of configuration section >>>
+
+/* 触发后每个输入采样最多写入的缓冲区中的采样数, 大于1才能追上 */
+#define TRIGGER_DRAIN_NUM 4
+
+/**
+ * @brief 触发统计
+ */
+typedef struct {
+    uint32_t events;  /*!< 触发的事件数 */
+    uint32_t written; /*!< 写入的采样数 */
+    uint32_t forced;  /*!< 缓冲区满时提前写入的采样数 */
+} trigger_stats_t;
+
+void trigger_init(void);
+void trigger_input(const mpu9250_sample_t *sample);
+void trigger_flush(void);
+void trigger_fire(void);
+void trigger_get_stats(trigger_stats_t *stats);
+
+#endif /* __TRIGGER_H */
@@ -0,0 +1,387 @@
+/**
+ * @file    ahrs.c
+ * @author  Deadline039
+ * @brief   姿态解算
+ * @version 1.0
+ * @date    2026-10-17
+ * @note    四元数姿态, 陀螺仪积分, 加速度计和磁场修正. 全部使用单精度,
+ *          常数都带f后缀, 只调用单精度数学函数, 不会提升为双精度,
+ *          在M4F上全部由FPU完成. 归一化使用快速平方根倒数, 避免除法和开方.
+ *          每次更新用DWT周期计数器计时.
+ */
+
+#include "ahrs.h"
+#include "calib.h"
+
+#include <math.h>
+
+/* 陀螺仪原始值到rad/s */
+#define AHRS_GYRO_SCALE                                                        \
+    ((float)(250 << MPU9250_GYRO_FS) / 32768.0f * 0.0174532925f)
+/* 标称采样周期(s) */
+#define AHRS_PERIOD     ((float)(1 + MPU9250_SMPLRT_DIV) * 0.001f)
+/* 采样间隔超过该值(us)时认为中间有丢失, 使用标称周期 */
+#define AHRS_MAX_DT_US  (100000)
+/* 弧度到角度 */
+#define AHRS_RAD_TO_DEG 57.2957795f
+
+#if (AHRS_ALGORITHM == 0)
+#define AHRS_TWO_KP (2.0f * AHRS_MAHONY_KP / 100.0f)
+#define AHRS_TWO_KI (2.0f * AHRS_MAHONY_KI / 1000.0f)
+#else  /* AHRS_ALGORITHM == 0 */
+#define AHRS_BETA (AHRS_MADGWICK_BETA / 1000.0f)
+#endif /* AHRS_ALGORITHM == 0 */
+
+static struct {
+    float q[4]; /*!< 姿态四元数, 机体到参考系 */
+#if (AHRS_ALGORITHM == 0)
+    float integral[3]; /*!< Mahony积分项, 即估计的陀螺仪零偏 */
+#endif /* AHRS_ALGORITHM == 0 */
+    uint32_t last_time; /*!< 上一个采样的时间(us) */
+    uint8_t started;    /*!< 已经收到过采样 */
+
+    uint32_t updates;    /*!< 更新次数 */
+    uint64_t cycles;     /*!< 更新的总周期数 */
+    uint32_t cycles_max; /*!< 每次更新的最大周期数 */
+} ahrs;
+
+/**
+ * @brief 快速平方根倒数
+ *
+ * @param x 输入, 大于0
+ * @return 1 / sqrt(x)
+ * @note 初值由整数运算得到, 两次牛顿迭代后相对误差约5e-6
+ */
+static inline float ahrs_inv_sqrt(float x) {
+    union {
+        float f;
+        int32_t i;
+    } conv = {.f = x};
+    float half = 0.5f * x;
+
+    conv.i = 0x5F3759DF - (conv.i >> 1);
+    conv.f *= 1.5f - half * conv.f * conv.f;
+    conv.f *= 1.5f - half * conv.f * conv.f;
+
+    return conv.f;
+}
+
+/**
+ * @brief 初始化姿态
+ *
+ */
+void ahrs_init(void) {
+    ahrs.q[0] = 1.0f;
+    ahrs.q[1] = 0.0f;
+    ahrs.q[2] = 0.0f;
+    ahrs.q[3] = 0.0f;
+#if (AHRS_ALGORITHM == 0)
+    ahrs.integral[0] = 0.0f;
+    ahrs.integral[1] = 0.0f;
+    ahrs.integral[2] = 0.0f;
+#endif /* AHRS_ALGORITHM == 0 */
+    ahrs.started = 0;
+
+    ahrs.updates = 0;
+    ahrs.cycles = 0;
+    ahrs.cycles_max = 0;
+
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+#if (AHRS_ALGORITHM == 0)
+
+/**
+ * @brief Mahony更新
+ *
+ * @param g 角速度(rad/s)
+ * @param a 加速度, 任意单位
+ * @param m 磁场, 任意单位, 为NULL时不使用
+ * @param dt 采样周期(s)
+ * @note 加速度和磁场的方向与估计的重力, 磁场方向的叉积作为误差,
+ *       经PI控制器修正角速度后积分
+ */
+static void ahrs_mahony(float g[3], float a[3], const float *m, float dt) {
+    float *q = ahrs.q;
+    float norm, e[3], v[3];
+    float q0 = q[0], q1 = q[1], q2 = q[2], q3 = q[3];
+
+    /* 自由落体时没有重力方向, 只积分角速度 */
+    norm = a[0] * a[0] + a[1] * a[1] + a[2] * a[2];
+    if (norm > 0.0f) {
+        norm = ahrs_inv_sqrt(norm);
+        a[0] *= norm;
+        a[1] *= norm;
+        a[2] *= norm;
+
+        /* 机体系中估计的重力方向的一半 */
+        v[0] = q1 * q3 - q0 * q2;
+        v[1] = q0 * q1 + q2 * q3;
+        v[2] = q0 * q0 - 0.5f + q3 * q3;
+
+        e[0] = a[1] * v[2] - a[2] * v[1];
+        e[1] = a[2] * v[0] - a[0] * v[2];
+        e[2] = a[0] * v[1] - a[1] * v[0];
+
+        norm = (m != NULL) ? m[0] * m[0] + m[1] * m[1] + m[2] * m[2] : 0.0f;
+        if (norm > 0.0f) {
+            float mx, my, mz, hx, hy, bx, bz, w[3];
+
+            norm = ahrs_inv_sqrt(norm);
+            mx = m[0] * norm;
+            my = m[1] * norm;
+            mz = m[2] * norm;
+
+            /* 磁场转到参考系, 水平分量都放在x轴上 */
+            hx = 2.0f * (mx * (0.5f - q2 * q2 - q3 * q3) +
+                         my * (q1 * q2 - q0 * q3) + mz * (q1 * q3 + q0 * q2));
+            hy = 2.0f * (mx * (q1 * q2 + q0 * q3) +
+                         my * (0.5f - q1 * q1 - q3 * q3) +
+                         mz * (q2 * q3 - q0 * q1));
+            bz = 2.0f * (mx * (q1 * q3 - q0 * q2) + my * (q2 * q3 + q0 * q1) +
+                         mz * (0.5f - q1 * q1 - q2 * q2));
+            norm = hx * hx + hy * hy;
+            bx = (norm > 0.0f) ? norm * ahrs_inv_sqrt(norm) : 0.0f;
+
+            /* 机体系中估计的磁场方向的一半 */
+            w[0] = bx * (0.5f - q2 * q2 - q3 * q3) + bz * (q1 * q3 - q0 * q2);
+            w[1] = bx * (q1 * q2 - q0 * q3) + bz * (q0 * q1 + q2 * q3);
+            w[2] = bx * (q0 * q2 + q1 * q3) + bz * (0.5f - q1 * q1 - q2 * q2);
+
+            e[0] += my * w[2] - mz * w[1];
+            e[1] += mz * w[0] - mx * w[2];
+            e[2] += mx * w[1] - my * w[0];
+        }
+
+        for (uint32_t i = 0; i < 3; ++i) {
+            if (AHRS_TWO_KI > 0.0f) {
+                ahrs.integral[i] += AHRS_TWO_KI * e[i] * dt;
+                g[i] += ahrs.integral[i];
+            }
+            g[i] += AHRS_TWO_KP * e[i];
+        }
+    }
+
+    /* q' = q * (0, g) / 2 */
+    for (uint32_t i = 0; i < 3; ++i) {
+        g[i] *= 0.5f * dt;
+    }
+    q[0] = q0 + (-q1 * g[0] - q2 * g[1] - q3 * g[2]);
+    q[1] = q1 + (q0 * g[0] + q2 * g[2] - q3 * g[1]);
+    q[2] = q2 + (q0 * g[1] - q1 * g[2] + q3 * g[0]);
+    q[3] = q3 + (q0 * g[2] + q1 * g[1] - q2 * g[0]);
+}
+
+#else  /* AHRS_ALGORITHM == 0 */
+
+/**
+ * @brief Madgwick更新
+ *
+ * @param g 角速度(rad/s)
+ * @param a 加速度, 任意单位
+ * @param m 磁场, 任意单位, 为NULL时不使用
+ * @param dt 采样周期(s)
+ * @note 用一步梯度下降使估计的重力, 磁场方向逼近测量值,
+ *       梯度方向乘以beta从四元数导数中减去
+ */
+static void ahrs_madgwick(float g[3], float a[3], const float *m, float dt) {
+    float *q = ahrs.q;
+    float norm, d[4], s[4], ea[3];
+    float q0 = q[0], q1 = q[1], q2 = q[2], q3 = q[3];
+
+    /* q' = q * (0, g) / 2 */
+    d[0] = 0.5f * (-q1 * g[0] - q2 * g[1] - q3 * g[2]);
+    d[1] = 0.5f * (q0 * g[0] + q2 * g[2] - q3 * g[1]);
+    d[2] = 0.5f * (q0 * g[1] - q1 * g[2] + q3 * g[0]);
+    d[3] = 0.5f * (q0 * g[2] + q1 * g[1] - q2 * g[0]);
+
+    /* 自由落体时没有重力方向, 只积分角速度 */
+    norm = a[0] * a[0] + a[1] * a[1] + a[2] * a[2];
+    if (norm > 0.0f) {
+        norm = ahrs_inv_sqrt(norm);
+        a[0] *= norm;
+        a[1] *= norm;
+        a[2] *= norm;
+
+        /* 估计的重力方向与测量值的差 */
+        ea[0] = 2.0f * (q1 * q3 - q0 * q2) - a[0];
+        ea[1] = 2.0f * (q0 * q1 + q2 * q3) - a[1];
+        ea[2] = 1.0f - 2.0f * (q1 * q1 + q2 * q2) - a[2];
+
+        /* 梯度为雅可比矩阵的转置乘以差 */
+        s[0] = -2.0f * q2 * ea[0] + 2.0f * q1 * ea[1];
+        s[1] = 2.0f * q3 * ea[0] + 2.0f * q0 * ea[1] - 4.0f * q1 * ea[2];
+        s[2] = -2.0f * q0 * ea[0] + 2.0f * q3 * ea[1] - 4.0f * q2 * ea[2];
+        s[3] = 2.0f * q1 * ea[0] + 2.0f * q2 * ea[1];
+
+        norm = (m != NULL) ? m[0] * m[0] + m[1] * m[1] + m[2] * m[2] : 0.0f;
+        if (norm > 0.0f) {
+            float mx, my, mz, hx, hy, bx, bz, em[3];
+
+            norm = ahrs_inv_sqrt(norm);
+            mx = m[0] * norm;
+            my = m[1] * norm;
+            mz = m[2] * norm;
+
+            /* 磁场转到参考系, 水平分量都放在x轴上 */
+            hx = 2.0f * (mx * (0.5f - q2 * q2 - q3 * q3) +
+                         my * (q1 * q2 - q0 * q3) + mz * (q1 * q3 + q0 * q2));
+            hy = 2.0f * (mx * (q1 * q2 + q0 * q3) +
+                         my * (0.5f - q1 * q1 - q3 * q3) +
+                         mz * (q2 * q3 - q0 * q1));
+            bz = 2.0f * (mx * (q1 * q3 - q0 * q2) + my * (q2 * q3 + q0 * q1) +
+                         mz * (0.5f - q1 * q1 - q2 * q2));
+            norm = hx * hx + hy * hy;
+            bx = (norm > 0.0f) ? norm * ahrs_inv_sqrt(norm) : 0.0f;
+
+            /* 估计的磁场方向与测量值的差 */
+            em[0] = bx * (0.5f - q2 * q2 - q3 * q3) + bz * (q1 * q3 - q0 * q2) -
+                    mx;
+            em[1] = bx * (q1 * q2 - q0 * q3) + bz * (q0 * q1 + q2 * q3) - my;
+            em[2] = bx * (q0 * q2 + q1 * q3) + bz * (0.5f - q1 * q1 - q2 * q2) -
+                    mz;
+
+            s[0] += -bz * q2 * em[0] + (-bx * q3 + bz * q1) * em[1] +
+                    bx * q2 * em[2];
+            s[1] += bz * q3 * em[0] + (bx * q2 + bz * q0) * em[1] +
+                    (bx * q3 - 2.0f * bz * q1) * em[2];
+            s[2] += (-2.0f * bx * q2 - bz * q0) * em[0] +
+                    (bx * q1 + bz * q3) * em[1] +
+                    (bx * q0 - 2.0f * bz * q2) * em[2];
+            s[3] += (-2.0f * bx * q3 + bz * q1) * em[0] +
+                    (-bx * q0 + bz * q2) * em[1] + bx * q1 * em[2];
+        }
+
+        norm = s[0] * s[0] + s[1] * s[1] + s[2] * s[2] + s[3] * s[3];
+        if (norm > 0.0f) {
+            norm = AHRS_BETA * ahrs_inv_sqrt(norm);
+            for (uint32_t i = 0; i < 4; ++i) {
+                d[i] -= norm * s[i];
+            }
+        }
+    }
+
+    for (uint32_t i = 0; i < 4; ++i) {
+        q[i] += d[i] * dt;
+    }
+}
+
+#endif /* AHRS_ALGORITHM == 0 */
+
+/**
+ * @brief 用一个采样更新姿态
+ *
+ * @param sample 采样
+ * @note 在主循环中按时间顺序调用
+ */
+void ahrs_update(const mpu9250_sample_t *sample) {
+    uint32_t start = DWT->CYCCNT;
+    uint32_t cycles, interval;
+    float g[3], a[3], mc[3], dt, norm;
+#if (AHRS_USE_MAG == 1)
+    float m[3];
+    const float *mag = m;
+#else  /* AHRS_USE_MAG == 1 */
+    const float *mag = NULL;
+#endif /* AHRS_USE_MAG == 1 */
+    float *q = ahrs.q;
+
+    interval = sample->time - ahrs.last_time;
+    if (!ahrs.started || (sample->flags & MPU9250_FLAG_GAP) ||
+        (interval == 0) || (interval > AHRS_MAX_DT_US)) {
+        dt = AHRS_PERIOD;
+    } else {
+        dt = (float)interval * 1e-6f;
+    }
+    ahrs.last_time = sample->time;
+    ahrs.started = 1;
+
+#if (CALIB_ENABLE == 1)
+    calib_apply(sample, a, g, mc);
+#else  /* CALIB_ENABLE == 1 */
+    for (uint32_t i = 0; i < 3; ++i) {
+        a[i] = (float)sample->accel[i];
+        g[i] = (float)sample->gyro[i];
+        mc[i] = (float)sample->mag[i];
+    }
+#endif /* CALIB_ENABLE == 1 */
+    for (uint32_t i = 0; i < 3; ++i) {
+        g[i] *= AHRS_GYRO_SCALE;
+    }
+
+#if (AHRS_USE_MAG == 1)
+    /* AK8963的x, y轴和加速度计对调, z轴相反 */
+    m[0] = mc[1];
+    m[1] = mc[0];
+    m[2] = -mc[2];
+#else  /* AHRS_USE_MAG == 1 */
+    UNUSED(mc);
+#endif /* AHRS_USE_MAG == 1 */
+
+#if (AHRS_ALGORITHM == 0)
+    ahrs_mahony(g, a, mag, dt);
+#else  /* AHRS_ALGORITHM == 0 */
+    ahrs_madgwick(g, a, mag, dt);
+#endif /* AHRS_ALGORITHM == 0 */
+
+    norm = ahrs_inv_sqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] +
+                         q[3] * q[3]);
+    for (uint32_t i = 0; i < 4; ++i) {
+        q[i] *= norm;
+    }
+
+    cycles = DWT->CYCCNT - start;
+    ahrs.updates++;
+    ahrs.cycles += cycles;
+    if (cycles > ahrs.cycles_max) {
+        ahrs.cycles_max = cycles;
+    }
+}
+
+/**
+ * @brief 获取姿态四元数
+ *
+ * @param[out] q 四元数, w, x, y, z
+ */
+void ahrs_get_quat(float q[4]) {
+    for (uint32_t i = 0; i < 4; ++i) {
+        q[i] = ahrs.q[i];
+    }
+}
+
+/**
+ * @brief 获取欧拉角
+ *
+ * @param[out] euler 横滚, 俯仰, 航向(度), ZYX顺序
+ */
+void ahrs_get_euler(float euler[3]) {
+    const float *q = ahrs.q;
+    float sinp = 2.0f * (q[0] * q[2] - q[3] * q[1]);
+
+    if (sinp > 1.0f) {
+        sinp = 1.0f;
+    } else if (sinp < -1.0f) {
+        sinp = -1.0f;
+    }
+
+    euler[0] = atan2f(2.0f * (q[0] * q[1] + q[2] * q[3]),
+                      1.0f - 2.0f * (q[1] * q[1] + q[2] * q[2])) *
+               AHRS_RAD_TO_DEG;
+    euler[1] = asinf(sinp) * AHRS_RAD_TO_DEG;
+    euler[2] = atan2f(2.0f * (q[0] * q[3] + q[1] * q[2]),
+                      1.0f - 2.0f * (q[2] * q[2] + q[3] * q[3])) *
+               AHRS_RAD_TO_DEG;
+}
+
+/**
+ * @brief 获取解算统计
+ *
+ * @param[out] stats 统计数据
+ */
+void ahrs_get_stats(ahrs_stats_t *stats) {
+    stats->updates = ahrs.updates;
+    stats->cycles_avg =
+        (ahrs.updates != 0) ? (uint32_t)(ahrs.cycles / ahrs.updates) : 0;
+    stats->cycles_max = ahrs.cycles_max;
+}
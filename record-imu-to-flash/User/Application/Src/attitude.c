@@ -0,0 +1,131 @@
+/**
+ * @file    attitude.c
+ * @author  Deadline039
+ * @brief   姿态记录
+ * @version 1.0
+ * @date    2026-10-17
+ * @note    每次解算后输入采样, 分频后取当前姿态编码存入块中, 时间单独保存.
+ *          写入时时间按二阶差分编码, 等间隔时每个1位. 块中的四元数和时间
+ *          一页放不下时按顺序分成多条记录, 每条记录可以单独解码
+ */
+
+#include "attitude.h"
+#include "ahrs.h"
+#include "dod.h"
+#include "quat.h"
+#include "recorder.h"
+
+#include <string.h>
+
+#if (ATTITUDE_ENABLE == 1)
+
+/* 每个四元数编码后的字节数 */
+#define ATTITUDE_QUAT_SIZE QUAT_SIZE(ATTITUDE_BITS)
+
+/* 一条记录的最大数据长度 */
+#define ATTITUDE_RECORD_MAX (FLASH_LOG_DATA_SIZE - sizeof(record_hdr_t))
+
+static struct {
+    uint8_t code[ATTITUDE_BLOCK * ATTITUDE_QUAT_SIZE]; /*!< 编码后的四元数 */
+    uint32_t time[ATTITUDE_BLOCK]; /*!< 对应采样的时间(us) */
+    uint16_t num;                  /*!< 块中的四元数数 */
+    uint16_t sent;                 /*!< 已写入的四元数数 */
+    uint16_t count;                /*!< 分频计数 */
+    uint8_t flags;                 /*!< 块内采样标志的或 */
+} attitude;
+
+/**
+ * @brief 初始化
+ *
+ */
+void attitude_init(void) {
+    attitude.num = 0;
+    attitude.sent = 0;
+    attitude.count = 0;
+    attitude.flags = 0;
+}
+
+/**
+ * @brief 输入一个原始采样, 在姿态解算之后调用
+ *
+ * @param sample 采样
+ * @note 分频期间跳过的采样有丢失时也记入块的标志
+ */
+void attitude_input(const mpu9250_sample_t *sample) {
+    float q[4];
+
+    attitude.flags |= (uint8_t)(sample->flags & MPU9250_FLAG_GAP);
+    if (++attitude.count < ATTITUDE_DIVIDER) {
+        return;
+    }
+    attitude.count = 0;
+
+    ahrs_get_quat(q);
+    quat_encode(q, ATTITUDE_BITS,
+                &attitude.code[attitude.num * ATTITUDE_QUAT_SIZE]);
+    attitude.time[attitude.num] = sample->time;
+
+    if (++attitude.num == ATTITUDE_BLOCK) {
+        attitude_flush();
+    }
+}
+
+/**
+ * @brief 写入块中的四元数
+ *
+ * @return 写入结果
+ *  @retval 0 成功或块为空
+ *  @retval 1 写入失败
+ * @note 在`recorder_flush`中也会调用
+ */
+uint8_t attitude_flush(void) {
+    static uint8_t buf[ATTITUDE_RECORD_MAX];
+    static uint8_t times[(ATTITUDE_BLOCK * DOD_MAX_BITS + 7) / 8];
+    record_attitude_t block = {.bits = ATTITUDE_BITS};
+    uint32_t start, num, len;
+    uint8_t res = 0;
+    dod_t dod, last;
+
+    /* 从进度处继续, 掉电中断可能打断了主循环中的写入 */
+    while (attitude.sent < attitude.num) {
+        start = attitude.sent;
+        block.flags = (start == 0) ? attitude.flags : 0;
+        /* 逐个编码时间, 加上四元数一页放不下时退回上一个 */
+        dod_init(&dod, attitude.time[start]);
+        dod_set_buffer(&dod, times, sizeof(times));
+        for (num = 0; start + num < attitude.num; ++num) {
+            last = dod;
+            dod_put(&dod, attitude.time[start + num]);
+            if (sizeof(block) + (num + 1) * ATTITUDE_QUAT_SIZE +
+                    dod_size(&dod) >
+                sizeof(buf)) {
+                dod = last;
+                break;
+            }
+        }
+
+        block.base = attitude.time[start];
+        block.num = (uint16_t)num;
+        len = num * ATTITUDE_QUAT_SIZE;
+        memcpy(buf, &block, sizeof(block));
+        memcpy(buf + sizeof(block), &attitude.code[start * ATTITUDE_QUAT_SIZE],
+               len);
+        memcpy(buf + sizeof(block) + len, times, dod_size(&dod));
+        len += sizeof(block) + dod_size(&dod);
+
+        if (recorder_write_part(RECORD_TYPE_ATTITUDE, 0, buf, len,
+                                &attitude.sent,
+                                (uint16_t)(start + num)) != 0) {
+            attitude.sent = (uint16_t)(start + num);
+            res = 1;
+        }
+    }
+
+    attitude.num = 0;
+    attitude.sent = 0;
+    attitude.flags = 0;
+
+    return res;
+}
+
+#endif /* ATTITUDE_ENABLE == 1 */
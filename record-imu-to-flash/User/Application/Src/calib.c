@@ -0,0 +1,650 @@
+/**
+ * @file    calib.c
+ * @author  Deadline039
+ * @brief   传感器校准
+ * @version 1.0
+ * @date    2026-10-17
+ * @note    三种校准都逐个采样更新, 不缓存采样:
+ *          - 陀螺仪: 静止时求均值作为零偏
+ *          - 加速度计: 六个朝向(各轴朝上和朝下)分别静止平均, 每对朝向的
+ *            和给出偏移, 差给出该轴的灵敏度和轴间耦合, 求逆得到矩阵
+ *          - 磁力计: 累加一般椭球x'Ax + 2b'x = 1的最小二乘法方程(9个未知数),
+ *            结束时求解, 求出中心(硬铁)和把椭球变为球面的对称矩阵(软铁)
+ *          平均期间角速度偏离均值超过阈值时重新开始.
+ *
+ *          串口命令(和日志检索共用串口):
+ *          cal gyro|accel|mag|done|stop|clear, cal显示参数.
+ *          accel每次采集一个朝向, 六个都采集后计算; mag开始拟合, 转动板子
+ *          后用done结束. 新的参数立即生效, 写入EEPROM并作为记录写入日志
+ */
+
+#include "calib.h"
+#include "eeprom.h"
+#include "query.h"
+#include "recorder.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#if (CALIB_ENABLE == 1)
+
+/* 采样率(Hz), 与MPU9250配置相同 */
+#define CALIB_RATE      (1000 / (1 + MPU9250_SMPLRT_DIV))
+
+/* 平均的采样数 */
+#define CALIB_GYRO_NUM  (CALIB_GYRO_TIME * CALIB_RATE / 1000 + 1)
+#define CALIB_ACCEL_NUM (CALIB_ACCEL_TIME * CALIB_RATE / 1000 + 1)
+
+/* 1g对应的加速度原始值 */
+#define CALIB_ONE_G     ((float)(16384 >> MPU9250_ACCEL_FS))
+
+/* 静止阈值对应的角速度原始值 */
+#define CALIB_STILL_LSB                                                        \
+    ((float)CALIB_STILL_DPS * 32768.0f / (float)(250 << MPU9250_GYRO_FS))
+
+/* 磁场拟合前乘的系数, 地磁约330LSB, 让法方程中的各项在1附近 */
+#define CALIB_MAG_SCALE (1.0f / 256.0f)
+
+/* 椭球拟合的未知数个数 */
+#define CALIB_FIT_NUM   9
+
+/**
+ * @brief 正在进行的校准
+ */
+typedef enum {
+    CALIB_IDLE = 0U,  /* 空闲 */
+    CALIB_RUN_GYRO,   /* 陀螺仪静止平均 */
+    CALIB_RUN_ACCEL,  /* 加速度计一个朝向的静止平均 */
+    CALIB_RUN_MAG     /* 磁力计椭球拟合 */
+} calib_state_t;
+
+static calib_param_t calib_param[CALIB_SENSOR_NUM];
+
+static struct {
+    calib_state_t state; /*!< 正在进行的校准 */
+    uint32_t count;      /*!< 已平均或拟合的采样数 */
+    float gyro[3];       /*!< 角速度均值, 用来判断静止 */
+    float accel[3];      /*!< 加速度均值 */
+
+    float faces[6][3]; /*!< 六个朝向的加速度均值, 序号为2 * 轴 + 朝下 */
+    uint8_t face_mask; /*!< 已采集的朝向 */
+
+    float ata[CALIB_FIT_NUM][CALIB_FIT_NUM]; /*!< 法方程矩阵, 只累加上三角 */
+    float atb[CALIB_FIT_NUM];                /*!< 法方程右端 */
+} calib;
+
+/**
+ * @brief 参数设为单位矩阵和零偏移
+ *
+ * @param[out] param 参数
+ */
+static void calib_identity(calib_param_t *param) {
+    memset(param, 0, sizeof(*param));
+    param->matrix[0][0] = 1.0f;
+    param->matrix[1][1] = 1.0f;
+    param->matrix[2][2] = 1.0f;
+}
+
+/**
+ * @brief 更新参数, 写入EEPROM和日志
+ *
+ * @param sensor 传感器
+ * @param param 新的参数
+ */
+static void calib_update(calib_sensor_t sensor, const calib_param_t *param) {
+    calib_param[sensor] = *param;
+
+    if (eeprom_write(CALIB_EEPROM_KEY + sensor, param, sizeof(*param)) != 0) {
+        printf("Calibration %u save failed. \r\n", (unsigned int)sensor);
+    }
+    recorder_write(RECORD_TYPE_CALIB, (uint8_t)sensor, param, sizeof(*param));
+}
+
+/**
+ * @brief 初始化, 从EEPROM读取参数, 写入日志
+ *
+ * @note 在`recorder_init`之后调用. 没有保存过的传感器不校准
+ */
+void calib_init(void) {
+    for (uint32_t i = 0; i < CALIB_SENSOR_NUM; ++i) {
+        if (eeprom_read(CALIB_EEPROM_KEY + i, &calib_param[i],
+                        sizeof(calib_param[i])) != 0) {
+            calib_identity(&calib_param[i]);
+        }
+        recorder_write(RECORD_TYPE_CALIB, (uint8_t)i, &calib_param[i],
+                       sizeof(calib_param[i]));
+    }
+
+    calib.state = CALIB_IDLE;
+}
+
+/**
+ * @brief 一个传感器乘矩阵加偏移
+ *
+ * @param param 参数
+ * @param raw 原始值
+ * @param[out] out 校准后的值
+ * @note M4F没有浮点SIMD, 展开后是9次乘加, 由FPU的VFMA完成
+ */
+static inline void calib_transform(const calib_param_t *param,
+                                   const int16_t raw[3], float out[3]) {
+    float x = (float)raw[0], y = (float)raw[1], z = (float)raw[2];
+
+    out[0] = param->offset[0] + param->matrix[0][0] * x +
+             param->matrix[0][1] * y + param->matrix[0][2] * z;
+    out[1] = param->offset[1] + param->matrix[1][0] * x +
+             param->matrix[1][1] * y + param->matrix[1][2] * z;
+    out[2] = param->offset[2] + param->matrix[2][0] * x +
+             param->matrix[2][1] * y + param->matrix[2][2] * z;
+}
+
+/**
+ * @brief 校准一个采样
+ *
+ * @param sample 原始采样
+ * @param[out] accel 加速度(LSB)
+ * @param[out] gyro 角速度(LSB)
+ * @param[out] mag 磁场(LSB), AK8963的坐标系
+ * @note 在姿态解算中调用, 约40周期
+ */
+void calib_apply(const mpu9250_sample_t *sample, float accel[3],
+                 float gyro[3], float mag[3]) {
+    calib_transform(&calib_param[CALIB_ACCEL], sample->accel, accel);
+    calib_transform(&calib_param[CALIB_GYRO], sample->gyro, gyro);
+    calib_transform(&calib_param[CALIB_MAG], sample->mag, mag);
+}
+
+/**
+ * @brief 获取校准参数
+ *
+ * @param sensor 传感器
+ * @param[out] param 参数
+ */
+void calib_get(calib_sensor_t sensor, calib_param_t *param) {
+    *param = calib_param[sensor];
+}
+
+/**
+ * @brief 3x3矩阵求逆
+ *
+ * @param a 矩阵
+ * @param[out] inv 逆矩阵
+ * @return 求逆结果
+ *  @retval 0 成功
+ *  @retval 1 矩阵奇异
+ */
+static uint8_t calib_inverse(const float a[3][3], float inv[3][3]) {
+    float det;
+
+    inv[0][0] = a[1][1] * a[2][2] - a[1][2] * a[2][1];
+    inv[0][1] = a[0][2] * a[2][1] - a[0][1] * a[2][2];
+    inv[0][2] = a[0][1] * a[1][2] - a[0][2] * a[1][1];
+    inv[1][0] = a[1][2] * a[2][0] - a[1][0] * a[2][2];
+    inv[1][1] = a[0][0] * a[2][2] - a[0][2] * a[2][0];
+    inv[1][2] = a[0][2] * a[1][0] - a[0][0] * a[1][2];
+    inv[2][0] = a[1][0] * a[2][1] - a[1][1] * a[2][0];
+    inv[2][1] = a[0][1] * a[2][0] - a[0][0] * a[2][1];
+    inv[2][2] = a[0][0] * a[1][1] - a[0][1] * a[1][0];
+
+    det = a[0][0] * inv[0][0] + a[0][1] * inv[1][0] + a[0][2] * inv[2][0];
+    if (fabsf(det) < 1e-12f) {
+        return 1;
+    }
+
+    det = 1.0f / det;
+    for (uint32_t i = 0; i < 3; ++i) {
+        for (uint32_t j = 0; j < 3; ++j) {
+            inv[i][j] *= det;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief 陀螺仪平均结束, 均值作为零偏
+ *
+ */
+static void calib_gyro_done(void) {
+    calib_param_t param;
+
+    calib_identity(&param);
+    for (uint32_t i = 0; i < 3; ++i) {
+        param.offset[i] = -calib.gyro[i];
+    }
+    calib_update(CALIB_GYRO, &param);
+
+    printf("Gyro bias: %d %d %d (0.01 LSB). \r\n",
+           (int)(calib.gyro[0] * 100.0f), (int)(calib.gyro[1] * 100.0f),
+           (int)(calib.gyro[2] * 100.0f));
+}
+
+/**
+ * @brief 加速度计一个朝向平均结束, 六个朝向都采集后计算参数
+ *
+ * @note 第j列为j轴朝上和朝下的差的一半, 即1g在j轴上时各轴的响应;
+ *       六个朝向的和的平均为偏移. 校准矩阵为1g的标称值乘该矩阵的逆
+ */
+static void calib_accel_done(void) {
+    calib_param_t param;
+    float a[3][3], inv[3][3], bias[3] = {0.0f, 0.0f, 0.0f};
+    uint32_t axis = 0, face;
+
+    for (uint32_t i = 1; i < 3; ++i) {
+        if (fabsf(calib.accel[i]) > fabsf(calib.accel[axis])) {
+            axis = i;
+        }
+    }
+    if (fabsf(calib.accel[axis]) < 0.5f * CALIB_ONE_G) {
+        printf("Accel: no axis is vertical, ignored. \r\n");
+        return;
+    }
+
+    face = 2 * axis + ((calib.accel[axis] < 0.0f) ? 1 : 0);
+    memcpy(calib.faces[face], calib.accel, sizeof(calib.accel));
+    calib.face_mask |= (uint8_t)(1U << face);
+    printf("Accel: %c%c captured, mask 0x%02X. \r\n",
+           (face & 1) ? '-' : '+', 'X' + axis, calib.face_mask);
+    if (calib.face_mask != 0x3F) {
+        return;
+    }
+
+    for (uint32_t j = 0; j < 3; ++j) {
+        for (uint32_t i = 0; i < 3; ++i) {
+            const float *up = calib.faces[2 * j];
+            const float *down = calib.faces[2 * j + 1];
+
+            a[i][j] = 0.5f * (up[i] - down[i]);
+            bias[i] += (up[i] + down[i]) / 6.0f;
+        }
+    }
+    calib.face_mask = 0;
+
+    if (calib_inverse(a, inv) != 0) {
+        printf("Accel: calibration failed. \r\n");
+        return;
+    }
+
+    for (uint32_t i = 0; i < 3; ++i) {
+        param.offset[i] = 0.0f;
+        for (uint32_t j = 0; j < 3; ++j) {
+            param.matrix[i][j] = CALIB_ONE_G * inv[i][j];
+            param.offset[i] -= param.matrix[i][j] * bias[j];
+        }
+    }
+    calib_update(CALIB_ACCEL, &param);
+
+    printf("Accel: offset %d %d %d, scale %d %d %d (0.001). \r\n",
+           (int)bias[0], (int)bias[1], (int)bias[2],
+           (int)(param.matrix[0][0] * 1000.0f),
+           (int)(param.matrix[1][1] * 1000.0f),
+           (int)(param.matrix[2][2] * 1000.0f));
+}
+
+/**
+ * @brief 静止平均输入一个采样
+ *
+ * @param sample 原始采样
+ */
+static void calib_average(const mpu9250_sample_t *sample) {
+    float n;
+
+    if (calib.count != 0) {
+        for (uint32_t i = 0; i < 3; ++i) {
+            if (fabsf((float)sample->gyro[i] - calib.gyro[i]) >
+                CALIB_STILL_LSB) {
+                calib.count = 0;
+                break;
+            }
+        }
+    }
+    if (sample->flags & MPU9250_FLAG_GAP) {
+        calib.count = 0;
+    }
+
+    n = 1.0f / (float)(++calib.count);
+    for (uint32_t i = 0; i < 3; ++i) {
+        calib.gyro[i] += ((float)sample->gyro[i] - calib.gyro[i]) * n;
+        calib.accel[i] += ((float)sample->accel[i] - calib.accel[i]) * n;
+    }
+
+    if (calib.state == CALIB_RUN_GYRO) {
+        if (calib.count >= CALIB_GYRO_NUM) {
+            calib.state = CALIB_IDLE;
+            calib_gyro_done();
+        }
+    } else if (calib.count >= CALIB_ACCEL_NUM) {
+        calib.state = CALIB_IDLE;
+        calib_accel_done();
+    }
+}
+
+/**
+ * @brief 椭球拟合输入一个磁场
+ *
+ * @param sample 原始采样
+ * @note 每行为(x^2, y^2, z^2, 2xy, 2xz, 2yz, 2x, 2y, 2z), 右端为1
+ */
+static void calib_mag_input(const mpu9250_sample_t *sample) {
+    float x, y, z, d[CALIB_FIT_NUM];
+
+    if (!(sample->flags & MPU9250_FLAG_MAG)) {
+        return;
+    }
+
+    x = (float)sample->mag[0] * CALIB_MAG_SCALE;
+    y = (float)sample->mag[1] * CALIB_MAG_SCALE;
+    z = (float)sample->mag[2] * CALIB_MAG_SCALE;
+    d[0] = x * x;
+    d[1] = y * y;
+    d[2] = z * z;
+    d[3] = 2.0f * x * y;
+    d[4] = 2.0f * x * z;
+    d[5] = 2.0f * y * z;
+    d[6] = 2.0f * x;
+    d[7] = 2.0f * y;
+    d[8] = 2.0f * z;
+
+    for (uint32_t i = 0; i < CALIB_FIT_NUM; ++i) {
+        for (uint32_t j = i; j < CALIB_FIT_NUM; ++j) {
+            calib.ata[i][j] += d[i] * d[j];
+        }
+        calib.atb[i] += d[i];
+    }
+    calib.count++;
+}
+
+/**
+ * @brief 求解法方程, 列主元高斯消元
+ *
+ * @param[out] v 解
+ * @return 求解结果
+ *  @retval 0 成功
+ *  @retval 1 矩阵奇异, 采样没有覆盖各个方向
+ * @note 会破坏累加的法方程
+ */
+static uint8_t calib_solve(float v[CALIB_FIT_NUM]) {
+    float (*a)[CALIB_FIT_NUM] = calib.ata;
+    float *b = calib.atb;
+
+    for (uint32_t i = 0; i < CALIB_FIT_NUM; ++i) {
+        for (uint32_t j = 0; j < i; ++j) {
+            a[i][j] = a[j][i];
+        }
+    }
+
+    for (uint32_t k = 0; k < CALIB_FIT_NUM; ++k) {
+        uint32_t pivot = k;
+
+        for (uint32_t i = k + 1; i < CALIB_FIT_NUM; ++i) {
+            if (fabsf(a[i][k]) > fabsf(a[pivot][k])) {
+                pivot = i;
+            }
+        }
+        if (fabsf(a[pivot][k]) < 1e-9f) {
+            return 1;
+        }
+        if (pivot != k) {
+            for (uint32_t j = 0; j < CALIB_FIT_NUM; ++j) {
+                float t = a[k][j];
+
+                a[k][j] = a[pivot][j];
+                a[pivot][j] = t;
+            }
+            float t = b[k];
+            b[k] = b[pivot];
+            b[pivot] = t;
+        }
+
+        for (uint32_t i = k + 1; i < CALIB_FIT_NUM; ++i) {
+            float f = a[i][k] / a[k][k];
+
+            for (uint32_t j = k; j < CALIB_FIT_NUM; ++j) {
+                a[i][j] -= f * a[k][j];
+            }
+            b[i] -= f * b[k];
+        }
+    }
+
+    for (uint32_t k = CALIB_FIT_NUM; k-- > 0;) {
+        float sum = b[k];
+
+        for (uint32_t j = k + 1; j < CALIB_FIT_NUM; ++j) {
+            sum -= a[k][j] * v[j];
+        }
+        v[k] = sum / a[k][k];
+    }
+
+    return 0;
+}
+
+/**
+ * @brief 3x3对称矩阵特征分解, 循环Jacobi方法
+ *
+ * @param[in,out] a 对称矩阵, 结束时对角线为特征值
+ * @param[out] v 特征向量, 第i列对应a[i][i]
+ */
+static void calib_eigen(float a[3][3], float v[3][3]) {
+    memset(v, 0, sizeof(float) * 9);
+    v[0][0] = v[1][1] = v[2][2] = 1.0f;
+
+    for (uint32_t sweep = 0; sweep < 10; ++sweep) {
+        for (uint32_t p = 0; p < 2; ++p) {
+            for (uint32_t q = p + 1; q < 3; ++q) {
+                float theta, t, c, s;
+
+                if (fabsf(a[p][q]) < 1e-12f) {
+                    continue;
+                }
+
+                /* 选择旋转角使a[p][q]为0 */
+                theta = (a[q][q] - a[p][p]) / (2.0f * a[p][q]);
+                t = ((theta >= 0.0f) ? 1.0f : -1.0f) /
+                    (fabsf(theta) + sqrtf(theta * theta + 1.0f));
+                c = 1.0f / sqrtf(t * t + 1.0f);
+                s = t * c;
+
+                for (uint32_t k = 0; k < 3; ++k) {
+                    float akp = a[k][p], akq = a[k][q];
+
+                    a[k][p] = c * akp - s * akq;
+                    a[k][q] = s * akp + c * akq;
+                }
+                for (uint32_t k = 0; k < 3; ++k) {
+                    float apk = a[p][k], aqk = a[q][k];
+
+                    a[p][k] = c * apk - s * aqk;
+                    a[q][k] = s * apk + c * aqk;
+                }
+                for (uint32_t k = 0; k < 3; ++k) {
+                    float vkp = v[k][p], vkq = v[k][q];
+
+                    v[k][p] = c * vkp - s * vkq;
+                    v[k][q] = s * vkp + c * vkq;
+                }
+            }
+        }
+    }
+}
+
+/**
+ * @brief 结束磁力计拟合, 计算参数
+ *
+ * @note 椭球(x - c)'Q(x - c) = 1, 其中c = -A^-1 b, Q = A / (1 + c'Ac).
+ *       Q = V diag(l) V', 软铁矩阵取r * V diag(sqrt(l)) V', 是对称矩阵,
+ *       不引入额外的旋转; r为几何平均半径, 校准后球面半径不变
+ */
+static void calib_mag_done(void) {
+    calib_param_t param;
+    float v[CALIB_FIT_NUM], a[3][3], inv[3][3], vec[3][3];
+    float c[3], k = 1.0f, r;
+
+    if (calib.count < CALIB_MAG_MIN) {
+        printf("Mag: %u samples, need %u. \r\n", (unsigned int)calib.count,
+               (unsigned int)CALIB_MAG_MIN);
+        return;
+    }
+    calib.state = CALIB_IDLE;
+
+    if (calib_solve(v) != 0) {
+        printf("Mag: fit failed. \r\n");
+        return;
+    }
+
+    a[0][0] = v[0];
+    a[1][1] = v[1];
+    a[2][2] = v[2];
+    a[0][1] = a[1][0] = v[3];
+    a[0][2] = a[2][0] = v[4];
+    a[1][2] = a[2][1] = v[5];
+    if (calib_inverse(a, inv) != 0) {
+        printf("Mag: fit failed. \r\n");
+        return;
+    }
+
+    for (uint32_t i = 0; i < 3; ++i) {
+        c[i] = -(inv[i][0] * v[6] + inv[i][1] * v[7] + inv[i][2] * v[8]);
+    }
+    for (uint32_t i = 0; i < 3; ++i) {
+        for (uint32_t j = 0; j < 3; ++j) {
+            k += c[i] * a[i][j] * c[j];
+        }
+    }
+
+    if (k == 0.0f) {
+        printf("Mag: not an ellipsoid. \r\n");
+        return;
+    }
+
+    /* 硬铁偏移大于半径时k为负, 拟合出的A也为负定, A / k仍是正定的 */
+    for (uint32_t i = 0; i < 3; ++i) {
+        for (uint32_t j = 0; j < 3; ++j) {
+            a[i][j] /= k;
+        }
+    }
+    calib_eigen(a, vec);
+    if ((a[0][0] <= 0.0f) || (a[1][1] <= 0.0f) || (a[2][2] <= 0.0f)) {
+        printf("Mag: not an ellipsoid. \r\n");
+        return;
+    }
+
+    r = powf(a[0][0] * a[1][1] * a[2][2], -1.0f / 6.0f);
+    for (uint32_t i = 0; i < 3; ++i) {
+        for (uint32_t j = 0; j < 3; ++j) {
+            param.matrix[i][j] = 0.0f;
+            for (uint32_t l = 0; l < 3; ++l) {
+                param.matrix[i][j] +=
+                    r * vec[i][l] * sqrtf(a[l][l]) * vec[j][l];
+            }
+        }
+    }
+
+    /* 拟合在缩放后的坐标中进行, 矩阵与缩放无关, 中心还原为原始值 */
+    for (uint32_t i = 0; i < 3; ++i) {
+        c[i] /= CALIB_MAG_SCALE;
+    }
+    for (uint32_t i = 0; i < 3; ++i) {
+        param.offset[i] = -(param.matrix[i][0] * c[0] +
+                            param.matrix[i][1] * c[1] +
+                            param.matrix[i][2] * c[2]);
+    }
+    calib_update(CALIB_MAG, &param);
+
+    printf("Mag: center %d %d %d, radius %d. \r\n", (int)c[0], (int)c[1],
+           (int)c[2], (int)(r / CALIB_MAG_SCALE));
+}
+
+/**
+ * @brief 输入一个原始采样, 进行正在进行的校准
+ *
+ * @param sample 原始采样
+ * @note 在主循环中, 姿态解算之前调用
+ */
+void calib_input(const mpu9250_sample_t *sample) {
+    switch (calib.state) {
+        case CALIB_RUN_GYRO:
+        case CALIB_RUN_ACCEL: {
+            calib_average(sample);
+        } break;
+
+        case CALIB_RUN_MAG: {
+            calib_mag_input(sample);
+        } break;
+
+        default: {
+        } break;
+    }
+}
+
+/**
+ * @brief 打印各传感器的参数
+ *
+ */
+static void calib_show(void) {
+    static const char *const names[CALIB_SENSOR_NUM] = {"Accel", "Gyro",
+                                                        "Mag"};
+
+    for (uint32_t s = 0; s < CALIB_SENSOR_NUM; ++s) {
+        const calib_param_t *p = &calib_param[s];
+
+        printf("%s (0.001):", names[s]);
+        for (uint32_t i = 0; i < 3; ++i) {
+            printf(" [%d %d %d | %d]", (int)(p->matrix[i][0] * 1000.0f),
+                   (int)(p->matrix[i][1] * 1000.0f),
+                   (int)(p->matrix[i][2] * 1000.0f),
+                   (int)(p->offset[i] * 1000.0f));
+        }
+        printf("\r\n");
+    }
+}
+
+/**
+ * @brief 解析校准命令
+ *
+ * @param cmd 命令
+ * @return 0-不是校准命令, 1-已处理
+ */
+uint8_t query_command_callback(const char *cmd) {
+    calib_param_t param;
+
+    if ((strncmp(cmd, "cal", 3) != 0) ||
+        ((cmd[3] != '\0') && (cmd[3] != ' '))) {
+        return 0;
+    }
+    cmd += 3;
+    while (*cmd == ' ') {
+        cmd++;
+    }
+
+    if (*cmd == '\0') {
+        calib_show();
+    } else if (strcmp(cmd, "gyro") == 0) {
+        calib.state = CALIB_RUN_GYRO;
+        calib.count = 0;
+    } else if (strcmp(cmd, "accel") == 0) {
+        calib.state = CALIB_RUN_ACCEL;
+        calib.count = 0;
+    } else if (strcmp(cmd, "mag") == 0) {
+        memset(calib.ata, 0, sizeof(calib.ata));
+        memset(calib.atb, 0, sizeof(calib.atb));
+        calib.state = CALIB_RUN_MAG;
+        calib.count = 0;
+    } else if ((strcmp(cmd, "done") == 0) && (calib.state == CALIB_RUN_MAG)) {
+        calib_mag_done();
+    } else if (strcmp(cmd, "stop") == 0) {
+        calib.state = CALIB_IDLE;
+        calib.face_mask = 0;
+    } else if (strcmp(cmd, "clear") == 0) {
+        calib_identity(&param);
+        for (uint32_t i = 0; i < CALIB_SENSOR_NUM; ++i) {
+            calib_update((calib_sensor_t)i, &param);
+        }
+    } else {
+        printf("Usage: cal [gyro|accel|mag|done|stop|clear]\r\n");
+    }
+
+    return 1;
+}
+
+#endif /* CALIB_ENABLE == 1 */
@@ -0,0 +1,239 @@
+/**
+ * @file    decimate.c
+ * @author  Deadline039
+ * @brief   IMU多速率抽取
+ * @version 1.0
+ * @date    2026-10-17
+ * @note    同一路IMU采样分成多个通道输出, 每个通道的采样率不同.
+ *          抽取倍数大于1的通道先经过抗混叠FIR再抽取, 只在输出时计算滤波器.
+ *          滤波器为Hamming窗的sinc, 截止频率为输出采样率的一半, 在初始化时
+ *          计算. 输出的时间为滤波器中心对应的输入的时间, 补偿群延迟.
+ *          抽取倍数为1的通道直接输出原始采样. 磁场单独记录, 不滤波,
+ *          输出最近一次的磁场.
+ */
+
+#include "decimate.h"
+
+#include <math.h>
+
+/* 滤波的轴: 加速度3, 温度1, 角速度3 */
+#define DECIMATE_AXIS_NUM 7
+
+#define DECIMATE_PI       3.14159265f
+
+/**
+ * @brief 输出通道
+ */
+typedef struct {
+    dsp_decimate_q15_t dec[DECIMATE_AXIS_NUM]; /*!< 每个轴的抽取器 */
+    q15_t *state;    /*!< 延迟线, 每个轴2 * taps个 */
+    q15_t *coeffs;   /*!< 抗混叠滤波器系数 */
+    uint32_t *times; /*!< 最近taps个输入的时间 */
+    uint16_t factor; /*!< 抽取倍数 */
+    uint16_t taps;   /*!< 抽头数 */
+    uint16_t pos;    /*!< 下一个输入时间写入的位置 */
+    uint16_t flags;  /*!< 上次输出之后输入的采样标志 */
+    uint8_t primed;  /*!< 已经有输入, 时间缓冲区有效 */
+    uint8_t enable;  /*!< 正在输出 */
+} decimate_channel_t;
+
+static q15_t decimate_state0[DECIMATE_AXIS_NUM * 2 * DECIMATE_CH0_TAPS];
+static q15_t decimate_coeffs0[DECIMATE_CH0_TAPS];
+static uint32_t decimate_times0[DECIMATE_CH0_TAPS];
+static q15_t decimate_state1[DECIMATE_AXIS_NUM * 2 * DECIMATE_CH1_TAPS];
+static q15_t decimate_coeffs1[DECIMATE_CH1_TAPS];
+static uint32_t decimate_times1[DECIMATE_CH1_TAPS];
+
+static decimate_channel_t decimate_channel[DECIMATE_CHANNEL_NUM] = {
+    {.state = decimate_state0,
+     .coeffs = decimate_coeffs0,
+     .times = decimate_times0,
+     .factor = DECIMATE_CH0_FACTOR,
+     .taps = DECIMATE_CH0_TAPS,
+     .enable = DECIMATE_CH0_START},
+    {.state = decimate_state1,
+     .coeffs = decimate_coeffs1,
+     .times = decimate_times1,
+     .factor = DECIMATE_CH1_FACTOR,
+     .taps = DECIMATE_CH1_TAPS,
+     .enable = DECIMATE_CH1_START},
+};
+
+/**
+ * @brief 计算一个抽头的系数
+ *
+ * @param n 抽头序号
+ * @param taps 抽头数
+ * @param fc 截止频率, 相对输入采样率
+ * @return 系数, 未归一化
+ */
+static float decimate_tap(uint32_t n, uint32_t taps, float fc) {
+    float x = (float)n - (float)(taps - 1) * 0.5f;
+    float h, w;
+
+    if (x == 0.0f) {
+        h = 2.0f * fc;
+    } else {
+        h = sinf(2.0f * DECIMATE_PI * fc * x) / (DECIMATE_PI * x);
+    }
+
+    if (taps == 1) {
+        return h;
+    }
+    w = 0.54f -
+        0.46f * cosf(2.0f * DECIMATE_PI * (float)n / (float)(taps - 1));
+
+    return h * w;
+}
+
+/**
+ * @brief 计算抗混叠滤波器系数
+ *
+ * @param channel 通道
+ * @note 直流增益归一化为1, 量化为Q15
+ */
+static void decimate_design(decimate_channel_t *channel) {
+    float fc = 0.5f / (float)channel->factor;
+    float sum = 0.0f;
+    float coeff;
+
+    for (uint32_t n = 0; n < channel->taps; ++n) {
+        sum += decimate_tap(n, channel->taps, fc);
+    }
+
+    for (uint32_t n = 0; n < channel->taps; ++n) {
+        coeff = decimate_tap(n, channel->taps, fc) / sum * 32768.0f;
+        coeff = (coeff > 32767.0f) ? 32767.0f : coeff;
+        channel->coeffs[n] = (q15_t)lrintf(coeff);
+    }
+}
+
+/**
+ * @brief 清空通道的滤波器状态
+ *
+ * @param channel 通道
+ * @note 下一个输出标记为有丢失
+ */
+static void decimate_reset(decimate_channel_t *channel) {
+    for (uint32_t i = 0; i < DECIMATE_AXIS_NUM; ++i) {
+        dsp_decimate_q15_init(&channel->dec[i], channel->coeffs,
+                              &channel->state[i * 2 * channel->taps],
+                              channel->taps, channel->factor);
+    }
+    channel->pos = 0;
+    channel->primed = 0;
+    channel->flags = MPU9250_FLAG_GAP;
+}
+
+/**
+ * @brief 初始化各通道, 计算滤波器系数
+ *
+ */
+void decimate_init(void) {
+    for (uint32_t i = 0; i < DECIMATE_CHANNEL_NUM; ++i) {
+        if (decimate_channel[i].factor > 1) {
+            decimate_design(&decimate_channel[i]);
+            decimate_reset(&decimate_channel[i]);
+        }
+    }
+}
+
+/**
+ * @brief 输入一个采样, 各通道需要时输出一个采样
+ *
+ * @param sample 输入的采样
+ * @param[out] out 各通道的输出, 只有对应位置1的有效
+ * @return 有输出的通道的位图
+ * @note 在主循环中调用
+ */
+uint32_t decimate_input(const mpu9250_sample_t *sample,
+                        mpu9250_sample_t out[DECIMATE_CHANNEL_NUM]) {
+    q15_t x[DECIMATE_AXIS_NUM], y[DECIMATE_AXIS_NUM];
+    uint32_t mask = 0;
+    uint32_t num, delay;
+
+    for (uint32_t i = 0; i < 3; ++i) {
+        x[i] = sample->accel[i];
+        x[4 + i] = sample->gyro[i];
+    }
+    x[3] = sample->temp;
+
+    for (uint32_t ch = 0; ch < DECIMATE_CHANNEL_NUM; ++ch) {
+        decimate_channel_t *channel = &decimate_channel[ch];
+
+        if (!channel->enable) {
+            continue;
+        }
+
+        channel->flags |= sample->flags;
+        if (channel->factor == 1) {
+            out[ch] = *sample;
+            out[ch].flags = channel->flags;
+            channel->flags = 0;
+            mask |= 1U << ch;
+            continue;
+        }
+
+        /* 刚开始时还没有足够的输入, 都当作第一个采样的时间 */
+        if (!channel->primed) {
+            for (uint32_t i = 0; i < channel->taps; ++i) {
+                channel->times[i] = sample->time;
+            }
+            channel->primed = 1;
+        }
+        channel->times[channel->pos] = sample->time;
+        channel->pos = (channel->pos + 1 == channel->taps) ? 0
+                                                           : channel->pos + 1;
+
+        /* 各轴的抽取相位相同, 同时输出 */
+        num = 0;
+        for (uint32_t i = 0; i < DECIMATE_AXIS_NUM; ++i) {
+            num = dsp_decimate_q15(&channel->dec[i], &x[i], &y[i], 1);
+        }
+        if (num == 0) {
+            continue;
+        }
+
+        /* 线性相位滤波器的输出对应中心抽头的输入 */
+        delay = (channel->taps - 1) / 2;
+        out[ch].time = channel->times[(channel->pos + channel->taps - 1 -
+                                       delay) %
+                                      channel->taps];
+        out[ch].flags = channel->flags;
+        channel->flags = 0;
+        for (uint32_t i = 0; i < 3; ++i) {
+            out[ch].accel[i] = y[i];
+            out[ch].gyro[i] = y[4 + i];
+            out[ch].mag[i] = sample->mag[i];
+        }
+        out[ch].temp = y[3];
+        mask |= 1U << ch;
+    }
+
+    return mask;
+}
+
+/**
+ * @brief 打开或关闭一个通道
+ *
+ * @param channel 通道号
+ * @param enable 1为打开, 0为关闭
+ * @note 在主循环中调用. 重新打开时清空滤波器, 第一个输出标记为有丢失
+ */
+void decimate_enable(uint8_t channel, uint8_t enable) {
+    decimate_channel_t *ch;
+
+    if (channel >= DECIMATE_CHANNEL_NUM) {
+        return;
+    }
+
+    ch = &decimate_channel[channel];
+    if (enable && !ch->enable) {
+        if (ch->factor > 1) {
+            decimate_reset(ch);
+        } else {
+            ch->flags = MPU9250_FLAG_GAP;
+        }
+    }
+    ch->enable = enable ? 1 : 0;
+}
@@ -18,16 +18,44 @@ void rtc_key_set_time(UART_HandleTypeDef *huart);
 int main(void) {
     bsp_init();
     rtc_key_set_time(&usart1_handle);
+    recorder_init();
+#if (CALIB_ENABLE == 1)
+    calib_init();
+#endif /* CALIB_ENABLE == 1 */
+    ahrs_init();
+#if (ATTITUDE_ENABLE == 1)
+    attitude_init();
+#endif /* ATTITUDE_ENABLE == 1 */
+    decimate_init();
+#if (SPECTRUM_ENABLE == 1)
+    spectrum_init();
+#endif /* SPECTRUM_ENABLE == 1 */
+#if (TRIGGER_ENABLE == 1)
+    trigger_init();
+#endif /* TRIGGER_ENABLE == 1 */
+#if (SUMMARY_ENABLE == 1)
+    summary_init();
+#endif /* SUMMARY_ENABLE == 1 */
+    if (mpu9250_init() != 0) {
+        printf("MPU9250 not found. \r\n");
+    }
 
-    char local_time_buffer[50];
-    struct tm *now_time;
+    key_press_t key;
 
     while (1) {
-        now_time = rtc_get_time();
-        strftime(local_time_buffer, sizeof(local_time_buffer),
-                 "%Y-%m-%d %H:%M:%S", now_time);
-        puts(local_time_buffer);
-        delay_ms(1000);
+        recorder_poll();
+        query_poll();
+
+        /* 按下KEY1检查日志 */
+        key = key_scan(0);
+        if (key == KEY1_PRESS) {
+            recorder_check();
+        }
+#if (TRIGGER_ENABLE == 1) && (TRIGGER_KEY != 0)
+        if (key == TRIGGER_KEY) {
+            trigger_fire();
+        }
+#endif /* (TRIGGER_ENABLE == 1) && (TRIGGER_KEY != 0) */
     }
 }
 
@@ -0,0 +1,801 @@
+/**
+ * @file    query.c
+ * @author  Deadline039
+ * @brief   日志检索
+ * @version 1.0
+ * @date    2026-10-17
+ * @note    串口收到检索命令后, 从最旧页到检索开始时的写入位置逐页检查.
+ *          先只读页头, 用页摘要中的时间范围, 记录类型, 通道和加速度,
+ *          角速度模的最大值跳过不可能有结果的页, 其余的页读出整页后逐条
+ *          检查记录, 结果通过串口DMA发送. 按模检索时采样块也先用块头中
+ *          模的最大值判断, 可能有结果的才解码, 逐个采样检查.
+ *
+ *          检索在主循环中进行, 每次轮询最多读取几页, 发送缓冲区未发完时
+ *          不再读取, 记录照常进行. 检索期间被覆盖的页直接跳到最旧页继续.
+ *
+ *          命令格式, 条件可以任意组合, 同一种条件可以出现多次:
+ *          find [type=N] [ch=N] [from=HH:MM[:SS]] [to=HH:MM[:SS]]
+ *               [hex=XXXX] [str=TEXT] [accel>MG] [gyro>DPS] [max=N]
+ *          stop
+ *          时间为当天的RTC时间. 字节序列只在一条记录内查找,
+ *          被分到两条记录中的不会找到. 时间未知的页不按时间过滤.
+ *          accel和gyro只检索IMU采样记录, 同时给出时需要同一个采样满足,
+ *          结果中是满足的采样数和第一个满足的采样.
+ */
+
+#include "query.h"
+#include "pack.h"
+#include "rtc.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* 命令最大长度 */
+#define QUERY_CMD_MAX  96
+
+/* 一行结果的最大长度 */
+#define QUERY_LINE_MAX (64 + QUERY_DUMP_MAX * 3)
+
+/* 能解码的最大采样块, 同配置的上限 */
+#define QUERY_IMU_BLOCK_MAX 64
+
+/* IMU采样记录的类型 */
+#define QUERY_IMU_TYPES                                                        \
+    ((1U << RECORD_TYPE_IMU) | (1U << RECORD_TYPE_IMU_BLOCK) |                 \
+     (1U << RECORD_TYPE_IMU_PACKED))
+
+/**
+ * @brief 检索状态
+ */
+typedef struct {
+    query_t cond;   /*!< 检索条件 */
+    uint8_t active; /*!< 是否正在检索 */
+    uint32_t page;  /*!< 下一个检查的页 */
+    uint32_t end;   /*!< 检索开始时的写入位置 */
+
+    flash_log_page_t buf; /*!< 正在检查的页 */
+    record_meta_t meta;   /*!< 正在检查的页的摘要 */
+    uint32_t offset;      /*!< 下一条记录在页内的偏移 */
+    uint8_t decoding;     /*!< 页内还有记录没有检查 */
+
+    float accel2; /*!< 加速度模的平方的下限(LSB^2) */
+    float gyro2;  /*!< 角速度模的平方的下限(LSB^2) */
+
+    int16_t column[IMU_COLUMN_NUM][QUERY_IMU_BLOCK_MAX]; /*!< 解码的采样 */
+    uint32_t hit_time; /*!< 第一个满足的采样的时间(us) */
+    uint16_t hit_num;  /*!< 满足的采样数 */
+    uint16_t hit;      /*!< 第一个满足的采样 */
+
+    uint32_t pages;   /*!< 检查的页数 */
+    uint32_t skipped; /*!< 根据摘要跳过的页数 */
+    uint32_t blocks;  /*!< 解码的采样块数 */
+    uint32_t pruned;  /*!< 根据块头跳过的采样块数 */
+    uint32_t matches; /*!< 输出的记录数 */
+
+    char line[QUERY_LINE_MAX]; /*!< 待发送的一行 */
+    uint32_t out_len;          /*!< 待发送的长度 */
+    uint32_t out_pos;          /*!< 已写入发送缓冲区的长度 */
+
+    char cmd[QUERY_CMD_MAX]; /*!< 正在接收的命令 */
+    uint32_t cmd_len;        /*!< 已接收的命令长度 */
+} query_state_t;
+
+static query_state_t query_state;
+
+/**
+ * @brief 类型或通道号对应的位
+ *
+ * @param n 类型或通道号
+ * @return 位图中的位, 大于7的都对应bit7
+ */
+static inline uint8_t query_bit(uint32_t n) {
+    return (uint8_t)(1U << (n < 7 ? n : 7));
+}
+
+/**
+ * @brief 把待发送的一行写入串口发送缓冲区
+ *
+ * @return 是否还有没有写入的数据
+ *  @retval 0 已全部写入
+ *  @retval 1 发送缓冲区忙, 下次轮询继续
+ */
+static uint8_t query_output(void) {
+    UART_HandleTypeDef *huart = &QUERY_UART_HANDLE;
+
+    if (query_state.out_pos == query_state.out_len) {
+        return 0;
+    }
+
+    /* DMA发送期间发送缓冲区不能写入 */
+    if (huart->gState != HAL_UART_STATE_READY) {
+        return 1;
+    }
+
+    query_state.out_pos +=
+        uart_dmatx_write(huart, query_state.line + query_state.out_pos,
+                         query_state.out_len - query_state.out_pos);
+    uart_dmatx_send(huart);
+
+    return (query_state.out_pos != query_state.out_len) ? 1 : 0;
+}
+
+/**
+ * @brief 在命令串口上输出一行
+ *
+ * @param __format 格式化字符串
+ * @return 输出结果
+ *  @retval 0 成功
+ *  @retval 1 上一行还没有写入发送缓冲区, 需要稍后再输出
+ */
+uint8_t query_printf(const char *__format, ...) {
+    va_list ap;
+    int len;
+
+    if (query_state.out_pos != query_state.out_len) {
+        return 1;
+    }
+
+    va_start(ap, __format);
+    len = vsnprintf(query_state.line, sizeof(query_state.line), __format, ap);
+    va_end(ap);
+
+    if (len < 0) {
+        return 0;
+    }
+
+    query_state.out_len = ((uint32_t)len < sizeof(query_state.line))
+                              ? (uint32_t)len
+                              : sizeof(query_state.line) - 1;
+    query_state.out_pos = 0;
+    query_output();
+
+    return 0;
+}
+
+/**
+ * @brief 解析当天的时间
+ *
+ * @param str 字符串, HH:MM或HH:MM:SS
+ * @param[out] time RTC时间(s)
+ * @return 解析结果
+ *  @retval 0 成功
+ *  @retval 1 格式错误
+ */
+static uint8_t query_parse_time(const char *str, uint32_t *time) {
+    struct tm tm = *rtc_get_time();
+    int hour, min, sec = 0;
+
+    if (sscanf(str, "%d:%d:%d", &hour, &min, &sec) < 2) {
+        return 1;
+    }
+
+    tm.tm_hour = hour;
+    tm.tm_min = min;
+    tm.tm_sec = sec;
+    *time = (uint32_t)mktime(&tm);
+
+    return 0;
+}
+
+/**
+ * @brief 解析十六进制字节序列
+ *
+ * @param str 字符串, 每个字节两位十六进制数
+ * @param[out] query 检索条件
+ * @return 解析结果
+ *  @retval 0 成功
+ *  @retval 1 格式错误或过长
+ */
+static uint8_t query_parse_hex(const char *str, query_t *query) {
+    uint32_t len = strlen(str);
+    char byte[3] = {0};
+    char *end;
+
+    if ((len == 0) || (len % 2) || (len / 2 > QUERY_PATTERN_MAX)) {
+        return 1;
+    }
+
+    for (uint32_t i = 0; i < len / 2; ++i) {
+        byte[0] = str[2 * i];
+        byte[1] = str[2 * i + 1];
+        query->pattern[i] = (uint8_t)strtoul(byte, &end, 16);
+        if (*end != '\0') {
+            return 1;
+        }
+    }
+    query->pattern_len = (uint8_t)(len / 2);
+
+    return 0;
+}
+
+/**
+ * @brief 解析检索命令
+ *
+ * @param cmd 命令, 格式见文件说明
+ * @param[out] query 检索条件
+ * @return 解析结果
+ *  @retval 0 成功
+ *  @retval 1 格式错误
+ */
+uint8_t query_parse(const char *cmd, query_t *query) {
+    char buf[QUERY_CMD_MAX];
+    char *key, *val;
+    char op;
+
+    strncpy(buf, cmd, sizeof(buf) - 1);
+    buf[sizeof(buf) - 1] = '\0';
+
+    key = strtok(buf, " ");
+    if ((key == NULL) || (strcmp(key, "find") != 0)) {
+        return 1;
+    }
+
+    memset(query, 0, sizeof(query_t));
+    query->to = 0xFFFFFFFF;
+
+    while ((key = strtok(NULL, " ")) != NULL) {
+        val = strpbrk(key, "=>");
+        if (val == NULL) {
+            return 1;
+        }
+        op = *val;
+        *val++ = '\0';
+
+        /* 模的条件用'>', 其余用'=' */
+        if ((op == '>') !=
+            ((strcmp(key, "accel") == 0) || (strcmp(key, "gyro") == 0))) {
+            return 1;
+        }
+
+        if (strcmp(key, "type") == 0) {
+            query->types |= query_bit(strtoul(val, NULL, 0));
+        } else if (strcmp(key, "ch") == 0) {
+            query->channels |= query_bit(strtoul(val, NULL, 0));
+        } else if (strcmp(key, "from") == 0) {
+            if (query_parse_time(val, &query->from) != 0) {
+                return 1;
+            }
+        } else if (strcmp(key, "to") == 0) {
+            if (query_parse_time(val, &query->to) != 0) {
+                return 1;
+            }
+        } else if (strcmp(key, "hex") == 0) {
+            if (query_parse_hex(val, query) != 0) {
+                return 1;
+            }
+        } else if (strcmp(key, "str") == 0) {
+            if (strlen(val) > QUERY_PATTERN_MAX) {
+                return 1;
+            }
+            query->pattern_len = (uint8_t)strlen(val);
+            memcpy(query->pattern, val, query->pattern_len);
+        } else if (strcmp(key, "accel") == 0) {
+            query->accel = (uint16_t)strtoul(val, NULL, 0);
+        } else if (strcmp(key, "gyro") == 0) {
+            query->gyro = (uint16_t)strtoul(val, NULL, 0);
+        } else if (strcmp(key, "max") == 0) {
+            query->max = strtoul(val, NULL, 0);
+        } else {
+            return 1;
+        }
+    }
+
+    /* 没有指定的为全部 */
+    if (query->types == 0) {
+        query->types = 0xFF;
+    }
+    if (query->channels == 0) {
+        query->channels = 0xFF;
+    }
+    if ((query->accel != 0) || (query->gyro != 0)) {
+        query->types &= QUERY_IMU_TYPES;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief 开始检索
+ *
+ * @param query 检索条件
+ * @return 开始结果
+ *  @retval 0 成功
+ *  @retval 1 日志未挂载
+ * @note 先把暂存页写入Flash, 检索到此时的写入位置为止
+ */
+uint8_t query_start(const query_t *query) {
+    flash_log_t *log = recorder_get_log();
+    /* 加速度16384 >> FS LSB/g, 角速度32768 / (250 << FS) LSB/dps */
+    float accel = (float)query->accel * (float)(16384 >> MPU9250_ACCEL_FS) /
+                  1000.0f;
+    float gyro =
+        (float)query->gyro * 32768.0f / (float)(250 << MPU9250_GYRO_FS);
+
+    if (log->page_num == 0) {
+        return 1;
+    }
+
+    recorder_flush();
+
+    query_state.cond = *query;
+    query_state.accel2 = accel * accel;
+    query_state.gyro2 = gyro * gyro;
+    query_state.page = log->tail;
+    query_state.end = log->head;
+    query_state.decoding = 0;
+    query_state.pages = 0;
+    query_state.skipped = 0;
+    query_state.blocks = 0;
+    query_state.pruned = 0;
+    query_state.matches = 0;
+    query_state.active = 1;
+
+    return 0;
+}
+
+/**
+ * @brief 结束检索, 输出统计
+ *
+ */
+void query_stop(void) {
+    if (!query_state.active) {
+        return;
+    }
+
+    query_state.active = 0;
+    query_printf("Query done: %u pages, %u skipped, %u blocks decoded, "
+                 "%u skipped, %u matches. \r\n",
+                 (unsigned int)query_state.pages,
+                 (unsigned int)query_state.skipped,
+                 (unsigned int)query_state.blocks,
+                 (unsigned int)query_state.pruned,
+                 (unsigned int)query_state.matches);
+}
+
+/**
+ * @brief 根据模的最大值判断是否可能有满足的采样
+ *
+ * @param accel_peak 加速度模的最大值(LSB), 不小于真实值
+ * @param gyro_peak 角速度模的最大值(LSB), 不小于真实值
+ * @return 0-不可能有, 1-可能有
+ * @note 和逐个采样检查用同样的比较, 不会漏掉满足的采样
+ */
+static uint8_t query_match_peak(uint16_t accel_peak, uint16_t gyro_peak) {
+    if ((query_state.cond.accel != 0) &&
+        ((float)((uint32_t)accel_peak * accel_peak) <= query_state.accel2)) {
+        return 0;
+    }
+    if ((query_state.cond.gyro != 0) &&
+        ((float)((uint32_t)gyro_peak * gyro_peak) <= query_state.gyro2)) {
+        return 0;
+    }
+    return 1;
+}
+
+/**
+ * @brief 根据页摘要判断页内是否可能有结果
+ *
+ * @param cond 检索条件
+ * @param meta 页摘要
+ * @return 0-不可能有, 1-可能有
+ */
+static uint8_t query_match_meta(const query_t *cond,
+                                const record_meta_t *meta) {
+    if (!(meta->types & cond->types) || !(meta->channels & cond->channels)) {
+        return 0;
+    }
+
+    if (!query_match_peak(meta->accel_peak, meta->gyro_peak)) {
+        return 0;
+    }
+
+    if (meta->time == RECORD_TIME_UNKNOWN) {
+        return 1;
+    }
+
+    return ((meta->time <= cond->to) && (meta->time + meta->span >= cond->from))
+               ? 1
+               : 0;
+}
+
+/**
+ * @brief 数据中是否包含字节序列
+ *
+ * @param data 数据
+ * @param len 数据长度
+ * @param pattern 字节序列
+ * @param pattern_len 字节序列长度
+ * @return 0-不包含, 1-包含
+ */
+static uint8_t query_search(const uint8_t *data, uint32_t len,
+                            const uint8_t *pattern, uint32_t pattern_len) {
+    for (uint32_t i = 0; i + pattern_len <= len; ++i) {
+        if ((data[i] == pattern[0]) &&
+            (memcmp(data + i, pattern, pattern_len) == 0)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief 检查解码的一个采样
+ *
+ * @param i 采样序号
+ * @return 0-不满足, 1-满足
+ */
+static uint8_t query_match_sample(uint32_t i) {
+    int16_t(*column)[QUERY_IMU_BLOCK_MAX] = query_state.column;
+    float sum;
+
+    if (query_state.cond.accel != 0) {
+        sum = (float)((uint32_t)(column[IMU_COLUMN_AX][i] *
+                                 column[IMU_COLUMN_AX][i]) +
+                      (uint32_t)(column[IMU_COLUMN_AY][i] *
+                                 column[IMU_COLUMN_AY][i]) +
+                      (uint32_t)(column[IMU_COLUMN_AZ][i] *
+                                 column[IMU_COLUMN_AZ][i]));
+        if (sum <= query_state.accel2) {
+            return 0;
+        }
+    }
+    if (query_state.cond.gyro != 0) {
+        sum = (float)((uint32_t)(column[IMU_COLUMN_GX][i] *
+                                 column[IMU_COLUMN_GX][i]) +
+                      (uint32_t)(column[IMU_COLUMN_GY][i] *
+                                 column[IMU_COLUMN_GY][i]) +
+                      (uint32_t)(column[IMU_COLUMN_GZ][i] *
+                                 column[IMU_COLUMN_GZ][i]));
+        if (sum <= query_state.gyro2) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * @brief 解码一条IMU采样记录, 逐个采样检查模的条件
+ *
+ * @param hdr 记录头
+ * @param data 记录数据
+ * @return 0-没有满足的采样或数据损坏, 1-有满足的采样
+ * @note 采样块先用块头中模的最大值判断, 可能有满足的才解码.
+ *       满足的采样数和第一个满足的采样记在检索状态中
+ */
+static uint8_t query_match_imu(const record_hdr_t *hdr, const uint8_t *data) {
+    int16_t(*column)[QUERY_IMU_BLOCK_MAX] = query_state.column;
+    record_imu_block_t block;
+    imu_sample_t sample;
+
+    if (hdr->type == RECORD_TYPE_IMU) {
+        if (hdr->len < sizeof(sample)) {
+            return 0;
+        }
+        /* 单个采样也按列存放 */
+        memcpy(&sample, data, sizeof(sample));
+        block.base = sample.time;
+        block.step = 0;
+        block.num = 1;
+        column[IMU_COLUMN_TIME][0] = 0;
+        for (uint32_t i = 0; i < 3; ++i) {
+            column[IMU_COLUMN_AX + i][0] = sample.accel[i];
+            column[IMU_COLUMN_GX + i][0] = sample.gyro[i];
+        }
+    } else {
+        if (hdr->len < sizeof(block)) {
+            return 0;
+        }
+        memcpy(&block, data, sizeof(block));
+        if ((block.num == 0) || (block.num > QUERY_IMU_BLOCK_MAX)) {
+            return 0;
+        }
+
+        if (!query_match_peak(block.accel_peak, block.gyro_peak)) {
+            query_state.pruned++;
+            return 0;
+        }
+        query_state.blocks++;
+
+        if (hdr->type == RECORD_TYPE_IMU_PACKED) {
+            if (pack_decode(data + sizeof(block), hdr->len - sizeof(block),
+                            &column[0][0], QUERY_IMU_BLOCK_MAX,
+                            IMU_COLUMN_NUM, block.num) != 0) {
+                return 0;
+            }
+        } else {
+            if ((block.stride < block.num) ||
+                (sizeof(block) + IMU_COLUMN_NUM * sizeof(int16_t) *
+                                     block.stride >
+                 hdr->len)) {
+                return 0;
+            }
+            for (uint32_t c = 0; c < IMU_COLUMN_NUM; ++c) {
+                memcpy(&column[c][0],
+                       data + sizeof(block) +
+                           c * block.stride * sizeof(int16_t),
+                       block.num * sizeof(int16_t));
+            }
+        }
+    }
+
+    query_state.hit_num = 0;
+    for (uint32_t i = 0; i < block.num; ++i) {
+        if (query_match_sample(i)) {
+            if (query_state.hit_num++ == 0) {
+                query_state.hit = (uint16_t)i;
+                query_state.hit_time =
+                    block.base + i * block.step +
+                    (uint32_t)(int32_t)column[IMU_COLUMN_TIME][i];
+            }
+        }
+    }
+
+    return (query_state.hit_num != 0) ? 1 : 0;
+}
+
+/**
+ * @brief 检查一条记录
+ *
+ * @param cond 检索条件
+ * @param hdr 记录头
+ * @param data 记录数据
+ * @param time 记录的RTC时间(s)
+ * @return 0-不满足, 1-满足
+ */
+static uint8_t query_match_record(const query_t *cond, const record_hdr_t *hdr,
+                                  const uint8_t *data, uint32_t time) {
+    if (!(query_bit(hdr->type) & cond->types) ||
+        !(query_bit(hdr->channel) & cond->channels)) {
+        return 0;
+    }
+
+    if ((time != RECORD_TIME_UNKNOWN) &&
+        ((time < cond->from) || (time > cond->to))) {
+        return 0;
+    }
+
+    if ((cond->pattern_len != 0) &&
+        !query_search(data, hdr->len, cond->pattern, cond->pattern_len)) {
+        return 0;
+    }
+
+    if ((cond->accel != 0) || (cond->gyro != 0)) {
+        return query_match_imu(hdr, data);
+    }
+
+    return 1;
+}
+
+/**
+ * @brief 格式化满足模的条件的采样数和第一个满足的采样
+ *
+ * @param line 输出位置
+ * @param size 可用长度
+ * @return 输出的长度
+ */
+static uint32_t query_print_sample(char *line, uint32_t size) {
+    int16_t(*column)[QUERY_IMU_BLOCK_MAX] = query_state.column;
+    uint32_t i = query_state.hit;
+    int32_t accel[3], gyro[3];
+
+    /* 加速度换算为mg, 角速度换算为dps */
+    for (uint32_t k = 0; k < 3; ++k) {
+        accel[k] = (int32_t)column[IMU_COLUMN_AX + k][i] * 1000 /
+                   (16384 >> MPU9250_ACCEL_FS);
+        gyro[k] = (int32_t)column[IMU_COLUMN_GX + k][i] *
+                  (250 << MPU9250_GYRO_FS) / 32768;
+    }
+
+    return (uint32_t)snprintf(
+        line, size, " %u hits, first %uus A %d %d %d mg G %d %d %d dps",
+        (unsigned int)query_state.hit_num,
+        (unsigned int)query_state.hit_time,
+        (int)accel[0], (int)accel[1], (int)accel[2], (int)gyro[0],
+        (int)gyro[1], (int)gyro[2]);
+}
+
+/**
+ * @brief 输出一条记录
+ *
+ * @param hdr 记录头
+ * @param data 记录数据
+ * @param time 记录的RTC时间(s)
+ */
+static void query_print_record(const record_hdr_t *hdr, const uint8_t *data,
+                               uint32_t time) {
+    char *line = query_state.line;
+    uint32_t size = sizeof(query_state.line) - 2;
+    uint32_t len = 0;
+    time_t rtc_time = (time_t)time;
+
+    if (time != RECORD_TIME_UNKNOWN) {
+        len = strftime(line, size, "%Y-%m-%d %H:%M:%S", localtime(&rtc_time));
+    } else {
+        len = snprintf(line, size, "unknown time");
+    }
+
+    len += snprintf(line + len, size - len, " T%u C%u %ums L%u:",
+                    (unsigned int)hdr->type, (unsigned int)hdr->channel,
+                    (unsigned int)hdr->time, (unsigned int)hdr->len);
+
+    if ((query_state.cond.accel != 0) || (query_state.cond.gyro != 0)) {
+        len += query_print_sample(line + len, size - len);
+    } else {
+        for (uint32_t i = 0; (i < hdr->len) && (i < QUERY_DUMP_MAX); ++i) {
+            len += snprintf(line + len, size - len, " %02X", data[i]);
+        }
+        if (hdr->len > QUERY_DUMP_MAX) {
+            len += snprintf(line + len, size - len, " ...");
+        }
+    }
+
+    line[len++] = '\r';
+    line[len++] = '\n';
+
+    query_state.out_len = len;
+    query_state.out_pos = 0;
+    query_output();
+}
+
+/**
+ * @brief 检查页内的下一条满足条件的记录
+ *
+ * @return 0-页内已检查完, 1-输出了一条记录
+ */
+static uint8_t query_decode(void) {
+    flash_log_page_t *page = &query_state.buf;
+    record_meta_t *meta = &query_state.meta;
+    record_hdr_t hdr;
+    uint32_t time;
+    uint8_t *data;
+
+    while (query_state.offset + sizeof(hdr) <= page->hdr.len) {
+        memcpy(&hdr, page->data + query_state.offset, sizeof(hdr));
+        if (query_state.offset + sizeof(hdr) + hdr.len > page->hdr.len) {
+            break;
+        }
+        data = page->data + query_state.offset + sizeof(hdr);
+        query_state.offset += sizeof(hdr) + hdr.len;
+
+        time = RECORD_TIME_UNKNOWN;
+        if (meta->time != RECORD_TIME_UNKNOWN) {
+            time = meta->time + (hdr.time - meta->tick) / 1000;
+        }
+
+        if (query_match_record(&query_state.cond, &hdr, data, time)) {
+            query_state.matches++;
+            query_print_record(&hdr, data, time);
+            return 1;
+        }
+    }
+
+    query_state.decoding = 0;
+    return 0;
+}
+
+/**
+ * @brief 检查下一页, 摘要符合条件时读出整页
+ *
+ * @param log 日志句柄
+ */
+static void query_check_page(flash_log_t *log) {
+    flash_log_page_hdr_t hdr;
+    uint32_t page = query_state.page;
+    uint32_t used = (log->head + log->page_num - log->tail) % log->page_num;
+
+    /* 检索期间最旧的页被覆盖了 */
+    if ((page + log->page_num - log->tail) % log->page_num >= used) {
+        page = log->tail;
+    }
+    query_state.page = (page + 1) % log->page_num;
+    query_state.pages++;
+
+    if (flash_log_read_hdr(log, page, &hdr) != 0) {
+        return;
+    }
+
+    memcpy(&query_state.meta, hdr.meta, sizeof(record_meta_t));
+    if (!query_match_meta(&query_state.cond, &query_state.meta)) {
+        query_state.skipped++;
+        return;
+    }
+
+    if (flash_log_read_page(log, page, &query_state.buf) != 0) {
+        return;
+    }
+    /* 页头读取后页可能已被覆盖, 以整页中的摘要为准 */
+    memcpy(&query_state.meta, query_state.buf.hdr.meta, sizeof(record_meta_t));
+    query_state.offset = 0;
+    query_state.decoding = 1;
+}
+
+/**
+ * @brief 其他模块的命令, 在检索命令之前处理
+ *
+ * @param cmd 命令
+ * @return 0-不是该模块的命令, 1-已处理
+ */
+__weak uint8_t query_command_callback(const char *cmd) {
+    UNUSED(cmd);
+    return 0;
+}
+
+/**
+ * @brief 接收命令, 收到一行后执行
+ *
+ */
+static void query_read_cmd(void) {
+    query_t query;
+    char c;
+
+    while (uart_dmarx_read(&QUERY_UART_HANDLE, &c, 1)) {
+        if ((c != '\r') && (c != '\n')) {
+            if (query_state.cmd_len < sizeof(query_state.cmd) - 1) {
+                query_state.cmd[query_state.cmd_len++] = c;
+            }
+            continue;
+        }
+
+        if (query_state.cmd_len == 0) {
+            continue;
+        }
+        query_state.cmd[query_state.cmd_len] = '\0';
+        query_state.cmd_len = 0;
+
+        if (query_command_callback(query_state.cmd) != 0) {
+            return;
+        }
+
+        if (strcmp(query_state.cmd, "stop") == 0) {
+            query_stop();
+        } else if (query_parse(query_state.cmd, &query) != 0) {
+            query_printf("Usage: find [type=N] [ch=N] [from=HH:MM[:SS]] "
+                         "[to=HH:MM[:SS]] [hex=XX] [str=S] [accel>MG] "
+                         "[gyro>DPS] [max=N]\r\n");
+        } else if (query_start(&query) != 0) {
+            query_printf("Log not mounted. \r\n");
+        }
+        /* 一次只执行一条命令, 输出发完再接收下一条 */
+        return;
+    }
+}
+
+/**
+ * @brief 接收命令并进行检索, 在主循环中调用
+ *
+ */
+void query_poll(void) {
+    flash_log_t *log = recorder_get_log();
+
+    /* 上一行还没有写入发送缓冲区 */
+    if (query_output() != 0) {
+        return;
+    }
+
+    query_read_cmd();
+
+    for (uint32_t n = 0; query_state.active && (n < QUERY_PAGES_PER_POLL);) {
+        if (query_state.decoding) {
+            if (query_decode() != 0) {
+                if ((query_state.cond.max != 0) &&
+                    (query_state.matches >= query_state.cond.max)) {
+                    query_state.decoding = 0;
+                    query_state.page = query_state.end;
+                }
+                /* 发送完再检查下一条 */
+                return;
+            }
+            continue;
+        }
+
+        if (query_state.page == query_state.end) {
+            query_stop();
+            return;
+        }
+
+        query_check_page(log);
+        n++;
+    }
+}
@@ -0,0 +1,1050 @@
+/**
+ * @file    recorder.c
+ * @author  Deadline039
+ * @brief   IMU数据记录
+ * @version 1.0
+ * @date    2026-10-17
+ * @note    掉电刷写: PVD中断优先级最高, 可以打断主循环中的Flash操作.
+ *          中断中暂停预擦除, 提交正在填充的块, 把暂存页写入Flash,
+ *          之后等待电压恢复或芯片复位. 写入的页数有上限, 超过后的记录丢弃;
+ *          触发缓冲区中还没写入的采样不再写入.
+ */
+
+#include "recorder.h"
+#include "ahrs.h"
+#include "decimate.h"
+#include "dod.h"
+#include "pack.h"
+#include "quat.h"
+#include "rtc.h"
+#include "trigger.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+_Static_assert(sizeof(record_meta_t) <= FLASH_LOG_META_SIZE,
+               "record_meta_t does not fit in the flash log page header");
+
+static w25qxx_t flash_dev[FLASH_LOG_CHIP_NUM] = {
+    {.bus = &spi5_bus,
+     .cs_port = W25QXX_CS_GPIO_PORT,
+     .cs_pin = W25QXX_CS_GPIO_PIN},
+#if (FLASH_LOG_CHIP_NUM == 2)
+    {.bus = &spi5_bus,
+     .cs_port = W25QXX_CS2_GPIO_PORT,
+     .cs_pin = W25QXX_CS2_GPIO_PIN},
+#endif /* FLASH_LOG_CHIP_NUM == 2 */
+};
+static flash_log_t log_handle;
+static uint8_t recorder_ready;
+
+#if (RECORDER_USE_PVD == 1)
+/* 进入掉电刷写时的页序号 */
+static uint32_t recorder_pvd_seq;
+#endif /* RECORDER_USE_PVD == 1 */
+
+/* 本次上电的RTC时间和对应的时间戳, 用来计算页摘要中的时间 */
+static uint32_t recorder_session_time = RECORD_TIME_UNKNOWN;
+static uint32_t recorder_session_tick;
+
+#if (RECORDER_IMU_COLUMNAR == 1)
+
+#if (RECORDER_IMU_PACK == 1)
+/* 每块的采样数. 压缩后超过一页时拆分, 只受内存限制 */
+#define RECORDER_IMU_BLOCK_NUM RECORDER_IMU_BLOCK
+#else  /* RECORDER_IMU_PACK == 1 */
+/* 不压缩时整块写成一条记录, 一页最多放下的采样数 */
+#define RECORDER_IMU_PAGE_NUM                                                  \
+    ((FLASH_LOG_DATA_SIZE - sizeof(record_hdr_t) -                             \
+      sizeof(record_imu_block_t)) /                                            \
+     (IMU_COLUMN_NUM * sizeof(int16_t)))
+/* 每块的采样数, 配置超过一页时减小 */
+#define RECORDER_IMU_BLOCK_NUM                                                 \
+    ((RECORDER_IMU_BLOCK < RECORDER_IMU_PAGE_NUM) ? RECORDER_IMU_BLOCK         \
+                                                  : RECORDER_IMU_PAGE_NUM)
+#endif /* RECORDER_IMU_PACK == 1 */
+
+/* 采样块的长度, 含记录头 */
+#define RECORDER_IMU_BLOCK_SIZE                                                \
+    (sizeof(record_hdr_t) + sizeof(record_imu_block_t) +                       \
+     IMU_COLUMN_NUM * sizeof(int16_t) * RECORDER_IMU_BLOCK_NUM)
+
+#if (RECORDER_IMU_PACK != 1)
+_Static_assert(RECORDER_IMU_BLOCK_SIZE <= FLASH_LOG_DATA_SIZE,
+               "IMU block does not fit in one flash log page");
+#endif /* RECORDER_IMU_PACK != 1 */
+
+/* 每个通道正在填充的采样块, 多个通道交替写入, 不能放在暂存页中 */
+static struct {
+    uint16_t column[IMU_COLUMN_NUM][RECORDER_IMU_BLOCK_NUM]; /*!< 各列数据 */
+    uint32_t tick; /*!< 第一个采样的时间戳(ms) */
+    uint32_t base; /*!< 第一个采样的时间(us) */
+    uint32_t step; /*!< 前两个采样的间隔(us) */
+    uint16_t num;  /*!< 已填充的采样数, 0表示没有正在填充的块 */
+    uint16_t sent; /*!< 拆分写入时已写入的采样数 */
+    uint8_t flags; /*!< 第一个采样的标志 */
+} imu_block[RECORDER_IMU_CHANNEL_NUM];
+
+#endif /* RECORDER_IMU_COLUMNAR == 1 */
+
+/* 正在填充的磁场块 */
+static struct {
+    int16_t mag[RECORDER_MAG_BLOCK][3]; /*!< 磁场 */
+    uint32_t time[RECORDER_MAG_BLOCK];  /*!< 对应采样的时间(us) */
+    uint16_t num;                       /*!< 块中的磁场数 */
+    uint16_t sent;                      /*!< 已写入的磁场数 */
+    uint8_t flags;                      /*!< 块内有丢失时为`MPU9250_FLAG_GAP` */
+} mag_block;
+
+static uint8_t recorder_mag_flush(void);
+
+/**
+ * @brief 三个分量的平方和
+ *
+ * @param x, y, z 分量(LSB)
+ * @return 平方和, 不会溢出
+ */
+static inline uint32_t recorder_sum2(int16_t x, int16_t y, int16_t z) {
+    return (uint32_t)(x * x) + (uint32_t)(y * y) + (uint32_t)(z * z);
+}
+
+/**
+ * @brief 由平方和求模, 向上取整
+ *
+ * @param sum 平方和
+ * @return 模(LSB), 不小于真实值
+ */
+static uint16_t recorder_root(uint32_t sum) {
+    uint32_t root = (uint32_t)sqrtf((float)sum);
+
+    /* 单精度开方可能小1 */
+    while (root * root < sum) {
+        root++;
+    }
+    return (uint16_t)root;
+}
+
+/**
+ * @brief 初始化Flash和日志, 写入上电记录
+ *
+ */
+void recorder_init(void) {
+    W25QXX_CS_GPIO_ENABLE();
+#if (FLASH_LOG_CHIP_NUM == 2)
+    W25QXX_CS2_GPIO_ENABLE();
+#endif /* FLASH_LOG_CHIP_NUM == 2 */
+
+    for (uint32_t i = 0; i < FLASH_LOG_CHIP_NUM; ++i) {
+        if (w25qxx_init(&flash_dev[i]) != 0) {
+            printf("W25Qxx %u not found. \r\n", (unsigned int)i);
+            return;
+        }
+    }
+
+    if (flash_log_init(&log_handle, flash_dev, RECORDER_LOG_BASE,
+                       flash_dev[0].capacity - RECORDER_LOG_BASE) != 0) {
+        printf("Flash log init failed. \r\n");
+        return;
+    }
+
+    printf("Flash log mounted, head: %u, tail: %u. \r\n",
+           (unsigned int)log_handle.head, (unsigned int)log_handle.tail);
+
+    recorder_ready = 1;
+
+    time_t now = mktime(rtc_get_time());
+    recorder_session_time = (uint32_t)now;
+    recorder_session_tick = HAL_GetTick();
+    recorder_write(RECORD_TYPE_SESSION, 0, &now, sizeof(now));
+
+#if (RECORDER_USE_PVD == 1)
+    pvd_init(RECORDER_PVD_LEVEL);
+#endif /* RECORDER_USE_PVD == 1 */
+}
+
+/**
+ * @brief 记录一个采样中的新磁场
+ *
+ * @param sample 原始采样
+ * @note 丢失的采样中可能有磁场, 也记为块内有丢失
+ */
+static void recorder_mag_input(const imu_sample_t *sample) {
+    if (sample->flags & (MPU9250_FLAG_GAP | MPU9250_FLAG_MAG_GAP)) {
+        mag_block.flags |= MPU9250_FLAG_GAP;
+    }
+    if (!(sample->flags & MPU9250_FLAG_MAG)) {
+        return;
+    }
+
+    memcpy(mag_block.mag[mag_block.num], sample->mag, sizeof(sample->mag));
+    mag_block.time[mag_block.num] = sample->time;
+    if (++mag_block.num == RECORDER_MAG_BLOCK) {
+        recorder_mag_flush();
+    }
+}
+
+/**
+ * @brief 取出IMU缓冲区中的采样写入日志
+ *
+ * @note 在主循环中调用, 原始采样用于姿态解算, 频谱分析和窗口统计,
+ *       抽取后按通道记录. 磁场只在有新数据时单独记录
+ */
+void recorder_poll(void) {
+    imu_sample_t sample;
+    imu_sample_t out[RECORDER_IMU_CHANNEL_NUM];
+    uint32_t mask;
+
+    while (mpu9250_read(&sample) == 0) {
+#if (CALIB_ENABLE == 1)
+        calib_input(&sample);
+#endif /* CALIB_ENABLE == 1 */
+        recorder_mag_input(&sample);
+        ahrs_update(&sample);
+#if (ATTITUDE_ENABLE == 1)
+        attitude_input(&sample);
+#endif /* ATTITUDE_ENABLE == 1 */
+#if (SPECTRUM_ENABLE == 1)
+        spectrum_input(&sample);
+#endif /* SPECTRUM_ENABLE == 1 */
+#if (SUMMARY_ENABLE == 1)
+        summary_input(&sample);
+#endif /* SUMMARY_ENABLE == 1 */
+        mask = decimate_input(&sample, out);
+        for (uint8_t ch = 0; ch < RECORDER_IMU_CHANNEL_NUM; ++ch) {
+            if (!(mask & (1U << ch))) {
+                continue;
+            }
+#if (TRIGGER_ENABLE == 1)
+            /* 触发通道的采样由触发决定是否写入 */
+            if (ch == TRIGGER_CHANNEL) {
+                trigger_input(&out[ch]);
+                continue;
+            }
+#endif /* TRIGGER_ENABLE == 1 */
+            recorder_write_imu(ch, &out[ch]);
+        }
+    }
+}
+
+/**
+ * @brief 在暂存页中预留一条记录
+ *
+ * @param len 记录长度, 含记录头
+ * @return 可写入的地址, NULL表示超过一页或掉电刷写的页数已用完
+ * @note 掉电刷写中写满`RECORDER_PVD_FLUSH_PAGES - 1`页后只接受当前页
+ *       放得下的记录, 加上最后写入的暂存页共`RECORDER_PVD_FLUSH_PAGES`页
+ */
+static uint8_t *recorder_reserve(uint32_t len) {
+#if (RECORDER_USE_PVD == 1)
+    uint32_t pages = log_handle.seq - recorder_pvd_seq;
+
+    if (log_handle.emergency && (pages + 1 >= RECORDER_PVD_FLUSH_PAGES) &&
+        (len > flash_log_space(&log_handle))) {
+        return NULL;
+    }
+#endif /* RECORDER_USE_PVD == 1 */
+
+    return flash_log_reserve(&log_handle, len);
+}
+
+/**
+ * @brief 写入一条记录
+ *
+ * @param type 记录类型
+ * @param channel 通道
+ * @param data 数据
+ * @param len 数据长度
+ * @return 写入结果
+ *  @retval 0 成功
+ *  @retval 1 未初始化或记录超过一页
+ */
+uint8_t recorder_write(uint8_t type, uint8_t channel, const void *data,
+                       uint32_t len) {
+    return recorder_write_part(type, channel, data, len, NULL, 0);
+}
+
+/**
+ * @brief 写入一块数据中的一段, 提交时同时记下写入进度
+ *
+ * @param type 记录类型
+ * @param channel 通道
+ * @param data 数据
+ * @param len 数据长度
+ * @param[out] sent 块的写入进度, NULL表示不记录
+ * @param value 写入后的进度
+ * @return 写入结果
+ *  @retval 0 成功
+ *  @retval 1 未初始化或记录超过一页
+ * @note 提交和更新进度之间关中断. 一块分成多条记录写入时掉电中断从
+ *       进度处继续, 不会重复写入主循环中已提交的部分
+ */
+uint8_t recorder_write_part(uint8_t type, uint8_t channel, const void *data,
+                            uint32_t len, uint16_t *sent, uint16_t value) {
+    record_hdr_t hdr = {.type = type,
+                        .channel = channel,
+                        .len = (uint16_t)len,
+                        .time = HAL_GetTick()};
+    uint32_t primask;
+    uint8_t *ptr;
+
+    if (!recorder_ready) {
+        return 1;
+    }
+
+    ptr = recorder_reserve(sizeof(hdr) + len);
+    if (ptr == NULL) {
+        return 1;
+    }
+
+    /* 暂存页中的记录不一定对齐 */
+    memcpy(ptr, &hdr, sizeof(hdr));
+    memcpy(ptr + sizeof(hdr), data, len);
+
+    primask = __get_PRIMASK();
+    __disable_irq();
+    flash_log_commit(&log_handle, sizeof(hdr) + len);
+    if (sent != NULL) {
+        *sent = value;
+    }
+    __set_PRIMASK(primask);
+
+    return 0;
+}
+
+#if (RECORDER_IMU_COLUMNAR == 1)
+
+/**
+ * @brief 计算通道块中一段采样的加速度和角速度模的最大值, 填入块头
+ *
+ * @param channel 通道
+ * @param start 第一个采样的序号
+ * @param num 采样数
+ * @param[out] block 块头
+ */
+static void recorder_imu_peak(uint8_t channel, uint32_t start, uint32_t num,
+                              record_imu_block_t *block) {
+    uint16_t(*column)[RECORDER_IMU_BLOCK_NUM] = imu_block[channel].column;
+    uint32_t accel = 0, gyro = 0, sum;
+
+    for (uint32_t i = start; i < start + num; ++i) {
+        sum = recorder_sum2((int16_t)column[IMU_COLUMN_AX][i],
+                            (int16_t)column[IMU_COLUMN_AY][i],
+                            (int16_t)column[IMU_COLUMN_AZ][i]);
+        accel = (sum > accel) ? sum : accel;
+        sum = recorder_sum2((int16_t)column[IMU_COLUMN_GX][i],
+                            (int16_t)column[IMU_COLUMN_GY][i],
+                            (int16_t)column[IMU_COLUMN_GZ][i]);
+        gyro = (sum > gyro) ? sum : gyro;
+    }
+
+    block->accel_peak = recorder_root(accel);
+    block->gyro_peak = recorder_root(gyro);
+}
+
+#if (RECORDER_IMU_PACK == 1)
+
+/**
+ * @brief 压缩并写入通道块中的一段采样
+ *
+ * @param channel 通道
+ * @param start 第一个采样的序号
+ * @param num 采样数
+ * @return 写入结果
+ *  @retval 0 成功
+ *  @retval 1 写入失败
+ * @note 压缩后超过一页时分成两半分别写入. 丢失标志只记在第一段,
+ *       后面各段的块头时间按间隔推算, 时间列不变
+ *       每段提交时记下已写入的采样数, 见`recorder_write_part`
+ */
+static uint8_t recorder_imu_pack(uint8_t channel, uint32_t start,
+                                 uint32_t num) {
+    static uint8_t buf[FLASH_LOG_DATA_SIZE];
+    record_hdr_t hdr = {.type = RECORD_TYPE_IMU_PACKED,
+                        .channel = channel,
+                        .time = imu_block[channel].tick};
+    record_imu_block_t block = {
+        .base = imu_block[channel].base + start * imu_block[channel].step,
+        .step = imu_block[channel].step,
+        .num = (uint16_t)num,
+        .stride = (uint8_t)num,
+        .flags = (start == 0) ? imu_block[channel].flags : 0};
+    uint32_t len;
+    uint32_t primask;
+    uint8_t *ptr;
+
+    len = pack_encode((const int16_t *)&imu_block[channel].column[0][start],
+                      RECORDER_IMU_BLOCK_NUM, IMU_COLUMN_NUM, num, buf,
+                      sizeof(buf) - sizeof(hdr) - sizeof(block));
+    if (len == 0) {
+        /* 一个采样一定放得下 */
+        if (recorder_imu_pack(channel, start, num / 2) != 0) {
+            return 1;
+        }
+        return recorder_imu_pack(channel, start + num / 2, num - num / 2);
+    }
+
+    recorder_imu_peak(channel, start, num, &block);
+    hdr.len = (uint16_t)(sizeof(block) + len);
+    ptr = recorder_reserve(sizeof(hdr) + hdr.len);
+    if (ptr == NULL) {
+        return 1;
+    }
+
+    memcpy(ptr, &hdr, sizeof(hdr));
+    memcpy(ptr + sizeof(hdr), &block, sizeof(block));
+    memcpy(ptr + sizeof(hdr) + sizeof(block), buf, len);
+
+    primask = __get_PRIMASK();
+    __disable_irq();
+    flash_log_commit(&log_handle, sizeof(hdr) + hdr.len);
+    imu_block[channel].sent = (uint16_t)(start + num);
+    __set_PRIMASK(primask);
+
+    return 0;
+}
+
+/**
+ * @brief 压缩并提交通道正在填充的采样块
+ *
+ * @param channel 通道
+ * @return 提交结果
+ *  @retval 0 成功或没有正在填充的块
+ *  @retval 1 写入失败
+ */
+static uint8_t recorder_imu_close(uint8_t channel) {
+    uint8_t res = 0;
+
+    if (imu_block[channel].num == 0) {
+        return 0;
+    }
+
+    /* 从上次拆分写入的进度继续 */
+    if (imu_block[channel].sent < imu_block[channel].num) {
+        res = recorder_imu_pack(channel, imu_block[channel].sent,
+                                imu_block[channel].num -
+                                    imu_block[channel].sent);
+    }
+    imu_block[channel].num = 0;
+    imu_block[channel].sent = 0;
+
+    return res;
+}
+
+#else  /* RECORDER_IMU_PACK == 1 */
+
+/**
+ * @brief 提交通道正在填充的采样块
+ *
+ * @param channel 通道
+ * @return 提交结果
+ *  @retval 0 成功或没有正在填充的块
+ *  @retval 1 写入失败
+ * @note 块没有填满时也按完整长度提交, 块头中记录有效的采样数
+ */
+static uint8_t recorder_imu_close(uint8_t channel) {
+    record_hdr_t hdr = {.type = RECORD_TYPE_IMU_BLOCK,
+                        .channel = channel,
+                        .len = RECORDER_IMU_BLOCK_SIZE - sizeof(record_hdr_t),
+                        .time = imu_block[channel].tick};
+    record_imu_block_t block = {.base = imu_block[channel].base,
+                                .step = imu_block[channel].step,
+                                .num = imu_block[channel].num,
+                                .stride = RECORDER_IMU_BLOCK_NUM,
+                                .flags = imu_block[channel].flags};
+    uint8_t *ptr;
+
+    if (block.num == 0) {
+        return 0;
+    }
+    recorder_imu_peak(channel, 0, block.num, &block);
+
+    ptr = recorder_reserve(RECORDER_IMU_BLOCK_SIZE);
+    if (ptr == NULL) {
+        return 1;
+    }
+
+    memcpy(ptr, &hdr, sizeof(hdr));
+    memcpy(ptr + sizeof(hdr), &block, sizeof(block));
+    memcpy(ptr + sizeof(hdr) + sizeof(block), imu_block[channel].column,
+           sizeof(imu_block[channel].column));
+    imu_block[channel].num = 0;
+    flash_log_commit(&log_handle, RECORDER_IMU_BLOCK_SIZE);
+
+    return 0;
+}
+
+#endif /* RECORDER_IMU_PACK == 1 */
+
+/**
+ * @brief 写入一个IMU采样
+ *
+ * @param channel 通道, 小于`RECORDER_IMU_CHANNEL_NUM`
+ * @param sample 采样
+ * @return 写入结果
+ *  @retval 0 成功
+ *  @retval 1 日志未挂载, 通道错误或写入失败
+ * @note 采样先按列填入通道的块, 块满, 时间与按前两个采样的间隔推算的
+ *       相差超过16位或者采样有丢失时提交. 刷写时也会提前提交
+ */
+uint8_t recorder_write_imu(uint8_t channel, const imu_sample_t *sample) {
+    uint32_t num;
+    int32_t offset = 0;
+
+    if ((!recorder_ready) || (channel >= RECORDER_IMU_CHANNEL_NUM)) {
+        return 1;
+    }
+
+    num = imu_block[channel].num;
+    if (num > 1) {
+        offset = (int32_t)(sample->time - imu_block[channel].base -
+                           num * imu_block[channel].step);
+    }
+    if ((num != 0) && ((num == RECORDER_IMU_BLOCK_NUM) ||
+                       (offset > INT16_MAX) || (offset < INT16_MIN) ||
+                       (sample->flags & MPU9250_FLAG_GAP))) {
+        if (recorder_imu_close(channel) != 0) {
+            return 1;
+        }
+        num = 0;
+    }
+
+    if (num == 0) {
+        imu_block[channel].tick = HAL_GetTick();
+        imu_block[channel].base = sample->time;
+        imu_block[channel].step = 0;
+        offset = 0;
+        imu_block[channel].flags =
+            (uint8_t)(sample->flags & MPU9250_FLAG_GAP);
+    } else if (num == 1) {
+        imu_block[channel].step = sample->time - imu_block[channel].base;
+    }
+
+    imu_block[channel].column[IMU_COLUMN_TIME][num] = (uint16_t)offset;
+    for (uint32_t i = 0; i < 3; ++i) {
+        imu_block[channel].column[IMU_COLUMN_AX + i][num] =
+            (uint16_t)sample->accel[i];
+        imu_block[channel].column[IMU_COLUMN_GX + i][num] =
+            (uint16_t)sample->gyro[i];
+    }
+    imu_block[channel].column[IMU_COLUMN_TEMP][num] = (uint16_t)sample->temp;
+
+    /* 写完再计数, 掉电刷写时不会提交半个采样 */
+    imu_block[channel].num = (uint16_t)(num + 1);
+
+    return 0;
+}
+
+#else /* RECORDER_IMU_COLUMNAR == 1 */
+
+/**
+ * @brief 写入一个IMU采样
+ *
+ * @param channel 通道
+ * @param sample 采样
+ * @return 写入结果
+ *  @retval 0 成功
+ *  @retval 1 日志未挂载或写入失败
+ */
+uint8_t recorder_write_imu(uint8_t channel, const imu_sample_t *sample) {
+    return recorder_write(RECORD_TYPE_IMU, channel, sample, sizeof(*sample));
+}
+
+#endif /* RECORDER_IMU_COLUMNAR == 1 */
+
+/**
+ * @brief 写入磁场块
+ *
+ * @return 写入结果
+ *  @retval 0 成功或块为空
+ *  @retval 1 写入失败
+ * @note 块中的磁场和时间一页放不下时按顺序分成多条记录
+ */
+static uint8_t recorder_mag_flush(void) {
+    static uint8_t buf[FLASH_LOG_DATA_SIZE - sizeof(record_hdr_t)];
+    static uint8_t times[(RECORDER_MAG_BLOCK * DOD_MAX_BITS + 7) / 8];
+    record_mag_t block = {.reserved = 0};
+    uint32_t start, num, len;
+    uint8_t res = 0;
+    dod_t dod, last;
+
+    /* 从进度处继续, 掉电中断可能打断了主循环中的写入 */
+    while (mag_block.sent < mag_block.num) {
+        start = mag_block.sent;
+        block.flags = (start == 0) ? mag_block.flags : 0;
+        /* 逐个编码时间, 加上磁场一页放不下时退回上一个 */
+        dod_init(&dod, mag_block.time[start]);
+        dod_set_buffer(&dod, times, sizeof(times));
+        for (num = 0; start + num < mag_block.num; ++num) {
+            last = dod;
+            dod_put(&dod, mag_block.time[start + num]);
+            if (sizeof(block) + (num + 1) * sizeof(mag_block.mag[0]) +
+                    dod_size(&dod) >
+                sizeof(buf)) {
+                dod = last;
+                break;
+            }
+        }
+
+        block.base = mag_block.time[start];
+        block.num = (uint16_t)num;
+        len = num * sizeof(mag_block.mag[0]);
+        memcpy(buf, &block, sizeof(block));
+        memcpy(buf + sizeof(block), mag_block.mag[start], len);
+        memcpy(buf + sizeof(block) + len, times, dod_size(&dod));
+        len += sizeof(block) + dod_size(&dod);
+
+        if (recorder_write_part(RECORD_TYPE_MAG, 0, buf, len, &mag_block.sent,
+                                (uint16_t)(start + num)) != 0) {
+            mag_block.sent = (uint16_t)(start + num);
+            res = 1;
+        }
+    }
+
+    mag_block.num = 0;
+    mag_block.sent = 0;
+    mag_block.flags = 0;
+
+    return res;
+}
+
+/**
+ * @brief 提交各通道正在填充的采样块, 磁场块和姿态块
+ *
+ */
+static void recorder_close_blocks(void) {
+#if (RECORDER_IMU_COLUMNAR == 1)
+    for (uint8_t ch = 0; ch < RECORDER_IMU_CHANNEL_NUM; ++ch) {
+        recorder_imu_close(ch);
+    }
+#endif /* RECORDER_IMU_COLUMNAR == 1 */
+    recorder_mag_flush();
+#if (ATTITUDE_ENABLE == 1)
+    attitude_flush();
+#endif /* ATTITUDE_ENABLE == 1 */
+}
+
+/**
+ * @brief 把暂存页写入Flash
+ *
+ * @return 写入结果
+ *  @retval 0 成功
+ *  @retval 1 日志未挂载或写入失败
+ * @note 先写入触发缓冲区中还没写入的采样, 再提交各通道正在填充的采样块,
+ *       磁场块和姿态块
+ */
+uint8_t recorder_flush(void) {
+    if (!recorder_ready) {
+        return 1;
+    }
+
+#if (TRIGGER_ENABLE == 1)
+    trigger_flush();
+#endif /* TRIGGER_ENABLE == 1 */
+    recorder_close_blocks();
+
+    return flash_log_flush(&log_handle);
+}
+
+/**
+ * @brief 页摘要中加入一条IMU采样记录的模的最大值
+ *
+ * @param meta 页摘要
+ * @param hdr 记录头
+ * @param data 记录数据
+ * @note 采样块用块头中的值, 不需要解码
+ */
+static void recorder_meta_peak(record_meta_t *meta, const record_hdr_t *hdr,
+                               const uint8_t *data) {
+    record_imu_block_t block;
+    imu_sample_t sample;
+
+    if (((hdr->type == RECORD_TYPE_IMU_BLOCK) ||
+         (hdr->type == RECORD_TYPE_IMU_PACKED)) &&
+        (hdr->len >= sizeof(block))) {
+        memcpy(&block, data, sizeof(block));
+    } else if ((hdr->type == RECORD_TYPE_IMU) &&
+               (hdr->len >= sizeof(sample))) {
+        memcpy(&sample, data, sizeof(sample));
+        block.accel_peak = recorder_root(recorder_sum2(
+            sample.accel[0], sample.accel[1], sample.accel[2]));
+        block.gyro_peak = recorder_root(
+            recorder_sum2(sample.gyro[0], sample.gyro[1], sample.gyro[2]));
+    } else {
+        return;
+    }
+
+    if (block.accel_peak > meta->accel_peak) {
+        meta->accel_peak = block.accel_peak;
+    }
+    if (block.gyro_peak > meta->gyro_peak) {
+        meta->gyro_peak = block.gyro_peak;
+    }
+}
+
+/**
+ * @brief 根据页内的记录填写页摘要
+ *
+ * @param log 日志句柄
+ * @param page 要写入的页
+ * @note 复位后写回的暂存页在写入上电记录之前写入, 时间记为未知
+ */
+void flash_log_meta_callback(flash_log_t *log, flash_log_page_t *page) {
+    record_meta_t meta = {.time = RECORD_TIME_UNKNOWN};
+    record_hdr_t hdr;
+    uint32_t last = 0;
+
+    UNUSED(log);
+
+    for (uint32_t offset = 0; offset + sizeof(hdr) <= page->hdr.len;
+         offset += sizeof(hdr) + hdr.len) {
+        memcpy(&hdr, page->data + offset, sizeof(hdr));
+        if (offset == 0) {
+            meta.tick = hdr.time;
+        }
+        last = hdr.time;
+        meta.types |= (uint8_t)(1U << (hdr.type < 7 ? hdr.type : 7));
+        meta.channels |= (uint8_t)(1U << (hdr.channel < 7 ? hdr.channel : 7));
+        if (offset + sizeof(hdr) + hdr.len <= page->hdr.len) {
+            recorder_meta_peak(&meta, &hdr, page->data + offset + sizeof(hdr));
+        }
+    }
+
+    last = (last - meta.tick + 999) / 1000;
+    meta.span = (last > 0xFFFF) ? 0xFFFF : (uint16_t)last;
+
+    if (recorder_session_time != RECORD_TIME_UNKNOWN) {
+        meta.time = recorder_session_time +
+                    (meta.tick - recorder_session_tick) / 1000;
+    }
+
+    memcpy(page->hdr.meta, &meta, sizeof(meta));
+}
+
+/* 检查时能解码的最大压缩块, 同配置的上限 */
+#define RECORDER_IMU_BLOCK_MAX 64
+
+/**
+ * @brief 解码一条压缩的IMU采样块
+ *
+ * @param data 记录数据, 不含记录头
+ * @param len 数据长度
+ * @param[out] raw 不压缩时的数据长度
+ * @return 解码结果
+ *  @retval 0 成功
+ *  @retval 1 数据损坏或块太长
+ */
+static uint8_t recorder_check_packed(const uint8_t *data, uint32_t len,
+                                     uint32_t *raw) {
+    static int16_t column[IMU_COLUMN_NUM * RECORDER_IMU_BLOCK_MAX];
+    record_imu_block_t block;
+
+    if (len < sizeof(block)) {
+        return 1;
+    }
+    memcpy(&block, data, sizeof(block));
+    if ((block.num == 0) || (block.num > RECORDER_IMU_BLOCK_MAX)) {
+        return 1;
+    }
+
+    *raw = sizeof(block) + IMU_COLUMN_NUM * sizeof(int16_t) * block.num;
+    return pack_decode(data + sizeof(block), len - sizeof(block), column,
+                       block.num, IMU_COLUMN_NUM, block.num);
+}
+
+/**
+ * @brief 解码一条姿态块
+ *
+ * @param data 记录数据, 不含记录头
+ * @param len 数据长度
+ * @param[out] num 四元数数
+ * @return 解码结果
+ *  @retval 0 成功
+ *  @retval 1 数据损坏
+ */
+static uint8_t recorder_check_attitude(const uint8_t *data, uint32_t len,
+                                       uint32_t *num) {
+    record_attitude_t block;
+    uint32_t size, time;
+    float q[4];
+    dod_t dod;
+
+    if (len < sizeof(block)) {
+        return 1;
+    }
+    memcpy(&block, data, sizeof(block));
+    if ((block.bits < QUAT_BITS_MIN) || (block.bits > QUAT_BITS_MAX)) {
+        return 1;
+    }
+    size = sizeof(block) + block.num * QUAT_SIZE(block.bits);
+    if ((block.num == 0) || (size > len)) {
+        return 1;
+    }
+
+    for (uint32_t i = 0; i < block.num; ++i) {
+        if (quat_decode(data + sizeof(block) + i * QUAT_SIZE(block.bits),
+                        block.bits, q) != 0) {
+            return 1;
+        }
+    }
+
+    dod_init(&dod, block.base);
+    dod_set_buffer(&dod, (void *)(data + size), len - size);
+    for (uint32_t i = 0; i < block.num; ++i) {
+        if (dod_get(&dod, &time) != 0) {
+            return 1;
+        }
+    }
+
+    *num = block.num;
+    return 0;
+}
+
+/**
+ * @brief 解码一条磁场块
+ *
+ * @param data 记录数据, 不含记录头
+ * @param len 数据长度
+ * @param[out] num 磁场数
+ * @return 解码结果
+ *  @retval 0 成功
+ *  @retval 1 数据损坏
+ */
+static uint8_t recorder_check_mag(const uint8_t *data, uint32_t len,
+                                  uint32_t *num) {
+    record_mag_t block;
+    uint32_t size, time;
+    dod_t dod;
+
+    if (len < sizeof(block)) {
+        return 1;
+    }
+    memcpy(&block, data, sizeof(block));
+    size = sizeof(block) + block.num * 3 * sizeof(int16_t);
+    if ((block.num == 0) || (size > len)) {
+        return 1;
+    }
+
+    dod_init(&dod, block.base);
+    dod_set_buffer(&dod, (void *)(data + size), len - size);
+    for (uint32_t i = 0; i < block.num; ++i) {
+        if (dod_get(&dod, &time) != 0) {
+            return 1;
+        }
+    }
+
+    *num = block.num;
+    return 0;
+}
+
+/**
+ * @brief 检查日志一致性, 打印结果
+ *
+ * @note 先把暂存页写入Flash, 然后从最旧页读到最新页, 检查页校验,
+ *       页序号是否连续, 页内记录是否完整. 断电测试后用来确认已写入的数据
+ *       没有损坏. 压缩的IMU采样块和姿态块逐条解码, 统计压缩比.
+ *       读取整个日志区需要几秒, 期间不记录数据.
+ *       最后打印读取速度, 用来确认预读是否让SPI时钟保持连续
+ */
+void recorder_check(void) {
+    static flash_log_page_t page;
+    uint32_t pages = 0, torn = 0, power_loss = 0, seq_error = 0;
+    uint32_t records = 0, bad_records = 0;
+    uint32_t packed = 0, packed_raw = 0, packed_len = 0, bad_packed = 0;
+    uint32_t quats = 0, quat_len = 0, bad_quat = 0;
+    uint32_t mags = 0, mag_len = 0, bad_mag = 0;
+    uint32_t last_seq = 0, raw;
+    uint32_t offset;
+    uint32_t bytes, clock;
+    spi_bus_stats_t stats;
+    mpu9250_stats_t imu_stats;
+    ahrs_stats_t ahrs_stats;
+#if (SPECTRUM_ENABLE == 1)
+    spectrum_stats_t spectrum_stats;
+#endif /* SPECTRUM_ENABLE == 1 */
+#if (TRIGGER_ENABLE == 1)
+    trigger_stats_t trigger_stats;
+#endif /* TRIGGER_ENABLE == 1 */
+    float euler[3];
+    record_hdr_t hdr;
+
+    if (!recorder_ready) {
+        return;
+    }
+
+    recorder_flush();
+    flash_log_sync(&log_handle);
+    /* 开始新的总线统计周期 */
+    spi_bus_get_stats(log_handle.dev[0]->bus, &stats);
+
+    for (uint32_t p = log_handle.tail; p != log_handle.head;
+         p = (p + 1) % log_handle.page_num) {
+        if (flash_log_read_page(&log_handle, p, &page) != 0) {
+            torn++;
+            continue;
+        }
+
+        pages++;
+        if (page.hdr.flags & FLASH_LOG_FLAG_POWER_LOSS) {
+            power_loss++;
+        }
+        /* 编程被打断的页不占用序号, 有效页的序号总是连续的 */
+        if ((last_seq != 0) && (page.hdr.seq != last_seq + 1)) {
+            seq_error++;
+        }
+        last_seq = page.hdr.seq;
+
+        for (offset = 0; offset < page.hdr.len;
+             offset += sizeof(hdr) + hdr.len) {
+            if (page.hdr.len - offset < sizeof(hdr)) {
+                bad_records++;
+                break;
+            }
+            memcpy(&hdr, page.data + offset, sizeof(hdr));
+            if ((hdr.type >= RECORD_TYPE_NUM) ||
+                (offset + sizeof(hdr) + hdr.len > page.hdr.len)) {
+                bad_records++;
+                break;
+            }
+            records++;
+
+            if (hdr.type == RECORD_TYPE_IMU_PACKED) {
+                if (recorder_check_packed(page.data + offset + sizeof(hdr),
+                                          hdr.len, &raw) != 0) {
+                    bad_packed++;
+                    continue;
+                }
+                packed++;
+                packed_raw += raw;
+                packed_len += hdr.len;
+            } else if (hdr.type == RECORD_TYPE_ATTITUDE) {
+                if (recorder_check_attitude(page.data + offset + sizeof(hdr),
+                                            hdr.len, &raw) != 0) {
+                    bad_quat++;
+                    continue;
+                }
+                quats += raw;
+                quat_len += sizeof(hdr) + hdr.len;
+            } else if (hdr.type == RECORD_TYPE_MAG) {
+                if (recorder_check_mag(page.data + offset + sizeof(hdr),
+                                       hdr.len, &raw) != 0) {
+                    bad_mag++;
+                    continue;
+                }
+                mags += raw;
+                mag_len += sizeof(hdr) + hdr.len;
+            }
+        }
+    }
+
+    printf("Log check: %u pages, %u torn, %u power loss, %u seq errors, "
+           "%u records, %u bad records. \r\n",
+           (unsigned int)pages, (unsigned int)torn, (unsigned int)power_loss,
+           (unsigned int)seq_error, (unsigned int)records,
+           (unsigned int)bad_records);
+
+    /* 压缩比为不压缩时的长度 / 压缩后的长度 */
+    if (packed_len != 0) {
+        printf("Packed IMU: %u blocks, %u errors, ratio %u.%02u. \r\n",
+               (unsigned int)packed, (unsigned int)bad_packed,
+               (unsigned int)(packed_raw / packed_len),
+               (unsigned int)(packed_raw % packed_len * 100 / packed_len));
+    }
+
+    /* 每个四元数平均占用的字节数, 含记录头, 块头和时间 */
+    if (quats != 0) {
+        printf("Attitude: %u quaternions, %u errors, %u.%02u bytes each. \r\n",
+               (unsigned int)quats, (unsigned int)bad_quat,
+               (unsigned int)(quat_len / quats),
+               (unsigned int)(quat_len % quats * 100 / quats));
+    }
+    if (mags != 0) {
+        printf("Mag: %u samples, %u errors, %u.%02u bytes each. \r\n",
+               (unsigned int)mags, (unsigned int)bad_mag,
+               (unsigned int)(mag_len / mags),
+               (unsigned int)(mag_len % mags * 100 / mags));
+    }
+
+    /* 读取速度和SPI时钟, 总线占用率 */
+    spi_bus_get_stats(log_handle.dev[0]->bus, &stats);
+    bytes = (pages + torn) * W25QXX_PAGE_SIZE;
+    clock = spi_get_clock(log_handle.dev[0]->bus->hspi);
+    if (stats.period != 0) {
+        printf("Read %u KB/s, SPI clock %u KHz, bus usage %u.%u%%, "
+               "%u transactions. \r\n",
+               (unsigned int)(bytes / stats.period * 1000 / 1024),
+               (unsigned int)(clock / 1000), (unsigned int)(stats.usage / 10),
+               (unsigned int)(stats.usage % 10), (unsigned int)stats.trans);
+    }
+
+    mpu9250_get_stats(&imu_stats);
+    printf("IMU: %u samples, %u reads, %u dropped, %u overrun, "
+           "%u overflow, %u errors, %u mag, %u mag lost. \r\n",
+           (unsigned int)imu_stats.samples, (unsigned int)imu_stats.reads,
+           (unsigned int)imu_stats.dropped, (unsigned int)imu_stats.overrun,
+           (unsigned int)imu_stats.overflow, (unsigned int)imu_stats.errors,
+           (unsigned int)imu_stats.mag, (unsigned int)imu_stats.mag_lost);
+    printf("Timestamp clock: %u Hz, nominal %u Hz. \r\n",
+           (unsigned int)timer_ts_get_freq(), (unsigned int)TIMER_TS_FREQ);
+
+    ahrs_get_stats(&ahrs_stats);
+    ahrs_get_euler(euler);
+    printf("AHRS: %u updates, %u cycles avg, %u max, "
+           "roll %d, pitch %d, yaw %d (0.1 deg). \r\n",
+           (unsigned int)ahrs_stats.updates,
+           (unsigned int)ahrs_stats.cycles_avg,
+           (unsigned int)ahrs_stats.cycles_max, (int)(euler[0] * 10.0f),
+           (int)(euler[1] * 10.0f), (int)(euler[2] * 10.0f));
+
+#if (SPECTRUM_ENABLE == 1)
+    spectrum_get_stats(&spectrum_stats);
+    printf("Spectrum: %u blocks, %u discarded, %u cycles max. \r\n",
+           (unsigned int)spectrum_stats.blocks,
+           (unsigned int)spectrum_stats.discarded,
+           (unsigned int)spectrum_stats.cycles_max);
+#endif /* SPECTRUM_ENABLE == 1 */
+
+#if (TRIGGER_ENABLE == 1)
+    trigger_get_stats(&trigger_stats);
+    printf("Trigger: %u events, %u samples written, %u forced. \r\n",
+           (unsigned int)trigger_stats.events,
+           (unsigned int)trigger_stats.written,
+           (unsigned int)trigger_stats.forced);
+#endif /* TRIGGER_ENABLE == 1 */
+}
+
+/**
+ * @brief 获取日志句柄, 用于读取
+ *
+ * @return 日志句柄
+ */
+flash_log_t *recorder_get_log(void) {
+    return &log_handle;
+}
+
+#if (RECORDER_USE_PVD == 1)
+
+/**
+ * @brief 掉电回调, 把缓冲区中的数据写入Flash
+ *
+ */
+void HAL_PWR_PVDCallback(void) {
+    if (!recorder_ready) {
+        return;
+    }
+
+    flash_log_emergency_begin(&log_handle);
+    recorder_pvd_seq = log_handle.seq;
+
+    /* 触发缓冲区中的采样数没有上限, 不再写入 */
+    recorder_close_blocks();
+    flash_log_flush(&log_handle);
+    flash_log_sync(&log_handle);
+
+    /* 电压恢复时复位重新挂载, 否则等待掉电 */
+    while (pvd_is_low())
+        ;
+    NVIC_SystemReset();
+}
+
+#endif /* RECORDER_USE_PVD == 1 */
@@ -0,0 +1,301 @@
+/**
+ * @file    spectrum.c
+ * @author  Deadline039
+ * @brief   振动频谱分析
+ * @version 1.0
+ * @date    2026-10-17
+ * @note    三个轴的原始加速度攒满N点后各做一次FFT: 减去块均值, 乘Hann窗,
+ *          实数FFT, 功率按窗的能量归一化后累加. 块之间不重叠.
+ *          一个记录周期的块平均后, 每个轴写一条摘要记录, 可选写入完整功率谱.
+ *          采样有丢失时丢弃正在填充的块, 从丢失后的采样重新开始.
+ *          在主循环中计算, N = 512时每块三个轴约20万周期
+ */
+
+#include "spectrum.h"
+#include "fft.h"
+#include "recorder.h"
+
+#include <math.h>
+#include <string.h>
+
+#if (SPECTRUM_ENABLE == 1)
+
+/* 采样率(Hz), 与MPU9250配置相同 */
+#define SPECTRUM_RATE     (1000 / (1 + MPU9250_SMPLRT_DIV))
+
+/* 单边功率谱的频点数 */
+#define SPECTRUM_BIN_NUM  (SPECTRUM_FFT_SIZE / 2 + 1)
+
+/* 每个记录周期的块数 */
+#define SPECTRUM_BLOCKS                                                        \
+    ((SPECTRUM_PERIOD * SPECTRUM_RATE < SPECTRUM_FFT_SIZE)                     \
+         ? 1                                                                   \
+         : (SPECTRUM_PERIOD * SPECTRUM_RATE / SPECTRUM_FFT_SIZE))
+
+#define SPECTRUM_PI       3.14159265f
+
+static fft_real_t spectrum_fft;
+static float spectrum_twiddle[3 * SPECTRUM_FFT_SIZE / 4];
+static float spectrum_window[SPECTRUM_FFT_SIZE];
+static float spectrum_buf[SPECTRUM_FFT_SIZE];
+static int16_t spectrum_input_buf[3][SPECTRUM_FFT_SIZE];
+static float spectrum_power[3][SPECTRUM_BIN_NUM];
+
+static struct {
+    float scale;     /*!< 功率归一化系数, 1 / (N * sum(w^2)) */
+    uint32_t base;   /*!< 本周期第一个采样的时间(us) */
+    uint16_t fill;   /*!< 正在填充的块中的采样数 */
+    uint16_t blocks; /*!< 本周期已累加的块数 */
+    uint8_t flags;   /*!< 本周期丢弃过块 */
+    uint8_t ready;   /*!< 已初始化 */
+
+    spectrum_stats_t stats; /*!< 统计 */
+} spectrum;
+
+/**
+ * @brief 初始化FFT和窗函数
+ *
+ */
+void spectrum_init(void) {
+    float sum = 0.0f;
+
+    if (fft_real_init(&spectrum_fft, spectrum_twiddle, SPECTRUM_FFT_SIZE) !=
+        0) {
+        return;
+    }
+
+    for (uint32_t i = 0; i < SPECTRUM_FFT_SIZE; ++i) {
+        spectrum_window[i] =
+            0.5f - 0.5f * cosf(2.0f * SPECTRUM_PI * (float)i /
+                               (float)SPECTRUM_FFT_SIZE);
+        sum += spectrum_window[i] * spectrum_window[i];
+    }
+    spectrum.scale = 1.0f / ((float)SPECTRUM_FFT_SIZE * sum);
+
+    memset(spectrum_power, 0, sizeof(spectrum_power));
+    memset(&spectrum.stats, 0, sizeof(spectrum.stats));
+    spectrum.fill = 0;
+    spectrum.blocks = 0;
+    spectrum.flags = 0;
+    spectrum.ready = 1;
+
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+/**
+ * @brief 计算一个轴的功率谱, 累加到周期的功率谱中
+ *
+ * @param axis 轴
+ */
+static void spectrum_block(uint32_t axis) {
+    const int16_t *x = spectrum_input_buf[axis];
+    float *power = spectrum_power[axis];
+    float *buf = spectrum_buf;
+    float mean = 0.0f;
+    float scale = spectrum.scale;
+
+    for (uint32_t i = 0; i < SPECTRUM_FFT_SIZE; ++i) {
+        mean += (float)x[i];
+    }
+    mean /= (float)SPECTRUM_FFT_SIZE;
+
+    for (uint32_t i = 0; i < SPECTRUM_FFT_SIZE; ++i) {
+        buf[i] = ((float)x[i] - mean) * spectrum_window[i];
+    }
+
+    fft_real(&spectrum_fft, buf);
+
+    /* 单边谱, 除直流和N / 2外都要加上负频率的功率 */
+    power[0] += buf[0] * buf[0] * scale;
+    power[SPECTRUM_BIN_NUM - 1] += buf[1] * buf[1] * scale;
+    for (uint32_t k = 1; k < SPECTRUM_BIN_NUM - 1; ++k) {
+        float re = buf[2 * k], im = buf[2 * k + 1];
+
+        power[k] += (re * re + im * im) * 2.0f * scale;
+    }
+}
+
+/**
+ * @brief 找出功率最大的几个局部峰值
+ *
+ * @param power 功率谱
+ * @param[out] rec 摘要, 填写峰值频率和幅度
+ * @note 频率在对数功率上做抛物线插值, 幅度取峰值和相邻两个频点的功率之和,
+ *       覆盖Hann窗的主瓣
+ */
+static void spectrum_peaks(const float *power, record_spectrum_t *rec) {
+    uint32_t bin[SPECTRUM_PEAK_NUM] = {0};
+    uint32_t num = 0;
+    float a, b, c, den, delta;
+
+    for (uint32_t k = 1; k < SPECTRUM_BIN_NUM - 1; ++k) {
+        uint32_t i;
+
+        if ((power[k] <= power[k - 1]) || (power[k] < power[k + 1])) {
+            continue;
+        }
+
+        /* 按功率从大到小插入 */
+        for (i = num; i > 0 && power[bin[i - 1]] < power[k]; --i) {
+            if (i < SPECTRUM_PEAK_NUM) {
+                bin[i] = bin[i - 1];
+            }
+        }
+        if (i < SPECTRUM_PEAK_NUM) {
+            bin[i] = k;
+            if (num < SPECTRUM_PEAK_NUM) {
+                num++;
+            }
+        }
+    }
+
+    for (uint32_t i = 0; i < SPECTRUM_PEAK_NUM; ++i) {
+        if (i >= num) {
+            rec->peak_freq[i] = 0.0f;
+            rec->peak_amp[i] = 0.0f;
+            continue;
+        }
+
+        a = logf(power[bin[i] - 1] + 1e-12f);
+        b = logf(power[bin[i]] + 1e-12f);
+        c = logf(power[bin[i] + 1] + 1e-12f);
+        den = a - 2.0f * b + c;
+        delta = (den < 0.0f) ? 0.5f * (a - c) / den : 0.0f;
+
+        rec->peak_freq[i] = ((float)bin[i] + delta) * (float)SPECTRUM_RATE /
+                            (float)SPECTRUM_FFT_SIZE;
+        rec->peak_amp[i] =
+            sqrtf(power[bin[i] - 1] + power[bin[i]] + power[bin[i] + 1]);
+    }
+}
+
+#if (SPECTRUM_SAVE_BINS == 1)
+
+/**
+ * @brief 写入一个轴的完整功率谱
+ *
+ * @param axis 轴
+ * @param power 平均后的功率谱
+ */
+static void spectrum_write_bins(uint8_t axis, const float *power) {
+    struct {
+        record_spectrum_bins_t hdr;
+        int16_t db[SPECTRUM_BINS_PER_RECORD];
+    } rec;
+    float db;
+
+    rec.hdr.base = spectrum.base;
+    rec.hdr.axis = axis;
+
+    for (uint32_t first = 0; first < SPECTRUM_BIN_NUM;
+         first += SPECTRUM_BINS_PER_RECORD) {
+        uint32_t num = SPECTRUM_BIN_NUM - first;
+
+        num = (num > SPECTRUM_BINS_PER_RECORD) ? SPECTRUM_BINS_PER_RECORD : num;
+        for (uint32_t i = 0; i < num; ++i) {
+            db = 1000.0f * log10f(power[first + i] + 1e-12f);
+            db = (db > 32767.0f) ? 32767.0f : db;
+            db = (db < -32768.0f) ? -32768.0f : db;
+            rec.db[i] = (int16_t)lrintf(db);
+        }
+
+        rec.hdr.first = (uint16_t)first;
+        rec.hdr.num = (uint8_t)num;
+        recorder_write(RECORD_TYPE_SPECTRUM_BINS, 0, &rec,
+                       sizeof(rec.hdr) + num * sizeof(int16_t));
+    }
+}
+
+#endif /* SPECTRUM_SAVE_BINS == 1 */
+
+/**
+ * @brief 平均本周期的功率谱, 写入记录
+ *
+ */
+static void spectrum_output(void) {
+    record_spectrum_t rec = {.base = spectrum.base,
+                             .rate = SPECTRUM_RATE,
+                             .fft_size = SPECTRUM_FFT_SIZE,
+                             .blocks = spectrum.blocks,
+                             .flags = spectrum.flags};
+    float inv = 1.0f / (float)spectrum.blocks;
+
+    for (uint8_t axis = 0; axis < 3; ++axis) {
+        float *power = spectrum_power[axis];
+
+        memset(rec.band, 0, sizeof(rec.band));
+        for (uint32_t k = 0; k < SPECTRUM_BIN_NUM; ++k) {
+            power[k] *= inv;
+            rec.band[k * SPECTRUM_BAND_NUM / SPECTRUM_BIN_NUM] += power[k];
+        }
+        spectrum_peaks(power, &rec);
+
+        rec.axis = axis;
+        recorder_write(RECORD_TYPE_SPECTRUM, 0, &rec, sizeof(rec));
+#if (SPECTRUM_SAVE_BINS == 1)
+        spectrum_write_bins(axis, power);
+#endif /* SPECTRUM_SAVE_BINS == 1 */
+    }
+
+    memset(spectrum_power, 0, sizeof(spectrum_power));
+    spectrum.blocks = 0;
+    spectrum.flags = 0;
+}
+
+/**
+ * @brief 输入一个原始采样
+ *
+ * @param sample 采样
+ * @note 在主循环中调用, 块满时计算FFT, 周期结束时写入记录
+ */
+void spectrum_input(const mpu9250_sample_t *sample) {
+    uint32_t start, cycles;
+
+    if (!spectrum.ready) {
+        return;
+    }
+
+    if ((sample->flags & MPU9250_FLAG_GAP) && (spectrum.fill != 0)) {
+        spectrum.fill = 0;
+        spectrum.flags |= MPU9250_FLAG_GAP;
+        spectrum.stats.discarded++;
+    }
+
+    if ((spectrum.fill == 0) && (spectrum.blocks == 0)) {
+        spectrum.base = sample->time;
+    }
+
+    spectrum_input_buf[0][spectrum.fill] = sample->accel[0];
+    spectrum_input_buf[1][spectrum.fill] = sample->accel[1];
+    spectrum_input_buf[2][spectrum.fill] = sample->accel[2];
+    if (++spectrum.fill < SPECTRUM_FFT_SIZE) {
+        return;
+    }
+    spectrum.fill = 0;
+
+    start = DWT->CYCCNT;
+    for (uint32_t axis = 0; axis < 3; ++axis) {
+        spectrum_block(axis);
+    }
+    cycles = DWT->CYCCNT - start;
+    if (cycles > spectrum.stats.cycles_max) {
+        spectrum.stats.cycles_max = cycles;
+    }
+    spectrum.stats.blocks++;
+
+    if (++spectrum.blocks >= SPECTRUM_BLOCKS) {
+        spectrum_output();
+    }
+}
+
+/**
+ * @brief 获取分析统计
+ *
+ * @param[out] stats 统计
+ */
+void spectrum_get_stats(spectrum_stats_t *stats) {
+    *stats = spectrum.stats;
+}
+
+#endif /* SPECTRUM_ENABLE == 1 */
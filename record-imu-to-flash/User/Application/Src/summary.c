@@ -0,0 +1,113 @@
+/**
+ * @file    summary.c
+ * @author  Deadline039
+ * @brief   IMU窗口统计
+ * @version 1.0
+ * @date    2026-10-17
+ * @note    均值和方差用Welford算法逐个采样更新: n加1, d = x - mean,
+ *          mean += d / n, m2 += d * (x - mean). 不会像累加平方和那样在
+ *          均值远大于波动(如重力)时损失精度. 每个采样一次除法, 各轴共用.
+ *          窗口按采样时间划分, 第一个超出窗口的采样开始新的窗口
+ */
+
+#include "summary.h"
+#include "recorder.h"
+
+#include <math.h>
+
+#if (SUMMARY_ENABLE == 1)
+
+/* 窗口长度(us) */
+#define SUMMARY_WINDOW_US ((uint32_t)SUMMARY_WINDOW * 1000000U)
+
+static struct {
+    float mean[SUMMARY_AXIS_NUM];  /*!< 均值 */
+    float m2[SUMMARY_AXIS_NUM];    /*!< 与均值之差的平方和 */
+    int16_t min[SUMMARY_AXIS_NUM]; /*!< 最小值 */
+    int16_t max[SUMMARY_AXIS_NUM]; /*!< 最大值 */
+    uint32_t base;                 /*!< 第一个采样的时间(us) */
+    uint32_t last;                 /*!< 最后一个采样的时间(us) */
+    uint32_t count;                /*!< 采样数 */
+    uint16_t flags;                /*!< 窗口内有丢失时为GAP标志 */
+} summary;
+
+/**
+ * @brief 初始化, 清空窗口
+ *
+ */
+void summary_init(void) {
+    summary.count = 0;
+}
+
+/**
+ * @brief 写入本窗口的统计记录
+ *
+ */
+static void summary_output(void) {
+    record_summary_t rec = {.base = summary.base,
+                            .span = summary.last - summary.base,
+                            .count = summary.count,
+                            .flags = summary.flags};
+    float var;
+
+    for (uint32_t i = 0; i < SUMMARY_AXIS_NUM; ++i) {
+        var = summary.m2[i] / (float)summary.count;
+        rec.axis[i].min = summary.min[i];
+        rec.axis[i].max = summary.max[i];
+        rec.axis[i].mean = summary.mean[i];
+        rec.axis[i].var = var;
+        rec.axis[i].rms = sqrtf(var + summary.mean[i] * summary.mean[i]);
+    }
+
+    recorder_write(RECORD_TYPE_SUMMARY, 0, &rec, sizeof(rec));
+}
+
+/**
+ * @brief 输入一个原始采样
+ *
+ * @param sample 采样
+ * @note 在主循环中调用, 窗口结束时写入记录
+ */
+void summary_input(const mpu9250_sample_t *sample) {
+    int16_t x[SUMMARY_AXIS_NUM];
+    float inv, delta;
+
+    if ((summary.count != 0) &&
+        (sample->time - summary.base >= SUMMARY_WINDOW_US)) {
+        summary_output();
+        summary.count = 0;
+    }
+
+    for (uint32_t i = 0; i < 3; ++i) {
+        x[i] = sample->accel[i];
+        x[4 + i] = sample->gyro[i];
+        x[7 + i] = sample->mag[i];
+    }
+    x[3] = sample->temp;
+
+    if (summary.count == 0) {
+        for (uint32_t i = 0; i < SUMMARY_AXIS_NUM; ++i) {
+            summary.mean[i] = 0.0f;
+            summary.m2[i] = 0.0f;
+            summary.min[i] = x[i];
+            summary.max[i] = x[i];
+        }
+        summary.base = sample->time;
+        summary.flags = 0;
+    }
+
+    summary.count++;
+    summary.last = sample->time;
+    summary.flags |= sample->flags & MPU9250_FLAG_GAP;
+    inv = 1.0f / (float)summary.count;
+
+    for (uint32_t i = 0; i < SUMMARY_AXIS_NUM; ++i) {
+        delta = (float)x[i] - summary.mean[i];
+        summary.mean[i] += delta * inv;
+        summary.m2[i] += delta * ((float)x[i] - summary.mean[i]);
+        summary.min[i] = (x[i] < summary.min[i]) ? x[i] : summary.min[i];
+        summary.max[i] = (x[i] > summary.max[i]) ? x[i] : summary.max[i];
+    }
+}
+
+#endif /* SUMMARY_ENABLE == 1 */
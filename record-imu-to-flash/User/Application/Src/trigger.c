@@ -0,0 +1,230 @@
+/**
+ * @file    trigger.c
+ * @author  Deadline039
+ * @brief   IMU事件触发记录
+ * @version 1.0
+ * @date    2026-10-17
+ * @note    触发通道的每个采样都先存入环形缓冲区, 缓冲区中最旧的pending个采样
+ *          需要写入日志. 空闲时pending为0, 缓冲区满后覆盖最旧的采样, 保留最近
+ *          触发前时间内的采样; 触发时缓冲区中的采样全部变为需要写入, 保持时间
+ *          内新存入的采样也需要写入. 每次输入最多写入几个, 触发前的采样分散
+ *          到之后的主循环中写入, 不会一次阻塞太久让IMU缓冲区溢出.
+ *          缓冲区满而最旧的采样还没写入时立即写入, 不会丢失.
+ */
+
+#include "trigger.h"
+#include "recorder.h"
+
+#if (TRIGGER_ENABLE == 1)
+
+#if (TRIGGER_CHANNEL == 0)
+#define TRIGGER_FACTOR DECIMATE_CH0_FACTOR
+#else  /* TRIGGER_CHANNEL == 0 */
+#define TRIGGER_FACTOR DECIMATE_CH1_FACTOR
+#endif /* TRIGGER_CHANNEL == 0 */
+
+/* 触发通道的采样率(Hz) */
+#define TRIGGER_RATE (1000 / (1 + MPU9250_SMPLRT_DIV) / TRIGGER_FACTOR)
+
+/* 缓冲区大小 */
+#define TRIGGER_RING_NUM                                                       \
+    ((TRIGGER_PRE_TIME * TRIGGER_RATE < 1000)                                  \
+         ? 1                                                                   \
+         : (TRIGGER_PRE_TIME * TRIGGER_RATE / 1000))
+
+#if (TRIGGER_USE_CCM == 1)
+/* CCM从0x10000000开始, 只有这一个变量放在CCM中 */
+#define TRIGGER_RING_ATTR __attribute__((section(".bss.ARM.__at_0x10000000")))
+#else  /* TRIGGER_USE_CCM == 1 */
+#define TRIGGER_RING_ATTR
+#endif /* TRIGGER_USE_CCM == 1 */
+
+static imu_sample_t trigger_ring[TRIGGER_RING_NUM] TRIGGER_RING_ATTR;
+
+static struct {
+    float accel2; /*!< 加速度阈值的平方(LSB^2) */
+    float gyro2;  /*!< 角速度阈值的平方(LSB^2) */
+    float jerk2;  /*!< 加加速度阈值的平方((LSB/s)^2) */
+
+    uint32_t hold_end;  /*!< 保持结束的时间(us) */
+    uint32_t last_time; /*!< 上一个采样的时间(us) */
+    int16_t last[3];    /*!< 上一个采样的加速度 */
+    uint8_t has_last;   /*!< 上一个采样有效 */
+    uint8_t recording;  /*!< 在保持时间内, 新的采样需要写入 */
+    uint8_t fired;      /*!< 按键手动触发 */
+
+    uint16_t head;    /*!< 最旧的采样的位置 */
+    uint16_t count;   /*!< 缓冲区中的采样数 */
+    uint16_t pending; /*!< 需要写入的采样数, 都是最旧的 */
+
+    trigger_stats_t stats; /*!< 统计 */
+} trigger;
+
+/**
+ * @brief 初始化, 打开触发通道, 计算阈值
+ *
+ */
+void trigger_init(void) {
+    /* 加速度16384 >> FS LSB/g, 角速度32768 / (250 << FS) LSB/dps */
+    float accel = (float)(16384 >> MPU9250_ACCEL_FS);
+    float gyro = 32768.0f / (float)(250 << MPU9250_GYRO_FS);
+
+    trigger.accel2 = (float)TRIGGER_ACCEL * accel / 1000.0f;
+    trigger.accel2 *= trigger.accel2;
+    trigger.gyro2 = (float)TRIGGER_GYRO * gyro;
+    trigger.gyro2 *= trigger.gyro2;
+    trigger.jerk2 = (float)TRIGGER_JERK * accel;
+    trigger.jerk2 *= trigger.jerk2;
+
+    trigger.head = 0;
+    trigger.count = 0;
+    trigger.pending = 0;
+    trigger.recording = 0;
+    trigger.has_last = 0;
+    trigger.fired = 0;
+
+    decimate_enable(TRIGGER_CHANNEL, 1);
+}
+
+/**
+ * @brief 检查触发条件
+ *
+ * @param sample 采样
+ * @return 是否满足条件
+ */
+static uint8_t trigger_check(const mpu9250_sample_t *sample) {
+    float a[3], g[3], d[3], dt;
+    uint8_t hit = 0;
+
+    for (uint32_t i = 0; i < 3; ++i) {
+        a[i] = (float)sample->accel[i];
+        g[i] = (float)sample->gyro[i];
+    }
+
+    if ((TRIGGER_ACCEL != 0) &&
+        (a[0] * a[0] + a[1] * a[1] + a[2] * a[2] > trigger.accel2)) {
+        hit = 1;
+    }
+    if ((TRIGGER_GYRO != 0) &&
+        (g[0] * g[0] + g[1] * g[1] + g[2] * g[2] > trigger.gyro2)) {
+        hit = 1;
+    }
+
+    /* 丢失采样后的差分没有意义 */
+    if ((TRIGGER_JERK != 0) && trigger.has_last &&
+        !(sample->flags & MPU9250_FLAG_GAP) &&
+        (sample->time != trigger.last_time)) {
+        for (uint32_t i = 0; i < 3; ++i) {
+            d[i] = a[i] - (float)trigger.last[i];
+        }
+        dt = (float)(sample->time - trigger.last_time) * 1e-6f;
+        if (d[0] * d[0] + d[1] * d[1] + d[2] * d[2] >
+            trigger.jerk2 * dt * dt) {
+            hit = 1;
+        }
+    }
+    trigger.last[0] = sample->accel[0];
+    trigger.last[1] = sample->accel[1];
+    trigger.last[2] = sample->accel[2];
+    trigger.last_time = sample->time;
+    trigger.has_last = 1;
+
+    if (trigger.fired) {
+        trigger.fired = 0;
+        hit = 1;
+    }
+
+    return hit;
+}
+
+/**
+ * @brief 写入并取出缓冲区中最旧的采样
+ *
+ */
+static void trigger_pop(void) {
+    recorder_write_imu(TRIGGER_CHANNEL, &trigger_ring[trigger.head]);
+    trigger.head = (trigger.head + 1 == TRIGGER_RING_NUM) ? 0
+                                                          : trigger.head + 1;
+    trigger.count--;
+    trigger.pending--;
+    trigger.stats.written++;
+}
+
+/**
+ * @brief 输入触发通道的一个采样
+ *
+ * @param sample 采样
+ * @note 在主循环中调用
+ */
+void trigger_input(const mpu9250_sample_t *sample) {
+    uint32_t tail;
+
+    if (trigger_check(sample)) {
+        if (!trigger.recording) {
+            /* 新的事件, 触发前的采样都需要写入 */
+            trigger.recording = 1;
+            trigger.pending = trigger.count;
+            trigger.stats.events++;
+        }
+        trigger.hold_end = sample->time + TRIGGER_HOLD_TIME * 1000U;
+    } else if (trigger.recording &&
+               ((int32_t)(sample->time - trigger.hold_end) >= 0)) {
+        trigger.recording = 0;
+    }
+
+    for (uint32_t i = 0; (i < TRIGGER_DRAIN_NUM) && (trigger.pending != 0);
+         ++i) {
+        trigger_pop();
+    }
+
+    if (trigger.count == TRIGGER_RING_NUM) {
+        if (trigger.pending != 0) {
+            trigger_pop();
+            trigger.stats.forced++;
+        } else {
+            trigger.head = (trigger.head + 1 == TRIGGER_RING_NUM)
+                               ? 0
+                               : trigger.head + 1;
+            trigger.count--;
+        }
+    }
+
+    tail = trigger.head + trigger.count;
+    tail = (tail >= TRIGGER_RING_NUM) ? tail - TRIGGER_RING_NUM : tail;
+    trigger_ring[tail] = *sample;
+    trigger.count++;
+    if (trigger.recording) {
+        trigger.pending++;
+    }
+}
+
+/**
+ * @brief 写入缓冲区中所有需要写入的采样
+ *
+ * @note 在`recorder_flush`中, 提交采样块之前调用
+ */
+void trigger_flush(void) {
+    while (trigger.pending != 0) {
+        trigger_pop();
+    }
+}
+
+/**
+ * @brief 手动触发, 下一个采样按满足条件处理
+ *
+ * @note 在主循环中检测到按键时调用
+ */
+void trigger_fire(void) {
+    trigger.fired = 1;
+}
+
+/**
+ * @brief 获取触发统计
+ *
+ * @param[out] stats 统计
+ */
+void trigger_get_stats(trigger_stats_t *stats) {
+    *stats = trigger.stats;
+}
+
+#endif /* TRIGGER_ENABLE == 1 */
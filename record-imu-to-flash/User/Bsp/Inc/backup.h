@@ -0,0 +1,21 @@
+/**
+ * @file    backup.h
+ * @author  Deadline039
+ * @brief   备份域存储(BKPSRAM)
+ * @version 1.0
+ * @date    2026-10-17
+ */
+
+#ifndef __BACKUP_H
+#define __BACKUP_H
+
+#include "stm32f4xx_hal.h"
+
+/* 备份SRAM大小 */
+#define BACKUP_SIZE 4096U
+
+void backup_init(void);
+void backup_read(uint32_t offset, void *buf, uint32_t len);
+void backup_write(uint32_t offset, const void *data, uint32_t len);
+
+#endif /* __BACKUP_H */
@@ -13,12 +13,21 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#include "backup.h"
 #include "delay.h"
+#include "eeprom.h"
+#include "i2c.h"
 #include "key.h"
 #include "led.h"
+#include "mpu9250.h"
+#include "pvd.h"
 #include "rtc.h"
+#include "spi.h"
+#include "spi_bus.h"
 #include "stm32f4xx_hal.h"
+#include "timer.h"
 #include "uart.h"
+#include "w25qxx.h"
 
 void bsp_init(void);
 
@@ -0,0 +1,40 @@
+/**
+ * @file    eeprom.h
+ * @author  Deadline039
+ * @brief   用片内Flash模拟EEPROM
+ * @version 1.0
+ * @date    2026-10-17
+ */
+
+#ifndef __EEPROM_H
+#define __EEPROM_H
+
+#include "stm32f4xx_hal.h"
+
+// <<< Use Configuration Wizard in Context Menu >>>
+
+//  <o> 页0所在扇区
+//  <i> 使用片内Flash最后两个扇区, 不能和程序重叠
+#define EEPROM_PAGE0_SECTOR FLASH_SECTOR_10
+//  <o> 页0起始地址
+#define EEPROM_PAGE0_ADDR   0x080C0000
+//  <o> 页1所在扇区
+#define EEPROM_PAGE1_SECTOR FLASH_SECTOR_11
+//  <o> 页1起始地址
+#define EEPROM_PAGE1_ADDR   0x080E0000
+//  <o> 页大小
+#define EEPROM_PAGE_SIZE    0x20000
+
+//  <o> 键的数量
+//  <i> 键的范围为0 ~ 键的数量 - 1
+#define EEPROM_KEY_NUM      32
+//  <o> 值的最大长度(byte)
+#define EEPROM_VALUE_MAX    128
+
+// <<< end of configuration section >>>
+
+uint8_t eeprom_init(void);
+uint8_t eeprom_read(uint16_t key, void *buf, uint16_t len);
+uint8_t eeprom_write(uint16_t key, const void *data, uint16_t len);
+
+#endif /* __EEPROM_H */
@@ -0,0 +1,29 @@
+/**
+ * @file    fft.h
+ * @author  Deadline039
+ * @brief   单精度实数FFT
+ * @version 1.0
+ * @date    2026-10-17
+ * @note    点数N的实数FFT按N / 2点复数FFT计算, 复数FFT为基4, 所以
+ *          N / 2必须是4的幂, 即N为8, 32, 128, 512, 2048...
+ *          M4F上N = 512约6万周期, 按指令数估算
+ */
+
+#ifndef __FFT_H
+#define __FFT_H
+
+#include <stdint.h>
+
+/**
+ * @brief 实数FFT
+ */
+typedef struct {
+    const float *twiddle; /*!< cos(2 * pi * k / N), 长度为3 * N / 4 */
+    uint16_t n;           /*!< 点数 */
+    uint8_t stages;       /*!< 基4级数, log4(N / 2) */
+} fft_real_t;
+
+uint8_t fft_real_init(fft_real_t *fft, float *twiddle, uint16_t n);
+void fft_real(const fft_real_t *fft, float *buf);
+
+#endif /* __FFT_H */
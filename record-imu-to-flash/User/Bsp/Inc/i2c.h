@@ -0,0 +1,72 @@
+/**
+ * @file    i2c.h
+ * @author  Deadline039
+ * @brief   STM32F429 I2C驱动
+ * @version 1.0
+ * @date    2026-10-17
+ */
+
+#ifndef __I2C_H
+#define __I2C_H
+
+#include "stm32f4xx_hal.h"
+
+// <<< Use Configuration Wizard in Context Menu >>>
+
+// <e> 启用I2C2
+// ==================
+
+#define I2C2_ENABLE 1
+
+#if (I2C2_ENABLE == 1)
+
+extern I2C_HandleTypeDef i2c2_handle;
+
+/* I2C2 SCL GPIO */
+#define I2C2_SCL_GPIO_PORT     GPIOH
+#define I2C2_SCL_GPIO_ENABLE() __HAL_RCC_GPIOH_CLK_ENABLE()
+#define I2C2_SCL_GPIO_PIN      GPIO_PIN_4
+/* I2C2 SDA GPIO */
+#define I2C2_SDA_GPIO_PORT     GPIOH
+#define I2C2_SDA_GPIO_ENABLE() __HAL_RCC_GPIOH_CLK_ENABLE()
+#define I2C2_SDA_GPIO_PIN      GPIO_PIN_5
+
+//  <o> I2C2事件和错误中断抢占优先级
+//  <i> 中断中会继续下一段传输, 不要低于DMA中断
+#define I2C2_IT_PREEMPT        1
+//  <o> I2C2事件和错误中断子优先级
+#define I2C2_IT_SUB            0
+
+//  <e> 使用接收DMA
+//  <i> 接收使用DMA1数据流2通道7, 和UART4接收DMA冲突
+#define I2C2_USE_DMA_RX        1
+
+#if (I2C2_USE_DMA_RX == 1)
+
+//  <o I2C2_DMA_PRIORITY> I2C2 DMA优先级
+//      <DMA_PRIORITY_LOW=>低
+//      <DMA_PRIORITY_MEDIUM=>中
+//      <DMA_PRIORITY_HIGH=>高
+//      <DMA_PRIORITY_VERY_HIGH=>非常高
+#define I2C2_DMA_PRIORITY   DMA_PRIORITY_HIGH
+//  <o> I2C2 DMA中断抢占优先级
+#define I2C2_DMA_IT_PREEMPT 1
+//  <o> I2C2 DMA中断子优先级
+#define I2C2_DMA_IT_SUB     1
+
+#endif /* I2C2_USE_DMA_RX == 1 */
+
+//  </e>
+
+#endif /* I2C2_ENABLE == 1 */
+
+// </e>
+
+//  <o> I2C阻塞传输超时时间(ms)
+#define I2C_TIMEOUT 100
+
+// <<< end of configuration section >>>
+
+void i2c_init(I2C_HandleTypeDef *hi2c, uint32_t clock_speed);
+
+#endif /* __I2C_H */
@@ -0,0 +1,164 @@
+/**
+ * @file    mpu9250.h
+ * @author  Deadline039
+ * @brief   MPU9250九轴传感器驱动
+ * @version 1.0
+ * @date    2026-10-17
+ */
+
+#ifndef __MPU9250_H
+#define __MPU9250_H
+
+#include "i2c.h"
+#include "spi_bus.h"
+#include "timer.h"
+
+// <<< Use Configuration Wizard in Context Menu >>>
+
+//  <q> 使用SPI接口
+//  <i> 关闭时使用I2C接口. SPI读取传感器数据最高20MHz, 延迟更短, 不占用I2C
+#define MPU9250_USE_SPI        0
+
+//  <o MPU9250_GYRO_FS> 陀螺仪量程
+//      <0=>250dps
+//      <1=>500dps
+//      <2=>1000dps
+//      <3=>2000dps
+#define MPU9250_GYRO_FS        3
+//  <o MPU9250_ACCEL_FS> 加速度计量程
+//      <0=>2g
+//      <1=>4g
+//      <2=>8g
+//      <3=>16g
+#define MPU9250_ACCEL_FS       2
+//  <o MPU9250_DLPF> 低通滤波带宽
+//  <i> 陀螺仪和加速度计使用相同的设置
+//      <1=>184Hz
+//      <2=>92Hz
+//      <3=>41Hz
+//      <4=>20Hz
+//      <5=>10Hz
+//      <6=>5Hz
+#define MPU9250_DLPF           1
+//  <o> 采样率分频 <0-255>
+//  <i> 采样率为1kHz / (1 + 分频)
+#define MPU9250_SMPLRT_DIV     0
+//  <o MPU9250_MAG_MODE> 磁力计采样率
+//  <i> AK8963独立测量, 只在有新数据的采样中读取磁场
+//      <0x12=>8Hz
+//      <0x16=>100Hz
+#define MPU9250_MAG_MODE       0x16
+
+// <e> FIFO批量读取
+// ==================
+// <i> 采样先存入MPU9250的512字节FIFO, 每隔几个采样读一次FIFO
+// <i> 使用输入捕获时每8个数据就绪边沿才产生一次捕获中断,
+// <i> 每批采样只有一次捕获中断和一次FIFO读取, 约为直接读取的1/8
+// <i> 使用外部中断时每个采样仍有一次中断, 只减少传输次数
+
+#define MPU9250_USE_FIFO 1
+
+#if (MPU9250_USE_FIFO == 1)
+
+//  <o> 每次读取的采样数 <1-23>
+//  <i> 每个采样22字节, FIFO最多存23个, 读取间隔内FIFO不能写满
+//  <i> 使用输入捕获时必须为8的倍数
+#define MPU9250_FIFO_BATCH 8
+
+#endif /* MPU9250_USE_FIFO == 1 */
+
+// </e>
+
+//  <o> 采样缓冲区大小 <2-256>
+//  <i> 必须为2的幂次方, 主循环来不及取出时丢弃新的采样
+#define MPU9250_RING_NUM       64
+
+//  <q> INT使用定时器输入捕获
+//  <i> 数据就绪的边沿由定时器硬件锁存, 采样时间不受中断延迟影响
+//  <i> 关闭时使用外部中断, 在中断中读取SysTick作为采样时间
+#define MPU9250_USE_CAPTURE    1
+
+//  <o> INT外部中断抢占优先级
+//  <i> 使用输入捕获时为定时器中断优先级, 在timer.h中设置
+#define MPU9250_INT_IT_PREEMPT 1
+//  <o> INT外部中断子优先级
+#define MPU9250_INT_IT_SUB     2
+
+// <<< end of configuration section >>>
+
+#if (MPU9250_USE_SPI == 1)
+
+/* 使用的SPI总线, 和W25Qxx共用, 读取采样使用高优先级 */
+#define MPU9250_SPI_BUS          spi5_bus
+/* 片选 */
+#define MPU9250_CS_GPIO_PORT     GPIOH
+#define MPU9250_CS_GPIO_ENABLE() __HAL_RCC_GPIOH_CLK_ENABLE()
+#define MPU9250_CS_GPIO_PIN      GPIO_PIN_11
+
+/* SPI时钟设置: 模式3. SPI5时钟90MHz, 读写配置寄存器最高1MHz, 128分频;
+ * 读取传感器数据和FIFO最高20MHz, 8分频 */
+#define MPU9250_SPI_MODE_SLOW                                                  \
+    (SPI_POLARITY_HIGH | SPI_PHASE_2EDGE | SPI_BAUDRATEPRESCALER_128)
+#define MPU9250_SPI_MODE_FAST                                                  \
+    (SPI_POLARITY_HIGH | SPI_PHASE_2EDGE | SPI_BAUDRATEPRESCALER_8)
+
+#else  /* MPU9250_USE_SPI == 1 */
+
+/* 使用的I2C, 需要启用接收DMA */
+#define MPU9250_I2C_HANDLE i2c2_handle
+/* I2C地址, AD0接地 */
+#define MPU9250_I2C_ADDR   (0x68 << 1)
+
+#endif /* MPU9250_USE_SPI == 1 */
+
+/* INT GPIO, 数据就绪时输出50us高电平脉冲 */
+#define MPU9250_INT_GPIO_PORT     GPIOH
+#define MPU9250_INT_GPIO_ENABLE() __HAL_RCC_GPIOH_CLK_ENABLE()
+#define MPU9250_INT_GPIO_PIN      GPIO_PIN_10
+#if (MPU9250_USE_CAPTURE == 1)
+/* PH10为TIM5通道1 */
+#define MPU9250_INT_GPIO_AF       TIMER_TS_GPIO_AF
+#else  /* MPU9250_USE_CAPTURE == 1 */
+#define MPU9250_INT_IRQn          EXTI15_10_IRQn
+#define MPU9250_INT_IRQHandler    EXTI15_10_IRQHandler
+#endif /* MPU9250_USE_CAPTURE == 1 */
+
+/* 采样标志 */
+#define MPU9250_FLAG_GAP     0x0001 /* 和上一个采样之间有丢失 */
+#define MPU9250_FLAG_MAG     0x0002 /* 磁场是本次采样读到的新数据 */
+#define MPU9250_FLAG_MAG_GAP 0x0004 /* AK8963数据溢出, 和上一个磁场之间有丢失 */
+
+/**
+ * @brief 一次采样, 原始数据
+ * @note 磁场为AK8963自身的坐标系, 和加速度计, 陀螺仪的坐标系不同.
+ *       磁场的采样率低, 只在带`MPU9250_FLAG_MAG`的采样中更新, 采样时间即
+ *       磁场的时间; 其他采样中为上一个磁场
+ */
+typedef struct {
+    uint32_t time;    /*!< 采样时间(us) */
+    uint16_t flags;   /*!< 采样标志 */
+    int16_t accel[3]; /*!< 加速度 */
+    int16_t temp;     /*!< 温度 */
+    int16_t gyro[3];  /*!< 角速度 */
+    int16_t mag[3];   /*!< 磁场 */
+} mpu9250_sample_t;
+
+/**
+ * @brief 采样统计
+ */
+typedef struct {
+    uint32_t samples;  /*!< 读到的采样数 */
+    uint32_t reads;    /*!< 读取次数 */
+    uint32_t dropped;  /*!< 缓冲区满丢弃的采样数 */
+    uint32_t overrun;  /*!< 上次读取还没完成时又产生的中断数 */
+    uint32_t overflow; /*!< FIFO溢出次数 */
+    uint32_t errors;   /*!< 传输错误数 */
+    uint32_t mag;      /*!< 读到的磁场数 */
+    uint32_t mag_lost; /*!< AK8963数据溢出次数 */
+} mpu9250_stats_t;
+
+uint8_t mpu9250_init(void);
+uint8_t mpu9250_read(mpu9250_sample_t *sample);
+void mpu9250_get_stats(mpu9250_stats_t *stats);
+
+#endif /* __MPU9250_H */
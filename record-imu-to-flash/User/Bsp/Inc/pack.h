@@ -0,0 +1,37 @@
+/**
+ * @file    pack.h
+ * @author  Deadline039
+ * @brief   多列int16数据的差分位压缩
+ * @version 1.0
+ * @date    2026-10-17
+ * @note    无损. 每列选择一阶或二阶线性预测, 残差经zigzag映射为无符号数后
+ *          按该列的最大位宽紧密排列; 或者按二阶差分变长编码(dod.h),
+ *          残差大多为0的列, 例如等间隔采样的时间, 每个值只需1位.
+ *          编码后的格式:
+ *          - 每列3字节列头: 预测阶数(bit5-6, 3为变长编码)和位宽(bit0-4),
+ *            第一个值(int16)
+ *          - 之后是定长列第2个起的残差, 按列依次排列, 每个残差`位宽`位,
+ *            从低位开始填入字节
+ *          - 最后是各变长编码列的位流, 按列依次排列, 每列字节对齐
+ *          一阶残差为x[i] - x[i - 1], 二阶残差为x[i] - 2x[i - 1] + x[i - 2],
+ *          二阶列的第二个值用一阶残差. 定长列每个值约10周期
+ */
+
+#ifndef __PACK_H
+#define __PACK_H
+
+#include <stdint.h>
+
+/* 每列的列头长度 */
+#define PACK_COLUMN_HDR_SIZE 3
+
+/* 最坏情况下编码后的长度, 残差最多18位 */
+#define PACK_MAX_SIZE(col_num, num)                                            \
+    ((col_num) * PACK_COLUMN_HDR_SIZE + ((col_num) * ((num) - 1) * 18 + 7) / 8)
+
+uint32_t pack_encode(const int16_t *data, uint32_t stride, uint32_t col_num,
+                     uint32_t num, uint8_t *out, uint32_t size);
+uint8_t pack_decode(const uint8_t *in, uint32_t len, int16_t *data,
+                    uint32_t stride, uint32_t col_num, uint32_t num);
+
+#endif /* __PACK_H */
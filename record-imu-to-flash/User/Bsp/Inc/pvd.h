@@ -0,0 +1,17 @@
+/**
+ * @file    pvd.h
+ * @author  Deadline039
+ * @brief   可编程电压监测器(PVD)
+ * @version 1.0
+ * @date    2026-10-17
+ */
+
+#ifndef __PVD_H
+#define __PVD_H
+
+#include "stm32f4xx_hal.h"
+
+void pvd_init(uint32_t level);
+uint8_t pvd_is_low(void);
+
+#endif /* __PVD_H */
@@ -0,0 +1,34 @@
+/**
+ * @file    quat.h
+ * @author  Deadline039
+ * @brief   四元数压缩
+ * @version 1.0
+ * @date    2026-10-17
+ * @note    单位四元数只有三个自由度, q和-q表示同一个姿态. 编码时去掉绝对值
+ *          最大的分量并让它为正, 其余三个分量都在[-1 / sqrt(2), 1 / sqrt(2)]
+ *          之间, 各量化为`bits`位; 解码时由单位长度求出最大的分量.
+ *          编码后的格式, 从低位开始填入字节:
+ *          - 2位: 去掉的分量序号, 0-3为w, x, y, z
+ *          - 3 * `bits`位: 其余三个分量按序号从小到大排列
+ *          量化误差引起的姿态误差(两个姿态之间的转角)不超过
+ *          `quat_max_error`, 10位约0.27度(4字节), 12位约0.07度(5字节),
+ *          15位约0.009度(6字节). 每个四元数约100周期
+ */
+
+#ifndef __QUAT_H
+#define __QUAT_H
+
+#include <stdint.h>
+
+/* 每个分量的位数范围 */
+#define QUAT_BITS_MIN 10
+#define QUAT_BITS_MAX 15
+
+/* 编码后的字节数 */
+#define QUAT_SIZE(bits) ((2 + 3 * (bits) + 7) / 8)
+
+void quat_encode(const float q[4], uint32_t bits, uint8_t *out);
+uint8_t quat_decode(const uint8_t *in, uint32_t bits, float q[4]);
+float quat_max_error(uint32_t bits);
+
+#endif /* __QUAT_H */
@@ -14,7 +14,12 @@
 
 #include <time.h>
 
+/* 唤醒中断优先级, 只用于清除唤醒标志 */
+#define RTC_WKUP_IT_PREEMPT 3
+#define RTC_WKUP_IT_SUB     0
+
 void rtc_init(void);
+void rtc_wakeup_start(void);
 
 uint8_t rtc_get_week(uint16_t year, uint8_t month, uint8_t day);
 
@@ -0,0 +1,87 @@
+/**
+ * @file    spi.h
+ * @author  Deadline039
+ * @brief   STM32F429 SPI驱动
+ * @version 1.0
+ * @date    2026-10-17
+ */
+
+#ifndef __SPI_H
+#define __SPI_H
+
+#include "stm32f4xx_hal.h"
+
+// <<< Use Configuration Wizard in Context Menu >>>
+
+// <e> 启用SPI5
+// ==================
+
+#define SPI5_ENABLE 1
+
+#if (SPI5_ENABLE == 1)
+
+extern SPI_HandleTypeDef spi5_handle;
+
+/* SPI5 SCK GPIO */
+#define SPI5_SCK_GPIO_PORT      GPIOF
+#define SPI5_SCK_GPIO_ENABLE()  __HAL_RCC_GPIOF_CLK_ENABLE()
+#define SPI5_SCK_GPIO_PIN       GPIO_PIN_7
+/* SPI5 MISO GPIO */
+#define SPI5_MISO_GPIO_PORT     GPIOF
+#define SPI5_MISO_GPIO_ENABLE() __HAL_RCC_GPIOF_CLK_ENABLE()
+#define SPI5_MISO_GPIO_PIN      GPIO_PIN_8
+/* SPI5 MOSI GPIO */
+#define SPI5_MOSI_GPIO_PORT     GPIOF
+#define SPI5_MOSI_GPIO_ENABLE() __HAL_RCC_GPIOF_CLK_ENABLE()
+#define SPI5_MOSI_GPIO_PIN      GPIO_PIN_9
+
+//  <e> 使用DMA
+//  <i> 接收使用DMA2数据流3, 发送使用DMA2数据流4
+//  <i> 和其他外设的DMA数据流不冲突
+#define SPI5_USE_DMA            1
+
+#if (SPI5_USE_DMA == 1)
+
+//  <o SPI5_DMA_PRIORITY> SPI5 DMA优先级
+//      <DMA_PRIORITY_LOW=>低
+//      <DMA_PRIORITY_MEDIUM=>中
+//      <DMA_PRIORITY_HIGH=>高
+//      <DMA_PRIORITY_VERY_HIGH=>非常高
+#define SPI5_DMA_PRIORITY   DMA_PRIORITY_MEDIUM
+//  <o> SPI5 DMA中断抢占优先级
+//  <i> 中断中会开始总线队列中的下一个事务, 不要高于串口DMA中断
+#define SPI5_DMA_IT_PREEMPT 1
+//  <o> SPI5 DMA中断子优先级
+#define SPI5_DMA_IT_SUB     0
+
+#endif /* SPI5_USE_DMA == 1 */
+
+//  </e>
+
+#endif /* SPI5_ENABLE == 1 */
+
+// </e>
+
+//  <o> SPI阻塞传输超时时间(ms)
+#define SPI_TIMEOUT 1000
+
+// <<< end of configuration section >>>
+
+void spi_init(SPI_HandleTypeDef *hspi, uint32_t clk_polarity,
+              uint32_t clk_phase, uint32_t baud_rate_prescaler);
+void spi_set_speed(SPI_HandleTypeDef *hspi, uint32_t baud_rate_prescaler);
+
+uint8_t spi_read_write_byte(SPI_HandleTypeDef *hspi, uint8_t data);
+HAL_StatusTypeDef spi_transmit(SPI_HandleTypeDef *hspi, const void *data,
+                               uint32_t len);
+HAL_StatusTypeDef spi_receive(SPI_HandleTypeDef *hspi, void *buf,
+                              uint32_t len);
+HAL_StatusTypeDef spi_transmit_dma(SPI_HandleTypeDef *hspi, const void *data,
+                                   uint16_t len);
+HAL_StatusTypeDef spi_receive_dma(SPI_HandleTypeDef *hspi, void *buf,
+                                  uint16_t len);
+uint32_t spi_get_clock(SPI_HandleTypeDef *hspi);
+
+void spi_abort(SPI_HandleTypeDef *hspi);
+
+#endif /* __SPI_H */
@@ -0,0 +1,108 @@
+/**
+ * @file    spi_bus.h
+ * @author  Deadline039
+ * @brief   SPI总线事务队列
+ * @version 1.0
+ * @date    2026-10-17
+ */
+
+#ifndef __SPI_BUS_H
+#define __SPI_BUS_H
+
+#include "spi.h"
+
+// <<< Use Configuration Wizard in Context Menu >>>
+
+//  <o> 命令阶段最大长度(byte)
+#define SPI_BUS_CMD_MAX 8
+
+//  <o> 使用DMA的最小数据长度(byte)
+//  <i> 数据较短时直接查询传输, 省去启动DMA和进中断的开销
+#define SPI_BUS_DMA_MIN 16
+
+// <<< end of configuration section >>>
+
+/**
+ * @brief 事务优先级, 同一优先级先提交的先执行
+ * @note 只在两个事务之间切换, 不会打断正在传输的事务
+ */
+typedef enum {
+    SPI_BUS_PRIO_HIGH = 0U, /* 传感器读取等对延迟敏感的事务 */
+    SPI_BUS_PRIO_NORMAL,    /* 一般命令 */
+    SPI_BUS_PRIO_LOW,       /* 大块数据读取 */
+    SPI_BUS_PRIO_NUM        /* 优先级数量 */
+} spi_bus_prio_t;
+
+/**
+ * @brief 事务状态
+ */
+typedef enum {
+    SPI_TRANS_IDLE = 0U, /* 未提交 */
+    SPI_TRANS_QUEUED,    /* 在队列中等待 */
+    SPI_TRANS_RUNNING,   /* 正在传输 */
+    SPI_TRANS_DONE,      /* 完成 */
+    SPI_TRANS_ERROR      /* 传输出错或被终止 */
+} spi_trans_state_t;
+
+/**
+ * @brief SPI事务, 拉低片选, 发送命令, 再发送或接收数据, 最后拉高片选
+ */
+typedef struct spi_trans {
+    GPIO_TypeDef *cs_port; /*!< 片选端口 */
+    uint16_t cs_pin;       /*!< 片选引脚 */
+    uint32_t mode;         /*!< 时钟极性 | 时钟相位 | 波特率分频 */
+    spi_bus_prio_t prio;   /*!< 优先级 */
+
+    uint8_t cmd[SPI_BUS_CMD_MAX]; /*!< 命令, 查询方式发送 */
+    uint8_t cmd_len;              /*!< 命令长度 */
+    const void *tx_data;          /*!< 要发送的数据, 和rx_data二选一 */
+    void *rx_data;                /*!< 接收缓冲区 */
+    uint16_t data_len;            /*!< 数据长度 */
+
+    void (*callback)(struct spi_trans *trans); /*!< 完成回调, 可以为NULL */
+    void *arg;                                 /*!< 回调参数 */
+
+    __IO spi_trans_state_t state; /*!< 状态 */
+    struct spi_trans *next;       /*!< 队列中的下一个事务 */
+} spi_trans_t;
+
+/**
+ * @brief SPI总线
+ */
+typedef struct {
+    SPI_HandleTypeDef *hspi; /*!< SPI句柄 */
+
+    spi_trans_t *head[SPI_BUS_PRIO_NUM]; /*!< 各优先级队列头 */
+    spi_trans_t *tail[SPI_BUS_PRIO_NUM]; /*!< 各优先级队列尾 */
+    spi_trans_t *volatile current;       /*!< 正在传输的事务 */
+
+    uint32_t trans_start;  /*!< 当前事务开始时的CPU周期计数 */
+    uint64_t busy_cycles;  /*!< 统计周期内总线忙的CPU周期数 */
+    uint32_t trans_count;  /*!< 统计周期内完成的事务数 */
+    uint32_t byte_count;   /*!< 统计周期内传输的字节数 */
+    uint32_t window_start; /*!< 统计周期开始时间(ms) */
+} spi_bus_t;
+
+/**
+ * @brief 总线统计
+ */
+typedef struct {
+    uint32_t usage;  /*!< 总线占用率(‰) */
+    uint32_t trans;  /*!< 完成的事务数 */
+    uint32_t bytes;  /*!< 传输的字节数 */
+    uint32_t period; /*!< 统计时长(ms) */
+} spi_bus_stats_t;
+
+#if (SPI5_ENABLE == 1)
+extern spi_bus_t spi5_bus;
+#endif /* SPI5_ENABLE == 1 */
+
+void spi_bus_init(spi_bus_t *bus);
+
+uint8_t spi_bus_submit(spi_bus_t *bus, spi_trans_t *trans);
+uint8_t spi_bus_transfer(spi_bus_t *bus, spi_trans_t *trans);
+void spi_bus_abort(spi_bus_t *bus);
+
+void spi_bus_get_stats(spi_bus_t *bus, spi_bus_stats_t *stats);
+
+#endif /* __SPI_BUS_H */
@@ -0,0 +1,63 @@
+/**
+ * @file    timer.h
+ * @author  Deadline039
+ * @brief   输入捕获时间戳定时器
+ * @version 1.0
+ * @date    2026-10-17
+ */
+
+#ifndef __TIMER_H
+#define __TIMER_H
+
+#include "stm32f4xx_hal.h"
+
+// <<< Use Configuration Wizard in Context Menu >>>
+
+//  <o> 计数频率(Hz)
+//  <i> 必须能整除定时器时钟(90MHz), 32位计数器在2^32/频率秒后回绕
+#define TIMER_TS_FREQ       10000000
+
+//  <o> 定时器中断抢占优先级
+//  <i> 捕获中断中会开始读取传感器, 不要高于总线中断
+#define TIMER_TS_IT_PREEMPT 1
+//  <o> 定时器中断子优先级
+#define TIMER_TS_IT_SUB     2
+
+// <e> 以RTC校准计数频率
+// ==================
+// <i> 用两次RTC秒事件之间的计数估计实际的计数频率, 修正晶振误差
+// <i> RTC使用LSI时LSI误差比晶振大, 不校准
+
+#define TIMER_TS_DISCIPLINE 1
+
+#if (TIMER_TS_DISCIPLINE == 1)
+
+//  <o> 校准滤波系数 <0-8>
+//  <i> 每次测量结果的权重为1/2^n
+#define TIMER_TS_FILTER_SHIFT 4
+//  <o> 最大频率误差(ppm) <1-10000>
+//  <i> 超过时认为测量有误, 丢弃本次测量
+#define TIMER_TS_MAX_PPM      200
+
+#endif /* TIMER_TS_DISCIPLINE == 1 */
+
+// </e>
+
+// <<< end of configuration section >>>
+
+/* 使用的定时器, 32位. 通道1捕获外部信号, 通道4捕获RTC唤醒事件 */
+#define TIMER_TS_INSTANCE     TIM5
+#define TIMER_TS_IRQn         TIM5_IRQn
+#define TIMER_TS_IRQHandler   TIM5_IRQHandler
+#define TIMER_TS_CLK_ENABLE() __HAL_RCC_TIM5_CLK_ENABLE()
+#define TIMER_TS_GPIO_AF      GPIO_AF2_TIM5
+
+void timer_ts_init(void);
+uint32_t timer_ts_now(void);
+uint32_t timer_ts_to_us(uint32_t count);
+uint32_t timer_ts_get_freq(void);
+
+void timer_ts_capture_start(uint32_t polarity, uint32_t prescaler);
+void timer_ts_capture_callback(uint32_t time);
+
+#endif /* __TIMER_H */
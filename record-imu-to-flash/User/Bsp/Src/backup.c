@@ -0,0 +1,60 @@
+/**
+ * @file    backup.c
+ * @author  Deadline039
+ * @brief   备份域存储(BKPSRAM)
+ * @version 1.0
+ * @date    2026-10-17
+ * @note    4K备份SRAM, 打开备份调压器后由VBAT供电, 复位和看门狗不会清除.
+ *          备份域写保护在`HAL_RTC_MspInit`中已解除, 这里再解除一次,
+ *          不依赖RTC的初始化顺序
+ */
+
+#include "backup.h"
+
+#include <assert.h>
+#include <string.h>
+
+/**
+ * @brief 备份SRAM初始化
+ *
+ */
+void backup_init(void) {
+    HAL_StatusTypeDef res = HAL_OK;
+
+    __HAL_RCC_PWR_CLK_ENABLE();
+    HAL_PWR_EnableBkUpAccess();
+    __HAL_RCC_BKPSRAM_CLK_ENABLE();
+
+    /* 打开备份调压器, 主电源断开后备份SRAM由VBAT保持 */
+    res = HAL_PWREx_EnableBkUpReg();
+
+#ifdef DEBUG
+    assert(res == HAL_OK);
+#endif /* DEBUG */
+}
+
+/**
+ * @brief 读备份SRAM
+ *
+ * @param offset 偏移地址
+ * @param buf 接收缓冲区
+ * @param len 读取长度
+ */
+void backup_read(uint32_t offset, void *buf, uint32_t len) {
+    assert_param(offset + len <= BACKUP_SIZE);
+
+    memcpy(buf, (const uint8_t *)BKPSRAM_BASE + offset, len);
+}
+
+/**
+ * @brief 写备份SRAM
+ *
+ * @param offset 偏移地址
+ * @param data 要写入的数据
+ * @param len 数据长度
+ */
+void backup_write(uint32_t offset, const void *data, uint32_t len) {
+    assert_param(offset + len <= BACKUP_SIZE);
+
+    memcpy((uint8_t *)BKPSRAM_BASE + offset, data, len);
+}
@@ -68,6 +68,13 @@ void bsp_init(void) {
     led_init();
     key_init();
     rtc_init();
+    timer_ts_init();
+    backup_init();
+    eeprom_init();
+    spi_init(&spi5_handle, SPI_POLARITY_HIGH, SPI_PHASE_2EDGE,
+             SPI_BAUDRATEPRESCALER_4);
+    spi_bus_init(&spi5_bus);
+    i2c_init(&i2c2_handle, 400000);
 }
 
 #ifdef USE_FULL_ASSERT
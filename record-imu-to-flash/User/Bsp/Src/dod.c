@@ -0,0 +1,214 @@
+/**
+ * @file    dod.c
+ * @author  Deadline039
+ * @brief   时间戳二阶差分编码
+ * @version 1.0
+ * @date    2026-10-17
+ * @note    逐位读写, 每个时间戳约20到80周期, 二阶差分为0时最快
+ */
+
+#include "dod.h"
+
+#include <stddef.h>
+
+/**
+ * @brief 前缀码的分档
+ */
+typedef struct {
+    uint8_t prefix;     /*!< 前缀, 从低位开始写入 */
+    uint8_t prefix_len; /*!< 前缀位数 */
+    uint8_t width;      /*!< 数值位数 */
+} dod_bucket_t;
+
+static const dod_bucket_t dod_buckets[] = {
+    {0x00, 1, 0},
+    {0x01, 2, 7},
+    {0x03, 3, 9},
+    {0x07, 4, 12},
+    {0x0F, 4, 32},
+};
+
+#define DOD_BUCKET_NUM (sizeof(dod_buckets) / sizeof(dod_buckets[0]))
+
+/**
+ * @brief 选择二阶差分所在的分档
+ *
+ * @param dod 二阶差分
+ * @return 分档序号
+ */
+static uint32_t dod_bucket(int32_t dod) {
+    if (dod == 0) {
+        return 0;
+    }
+
+    for (uint32_t i = 1; i < DOD_BUCKET_NUM - 1; ++i) {
+        int32_t half = (int32_t)(1U << (dod_buckets[i].width - 1));
+
+        if ((dod >= -half) && (dod < half)) {
+            return i;
+        }
+    }
+
+    return DOD_BUCKET_NUM - 1;
+}
+
+/**
+ * @brief 写入若干位
+ *
+ * @param dod 编解码状态
+ * @param value 数值, 从低位开始写入
+ * @param width 位数, 不超过32
+ */
+static void dod_write(dod_t *dod, uint32_t value, uint32_t width) {
+    for (uint32_t i = 0; i < width; ++i) {
+        uint32_t byte = dod->pos >> 3, bit = dod->pos & 7;
+
+        if (bit == 0) {
+            dod->buf[byte] = 0;
+        }
+        dod->buf[byte] |= (uint8_t)(((value >> i) & 1U) << bit);
+        dod->pos++;
+    }
+}
+
+/**
+ * @brief 读取若干位
+ *
+ * @param dod 编解码状态
+ * @param width 位数, 不超过32
+ * @return 数值
+ */
+static uint32_t dod_read(dod_t *dod, uint32_t width) {
+    uint32_t value = 0;
+
+    for (uint32_t i = 0; i < width; ++i) {
+        value |= (uint32_t)((dod->buf[dod->pos >> 3] >> (dod->pos & 7)) & 1U)
+                 << i;
+        dod->pos++;
+    }
+
+    return value;
+}
+
+/**
+ * @brief 初始化编解码状态
+ *
+ * @param dod 编解码状态
+ * @param base 基准时间戳, 第一个时间戳与它的差作为第一个间隔
+ * @note 之后用`dod_set_buffer`指定位流缓冲区
+ */
+void dod_init(dod_t *dod, uint32_t base) {
+    dod->buf = NULL;
+    dod->size = 0;
+    dod->pos = 0;
+    dod->prev = base;
+    dod->delta = 0;
+}
+
+/**
+ * @brief 指定位流缓冲区, 从开头读写
+ *
+ * @param dod 编解码状态
+ * @param buf 缓冲区
+ * @param size 缓冲区大小
+ * @note 时间戳状态保留, 可以把一串时间戳分到多段缓冲区中, 每段字节对齐
+ */
+void dod_set_buffer(dod_t *dod, void *buf, uint32_t size) {
+    dod->buf = buf;
+    dod->size = size;
+    dod->pos = 0;
+}
+
+/**
+ * @brief 二阶差分编码后的位数
+ *
+ * @param dod 二阶差分
+ * @return 位数
+ */
+uint32_t dod_bits(int32_t dod) {
+    const dod_bucket_t *bucket = &dod_buckets[dod_bucket(dod)];
+
+    return bucket->prefix_len + bucket->width;
+}
+
+/**
+ * @brief 下一个时间戳编码后的位数
+ *
+ * @param dod 编解码状态
+ * @param time 时间戳
+ * @return 位数
+ */
+uint32_t dod_cost(const dod_t *dod, uint32_t time) {
+    return dod_bits((int32_t)(time - dod->prev - dod->delta));
+}
+
+/**
+ * @brief 编码一个时间戳
+ *
+ * @param dod 编解码状态
+ * @param time 时间戳
+ * @return 编码结果
+ *  @retval 0 成功
+ *  @retval 1 缓冲区放不下, 状态不变
+ */
+uint8_t dod_put(dod_t *dod, uint32_t time) {
+    uint32_t delta = time - dod->prev;
+    int32_t value = (int32_t)(delta - dod->delta);
+    const dod_bucket_t *bucket = &dod_buckets[dod_bucket(value)];
+
+    if (dod->pos + bucket->prefix_len + bucket->width > dod->size * 8) {
+        return 1;
+    }
+
+    dod_write(dod, bucket->prefix, bucket->prefix_len);
+    dod_write(dod, (uint32_t)value, bucket->width);
+
+    dod->prev = time;
+    dod->delta = delta;
+
+    return 0;
+}
+
+/**
+ * @brief 解码一个时间戳
+ *
+ * @param dod 编解码状态
+ * @param[out] time 时间戳
+ * @return 解码结果
+ *  @retval 0 成功
+ *  @retval 1 位流不完整
+ */
+uint8_t dod_get(dod_t *dod, uint32_t *time) {
+    const dod_bucket_t *bucket;
+    uint32_t ones = 0;
+    uint32_t value;
+
+    /* 前缀中1的个数就是分档序号, 以0结束或达到4个 */
+    while (ones < DOD_BUCKET_NUM - 1) {
+        if (dod->pos >= dod->size * 8) {
+            return 1;
+        }
+        if (dod_read(dod, 1) == 0) {
+            break;
+        }
+        ones++;
+    }
+
+    bucket = &dod_buckets[ones];
+    if (dod->pos + bucket->width > dod->size * 8) {
+        return 1;
+    }
+
+    value = dod_read(dod, bucket->width);
+    /* 数值位数小于32时符号扩展 */
+    if ((bucket->width != 0) && (bucket->width < 32) &&
+        (value & (1U << (bucket->width - 1)))) {
+        value |= ~((1U << bucket->width) - 1);
+    }
+
+    dod->delta += value;
+    dod->prev += dod->delta;
+    *time = dod->prev;
+
+    return 0;
+}
@@ -0,0 +1,331 @@
+/**
+ * @file    dsp.c
+ * @author  Deadline039
+ * @brief   Q15定点信号处理
+ * @version 1.0
+ * @date    2026-10-17
+ * @note    两个相邻的Q15按32位读出, 在M4上用SMLALD一条指令完成两次乘加,
+ *          QADD16一条指令完成两次饱和加法. 没有DSP扩展的内核(M3, 上位机)
+ *          使用和指令定义相同的C实现, 结果逐位一致. 乘加都累加到64位,
+ *          不会溢出; 只在输出时舍入并饱和到Q15. 按小端读取.
+ */
+
+#include "dsp.h"
+
+#include <string.h>
+
+#if (defined(__ARM_FEATURE_DSP) && (__ARM_FEATURE_DSP == 1))
+
+#define dsp_smlald(x, y, acc) ((q63_t)__SMLALD((x), (y), (uint64_t)(acc)))
+#define dsp_qadd16(x, y)      __QADD16((x), (y))
+
+#else  /* __ARM_FEATURE_DSP == 1 */
+
+/**
+ * @brief 两个16位乘积的和加到64位累加器, 同SMLALD
+ *
+ * @param x 两个Q15
+ * @param y 两个Q15
+ * @param acc 累加器
+ * @return 累加结果
+ */
+static inline q63_t dsp_smlald(uint32_t x, uint32_t y, q63_t acc) {
+    return acc + (int32_t)(int16_t)x * (int16_t)y +
+           (int32_t)(int16_t)(x >> 16) * (int16_t)(y >> 16);
+}
+
+#endif /* __ARM_FEATURE_DSP == 1 */
+
+/**
+ * @brief 饱和到Q15
+ *
+ * @param x 输入
+ * @return 饱和结果
+ */
+static inline q15_t dsp_sat_q15(q63_t x) {
+    if (x > INT16_MAX) {
+        return INT16_MAX;
+    }
+    if (x < INT16_MIN) {
+        return INT16_MIN;
+    }
+    return (q15_t)x;
+}
+
+#if !(defined(__ARM_FEATURE_DSP) && (__ARM_FEATURE_DSP == 1))
+
+/**
+ * @brief 两组16位饱和加法, 同QADD16
+ *
+ * @param x 两个Q15
+ * @param y 两个Q15
+ * @return 两个和
+ */
+static inline uint32_t dsp_qadd16(uint32_t x, uint32_t y) {
+    uint16_t lo = (uint16_t)dsp_sat_q15((int16_t)x + (int16_t)y);
+    uint16_t hi =
+        (uint16_t)dsp_sat_q15((int16_t)(x >> 16) + (int16_t)(y >> 16));
+
+    return ((uint32_t)hi << 16) | lo;
+}
+
+#endif /* __ARM_FEATURE_DSP == 1 */
+
+/**
+ * @brief 读取两个相邻的Q15
+ *
+ * @param p 地址, 可以不对齐
+ * @return 低16位为p[0], 高16位为p[1]
+ */
+static inline uint32_t dsp_read_q15x2(const q15_t *p) {
+    uint32_t value;
+
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+/**
+ * @brief 舍入, 饱和到Q15
+ *
+ * @param acc 累加器
+ * @param shift 右移位数, 1-31
+ * @return 结果
+ */
+static inline q15_t dsp_round_q15(q63_t acc, uint32_t shift) {
+    return dsp_sat_q15((acc + ((q63_t)1 << (shift - 1))) >> shift);
+}
+
+/**
+ * @brief 点积
+ *
+ * @param a 向量a
+ * @param b 向量b
+ * @param n 长度
+ * @return 点积, Q30, 不会溢出
+ */
+q63_t dsp_dot_q15(const q15_t *a, const q15_t *b, uint32_t n) {
+    q63_t acc = 0;
+    uint32_t i = 0;
+
+    for (; i + 4 <= n; i += 4) {
+        acc = dsp_smlald(dsp_read_q15x2(&a[i]), dsp_read_q15x2(&b[i]), acc);
+        acc = dsp_smlald(dsp_read_q15x2(&a[i + 2]), dsp_read_q15x2(&b[i + 2]),
+                         acc);
+    }
+    for (; i < n; ++i) {
+        acc += (int32_t)a[i] * b[i];
+    }
+
+    return acc;
+}
+
+/**
+ * @brief 饱和加法
+ *
+ * @param a 向量a
+ * @param b 向量b
+ * @param[out] out 和, 可以和a或b相同
+ * @param n 长度
+ */
+void dsp_add_q15(const q15_t *a, const q15_t *b, q15_t *out, uint32_t n) {
+    uint32_t i = 0;
+    uint32_t sum;
+
+    for (; i + 2 <= n; i += 2) {
+        sum = dsp_qadd16(dsp_read_q15x2(&a[i]), dsp_read_q15x2(&b[i]));
+        memcpy(&out[i], &sum, sizeof(sum));
+    }
+    if (i < n) {
+        out[i] = dsp_sat_q15((int32_t)a[i] + b[i]);
+    }
+}
+
+/**
+ * @brief 初始化FIR滤波器
+ *
+ * @param[out] fir 滤波器
+ * @param coeffs 系数, coeffs[0]对应最新的输入, 需要一直有效
+ * @param state 延迟线, 长度为2 * num_taps
+ * @param num_taps 抽头数
+ */
+void dsp_fir_q15_init(dsp_fir_q15_t *fir, const q15_t *coeffs, q15_t *state,
+                      uint16_t num_taps) {
+    fir->coeffs = coeffs;
+    fir->state = state;
+    fir->num_taps = num_taps;
+    fir->pos = 0;
+    memset(state, 0, 2 * num_taps * sizeof(q15_t));
+}
+
+/**
+ * @brief 输入放入延迟线
+ *
+ * @param fir 滤波器
+ * @param x 输入
+ * @note 延迟线存两份, 从pos开始的num_taps个输入总是连续的,
+ *       由新到旧排列, 计算时不用处理回绕
+ */
+static inline void dsp_fir_push(dsp_fir_q15_t *fir, q15_t x) {
+    uint32_t pos = (fir->pos == 0) ? fir->num_taps - 1 : fir->pos - 1;
+
+    fir->state[pos] = x;
+    fir->state[pos + fir->num_taps] = x;
+    fir->pos = pos;
+}
+
+/**
+ * @brief 计算FIR输出
+ *
+ * @param fir 滤波器
+ * @return 输出
+ */
+static inline q15_t dsp_fir_output(const dsp_fir_q15_t *fir) {
+    return dsp_round_q15(
+        dsp_dot_q15(fir->coeffs, &fir->state[fir->pos], fir->num_taps), 15);
+}
+
+/**
+ * @brief FIR滤波
+ *
+ * @param fir 滤波器
+ * @param in 输入
+ * @param[out] out 输出, 可以和输入相同
+ * @param n 采样数
+ */
+void dsp_fir_q15(dsp_fir_q15_t *fir, const q15_t *in, q15_t *out, uint32_t n) {
+    for (uint32_t i = 0; i < n; ++i) {
+        dsp_fir_push(fir, in[i]);
+        out[i] = dsp_fir_output(fir);
+    }
+}
+
+/**
+ * @brief 初始化FIR抽取器
+ *
+ * @param[out] dec 抽取器
+ * @param coeffs 抗混叠滤波器系数, 截止频率不高于输出采样率的一半
+ * @param state 延迟线, 长度为2 * num_taps
+ * @param num_taps 抽头数
+ * @param factor 抽取倍数
+ */
+void dsp_decimate_q15_init(dsp_decimate_q15_t *dec, const q15_t *coeffs,
+                           q15_t *state, uint16_t num_taps, uint16_t factor) {
+    dsp_fir_q15_init(&dec->fir, coeffs, state, num_taps);
+    dec->factor = factor;
+    dec->phase = factor;
+}
+
+/**
+ * @brief 抽取, 只在需要输出时计算滤波器
+ *
+ * @param dec 抽取器
+ * @param in 输入
+ * @param[out] out 输出, 长度至少为n / factor + 1, 可以和输入相同
+ * @param n 输入采样数
+ * @return 输出采样数
+ */
+uint32_t dsp_decimate_q15(dsp_decimate_q15_t *dec, const q15_t *in,
+                          q15_t *out, uint32_t n) {
+    uint32_t num = 0;
+
+    for (uint32_t i = 0; i < n; ++i) {
+        dsp_fir_push(&dec->fir, in[i]);
+        if (--dec->phase == 0) {
+            dec->phase = dec->factor;
+            out[num++] = dsp_fir_output(&dec->fir);
+        }
+    }
+
+    return num;
+}
+
+/**
+ * @brief 初始化级联双二阶滤波器
+ *
+ * @param[out] iir 滤波器
+ * @param coeffs 系数, 每级{b0, 0, b1, b2, a1, a2}, 需要一直有效
+ * @param state 状态, 长度为4 * num_stages
+ * @param num_stages 级数
+ * @param shift 系数缩小的位数, 系数绝对值不小于1时使用, 0-14
+ */
+void dsp_biquad_q15_init(dsp_biquad_q15_t *iir, const q15_t *coeffs,
+                         q15_t *state, uint8_t num_stages, uint8_t shift) {
+    iir->coeffs = coeffs;
+    iir->state = state;
+    iir->num_stages = num_stages;
+    iir->shift = shift;
+    memset(state, 0, 4 * num_stages * sizeof(q15_t));
+}
+
+/**
+ * @brief 双二阶滤波
+ *
+ * @param iir 滤波器
+ * @param in 输入
+ * @param[out] out 输出, 可以和输入相同
+ * @param n 采样数
+ */
+void dsp_biquad_q15(dsp_biquad_q15_t *iir, const q15_t *in, q15_t *out,
+                    uint32_t n) {
+    uint32_t shift = 15 - iir->shift;
+
+    for (uint32_t i = 0; i < n; ++i) {
+        q15_t x = in[i];
+
+        for (uint32_t k = 0; k < iir->num_stages; ++k) {
+            const q15_t *c = &iir->coeffs[k * 6];
+            q15_t *s = &iir->state[k * 4];
+            q63_t acc = (int32_t)c[0] * x;
+            q15_t y;
+
+            acc = dsp_smlald(dsp_read_q15x2(&c[2]), dsp_read_q15x2(&s[0]), acc);
+            acc = dsp_smlald(dsp_read_q15x2(&c[4]), dsp_read_q15x2(&s[2]), acc);
+            y = dsp_round_q15(acc, shift);
+
+            s[1] = s[0];
+            s[0] = x;
+            s[3] = s[2];
+            s[2] = y;
+            x = y;
+        }
+
+        out[i] = x;
+    }
+}
+
+/**
+ * @brief 初始化滑动平均
+ *
+ * @param[out] mavg 滑动平均
+ * @param buf 窗口缓冲区, 长度为len
+ * @param len 窗口长度
+ */
+void dsp_mavg_q15_init(dsp_mavg_q15_t *mavg, q15_t *buf, uint16_t len) {
+    mavg->buf = buf;
+    mavg->sum = 0;
+    mavg->len = len;
+    mavg->pos = 0;
+    memset(buf, 0, len * sizeof(q15_t));
+}
+
+/**
+ * @brief 滑动平均, 每个输入只做一次加减
+ *
+ * @param mavg 滑动平均
+ * @param in 输入
+ * @param[out] out 输出, 向0取整, 可以和输入相同
+ * @param n 采样数
+ */
+void dsp_mavg_q15(dsp_mavg_q15_t *mavg, const q15_t *in, q15_t *out,
+                  uint32_t n) {
+    for (uint32_t i = 0; i < n; ++i) {
+        q15_t x = in[i];
+
+        mavg->sum += x - mavg->buf[mavg->pos];
+        mavg->buf[mavg->pos] = x;
+        if (++mavg->pos == mavg->len) {
+            mavg->pos = 0;
+        }
+        out[i] = (q15_t)(mavg->sum / mavg->len);
+    }
+}
@@ -0,0 +1,191 @@
+/**
+ * @file    fft.c
+ * @author  Deadline039
+ * @brief   单精度实数FFT
+ * @version 1.0
+ * @date    2026-10-17
+ * @note    N点实数序列看作N / 2点复数序列(偶数点为实部, 奇数点为虚部),
+ *          用基4频域抽取FFT原位计算, 数字倒序后再拆分出实数序列的频谱.
+ *          旋转因子只存一张cos表, sin由cos(pi / 2 - x)得到
+ */
+
+#include "fft.h"
+
+#include <math.h>
+
+#define FFT_PI 3.14159265f
+
+/**
+ * @brief 旋转因子W_N^k的实部
+ *
+ * @param fft FFT
+ * @param k 序号, 小于3 * N / 4
+ * @return cos(2 * pi * k / N)
+ */
+static inline float fft_cos(const fft_real_t *fft, uint32_t k) {
+    return fft->twiddle[k];
+}
+
+/**
+ * @brief 旋转因子W_N^k虚部的相反数
+ *
+ * @param fft FFT
+ * @param k 序号, 小于3 * N / 4
+ * @return sin(2 * pi * k / N)
+ */
+static inline float fft_sin(const fft_real_t *fft, uint32_t k) {
+    uint32_t quarter = fft->n / 4;
+
+    return fft->twiddle[(k > quarter) ? k - quarter : quarter - k];
+}
+
+/**
+ * @brief 初始化实数FFT, 计算旋转因子
+ *
+ * @param[out] fft FFT
+ * @param twiddle 旋转因子表, 长度为3 * N / 4, 需要一直有效
+ * @param n 点数, N / 2必须是4的幂
+ * @return 初始化结果
+ *  @retval 0 成功
+ *  @retval 1 点数错误
+ */
+uint8_t fft_real_init(fft_real_t *fft, float *twiddle, uint16_t n) {
+    uint32_t m = n / 2;
+    uint8_t stages = 0;
+
+    if (n < 8) {
+        return 1;
+    }
+    for (; m > 1; m >>= 2) {
+        if (m & 3) {
+            return 1;
+        }
+        stages++;
+    }
+
+    for (uint32_t k = 0; k < 3U * n / 4; ++k) {
+        twiddle[k] = cosf(2.0f * FFT_PI * (float)k / (float)n);
+    }
+
+    fft->twiddle = twiddle;
+    fft->n = n;
+    fft->stages = stages;
+
+    return 0;
+}
+
+/**
+ * @brief 基4复数FFT, 原位计算, 输出为自然顺序
+ *
+ * @param fft FFT
+ * @param x N / 2个复数, 实部虚部交替存放
+ */
+static void fft_radix4(const fft_real_t *fft, float *x) {
+    uint32_t m = fft->n / 2;
+
+    for (uint32_t n2 = m; n2 > 1; n2 >>= 2) {
+        uint32_t n1 = n2 >> 2;
+        /* 本级的W_(n2)^j即W_N^(j * step) */
+        uint32_t step = fft->n / n2;
+
+        for (uint32_t j = 0; j < n1; ++j) {
+            float c1 = fft_cos(fft, j * step), s1 = fft_sin(fft, j * step);
+            float c2 = fft_cos(fft, 2 * j * step);
+            float s2 = fft_sin(fft, 2 * j * step);
+            float c3 = fft_cos(fft, 3 * j * step);
+            float s3 = fft_sin(fft, 3 * j * step);
+
+            for (uint32_t i = j; i < m; i += n2) {
+                float *a = &x[2 * i];
+                float *b = &x[2 * (i + n1)];
+                float *c = &x[2 * (i + 2 * n1)];
+                float *d = &x[2 * (i + 3 * n1)];
+                float t0r = a[0] + c[0], t0i = a[1] + c[1];
+                float t1r = a[0] - c[0], t1i = a[1] - c[1];
+                float t2r = b[0] + d[0], t2i = b[1] + d[1];
+                float t3r = b[0] - d[0], t3i = b[1] - d[1];
+                float yr, yi;
+
+                a[0] = t0r + t2r;
+                a[1] = t0i + t2i;
+
+                /* (t1 - j * t3) * W^j */
+                yr = t1r + t3i;
+                yi = t1i - t3r;
+                b[0] = yr * c1 + yi * s1;
+                b[1] = yi * c1 - yr * s1;
+
+                /* (t0 - t2) * W^2j */
+                yr = t0r - t2r;
+                yi = t0i - t2i;
+                c[0] = yr * c2 + yi * s2;
+                c[1] = yi * c2 - yr * s2;
+
+                /* (t1 + j * t3) * W^3j */
+                yr = t1r - t3i;
+                yi = t1i + t3r;
+                d[0] = yr * c3 + yi * s3;
+                d[1] = yi * c3 - yr * s3;
+            }
+        }
+    }
+
+    /* 频域抽取的输出是按4进制数字倒序排列的 */
+    for (uint32_t i = 0; i < m; ++i) {
+        uint32_t r = 0;
+        uint32_t v = i;
+        float t;
+
+        for (uint32_t s = 0; s < fft->stages; ++s) {
+            r = (r << 2) | (v & 3);
+            v >>= 2;
+        }
+        if (i < r) {
+            t = x[2 * i];
+            x[2 * i] = x[2 * r];
+            x[2 * r] = t;
+            t = x[2 * i + 1];
+            x[2 * i + 1] = x[2 * r + 1];
+            x[2 * r + 1] = t;
+        }
+    }
+}
+
+/**
+ * @brief 实数FFT, 原位计算
+ *
+ * @param fft FFT
+ * @param buf 输入N个实数, 输出前N / 2 + 1个频点:
+ *            buf[0]为直流, buf[1]为N / 2处(都是实数),
+ *            buf[2k], buf[2k + 1]为第k个频点的实部和虚部
+ * @note 没有归一化, 幅值为时域的N / 2倍
+ */
+void fft_real(const fft_real_t *fft, float *buf) {
+    uint32_t m = fft->n / 2;
+    float x0r, x0i;
+
+    fft_radix4(fft, buf);
+
+    /* Z[k] = E[k] + j * O[k], 偶数点和奇数点的频谱由Z[k]和Z[m - k]共轭对称
+     * 拆出, X[k] = E[k] + W_N^k * O[k], X[m - k] = conj(E[k] - W_N^k * O[k])
+     */
+    x0r = buf[0];
+    x0i = buf[1];
+    buf[0] = x0r + x0i;
+    buf[1] = x0r - x0i;
+
+    for (uint32_t k = 1; k <= m / 2; ++k) {
+        float *a = &buf[2 * k];
+        float *b = &buf[2 * (m - k)];
+        float er = 0.5f * (a[0] + b[0]), ei = 0.5f * (a[1] - b[1]);
+        float dr = 0.5f * (a[1] + b[1]), di = -0.5f * (a[0] - b[0]);
+        float c = fft_cos(fft, k), s = fft_sin(fft, k);
+        float tr = dr * c + di * s;
+        float ti = di * c - dr * s;
+
+        a[0] = er + tr;
+        a[1] = ei + ti;
+        b[0] = er - tr;
+        b[1] = ti - ei;
+    }
+}
@@ -0,0 +1,128 @@
+/**
+ * @file    i2c.c
+ * @author  Deadline039
+ * @brief   STM32F429 I2C驱动
+ * @version 1.0
+ * @date    2026-10-17
+ */
+
+#include "i2c.h"
+
+#include <assert.h>
+
+#if (I2C2_ENABLE == 1)
+I2C_HandleTypeDef i2c2_handle = {.Instance = I2C2};
+
+#if (I2C2_USE_DMA_RX == 1)
+static DMA_HandleTypeDef i2c2_dmarx_handle = {
+    .Instance = DMA1_Stream2,
+    .Init.Channel = DMA_CHANNEL_7,
+    .Init.Direction = DMA_PERIPH_TO_MEMORY,       /* 接收, 外设到内存 */
+    .Init.MemDataAlignment = DMA_MDATAALIGN_BYTE, /* 内存以字节对齐 */
+    .Init.MemInc = DMA_MINC_ENABLE,               /* 启用内存地址自增 */
+    .Init.Mode = DMA_NORMAL,                      /* 正常模式 */
+    .Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE, /* 外设以字节对齐 */
+    .Init.PeriphInc = DMA_PINC_DISABLE, /* 关闭外设地址自增 */
+    .Init.Priority = I2C2_DMA_PRIORITY  /* DMA优先级 */
+};
+
+/**
+ * @brief I2C2 DMA接收中断句柄
+ *
+ */
+void DMA1_Stream2_IRQHandler(void) {
+    HAL_DMA_IRQHandler(&i2c2_dmarx_handle);
+}
+#endif /* I2C2_USE_DMA_RX == 1 */
+
+/**
+ * @brief I2C2事件中断句柄
+ *
+ */
+void I2C2_EV_IRQHandler(void) {
+    HAL_I2C_EV_IRQHandler(&i2c2_handle);
+}
+
+/**
+ * @brief I2C2错误中断句柄
+ *
+ */
+void I2C2_ER_IRQHandler(void) {
+    HAL_I2C_ER_IRQHandler(&i2c2_handle);
+}
+
+#endif /* I2C2_ENABLE == 1 */
+
+/**
+ * @brief I2C初始化, 主机模式, 7位地址
+ *
+ * @param hi2c I2C句柄
+ * @param clock_speed 时钟频率(Hz), 最大400000
+ */
+void i2c_init(I2C_HandleTypeDef *hi2c, uint32_t clock_speed) {
+    HAL_StatusTypeDef res = HAL_OK;
+
+    hi2c->Init.ClockSpeed = clock_speed;
+    hi2c->Init.DutyCycle = I2C_DUTYCYCLE_2;
+    hi2c->Init.OwnAddress1 = 0;
+    hi2c->Init.AddressingMode = I2C_ADDRESSINGMODE_7BIT;
+    hi2c->Init.DualAddressMode = I2C_DUALADDRESS_DISABLE;
+    hi2c->Init.OwnAddress2 = 0;
+    hi2c->Init.GeneralCallMode = I2C_GENERALCALL_DISABLE;
+    hi2c->Init.NoStretchMode = I2C_NOSTRETCH_DISABLE;
+
+    res = HAL_I2C_Init(hi2c);
+#ifdef DEBUG
+    assert(res == HAL_OK);
+#endif /* DEBUG */
+}
+
+/**
+ * @brief I2C底层初始化
+ *
+ * @param hi2c I2C句柄
+ */
+void HAL_I2C_MspInit(I2C_HandleTypeDef *hi2c) {
+    HAL_StatusTypeDef res = HAL_OK;
+    GPIO_InitTypeDef gpio_init_struct = {.Mode = GPIO_MODE_AF_OD,
+                                         .Pull = GPIO_PULLUP,
+                                         .Speed = GPIO_SPEED_FREQ_HIGH};
+
+    if (hi2c->Instance == I2C2) {
+
+#if (I2C2_ENABLE == 1)
+        __HAL_RCC_I2C2_CLK_ENABLE();
+
+        I2C2_SCL_GPIO_ENABLE();
+        I2C2_SDA_GPIO_ENABLE();
+
+        gpio_init_struct.Alternate = GPIO_AF4_I2C2;
+
+        gpio_init_struct.Pin = I2C2_SCL_GPIO_PIN;
+        HAL_GPIO_Init(I2C2_SCL_GPIO_PORT, &gpio_init_struct);
+
+        gpio_init_struct.Pin = I2C2_SDA_GPIO_PIN;
+        HAL_GPIO_Init(I2C2_SDA_GPIO_PORT, &gpio_init_struct);
+
+        HAL_NVIC_SetPriority(I2C2_EV_IRQn, I2C2_IT_PREEMPT, I2C2_IT_SUB);
+        HAL_NVIC_EnableIRQ(I2C2_EV_IRQn);
+        HAL_NVIC_SetPriority(I2C2_ER_IRQn, I2C2_IT_PREEMPT, I2C2_IT_SUB);
+        HAL_NVIC_EnableIRQ(I2C2_ER_IRQn);
+
+#if (I2C2_USE_DMA_RX == 1)
+        __HAL_RCC_DMA1_CLK_ENABLE();
+
+        res = HAL_DMA_Init(&i2c2_dmarx_handle);
+#ifdef DEBUG
+        assert(res == HAL_OK);
+#endif /* DEBUG */
+        __HAL_LINKDMA(hi2c, hdmarx, i2c2_dmarx_handle);
+
+        HAL_NVIC_SetPriority(DMA1_Stream2_IRQn, I2C2_DMA_IT_PREEMPT,
+                             I2C2_DMA_IT_SUB);
+        HAL_NVIC_EnableIRQ(DMA1_Stream2_IRQn);
+#endif /* I2C2_USE_DMA_RX == 1 */
+
+#endif /* I2C2_ENABLE == 1 */
+    }
+}
@@ -0,0 +1,970 @@
+/**
+ * @file    mpu9250.c
+ * @author  Deadline039
+ * @brief   MPU9250九轴传感器驱动
+ * @version 1.0
+ * @date    2026-10-17
+ * @note    AK8963挂在MPU9250的辅助I2C上, 由内部I2C主机的从机0在每次采样时
+ *          从ST1读到ST2, 放入EXT_SENS_DATA. 数据就绪时INT引脚产生外部中断,
+ *          在中断中记录时间并发送寄存器地址, 发送完成后用DMA连续读出加速度,
+ *          温度, 角速度和ST1, 读取完成后放入缓冲区. 整个过程不需要主循环参与.
+ *          读ST2后AK8963清除数据就绪, 所以ST1只在取到新数据的那次采样中
+ *          置位, 这时才接着读出磁场和ST2. 磁场为100Hz时, 1kHz采样中
+ *          九成只读15字节. 使用FIFO时每个采样固定带有ST1到ST2,
+ *          同样只在ST1置位时输出新的磁场.
+ *          使用SPI接口时读取作为高优先级事务提交到SPI总线队列,
+ *          读到的采样和I2C接口相同. INT也可以连到定时器输入捕获,
+ *          采样时间为硬件锁存的边沿时间, 在捕获中断中开始读取.
+ *          同时使用FIFO时捕获8分频, 每8个采样只有一次捕获中断,
+ *          FIFO中的采样数由边沿数得到, 不读字节数直接读出.
+ */
+
+#include "mpu9250.h"
+
+/* MPU9250寄存器 */
+#define MPU9250_SMPLRT_DIV_REG  0x19
+#define MPU9250_CONFIG          0x1A
+#define MPU9250_GYRO_CONFIG     0x1B
+#define MPU9250_ACCEL_CONFIG    0x1C
+#define MPU9250_ACCEL_CONFIG2   0x1D
+#define MPU9250_I2C_MST_CTRL    0x24
+#define MPU9250_I2C_SLV0_ADDR   0x25
+#define MPU9250_I2C_SLV0_REG    0x26
+#define MPU9250_I2C_SLV0_CTRL   0x27
+#define MPU9250_FIFO_EN         0x23
+#define MPU9250_INT_PIN_CFG     0x37
+#define MPU9250_INT_ENABLE      0x38
+#define MPU9250_ACCEL_XOUT_H    0x3B
+#define MPU9250_EXT_SENS_DATA   0x49
+#define MPU9250_I2C_SLV0_DO     0x63
+#define MPU9250_USER_CTRL       0x6A
+#define MPU9250_PWR_MGMT_1      0x6B
+#define MPU9250_FIFO_COUNTH     0x72
+#define MPU9250_FIFO_R_W        0x74
+#define MPU9250_WHO_AM_I        0x75
+
+#define MPU9250_I2C_MST_EN      0x20 /* USER_CTRL 启用内部I2C主机 */
+#define MPU9250_I2C_IF_DIS      0x10 /* USER_CTRL 关闭I2C接口, 只用SPI */
+#define MPU9250_FIFO_ENABLE     0x40 /* USER_CTRL 启用FIFO */
+#define MPU9250_FIFO_RST        0x04 /* USER_CTRL 复位FIFO */
+#define MPU9250_FIFO_MODE       0x40 /* CONFIG FIFO满后不再写入 */
+#define MPU9250_FIFO_ALL        0xF9 /* FIFO_EN 温度, 角速度, 加速度, 从机0 */
+#define MPU9250_WAIT_FOR_ES     0x40 /* I2C_MST_CTRL 外部数据读完再产生中断 */
+#define MPU9250_I2C_MST_400K    0x0D /* I2C_MST_CTRL 内部I2C 400kHz */
+#define MPU9250_SLV_EN          0x80 /* I2C_SLVx_CTRL 启用从机 */
+#define MPU9250_SLV_READ        0x80 /* I2C_SLVx_ADDR 读操作 */
+#define MPU9250_RAW_RDY_EN      0x01 /* INT_ENABLE 数据就绪中断 */
+#define MPU9250_H_RESET         0x80 /* PWR_MGMT_1 复位 */
+#define MPU9250_CLKSEL_PLL      0x01 /* PWR_MGMT_1 自动选择PLL时钟 */
+#define MPU9250_SPI_READ        0x80 /* SPI寄存器地址最高位为1时读取 */
+
+/* AK8963寄存器 */
+#define AK8963_I2C_ADDR         0x0C
+#define AK8963_WIA              0x00
+#define AK8963_ST1              0x02
+#define AK8963_HXL              0x03
+#define AK8963_CNTL1            0x0A
+#define AK8963_CNTL2            0x0B
+
+#define AK8963_WIA_VALUE        0x48
+#define AK8963_SRST             0x01 /* CNTL2 复位 */
+#define AK8963_DRDY             0x01 /* ST1 数据就绪 */
+#define AK8963_DOR              0x02 /* ST1 上一个数据没有读出就被覆盖 */
+
+/* 每次读取的长度: 加速度6, 温度2, 角速度6, ST1 1 */
+#define MPU9250_BURST_LEN       15
+/* ST1置位时再读取的长度: 磁场6, ST2 1 */
+#define MPU9250_MAG_LEN         7
+/* 一个采样的完整长度, ST1在`MPU9250_BURST_LEN - 1`处 */
+#define MPU9250_SAMPLE_LEN      (MPU9250_BURST_LEN + MPU9250_MAG_LEN)
+/* AK8963从ST1读到ST2, 读ST2后才会更新下一次数据 */
+#define AK8963_READ_LEN         8
+
+#if (MPU9250_USE_FIFO == 1)
+/* FIFO中每个采样都带有ST1到ST2, FIFO最多存放的完整采样数 */
+#define MPU9250_FIFO_MAX        (512 / MPU9250_SAMPLE_LEN)
+#define MPU9250_BUF_LEN         (MPU9250_FIFO_MAX * MPU9250_SAMPLE_LEN)
+#if (MPU9250_USE_CAPTURE == 1)
+/* 每8个数据就绪边沿捕获一次, 只锁存最后一个边沿的时间 */
+#define MPU9250_INT_DIV         8
+#define MPU9250_INT_PSC         TIM_ICPSC_DIV8
+#else  /* MPU9250_USE_CAPTURE == 1 */
+#define MPU9250_INT_DIV         1
+#endif /* MPU9250_USE_CAPTURE == 1 */
+#if (MPU9250_FIFO_BATCH % MPU9250_INT_DIV != 0)
+#error "MPU9250_FIFO_BATCH must be a multiple of the capture prescaler"
+#endif /* MPU9250_FIFO_BATCH % MPU9250_INT_DIV != 0 */
+#else  /* MPU9250_USE_FIFO == 1 */
+#define MPU9250_BUF_LEN         MPU9250_SAMPLE_LEN
+#define MPU9250_INT_PSC         TIM_ICPSC_DIV1
+#endif /* MPU9250_USE_FIFO == 1 */
+
+#if (MPU9250_USE_SPI == 1)
+/* USER_CTRL中始终保持的位 */
+#define MPU9250_USER_CTRL_BASE  (MPU9250_I2C_MST_EN | MPU9250_I2C_IF_DIS)
+#else  /* MPU9250_USE_SPI == 1 */
+#define MPU9250_USER_CTRL_BASE  MPU9250_I2C_MST_EN
+#endif /* MPU9250_USE_SPI == 1 */
+
+/* 标称采样周期(us) */
+#define MPU9250_PERIOD_US       (1000 * (1 + MPU9250_SMPLRT_DIV))
+
+/**
+ * @brief 正在进行的传输
+ */
+typedef enum {
+    MPU9250_IDLE = 0U,  /* 空闲 */
+    MPU9250_READ_DATA,  /* 直接读取一个采样 */
+    MPU9250_READ_MAG,   /* 直接读取时ST1置位, 读取磁场 */
+    MPU9250_READ_COUNT, /* 读取FIFO中的字节数 */
+    MPU9250_READ_FIFO,  /* 读取FIFO中的采样 */
+    MPU9250_RESET_FIFO  /* 复位FIFO */
+} mpu9250_state_t;
+
+static struct {
+    mpu9250_sample_t ring[MPU9250_RING_NUM]; /*!< 采样缓冲区 */
+    __IO uint32_t head;                      /*!< 写入位置, 在中断中修改 */
+    __IO uint32_t tail;                      /*!< 读取位置, 在主循环中修改 */
+
+    uint8_t buf[MPU9250_BUF_LEN]; /*!< DMA接收缓冲区 */
+#if (MPU9250_USE_SPI == 1)
+    spi_trans_t trans; /*!< SPI事务 */
+#else  /* MPU9250_USE_SPI == 1 */
+    uint8_t tx[2];   /*!< 发送的寄存器地址和数据 */
+    uint8_t *rx_buf; /*!< 接收缓冲区 */
+    uint32_t rx_len; /*!< 接收长度, 0表示写寄存器 */
+#endif /* MPU9250_USE_SPI == 1 */
+    __IO uint8_t state;           /*!< 正在进行的传输 */
+    uint8_t gap;                  /*!< 下一个采样之前有丢失 */
+    uint8_t stale;                /*!< 读取期间又产生了采样, 丢弃这次读到的 */
+    uint8_t ready;                /*!< 初始化完成 */
+    uint32_t time;                /*!< 直接读取的采样时间 */
+    int16_t mag[3];               /*!< 最近一次读到的磁场 */
+
+#if (MPU9250_USE_FIFO == 1)
+    uint32_t int_count;   /*!< 数据就绪边沿数, 即产生的采样数 */
+    uint32_t int_time;    /*!< 最近一次中断对应边沿的时间 */
+    uint32_t snap_count;  /*!< 开始读取FIFO时的边沿数 */
+    uint32_t snap_time;   /*!< 开始读取FIFO时的边沿时间 */
+    uint32_t fifo_index;  /*!< FIFO中第一个采样的序号 */
+    uint32_t fifo_num;    /*!< 正在读取的采样数 */
+    uint32_t period;      /*!< 采样周期, 单位1/256us */
+    uint8_t reset_needed; /*!< 下次读取前先复位FIFO */
+    uint8_t align;        /*!< 下次读取前先读出字节数, 对齐采样序号 */
+#endif /* MPU9250_USE_FIFO == 1 */
+
+    mpu9250_stats_t stats; /*!< 采样统计 */
+} mpu9250;
+
+#if (MPU9250_USE_SPI == 1)
+
+/**
+ * @brief 初始化SPI事务
+ *
+ * @param trans 事务
+ * @param reg 寄存器地址, 读取时最高位为1
+ * @param mode SPI时钟设置
+ */
+static void mpu9250_trans_init(spi_trans_t *trans, uint8_t reg,
+                               uint32_t mode) {
+    trans->cs_port = MPU9250_CS_GPIO_PORT;
+    trans->cs_pin = MPU9250_CS_GPIO_PIN;
+    trans->mode = mode;
+    trans->prio = SPI_BUS_PRIO_HIGH;
+    trans->cmd[0] = reg;
+    trans->cmd_len = 1;
+    trans->tx_data = NULL;
+    trans->rx_data = NULL;
+    trans->data_len = 0;
+    trans->callback = NULL;
+    trans->arg = NULL;
+    trans->state = SPI_TRANS_IDLE;
+}
+
+/**
+ * @brief 写MPU9250寄存器
+ *
+ * @param reg 寄存器地址
+ * @param value 写入的值
+ * @return 写入结果
+ *  @retval 0 成功
+ *  @retval 1 失败
+ */
+static uint8_t mpu9250_write_reg(uint8_t reg, uint8_t value) {
+    spi_trans_t trans;
+
+    mpu9250_trans_init(&trans, reg, MPU9250_SPI_MODE_SLOW);
+    trans.cmd[1] = value;
+    trans.cmd_len = 2;
+
+    return spi_bus_transfer(&MPU9250_SPI_BUS, &trans);
+}
+
+/**
+ * @brief 读MPU9250寄存器
+ *
+ * @param reg 寄存器地址
+ * @param[out] value 读出的值
+ * @return 读取结果
+ *  @retval 0 成功
+ *  @retval 1 失败
+ */
+static uint8_t mpu9250_read_reg(uint8_t reg, uint8_t *value) {
+    spi_trans_t trans;
+
+    mpu9250_trans_init(&trans, reg | MPU9250_SPI_READ, MPU9250_SPI_MODE_SLOW);
+    trans.rx_data = value;
+    trans.data_len = 1;
+
+    return spi_bus_transfer(&MPU9250_SPI_BUS, &trans);
+}
+
+#else  /* MPU9250_USE_SPI == 1 */
+
+/**
+ * @brief 写MPU9250寄存器
+ *
+ * @param reg 寄存器地址
+ * @param value 写入的值
+ * @return 写入结果
+ *  @retval 0 成功
+ *  @retval 1 失败
+ */
+static uint8_t mpu9250_write_reg(uint8_t reg, uint8_t value) {
+    return HAL_I2C_Mem_Write(&MPU9250_I2C_HANDLE, MPU9250_I2C_ADDR, reg,
+                             I2C_MEMADD_SIZE_8BIT, &value, 1,
+                             I2C_TIMEOUT) != HAL_OK;
+}
+
+/**
+ * @brief 读MPU9250寄存器
+ *
+ * @param reg 寄存器地址
+ * @param[out] value 读出的值
+ * @return 读取结果
+ *  @retval 0 成功
+ *  @retval 1 失败
+ */
+static uint8_t mpu9250_read_reg(uint8_t reg, uint8_t *value) {
+    return HAL_I2C_Mem_Read(&MPU9250_I2C_HANDLE, MPU9250_I2C_ADDR, reg,
+                            I2C_MEMADD_SIZE_8BIT, value, 1,
+                            I2C_TIMEOUT) != HAL_OK;
+}
+
+#endif /* MPU9250_USE_SPI == 1 */
+
+/**
+ * @brief 通过内部I2C主机的从机0写AK8963寄存器
+ *
+ * @param reg 寄存器地址
+ * @param value 写入的值
+ * @return 写入结果
+ *  @retval 0 成功
+ *  @retval 1 失败
+ */
+static uint8_t ak8963_write_reg(uint8_t reg, uint8_t value) {
+    uint8_t res = 0;
+
+    res |= mpu9250_write_reg(MPU9250_I2C_SLV0_ADDR, AK8963_I2C_ADDR);
+    res |= mpu9250_write_reg(MPU9250_I2C_SLV0_REG, reg);
+    res |= mpu9250_write_reg(MPU9250_I2C_SLV0_DO, value);
+    res |= mpu9250_write_reg(MPU9250_I2C_SLV0_CTRL, MPU9250_SLV_EN | 1);
+    /* 从机在下一个采样周期才执行 */
+    HAL_Delay(10);
+
+    return res;
+}
+
+/**
+ * @brief 通过内部I2C主机的从机0读AK8963寄存器
+ *
+ * @param reg 寄存器地址
+ * @param[out] value 读出的值
+ * @return 读取结果
+ *  @retval 0 成功
+ *  @retval 1 失败
+ */
+static uint8_t ak8963_read_reg(uint8_t reg, uint8_t *value) {
+    uint8_t res = 0;
+
+    res |= mpu9250_write_reg(MPU9250_I2C_SLV0_ADDR,
+                             AK8963_I2C_ADDR | MPU9250_SLV_READ);
+    res |= mpu9250_write_reg(MPU9250_I2C_SLV0_REG, reg);
+    res |= mpu9250_write_reg(MPU9250_I2C_SLV0_CTRL, MPU9250_SLV_EN | 1);
+    HAL_Delay(10);
+    res |= mpu9250_read_reg(MPU9250_EXT_SENS_DATA, value);
+
+    return res;
+}
+
+#if (MPU9250_USE_CAPTURE == 0)
+
+/**
+ * @brief 获取当前时间
+ *
+ * @return 时间(us), 由SysTick计算
+ * @note 在中断中调用时SysTick中断可能还没有处理, 根据挂起标志补上
+ */
+static uint32_t mpu9250_get_time(void) {
+    uint32_t load = SysTick->LOAD + 1;
+    uint32_t ms, val, pending;
+
+    do {
+        ms = HAL_GetTick();
+        val = SysTick->VAL;
+        pending = SCB->ICSR & SCB_ICSR_PENDSTSET_Msk;
+    } while (ms != HAL_GetTick());
+
+    /* 已经重装但计数还没有加上 */
+    if (pending && (val > load / 2)) {
+        ms++;
+    }
+
+    return ms * 1000 + (load - 1 - val) / (load / 1000);
+}
+
+#elif (MPU9250_USE_FIFO == 1)
+
+/**
+ * @brief 获取当前时间
+ *
+ * @return 时间(us), 与捕获的边沿时间相同
+ */
+static uint32_t mpu9250_get_time(void) {
+    return timer_ts_now();
+}
+
+#endif /* MPU9250_USE_CAPTURE == 0 */
+
+/**
+ * @brief 初始化MPU9250和AK8963, 开始采样
+ *
+ * @return 初始化结果
+ *  @retval 0 成功
+ *  @retval 1 MPU9250或AK8963没有响应
+ * @note 需要先初始化I2C或SPI总线. 初始化时阻塞读写寄存器,
+ *       之后的采样由中断完成
+ */
+uint8_t mpu9250_init(void) {
+#if (MPU9250_USE_CAPTURE == 1)
+    GPIO_InitTypeDef gpio_init_struct = {.Pin = MPU9250_INT_GPIO_PIN,
+                                         .Mode = GPIO_MODE_AF_PP,
+                                         .Pull = GPIO_PULLDOWN,
+                                         .Speed = GPIO_SPEED_FREQ_HIGH,
+                                         .Alternate = MPU9250_INT_GPIO_AF};
+#else  /* MPU9250_USE_CAPTURE == 1 */
+    GPIO_InitTypeDef gpio_init_struct = {.Pin = MPU9250_INT_GPIO_PIN,
+                                         .Mode = GPIO_MODE_IT_RISING,
+                                         .Pull = GPIO_PULLDOWN,
+                                         .Speed = GPIO_SPEED_FREQ_HIGH};
+#endif /* MPU9250_USE_CAPTURE == 1 */
+    uint8_t res = 0;
+    uint8_t id;
+
+#if (MPU9250_USE_SPI == 1)
+    GPIO_InitTypeDef cs_init_struct = {.Pin = MPU9250_CS_GPIO_PIN,
+                                       .Mode = GPIO_MODE_OUTPUT_PP,
+                                       .Pull = GPIO_PULLUP,
+                                       .Speed = GPIO_SPEED_FREQ_HIGH};
+
+    MPU9250_CS_GPIO_ENABLE();
+    HAL_GPIO_Init(MPU9250_CS_GPIO_PORT, &cs_init_struct);
+    HAL_GPIO_WritePin(MPU9250_CS_GPIO_PORT, MPU9250_CS_GPIO_PIN, GPIO_PIN_SET);
+
+    /* 先关闭I2C接口, 避免SPI通信被当成I2C */
+    mpu9250_write_reg(MPU9250_USER_CTRL, MPU9250_I2C_IF_DIS);
+#endif /* MPU9250_USE_SPI == 1 */
+
+    if (mpu9250_read_reg(MPU9250_WHO_AM_I, &id) != 0) {
+        return 1;
+    }
+    /* MPU9255为0x73 */
+    if ((id != 0x71) && (id != 0x73)) {
+        return 1;
+    }
+
+    mpu9250_write_reg(MPU9250_PWR_MGMT_1, MPU9250_H_RESET);
+    HAL_Delay(100);
+
+    res |= mpu9250_write_reg(MPU9250_PWR_MGMT_1, MPU9250_CLKSEL_PLL);
+    /* 复位后重新关闭I2C接口, 启用内部I2C主机 */
+    res |= mpu9250_write_reg(MPU9250_USER_CTRL, MPU9250_USER_CTRL_BASE);
+#if (MPU9250_USE_FIFO == 1)
+    res |= mpu9250_write_reg(MPU9250_CONFIG, MPU9250_FIFO_MODE | MPU9250_DLPF);
+#else  /* MPU9250_USE_FIFO == 1 */
+    res |= mpu9250_write_reg(MPU9250_CONFIG, MPU9250_DLPF);
+#endif /* MPU9250_USE_FIFO == 1 */
+    res |= mpu9250_write_reg(MPU9250_SMPLRT_DIV_REG, MPU9250_SMPLRT_DIV);
+    res |= mpu9250_write_reg(MPU9250_GYRO_CONFIG, MPU9250_GYRO_FS << 3);
+    res |= mpu9250_write_reg(MPU9250_ACCEL_CONFIG, MPU9250_ACCEL_FS << 3);
+    res |= mpu9250_write_reg(MPU9250_ACCEL_CONFIG2, MPU9250_DLPF);
+
+    /* 外部数据读完再产生数据就绪中断 */
+    res |= mpu9250_write_reg(MPU9250_I2C_MST_CTRL,
+                             MPU9250_WAIT_FOR_ES | MPU9250_I2C_MST_400K);
+    if (res != 0) {
+        return 1;
+    }
+
+    ak8963_write_reg(AK8963_CNTL2, AK8963_SRST);
+    if ((ak8963_read_reg(AK8963_WIA, &id) != 0) || (id != AK8963_WIA_VALUE)) {
+        return 1;
+    }
+    res |= ak8963_write_reg(AK8963_CNTL1, MPU9250_MAG_MODE);
+
+    /* 从机0每次采样从ST1读到ST2, 放在EXT_SENS_DATA_00开始的位置,
+     * 紧跟在角速度之后 */
+    res |= mpu9250_write_reg(MPU9250_I2C_SLV0_ADDR,
+                             AK8963_I2C_ADDR | MPU9250_SLV_READ);
+    res |= mpu9250_write_reg(MPU9250_I2C_SLV0_REG, AK8963_ST1);
+    res |= mpu9250_write_reg(MPU9250_I2C_SLV0_CTRL,
+                             MPU9250_SLV_EN | AK8963_READ_LEN);
+
+#if (MPU9250_USE_FIFO == 1)
+    /* 采样按寄存器顺序写入FIFO, 和直接读取的格式相同 */
+    res |= mpu9250_write_reg(MPU9250_FIFO_EN, MPU9250_FIFO_ALL);
+    res |= mpu9250_write_reg(MPU9250_USER_CTRL, MPU9250_USER_CTRL_BASE |
+                                                    MPU9250_FIFO_ENABLE |
+                                                    MPU9250_FIFO_RST);
+    mpu9250.period = MPU9250_PERIOD_US << 8;
+    mpu9250.align = 1;
+#endif /* MPU9250_USE_FIFO == 1 */
+
+    /* INT高电平有效, 推挽输出, 50us脉冲 */
+    res |= mpu9250_write_reg(MPU9250_INT_PIN_CFG, 0x00);
+    res |= mpu9250_write_reg(MPU9250_INT_ENABLE, MPU9250_RAW_RDY_EN);
+    if (res != 0) {
+        return 1;
+    }
+
+    mpu9250.ready = 1;
+
+    MPU9250_INT_GPIO_ENABLE();
+    HAL_GPIO_Init(MPU9250_INT_GPIO_PORT, &gpio_init_struct);
+#if (MPU9250_USE_CAPTURE == 1)
+    timer_ts_capture_start(TIM_ICPOLARITY_RISING, MPU9250_INT_PSC);
+#else  /* MPU9250_USE_CAPTURE == 1 */
+    HAL_NVIC_SetPriority(MPU9250_INT_IRQn, MPU9250_INT_IT_PREEMPT,
+                         MPU9250_INT_IT_SUB);
+    HAL_NVIC_EnableIRQ(MPU9250_INT_IRQn);
+#endif /* MPU9250_USE_CAPTURE == 1 */
+
+    return 0;
+}
+
+/**
+ * @brief 从缓冲区取出一个采样
+ *
+ * @param[out] sample 采样
+ * @return 读取结果
+ *  @retval 0 成功
+ *  @retval 1 缓冲区为空
+ */
+uint8_t mpu9250_read(mpu9250_sample_t *sample) {
+    uint32_t tail = mpu9250.tail;
+
+    if (tail == mpu9250.head) {
+        return 1;
+    }
+
+    *sample = mpu9250.ring[tail % MPU9250_RING_NUM];
+    mpu9250.tail = tail + 1;
+
+    return 0;
+}
+
+/**
+ * @brief 获取采样统计
+ *
+ * @param[out] stats 统计数据
+ */
+void mpu9250_get_stats(mpu9250_stats_t *stats) {
+    uint32_t primask = __get_PRIMASK();
+
+    __disable_irq();
+    *stats = mpu9250.stats;
+    __set_PRIMASK(primask);
+}
+
+/**
+ * @brief 解析一个采样, 放入采样缓冲区
+ *
+ * @param buf 采样数据, 和寄存器的顺序相同. ST1没有置位时磁场和ST2无效
+ * @param time 采样时间(us)
+ * @note 缓冲区满时丢弃的采样中的磁场仍然保留, 作为之后采样的磁场
+ */
+static void mpu9250_push(const uint8_t *buf, uint32_t time) {
+    mpu9250_sample_t *sample;
+    uint32_t head = mpu9250.head;
+    uint8_t st1 = buf[MPU9250_BURST_LEN - 1];
+    uint16_t flags = 0;
+
+    if (st1 & AK8963_DRDY) {
+        /* AK8963低字节在前 */
+        for (uint32_t i = 0; i < 3; ++i) {
+            mpu9250.mag[i] = (int16_t)((buf[16 + i * 2] << 8) |
+                                       buf[15 + i * 2]);
+        }
+        mpu9250.stats.mag++;
+        flags |= MPU9250_FLAG_MAG;
+        if (st1 & AK8963_DOR) {
+            mpu9250.stats.mag_lost++;
+            flags |= MPU9250_FLAG_MAG_GAP;
+        }
+    }
+
+    mpu9250.stats.samples++;
+    if (head - mpu9250.tail >= MPU9250_RING_NUM) {
+        mpu9250.stats.dropped++;
+        mpu9250.gap = 1;
+        return;
+    }
+
+    sample = &mpu9250.ring[head % MPU9250_RING_NUM];
+    sample->time = time;
+    sample->flags = mpu9250.gap ? (flags | MPU9250_FLAG_GAP) : flags;
+    mpu9250.gap = 0;
+    /* MPU9250高字节在前 */
+    for (uint32_t i = 0; i < 3; ++i) {
+        sample->accel[i] = (int16_t)((buf[i * 2] << 8) | buf[i * 2 + 1]);
+        sample->gyro[i] = (int16_t)((buf[8 + i * 2] << 8) | buf[9 + i * 2]);
+    }
+    sample->temp = (int16_t)((buf[6] << 8) | buf[7]);
+    for (uint32_t i = 0; i < 3; ++i) {
+        sample->mag[i] = mpu9250.mag[i];
+    }
+
+    mpu9250.head = head + 1;
+}
+
+static void mpu9250_xfer_done(void);
+static void mpu9250_xfer_error(void);
+
+#if (MPU9250_USE_SPI == 1)
+
+/**
+ * @brief SPI事务完成回调
+ *
+ * @param trans 事务
+ */
+static void mpu9250_trans_done(spi_trans_t *trans) {
+    if (trans->state == SPI_TRANS_DONE) {
+        mpu9250_xfer_done();
+    } else {
+        mpu9250_xfer_error();
+    }
+}
+
+/**
+ * @brief 开始读取寄存器, 完成后调用`mpu9250_xfer_done`
+ *
+ * @param reg 起始寄存器
+ * @param buf 接收缓冲区
+ * @param len 读取长度
+ * @return 开始结果
+ *  @retval 0 成功
+ *  @retval 1 事务还没有结束
+ * @note 以高优先级提交到总线队列, 数据较长时用DMA读取
+ */
+static uint8_t mpu9250_xfer_read(uint8_t reg, uint8_t *buf, uint32_t len) {
+    mpu9250_trans_init(&mpu9250.trans, reg | MPU9250_SPI_READ,
+                       MPU9250_SPI_MODE_FAST);
+    mpu9250.trans.rx_data = buf;
+    mpu9250.trans.data_len = (uint16_t)len;
+    mpu9250.trans.callback = mpu9250_trans_done;
+    mpu9250.stats.reads++;
+
+    return spi_bus_submit(&MPU9250_SPI_BUS, &mpu9250.trans);
+}
+
+#if (MPU9250_USE_FIFO == 1)
+
+/**
+ * @brief 开始写寄存器, 完成后调用`mpu9250_xfer_done`
+ *
+ * @param reg 寄存器地址
+ * @param value 写入的值
+ * @return 开始结果
+ *  @retval 0 成功
+ *  @retval 1 事务还没有结束
+ */
+static uint8_t mpu9250_xfer_write(uint8_t reg, uint8_t value) {
+    mpu9250_trans_init(&mpu9250.trans, reg, MPU9250_SPI_MODE_SLOW);
+    mpu9250.trans.cmd[1] = value;
+    mpu9250.trans.cmd_len = 2;
+    mpu9250.trans.callback = mpu9250_trans_done;
+
+    return spi_bus_submit(&MPU9250_SPI_BUS, &mpu9250.trans);
+}
+
+#endif /* MPU9250_USE_FIFO == 1 */
+
+#else  /* MPU9250_USE_SPI == 1 */
+
+/**
+ * @brief 开始读取寄存器, 完成后调用`mpu9250_xfer_done`
+ *
+ * @param reg 起始寄存器
+ * @param buf 接收缓冲区
+ * @param len 读取长度
+ * @return 开始结果
+ *  @retval 0 成功
+ *  @retval 1 总线忙或错误
+ * @note 先发送寄存器地址, 不产生停止位, 发送完成后重复起始用DMA读取
+ */
+static uint8_t mpu9250_xfer_read(uint8_t reg, uint8_t *buf, uint32_t len) {
+    mpu9250.tx[0] = reg;
+    mpu9250.rx_buf = buf;
+    mpu9250.rx_len = len;
+    mpu9250.stats.reads++;
+
+    return HAL_I2C_Master_Seq_Transmit_IT(&MPU9250_I2C_HANDLE,
+                                          MPU9250_I2C_ADDR, mpu9250.tx, 1,
+                                          I2C_FIRST_FRAME) != HAL_OK;
+}
+
+#if (MPU9250_USE_FIFO == 1)
+
+/**
+ * @brief 开始写寄存器, 完成后调用`mpu9250_xfer_done`
+ *
+ * @param reg 寄存器地址
+ * @param value 写入的值
+ * @return 开始结果
+ *  @retval 0 成功
+ *  @retval 1 总线忙或错误
+ */
+static uint8_t mpu9250_xfer_write(uint8_t reg, uint8_t value) {
+    mpu9250.tx[0] = reg;
+    mpu9250.tx[1] = value;
+    mpu9250.rx_len = 0;
+
+    return HAL_I2C_Master_Transmit_IT(&MPU9250_I2C_HANDLE, MPU9250_I2C_ADDR,
+                                      mpu9250.tx, 2) != HAL_OK;
+}
+
+#endif /* MPU9250_USE_FIFO == 1 */
+
+#endif /* MPU9250_USE_SPI == 1 */
+
+/**
+ * @brief 传输失败, 回到空闲
+ *
+ */
+static void mpu9250_xfer_error(void) {
+    mpu9250.stats.errors++;
+
+#if (MPU9250_USE_FIFO == 1)
+    /* FIFO读到一半时不知道下一个采样从哪里开始, 复位后重新对齐 */
+    if ((mpu9250.state == MPU9250_READ_FIFO) ||
+        (mpu9250.state == MPU9250_RESET_FIFO)) {
+        mpu9250.reset_needed = 1;
+        mpu9250.gap = 1;
+    }
+#else  /* MPU9250_USE_FIFO == 1 */
+    mpu9250.gap = 1;
+    mpu9250.stale = 0;
+#endif /* MPU9250_USE_FIFO == 1 */
+
+    mpu9250.state = MPU9250_IDLE;
+}
+
+#if (MPU9250_USE_FIFO == 1)
+
+/**
+ * @brief 读出FIFO中的`fifo_num`个采样
+ *
+ */
+static void mpu9250_fifo_read(void) {
+    if (mpu9250.fifo_num == 0) {
+        mpu9250.state = MPU9250_IDLE;
+        return;
+    }
+
+    mpu9250.state = MPU9250_READ_FIFO;
+    if (mpu9250_xfer_read(MPU9250_FIFO_R_W, mpu9250.buf,
+                          mpu9250.fifo_num * MPU9250_SAMPLE_LEN) != 0) {
+        mpu9250_xfer_error();
+    }
+}
+
+/**
+ * @brief 开始一次FIFO读取
+ *
+ * @note FIFO中的采样数由边沿数得到, 直接读出. 刚启动或复位FIFO后
+ *       先读取FIFO中的字节数, 对齐采样序号
+ */
+static void mpu9250_fifo_start(void) {
+    uint32_t count = mpu9250.int_count - mpu9250.snap_count;
+    uint32_t time = mpu9250.int_time - mpu9250.snap_time;
+
+    if (mpu9250.reset_needed) {
+        mpu9250.state = MPU9250_RESET_FIFO;
+        if (mpu9250_xfer_write(MPU9250_USER_CTRL,
+                               MPU9250_USER_CTRL_BASE | MPU9250_FIFO_ENABLE |
+                                   MPU9250_FIFO_RST) != 0) {
+            mpu9250_xfer_error();
+        }
+        return;
+    }
+
+    /* 用两次读取之间的中断次数和时间修正采样周期, 平滑抖动 */
+    if ((mpu9250.snap_count != 0) && (count != 0) && (time < (1 << 23))) {
+        int32_t period = (int32_t)((time << 8) / count);
+        mpu9250.period += (period - (int32_t)mpu9250.period) / 8;
+    }
+    mpu9250.snap_count = mpu9250.int_count;
+    mpu9250.snap_time = mpu9250.int_time;
+
+    if (mpu9250.align) {
+        mpu9250.state = MPU9250_READ_COUNT;
+        if (mpu9250_xfer_read(MPU9250_FIFO_COUNTH, mpu9250.buf, 2) != 0) {
+            mpu9250_xfer_error();
+        }
+        return;
+    }
+
+    mpu9250.fifo_num = mpu9250.snap_count - mpu9250.fifo_index;
+    if (mpu9250.fifo_num > MPU9250_FIFO_MAX) {
+        /* 上次读取推迟太久, FIFO已经写满 */
+        mpu9250.stats.overflow++;
+        mpu9250.gap = 1;
+        mpu9250.reset_needed = 1;
+        mpu9250_fifo_start();
+        return;
+    }
+    mpu9250_fifo_read();
+}
+
+/**
+ * @brief 解析从FIFO读出的采样
+ *
+ * @note 每个采样对应一个数据就绪边沿, 开始读取时最近一次中断对应序号为
+ *       `snap_count - 1`的采样, 按采样周期推算其他采样的时间
+ */
+static void mpu9250_fifo_push(void) {
+    int32_t offset;
+
+    for (uint32_t i = 0; i < mpu9250.fifo_num; ++i) {
+        offset = (int32_t)(mpu9250.fifo_index + i - (mpu9250.snap_count - 1));
+        mpu9250_push(&mpu9250.buf[i * MPU9250_SAMPLE_LEN],
+                     mpu9250.snap_time +
+                         offset * (int32_t)mpu9250.period / 256);
+    }
+    mpu9250.fifo_index += mpu9250.fifo_num;
+}
+
+#endif /* MPU9250_USE_FIFO == 1 */
+
+/**
+ * @brief 一段传输完成, 开始下一段或回到空闲
+ *
+ */
+static void mpu9250_xfer_done(void) {
+    switch (mpu9250.state) {
+        case MPU9250_READ_DATA: {
+            if (mpu9250.stale) {
+                mpu9250.stale = 0;
+                mpu9250.gap = 1;
+                break;
+            }
+            /* 新的磁场在下一次采样时才会被从机0覆盖, 不会读到下一个磁场 */
+            if (mpu9250.buf[MPU9250_BURST_LEN - 1] & AK8963_DRDY) {
+                mpu9250.state = MPU9250_READ_MAG;
+                if (mpu9250_xfer_read(MPU9250_EXT_SENS_DATA + 1,
+                                      &mpu9250.buf[MPU9250_BURST_LEN],
+                                      MPU9250_MAG_LEN) != 0) {
+                    mpu9250_xfer_error();
+                }
+                return;
+            }
+            mpu9250_push(mpu9250.buf, mpu9250.time);
+        } break;
+
+        case MPU9250_READ_MAG: {
+            if (mpu9250.stale) {
+                mpu9250.stale = 0;
+                mpu9250.gap = 1;
+                break;
+            }
+            mpu9250_push(mpu9250.buf, mpu9250.time);
+        } break;
+
+#if (MPU9250_USE_FIFO == 1)
+        case MPU9250_READ_COUNT: {
+            uint32_t count = ((mpu9250.buf[0] << 8) | mpu9250.buf[1]) & 0x1FFF;
+
+            if (count > MPU9250_BUF_LEN) {
+                /* FIFO满后最后一个采样可能不完整, 之后的采样也不再写入 */
+                mpu9250.stats.overflow++;
+                mpu9250.gap = 1;
+                mpu9250.reset_needed = 1;
+                mpu9250_fifo_start();
+                return;
+            }
+
+            /* 捕获分频时不知道FIFO中第一个采样的序号. 捕获中断后立即
+             * 读出的字节数只含到`snap_count - 1`为止的采样, 以此对齐.
+             * 读取推迟到下一个采样之后时可能多算, 留到下次再对齐 */
+            if (mpu9250_get_time() - mpu9250.snap_time >=
+                MPU9250_PERIOD_US / 2) {
+                break;
+            }
+            mpu9250.fifo_num = count / MPU9250_SAMPLE_LEN;
+            mpu9250.fifo_index = mpu9250.snap_count - mpu9250.fifo_num;
+            mpu9250.align = 0;
+            mpu9250_fifo_read();
+            return;
+        }
+
+        case MPU9250_READ_FIFO: {
+            mpu9250_fifo_push();
+            /* 读取推迟太久时FIFO在开始读取之后才写满, 读出的数据看不出.
+             * 由边沿数得到读出前FIFO中的采样数, 超过容量时之后的采样
+             * 没有写入, 最后一个可能不完整. 已经读出的采样不受影响 */
+            if (mpu9250.int_count - mpu9250.fifo_index + mpu9250.fifo_num >
+                MPU9250_FIFO_MAX) {
+                mpu9250.stats.overflow++;
+                mpu9250.gap = 1;
+                mpu9250.reset_needed = 1;
+            }
+        } break;
+
+        case MPU9250_RESET_FIFO: {
+            /* 捕获分频时复位时刻在两次中断之间, 下次读取时重新对齐 */
+            mpu9250.align = 1;
+            mpu9250.reset_needed = 0;
+        } break;
+#endif /* MPU9250_USE_FIFO == 1 */
+
+        default: {
+        } break;
+    }
+
+    mpu9250.state = MPU9250_IDLE;
+}
+
+/**
+ * @brief 数据就绪, 开始读取
+ *
+ * @param time 数据就绪的时间(us)
+ * @note 使用FIFO时只记录边沿数和时间, 每隔几个采样读一次FIFO.
+ *       捕获分频时每次中断对应8个边沿
+ */
+static void mpu9250_int(uint32_t time) {
+    if (!mpu9250.ready) {
+        return;
+    }
+
+#if (MPU9250_USE_FIFO == 1)
+    mpu9250.int_count += MPU9250_INT_DIV;
+    mpu9250.int_time = time;
+
+    /* 上次读取还没完成时采样留在FIFO中, 下次一起读出 */
+    if ((mpu9250.int_count - mpu9250.snap_count >= MPU9250_FIFO_BATCH) &&
+        (mpu9250.state == MPU9250_IDLE)) {
+        mpu9250_fifo_start();
+    }
+#else  /* MPU9250_USE_FIFO == 1 */
+    /* 正在读取的数据可能已经是这个新的采样, 和记录的时间对不上,
+     * 读完后丢弃, 在下一个采样上标记丢失 */
+    if (mpu9250.state != MPU9250_IDLE) {
+        mpu9250.stats.overrun++;
+        mpu9250.stale = 1;
+        return;
+    }
+
+    mpu9250.time = time;
+    mpu9250.state = MPU9250_READ_DATA;
+    if (mpu9250_xfer_read(MPU9250_ACCEL_XOUT_H, mpu9250.buf,
+                          MPU9250_BURST_LEN) != 0) {
+        mpu9250_xfer_error();
+    }
+#endif /* MPU9250_USE_FIFO == 1 */
+}
+
+#if (MPU9250_USE_CAPTURE == 1)
+
+/**
+ * @brief INT输入捕获回调
+ *
+ * @param time 边沿的时间(us)
+ */
+void timer_ts_capture_callback(uint32_t time) {
+    mpu9250_int(time);
+}
+
+#else  /* MPU9250_USE_CAPTURE == 1 */
+
+/**
+ * @brief INT外部中断服务函数
+ *
+ */
+void MPU9250_INT_IRQHandler(void) {
+    HAL_GPIO_EXTI_IRQHandler(MPU9250_INT_GPIO_PIN);
+}
+
+/**
+ * @brief 外部中断回调
+ *
+ * @param pin 中断引脚
+ */
+void HAL_GPIO_EXTI_Callback(uint16_t pin) {
+    if (pin == MPU9250_INT_GPIO_PIN) {
+        mpu9250_int(mpu9250_get_time());
+    }
+}
+
+#endif /* MPU9250_USE_CAPTURE == 1 */
+
+#if (MPU9250_USE_SPI == 0)
+
+/**
+ * @brief I2C发送完成回调, 读寄存器时开始DMA读取
+ *
+ * @param hi2c I2C句柄
+ */
+void HAL_I2C_MasterTxCpltCallback(I2C_HandleTypeDef *hi2c) {
+    if (hi2c != &MPU9250_I2C_HANDLE) {
+        return;
+    }
+
+    if (mpu9250.rx_len == 0) {
+        mpu9250_xfer_done();
+        return;
+    }
+
+    if (HAL_I2C_Master_Seq_Receive_DMA(hi2c, MPU9250_I2C_ADDR, mpu9250.rx_buf,
+                                       mpu9250.rx_len,
+                                       I2C_LAST_FRAME) != HAL_OK) {
+        mpu9250_xfer_error();
+    }
+}
+
+/**
+ * @brief I2C接收完成回调
+ *
+ * @param hi2c I2C句柄
+ */
+void HAL_I2C_MasterRxCpltCallback(I2C_HandleTypeDef *hi2c) {
+    if (hi2c != &MPU9250_I2C_HANDLE) {
+        return;
+    }
+
+    mpu9250_xfer_done();
+}
+
+/**
+ * @brief I2C错误回调
+ *
+ * @param hi2c I2C句柄
+ */
+void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c) {
+    if (hi2c != &MPU9250_I2C_HANDLE) {
+        return;
+    }
+
+    mpu9250_xfer_error();
+}
+
+#endif /* MPU9250_USE_SPI == 0 */
@@ -0,0 +1,277 @@
+/**
+ * @file    pack.c
+ * @author  Deadline039
+ * @brief   多列int16数据的差分位压缩
+ * @version 1.0
+ * @date    2026-10-17
+ * @note    编码时每列先扫描一遍求两种预测的最大残差和二阶差分编码的总位数,
+ *          选占用最少的, 再扫描一遍写出. 残差在32位中计算, 解码时按相同的
+ *          预测逐个还原, 结果逐位一致
+ */
+
+#include "pack.h"
+#include "dod.h"
+
+/* 列头中的字段 */
+#define PACK_ORDER_POS   5
+#define PACK_WIDTH_MASK  0x1F
+
+/* 按二阶差分变长编码的列 */
+#define PACK_ORDER_DOD   3
+
+/**
+ * @brief 位写入器
+ */
+typedef struct {
+    uint8_t *out;  /*!< 输出 */
+    uint32_t pos;  /*!< 已写入的字节数 */
+    uint32_t acc;  /*!< 还未写出的位 */
+    uint32_t bits; /*!< acc中的位数 */
+} pack_writer_t;
+
+/**
+ * @brief 位读取器
+ */
+typedef struct {
+    const uint8_t *in; /*!< 输入 */
+    uint32_t pos;      /*!< 已读取的字节数 */
+    uint32_t len;      /*!< 输入长度 */
+    uint32_t acc;      /*!< 还未取出的位 */
+    uint32_t bits;     /*!< acc中的位数 */
+} pack_reader_t;
+
+/**
+ * @brief 有符号数映射为无符号数, 绝对值小的映射为小的数
+ *
+ * @param r 残差
+ * @return 0, -1, 1, -2, 2...依次映射为0, 1, 2, 3, 4...
+ */
+static inline uint32_t pack_zigzag(int32_t r) {
+    return ((uint32_t)r << 1) ^ (uint32_t)(r >> 31);
+}
+
+/**
+ * @brief zigzag的逆映射
+ *
+ * @param z 无符号数
+ * @return 残差
+ */
+static inline int32_t pack_unzigzag(uint32_t z) {
+    return (int32_t)(z >> 1) ^ -(int32_t)(z & 1);
+}
+
+/**
+ * @brief 表示一个无符号数需要的位数
+ *
+ * @param v 无符号数
+ * @return 位数, 0需要0位
+ */
+static inline uint32_t pack_width(uint32_t v) {
+    uint32_t width = 0;
+
+    for (; v != 0; v >>= 1) {
+        width++;
+    }
+
+    return width;
+}
+
+/**
+ * @brief 计算预测残差
+ *
+ * @param col 列
+ * @param i 序号, 不小于1
+ * @param order 预测阶数, 1或2
+ * @return 残差
+ */
+static inline int32_t pack_residual(const int16_t *col, uint32_t i,
+                                    uint32_t order) {
+    if ((order == 1) || (i == 1)) {
+        return (int32_t)col[i] - col[i - 1];
+    }
+
+    return (int32_t)col[i] - 2 * (int32_t)col[i - 1] + col[i - 2];
+}
+
+/**
+ * @brief 编码
+ *
+ * @param data 数据, 第c列第i个值为data[c * stride + i]
+ * @param stride 每列的间隔
+ * @param col_num 列数
+ * @param num 每列的值数, 不为0
+ * @param[out] out 输出
+ * @param size 输出缓冲区大小
+ * @return 编码后的长度, 0表示缓冲区放不下
+ */
+uint32_t pack_encode(const int16_t *data, uint32_t stride, uint32_t col_num,
+                     uint32_t num, uint8_t *out, uint32_t size) {
+    pack_writer_t w = {.out = out, .pos = col_num * PACK_COLUMN_HDR_SIZE};
+    uint32_t total = 0, dod_total = 0;
+    dod_t dod;
+
+    if (w.pos > size) {
+        return 0;
+    }
+
+    /* 先选出每列的预测阶数和位宽写入列头, 确认放得下再写残差 */
+    for (uint32_t c = 0; c < col_num; ++c) {
+        const int16_t *col = &data[c * stride];
+        uint32_t max1 = 0, max2 = 0, bits = 0;
+        uint32_t w1, w2, order, width;
+
+        /* 第二个值的二阶残差就是与第一个值的差, 和时间戳编码的规则相同 */
+        for (uint32_t i = 1; i < num; ++i) {
+            max1 |= pack_zigzag(pack_residual(col, i, 1));
+            max2 |= pack_zigzag(pack_residual(col, i, 2));
+            bits += dod_bits(pack_residual(col, i, 2));
+        }
+        w1 = pack_width(max1);
+        w2 = pack_width(max2);
+
+        order = (w2 < w1) ? 2 : 1;
+        width = (w2 < w1) ? w2 : w1;
+
+        /* 变长编码单独按字节对齐存放 */
+        if ((bits + 7) / 8 * 8 < width * (num - 1)) {
+            order = PACK_ORDER_DOD;
+            width = 0;
+            dod_total += (bits + 7) / 8;
+        }
+        total += width * (num - 1);
+
+        out[c * PACK_COLUMN_HDR_SIZE] =
+            (uint8_t)((order << PACK_ORDER_POS) | width);
+        out[c * PACK_COLUMN_HDR_SIZE + 1] = (uint8_t)((uint16_t)col[0]);
+        out[c * PACK_COLUMN_HDR_SIZE + 2] = (uint8_t)((uint16_t)col[0] >> 8);
+    }
+
+    if (w.pos + (total + 7) / 8 + dod_total > size) {
+        return 0;
+    }
+
+    for (uint32_t c = 0; c < col_num; ++c) {
+        const int16_t *col = &data[c * stride];
+        uint32_t order = out[c * PACK_COLUMN_HDR_SIZE] >> PACK_ORDER_POS;
+        uint32_t width = out[c * PACK_COLUMN_HDR_SIZE] & PACK_WIDTH_MASK;
+
+        if (width == 0) {
+            continue;
+        }
+
+        for (uint32_t i = 1; i < num; ++i) {
+            w.acc |= pack_zigzag(pack_residual(col, i, order)) << w.bits;
+            w.bits += width;
+            while (w.bits >= 8) {
+                w.out[w.pos++] = (uint8_t)w.acc;
+                w.acc >>= 8;
+                w.bits -= 8;
+            }
+        }
+    }
+
+    if (w.bits != 0) {
+        w.out[w.pos++] = (uint8_t)w.acc;
+    }
+
+    /* 数值先转为32位, 差分与残差相同 */
+    for (uint32_t c = 0; c < col_num; ++c) {
+        const int16_t *col = &data[c * stride];
+
+        if ((out[c * PACK_COLUMN_HDR_SIZE] >> PACK_ORDER_POS) !=
+            PACK_ORDER_DOD) {
+            continue;
+        }
+
+        dod_init(&dod, (uint32_t)(int32_t)col[0]);
+        dod_set_buffer(&dod, &w.out[w.pos], size - w.pos);
+        for (uint32_t i = 1; i < num; ++i) {
+            dod_put(&dod, (uint32_t)(int32_t)col[i]);
+        }
+        w.pos += dod_size(&dod);
+    }
+
+    return w.pos;
+}
+
+/**
+ * @brief 解码
+ *
+ * @param in 编码后的数据
+ * @param len 数据长度
+ * @param[out] data 数据, 第c列第i个值为data[c * stride + i]
+ * @param stride 每列的间隔
+ * @param col_num 列数, 和编码时相同
+ * @param num 每列的值数, 和编码时相同
+ * @return 解码结果
+ *  @retval 0 成功
+ *  @retval 1 数据不完整或列头错误
+ */
+uint8_t pack_decode(const uint8_t *in, uint32_t len, int16_t *data,
+                    uint32_t stride, uint32_t col_num, uint32_t num) {
+    pack_reader_t r = {.in = in, .pos = col_num * PACK_COLUMN_HDR_SIZE,
+                       .len = len};
+    uint32_t time;
+    dod_t dod;
+
+    if (r.pos > len) {
+        return 1;
+    }
+
+    for (uint32_t c = 0; c < col_num; ++c) {
+        const uint8_t *hdr = &in[c * PACK_COLUMN_HDR_SIZE];
+        uint32_t order = hdr[0] >> PACK_ORDER_POS;
+        uint32_t width = hdr[0] & PACK_WIDTH_MASK;
+        uint32_t mask = (1U << width) - 1;
+        int16_t *col = &data[c * stride];
+
+        if ((order < 1) || (order > PACK_ORDER_DOD) || (width > 18)) {
+            return 1;
+        }
+
+        col[0] = (int16_t)(hdr[1] | (hdr[2] << 8));
+        if (order == PACK_ORDER_DOD) {
+            continue;
+        }
+        for (uint32_t i = 1; i < num; ++i) {
+            int32_t pred;
+
+            while (r.bits < width) {
+                if (r.pos >= r.len) {
+                    return 1;
+                }
+                r.acc |= (uint32_t)r.in[r.pos++] << r.bits;
+                r.bits += 8;
+            }
+
+            pred = ((order == 1) || (i == 1))
+                       ? col[i - 1]
+                       : 2 * (int32_t)col[i - 1] - col[i - 2];
+            col[i] = (int16_t)(pred + pack_unzigzag(r.acc & mask));
+            r.acc >>= width;
+            r.bits -= width;
+        }
+    }
+
+    /* 读取器只在需要时取字节, 定长部分之后就是变长编码 */
+    for (uint32_t c = 0; c < col_num; ++c) {
+        int16_t *col = &data[c * stride];
+
+        if ((in[c * PACK_COLUMN_HDR_SIZE] >> PACK_ORDER_POS) !=
+            PACK_ORDER_DOD) {
+            continue;
+        }
+
+        dod_init(&dod, (uint32_t)(int32_t)col[0]);
+        dod_set_buffer(&dod, (void *)&in[r.pos], len - r.pos);
+        for (uint32_t i = 1; i < num; ++i) {
+            if (dod_get(&dod, &time) != 0) {
+                return 1;
+            }
+            col[i] = (int16_t)time;
+        }
+        r.pos += dod_size(&dod);
+    }
+
+    return 0;
+}
@@ -0,0 +1,122 @@
+/**
+ * @file    quat.c
+ * @author  Deadline039
+ * @brief   四元数压缩
+ * @version 1.0
+ * @date    2026-10-17
+ * @note    全部单精度运算. 量化按四舍五入, 每个分量的误差不超过量化步长的
+ *          一半. 输入不是单位四元数时先归一化
+ */
+
+#include "quat.h"
+
+#include <math.h>
+
+/* 去掉最大分量后, 其余分量的绝对值上限 */
+#define QUAT_RANGE 0.70710678f
+
+/**
+ * @brief 编码
+ *
+ * @param q 四元数, w, x, y, z
+ * @param bits 每个分量的位数, `QUAT_BITS_MIN`到`QUAT_BITS_MAX`
+ * @param[out] out 输出, `QUAT_SIZE(bits)`字节
+ */
+void quat_encode(const float q[4], uint32_t bits, uint8_t *out) {
+    uint32_t max = (1U << bits) - 1;
+    uint32_t largest = 0;
+    uint64_t code;
+    uint32_t shift = 2;
+    float norm = 0.0f, scale;
+
+    for (uint32_t i = 0; i < 4; ++i) {
+        norm += q[i] * q[i];
+        if (fabsf(q[i]) > fabsf(q[largest])) {
+            largest = i;
+        }
+    }
+
+    /* 最大的分量为负时取-q, 解码时最大的分量总是正的 */
+    scale = (norm > 0.0f) ? 1.0f / sqrtf(norm) : 1.0f;
+    if (q[largest] < 0.0f) {
+        scale = -scale;
+    }
+
+    code = largest;
+    for (uint32_t i = 0; i < 4; ++i) {
+        float v;
+        int32_t n;
+
+        if (i == largest) {
+            continue;
+        }
+
+        v = (q[i] * scale / QUAT_RANGE + 1.0f) * 0.5f * (float)max;
+        n = (int32_t)lrintf(v);
+        n = (n < 0) ? 0 : n;
+        n = (n > (int32_t)max) ? (int32_t)max : n;
+        code |= (uint64_t)n << shift;
+        shift += bits;
+    }
+
+    for (uint32_t i = 0; i < QUAT_SIZE(bits); ++i) {
+        out[i] = (uint8_t)(code >> (8 * i));
+    }
+}
+
+/**
+ * @brief 解码
+ *
+ * @param in 编码后的数据, `QUAT_SIZE(bits)`字节
+ * @param bits 每个分量的位数, 和编码时相同
+ * @param[out] q 单位四元数, w, x, y, z
+ * @return 解码结果
+ *  @retval 0 成功
+ *  @retval 1 编码无效, 其余分量的平方和超过3 / 4, 即大于去掉的分量
+ */
+uint8_t quat_decode(const uint8_t *in, uint32_t bits, float q[4]) {
+    uint32_t max = (1U << bits) - 1;
+    uint32_t largest;
+    uint64_t code = 0;
+    uint32_t shift = 2;
+    float sum = 0.0f;
+
+    for (uint32_t i = 0; i < QUAT_SIZE(bits); ++i) {
+        code |= (uint64_t)in[i] << (8 * i);
+    }
+
+    largest = (uint32_t)(code & 0x03);
+    for (uint32_t i = 0; i < 4; ++i) {
+        uint32_t n;
+
+        if (i == largest) {
+            continue;
+        }
+
+        n = (uint32_t)(code >> shift) & max;
+        q[i] = ((float)n / (float)max * 2.0f - 1.0f) * QUAT_RANGE;
+        sum += q[i] * q[i];
+        shift += bits;
+    }
+
+    /* 去掉的分量不小于1 / 2, 其余分量的平方和不超过3 / 4, 留出量化误差 */
+    if (sum > 0.76f) {
+        q[largest] = 0.0f;
+        return 1;
+    }
+    q[largest] = sqrtf(1.0f - sum);
+
+    return 0;
+}
+
+/**
+ * @brief 量化引起的最大姿态误差
+ *
+ * @param bits 每个分量的位数
+ * @return 两个姿态之间的最大转角(rad)
+ */
+float quat_max_error(uint32_t bits) {
+    /* 三个分量误差各不超过半个步长, 最大分量为正且不小于1 / 2,
+       由它们求出的误差不超过3倍; 转角约为四元数误差长度的2倍 */
+    return 2.0f * 3.4641016f * QUAT_RANGE / (float)((1U << bits) - 1);
+}
@@ -60,6 +60,33 @@ void RTC_Alarm_IRQHandler(void) {
     HAL_RTC_AlarmIRQHandler(&rtc_handle);
 }
 
+/**
+ * @brief 启动唤醒定时器, 每秒产生一次唤醒中断
+ *
+ * @note 唤醒定时器使用1Hz的ck_spre. 唤醒中断可以重映射到TIM5通道4,
+ *       用于校准其他时钟. 中断中清除唤醒标志, 下一秒才能再次产生上升沿
+ */
+void rtc_wakeup_start(void) {
+    HAL_StatusTypeDef res = HAL_OK;
+
+    res = HAL_RTCEx_SetWakeUpTimer_IT(&rtc_handle, 0,
+                                      RTC_WAKEUPCLOCK_CK_SPRE_16BITS);
+#ifdef DEBUG
+    assert(res == HAL_OK);
+#endif /* DEBUG */
+
+    HAL_NVIC_SetPriority(RTC_WKUP_IRQn, RTC_WKUP_IT_PREEMPT, RTC_WKUP_IT_SUB);
+    HAL_NVIC_EnableIRQ(RTC_WKUP_IRQn);
+}
+
+/**
+ * @brief RTC唤醒中断服务函数
+ *
+ */
+void RTC_WKUP_IRQHandler(void) {
+    HAL_RTCEx_WakeUpTimerIRQHandler(&rtc_handle);
+}
+
 /**
  * @brief RTC底层初始化
  *
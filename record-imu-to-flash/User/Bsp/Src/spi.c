@@ -0,0 +1,308 @@
+/**
+ * @file    spi.c
+ * @author  Deadline039
+ * @brief   STM32F429 SPI驱动
+ * @version 1.0
+ * @date    2026-10-17
+ */
+
+#include "spi.h"
+
+#include <assert.h>
+
+#if (SPI5_ENABLE == 1)
+SPI_HandleTypeDef spi5_handle = {.Instance = SPI5};
+
+#if (SPI5_USE_DMA == 1)
+static DMA_HandleTypeDef spi5_dmarx_handle = {
+    .Instance = DMA2_Stream3,
+    .Init.Channel = DMA_CHANNEL_2,
+    .Init.Direction = DMA_PERIPH_TO_MEMORY,       /* 接收, 外设到内存 */
+    .Init.MemDataAlignment = DMA_MDATAALIGN_BYTE, /* 内存以字节对齐 */
+    .Init.MemInc = DMA_MINC_ENABLE,               /* 启用内存地址自增 */
+    .Init.Mode = DMA_NORMAL,                      /* 正常模式 */
+    .Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE, /* 外设以字节对齐 */
+    .Init.PeriphInc = DMA_PINC_DISABLE, /* 关闭外设地址自增 */
+    .Init.Priority = SPI5_DMA_PRIORITY  /* DMA优先级 */
+};
+
+static DMA_HandleTypeDef spi5_dmatx_handle = {
+    .Instance = DMA2_Stream4,
+    .Init.Channel = DMA_CHANNEL_2,
+    .Init.Direction = DMA_MEMORY_TO_PERIPH,       /* 发送, 内存到外设 */
+    .Init.MemDataAlignment = DMA_MDATAALIGN_BYTE, /* 内存以字节对齐 */
+    .Init.MemInc = DMA_MINC_ENABLE,               /* 启用内存地址自增 */
+    .Init.Mode = DMA_NORMAL,                      /* 正常模式 */
+    .Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE, /* 外设以字节对齐 */
+    .Init.PeriphInc = DMA_PINC_DISABLE, /* 关闭外设地址自增 */
+    .Init.Priority = SPI5_DMA_PRIORITY  /* DMA优先级 */
+};
+
+/**
+ * @brief SPI5 DMA接收中断句柄
+ *
+ */
+void DMA2_Stream3_IRQHandler(void) {
+    HAL_DMA_IRQHandler(&spi5_dmarx_handle);
+}
+
+/**
+ * @brief SPI5 DMA发送中断句柄
+ *
+ */
+void DMA2_Stream4_IRQHandler(void) {
+    HAL_DMA_IRQHandler(&spi5_dmatx_handle);
+}
+#endif /* SPI5_USE_DMA == 1 */
+
+#endif /* SPI5_ENABLE == 1 */
+
+/**
+ * @brief SPI初始化, 主机模式, 8位数据, 软件片选
+ *
+ * @param hspi SPI句柄
+ * @param clk_polarity 时钟极性
+ *  @arg `SPI_POLARITY_LOW` 空闲时SCK为低电平
+ *  @arg `SPI_POLARITY_HIGH` 空闲时SCK为高电平
+ * @param clk_phase 时钟相位
+ *  @arg `SPI_PHASE_1EDGE` 第一个边沿采样
+ *  @arg `SPI_PHASE_2EDGE` 第二个边沿采样
+ * @param baud_rate_prescaler 波特率分频系数
+ *  @arg `SPI_BAUDRATEPRESCALER_2` ~ `SPI_BAUDRATEPRESCALER_256`
+ */
+void spi_init(SPI_HandleTypeDef *hspi, uint32_t clk_polarity,
+              uint32_t clk_phase, uint32_t baud_rate_prescaler) {
+    HAL_StatusTypeDef res = HAL_OK;
+
+    hspi->Init.Mode = SPI_MODE_MASTER;
+    hspi->Init.Direction = SPI_DIRECTION_2LINES;
+    hspi->Init.DataSize = SPI_DATASIZE_8BIT;
+    hspi->Init.CLKPolarity = clk_polarity;
+    hspi->Init.CLKPhase = clk_phase;
+    hspi->Init.NSS = SPI_NSS_SOFT;
+    hspi->Init.BaudRatePrescaler = baud_rate_prescaler;
+    hspi->Init.FirstBit = SPI_FIRSTBIT_MSB;
+    hspi->Init.TIMode = SPI_TIMODE_DISABLE;
+    hspi->Init.CRCCalculation = SPI_CRCCALCULATION_DISABLE;
+    hspi->Init.CRCPolynomial = 7;
+
+    res = HAL_SPI_Init(hspi);
+#ifdef DEBUG
+    assert(res == HAL_OK);
+#endif /* DEBUG */
+
+    __HAL_SPI_ENABLE(hspi);
+}
+
+/**
+ * @brief SPI底层初始化
+ *
+ * @param hspi SPI句柄
+ */
+void HAL_SPI_MspInit(SPI_HandleTypeDef *hspi) {
+    HAL_StatusTypeDef res = HAL_OK;
+    GPIO_InitTypeDef gpio_init_struct = {.Mode = GPIO_MODE_AF_PP,
+                                         .Pull = GPIO_PULLUP,
+                                         .Speed = GPIO_SPEED_FREQ_VERY_HIGH};
+
+    if (hspi->Instance == SPI5) {
+
+#if (SPI5_ENABLE == 1)
+        __HAL_RCC_SPI5_CLK_ENABLE();
+
+        SPI5_SCK_GPIO_ENABLE();
+        SPI5_MISO_GPIO_ENABLE();
+        SPI5_MOSI_GPIO_ENABLE();
+
+        gpio_init_struct.Alternate = GPIO_AF5_SPI5;
+
+        gpio_init_struct.Pin = SPI5_SCK_GPIO_PIN;
+        HAL_GPIO_Init(SPI5_SCK_GPIO_PORT, &gpio_init_struct);
+
+        gpio_init_struct.Pin = SPI5_MISO_GPIO_PIN;
+        HAL_GPIO_Init(SPI5_MISO_GPIO_PORT, &gpio_init_struct);
+
+        gpio_init_struct.Pin = SPI5_MOSI_GPIO_PIN;
+        HAL_GPIO_Init(SPI5_MOSI_GPIO_PORT, &gpio_init_struct);
+
+#if (SPI5_USE_DMA == 1)
+        __HAL_RCC_DMA2_CLK_ENABLE();
+
+        res = HAL_DMA_Init(&spi5_dmarx_handle);
+#ifdef DEBUG
+        assert(res == HAL_OK);
+#endif /* DEBUG */
+        __HAL_LINKDMA(hspi, hdmarx, spi5_dmarx_handle);
+
+        res = HAL_DMA_Init(&spi5_dmatx_handle);
+#ifdef DEBUG
+        assert(res == HAL_OK);
+#endif /* DEBUG */
+        __HAL_LINKDMA(hspi, hdmatx, spi5_dmatx_handle);
+
+        HAL_NVIC_SetPriority(DMA2_Stream3_IRQn, SPI5_DMA_IT_PREEMPT,
+                             SPI5_DMA_IT_SUB);
+        HAL_NVIC_EnableIRQ(DMA2_Stream3_IRQn);
+        HAL_NVIC_SetPriority(DMA2_Stream4_IRQn, SPI5_DMA_IT_PREEMPT,
+                             SPI5_DMA_IT_SUB);
+        HAL_NVIC_EnableIRQ(DMA2_Stream4_IRQn);
+#endif /* SPI5_USE_DMA == 1 */
+
+#endif /* SPI5_ENABLE == 1 */
+    }
+}
+
+/**
+ * @brief 设置SPI速度
+ *
+ * @param hspi SPI句柄
+ * @param baud_rate_prescaler 波特率分频系数
+ */
+void spi_set_speed(SPI_HandleTypeDef *hspi, uint32_t baud_rate_prescaler) {
+    assert_param(IS_SPI_BAUDRATE_PRESCALER(baud_rate_prescaler));
+
+    __HAL_SPI_DISABLE(hspi);
+    hspi->Instance->CR1 &= ~SPI_CR1_BR;
+    hspi->Instance->CR1 |= baud_rate_prescaler;
+    hspi->Init.BaudRatePrescaler = baud_rate_prescaler;
+    __HAL_SPI_ENABLE(hspi);
+}
+
+/**
+ * @brief SPI读写一个字节
+ *
+ * @param hspi SPI句柄
+ * @param data 要发送的数据
+ * @return 接收到的数据
+ */
+uint8_t spi_read_write_byte(SPI_HandleTypeDef *hspi, uint8_t data) {
+    uint8_t rx_data = 0;
+    HAL_SPI_TransmitReceive(hspi, &data, &rx_data, 1, SPI_TIMEOUT);
+    return rx_data;
+}
+
+/**
+ * @brief SPI阻塞发送
+ *
+ * @param hspi SPI句柄
+ * @param data 要发送的数据
+ * @param len 数据长度
+ * @return 发送状态
+ * @note HAL库单次传输长度为16位, 这里分段发送
+ */
+HAL_StatusTypeDef spi_transmit(SPI_HandleTypeDef *hspi, const void *data,
+                               uint32_t len) {
+    HAL_StatusTypeDef res = HAL_OK;
+    const uint8_t *ptr = (const uint8_t *)data;
+    uint16_t once;
+
+    while (len && (res == HAL_OK)) {
+        once = (len > 0xFFFF) ? 0xFFFF : (uint16_t)len;
+        res = HAL_SPI_Transmit(hspi, (uint8_t *)ptr, once, SPI_TIMEOUT);
+        ptr += once;
+        len -= once;
+    }
+
+    return res;
+}
+
+/**
+ * @brief SPI阻塞接收
+ *
+ * @param hspi SPI句柄
+ * @param buf 接收缓冲区
+ * @param len 接收长度
+ * @return 接收状态
+ */
+HAL_StatusTypeDef spi_receive(SPI_HandleTypeDef *hspi, void *buf,
+                              uint32_t len) {
+    HAL_StatusTypeDef res = HAL_OK;
+    uint8_t *ptr = (uint8_t *)buf;
+    uint16_t once;
+
+    while (len && (res == HAL_OK)) {
+        once = (len > 0xFFFF) ? 0xFFFF : (uint16_t)len;
+        res = HAL_SPI_Receive(hspi, ptr, once, SPI_TIMEOUT);
+        ptr += once;
+        len -= once;
+    }
+
+    return res;
+}
+
+/**
+ * @brief SPI DMA发送, 发出后立即返回
+ *
+ * @param hspi SPI句柄
+ * @param data 要发送的数据, 传输完成前不能修改
+ * @param len 数据长度
+ * @return 启动状态, 未配置DMA时返回`HAL_ERROR`
+ * @note 完成后调用`HAL_SPI_TxCpltCallback`
+ */
+HAL_StatusTypeDef spi_transmit_dma(SPI_HandleTypeDef *hspi, const void *data,
+                                   uint16_t len) {
+    if (hspi->hdmatx == NULL) {
+        return HAL_ERROR;
+    }
+
+    return HAL_SPI_Transmit_DMA(hspi, (uint8_t *)data, len);
+}
+
+/**
+ * @brief SPI DMA接收, 发出后立即返回
+ *
+ * @param hspi SPI句柄
+ * @param buf 接收缓冲区, 传输完成前不能使用
+ * @param len 接收长度
+ * @return 启动状态, 未配置DMA时返回`HAL_ERROR`
+ * @note 主机模式下发送DMA同时从缓冲区发出数据产生时钟.
+ *       完成后调用`HAL_SPI_RxCpltCallback`
+ */
+HAL_StatusTypeDef spi_receive_dma(SPI_HandleTypeDef *hspi, void *buf,
+                                  uint16_t len) {
+    if ((hspi->hdmarx == NULL) || (hspi->hdmatx == NULL)) {
+        return HAL_ERROR;
+    }
+
+    return HAL_SPI_Receive_DMA(hspi, (uint8_t *)buf, len);
+}
+
+/**
+ * @brief 获取SPI时钟频率
+ *
+ * @param hspi SPI句柄
+ * @return SCK频率(Hz)
+ */
+uint32_t spi_get_clock(SPI_HandleTypeDef *hspi) {
+    uint32_t pclk, shift;
+
+    if ((hspi->Instance == SPI1) || (hspi->Instance == SPI4) ||
+        (hspi->Instance == SPI5) || (hspi->Instance == SPI6)) {
+        pclk = HAL_RCC_GetPCLK2Freq();
+    } else {
+        pclk = HAL_RCC_GetPCLK1Freq();
+    }
+
+    /* 分频系数为2^(BR + 1) */
+    shift = (hspi->Init.BaudRatePrescaler >> SPI_CR1_BR_Pos) + 1;
+
+    return pclk >> shift;
+}
+
+/**
+ * @brief 强制结束SPI传输, 恢复到空闲状态
+ *
+ * @param hspi SPI句柄
+ * @note 用于高优先级中断打断了主循环中的SPI传输的场合.
+ *       HAL库传输函数会上锁, 被打断时句柄处于BUSY状态, 必须手动解锁
+ */
+void spi_abort(SPI_HandleTypeDef *hspi) {
+    HAL_SPI_Abort(hspi);
+
+    /* 读空接收寄存器, 清除溢出标志 */
+    __HAL_SPI_CLEAR_OVRFLAG(hspi);
+
+    hspi->State = HAL_SPI_STATE_READY;
+    __HAL_UNLOCK(hspi);
+    __HAL_SPI_ENABLE(hspi);
+}
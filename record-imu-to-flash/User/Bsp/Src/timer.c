@@ -0,0 +1,230 @@
+/**
+ * @file    timer.c
+ * @author  Deadline039
+ * @brief   输入捕获时间戳定时器
+ * @version 1.0
+ * @date    2026-10-17
+ * @note    32位定时器自由计数, 通道1在外部信号的边沿由硬件锁存计数值,
+ *          时间不受中断延迟和其他中断的影响. 通道4重映射到RTC唤醒中断,
+ *          RTC每秒产生一次事件, 以此为锚点把计数换算为微秒,
+ *          并用两次事件之间的计数校准计数频率, 修正晶振的误差.
+ *          换算的时间和`HAL_GetTick`起点相同, 单位us, 约71分钟回绕一次.
+ */
+
+#include "timer.h"
+#include "rtc.h"
+
+#include <assert.h>
+#include <stdlib.h>
+
+static TIM_HandleTypeDef timer_ts_handle = {.Instance = TIMER_TS_INSTANCE};
+
+static struct {
+    uint64_t anchor;       /*!< 锚点时间, 单位2^-32us */
+    uint32_t anchor_count; /*!< 锚点的计数值 */
+    uint32_t scale;        /*!< 每个计数的时间, 单位2^-32us */
+    uint64_t freq;         /*!< 计数频率, 单位1/256Hz */
+
+    uint32_t rtc_count; /*!< 上一次RTC事件的计数值 */
+    uint8_t rtc_valid;  /*!< 已经捕获过RTC事件 */
+    uint8_t rtc_lse;    /*!< RTC使用LSE */
+} timer_ts;
+
+/**
+ * @brief 初始化定时器, 开始计时
+ *
+ * @note 需要先初始化RTC, 通道4使用RTC唤醒中断
+ */
+void timer_ts_init(void) {
+    HAL_StatusTypeDef res = HAL_OK;
+    TIM_IC_InitTypeDef ic_init_struct = {
+        .ICPolarity = TIM_ICPOLARITY_RISING,
+        .ICSelection = TIM_ICSELECTION_DIRECTTI, /* 直接连到对应的输入 */
+        .ICPrescaler = TIM_ICPSC_DIV1,           /* 每个边沿都捕获 */
+        .ICFilter = 0};
+    uint32_t clock = HAL_RCC_GetPCLK1Freq();
+
+    /* APB1分频时定时器时钟为PCLK1的2倍 */
+    if ((RCC->CFGR & RCC_CFGR_PPRE1) != RCC_HCLK_DIV1) {
+        clock *= 2;
+    }
+
+    TIMER_TS_CLK_ENABLE();
+
+    timer_ts_handle.Init.Prescaler = clock / TIMER_TS_FREQ - 1;
+    timer_ts_handle.Init.CounterMode = TIM_COUNTERMODE_UP;
+    timer_ts_handle.Init.Period = 0xFFFFFFFF;
+    timer_ts_handle.Init.ClockDivision = TIM_CLOCKDIVISION_DIV1;
+    timer_ts_handle.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_DISABLE;
+    res = HAL_TIM_IC_Init(&timer_ts_handle);
+#ifdef DEBUG
+    assert(res == HAL_OK);
+#endif /* DEBUG */
+
+    /* 通道4捕获RTC唤醒中断 */
+    res = HAL_TIMEx_RemapConfig(&timer_ts_handle, TIM_TIM5_RTC);
+#ifdef DEBUG
+    assert(res == HAL_OK);
+#endif /* DEBUG */
+    res = HAL_TIM_IC_ConfigChannel(&timer_ts_handle, &ic_init_struct,
+                                   TIM_CHANNEL_4);
+#ifdef DEBUG
+    assert(res == HAL_OK);
+#endif /* DEBUG */
+
+    timer_ts.anchor = (uint64_t)(HAL_GetTick() * 1000) << 32;
+    timer_ts.anchor_count = 0;
+    timer_ts.freq = (uint64_t)TIMER_TS_FREQ << 8;
+    timer_ts.scale = (uint32_t)((1000000ULL << 32) / TIMER_TS_FREQ);
+
+    HAL_NVIC_SetPriority(TIMER_TS_IRQn, TIMER_TS_IT_PREEMPT, TIMER_TS_IT_SUB);
+    HAL_NVIC_EnableIRQ(TIMER_TS_IRQn);
+
+    __HAL_TIM_SET_COUNTER(&timer_ts_handle, 0);
+    res = HAL_TIM_IC_Start_IT(&timer_ts_handle, TIM_CHANNEL_4);
+#ifdef DEBUG
+    assert(res == HAL_OK);
+#endif /* DEBUG */
+
+    /* RTC使用LSI时只用秒事件更新锚点, 不校准 */
+    timer_ts.rtc_lse =
+        (__HAL_RCC_GET_RTC_SOURCE() == RCC_RTCCLKSOURCE_LSE) ? 1 : 0;
+    rtc_wakeup_start();
+}
+
+/**
+ * @brief 把计数值换算为时间
+ *
+ * @param count 计数值, 和锚点相差不超过200秒
+ * @return 时间, 单位2^-32us
+ * @note 关中断或在定时器中断中调用
+ */
+static uint64_t timer_ts_convert(uint32_t count) {
+    int32_t delta = (int32_t)(count - timer_ts.anchor_count);
+
+    return timer_ts.anchor + (uint64_t)((int64_t)delta * timer_ts.scale);
+}
+
+/**
+ * @brief 把计数值换算为时间
+ *
+ * @param count 计数值, 如捕获的值
+ * @return 时间(us)
+ */
+uint32_t timer_ts_to_us(uint32_t count) {
+    uint32_t primask = __get_PRIMASK();
+    uint64_t time;
+
+    __disable_irq();
+    time = timer_ts_convert(count);
+    __set_PRIMASK(primask);
+
+    return (uint32_t)(time >> 32);
+}
+
+/**
+ * @brief 获取当前时间
+ *
+ * @return 时间(us), 约71分钟回绕一次
+ */
+uint32_t timer_ts_now(void) {
+    return timer_ts_to_us(__HAL_TIM_GET_COUNTER(&timer_ts_handle));
+}
+
+/**
+ * @brief 获取校准后的计数频率
+ *
+ * @return 计数频率(Hz)
+ */
+uint32_t timer_ts_get_freq(void) {
+    return (uint32_t)(timer_ts.freq >> 8);
+}
+
+/**
+ * @brief 开始在通道1捕获外部信号
+ *
+ * @param polarity 捕获的边沿, `TIM_ICPOLARITY_RISING`等
+ * @param prescaler 每几个边沿捕获一次, `TIM_ICPSC_DIV1`到`TIM_ICPSC_DIV8`
+ * @note 需要先把引脚配置为定时器复用功能, 每次捕获调用
+ *       `timer_ts_capture_callback`. 分频时只锁存每组最后一个边沿的时间,
+ *       分频计数从开始捕获时算起
+ */
+void timer_ts_capture_start(uint32_t polarity, uint32_t prescaler) {
+    HAL_StatusTypeDef res = HAL_OK;
+    TIM_IC_InitTypeDef ic_init_struct = {
+        .ICPolarity = polarity,
+        .ICSelection = TIM_ICSELECTION_DIRECTTI, /* 直接连到对应的输入 */
+        .ICPrescaler = prescaler,
+        .ICFilter = 0};
+
+    res = HAL_TIM_IC_ConfigChannel(&timer_ts_handle, &ic_init_struct,
+                                   TIM_CHANNEL_1);
+#ifdef DEBUG
+    assert(res == HAL_OK);
+#endif /* DEBUG */
+    res = HAL_TIM_IC_Start_IT(&timer_ts_handle, TIM_CHANNEL_1);
+#ifdef DEBUG
+    assert(res == HAL_OK);
+#endif /* DEBUG */
+}
+
+/**
+ * @brief 通道1捕获回调
+ *
+ * @param time 边沿的时间(us)
+ * @note 在定时器中断中调用
+ */
+__weak void timer_ts_capture_callback(uint32_t time) {
+    UNUSED(time);
+}
+
+/**
+ * @brief RTC秒事件, 更新锚点, 校准计数频率
+ *
+ * @param count 事件的计数值
+ */
+static void timer_ts_rtc_event(uint32_t count) {
+    uint32_t ticks = count - timer_ts.rtc_count;
+
+    /* 先用原来的频率换算到这一点, 之后的时间从这里按新的频率计算 */
+    timer_ts.anchor = timer_ts_convert(count);
+    timer_ts.anchor_count = count;
+
+#if (TIMER_TS_DISCIPLINE == 1)
+    int64_t error = (int64_t)ticks - TIMER_TS_FREQ;
+
+    /* 第一次事件没有间隔, LSI误差太大, 都不校准 */
+    if (timer_ts.rtc_valid && timer_ts.rtc_lse &&
+        (llabs(error) * 1000000 <=
+         (int64_t)TIMER_TS_FREQ * TIMER_TS_MAX_PPM)) {
+        timer_ts.freq += (((int64_t)ticks << 8) - (int64_t)timer_ts.freq) >>
+                         TIMER_TS_FILTER_SHIFT;
+        timer_ts.scale = (uint32_t)((1000000ULL << 40) / timer_ts.freq);
+    }
+#else  /* TIMER_TS_DISCIPLINE == 1 */
+    UNUSED(ticks);
+#endif /* TIMER_TS_DISCIPLINE == 1 */
+
+    timer_ts.rtc_count = count;
+    timer_ts.rtc_valid = 1;
+}
+
+/**
+ * @brief 定时器中断服务函数
+ *
+ */
+void TIMER_TS_IRQHandler(void) {
+    if (__HAL_TIM_GET_FLAG(&timer_ts_handle, TIM_FLAG_CC1) &&
+        __HAL_TIM_GET_IT_SOURCE(&timer_ts_handle, TIM_IT_CC1)) {
+        /* 读捕获值会清除标志 */
+        timer_ts_capture_callback(
+            timer_ts_to_us(HAL_TIM_ReadCapturedValue(&timer_ts_handle,
+                                                     TIM_CHANNEL_1)));
+    }
+
+    if (__HAL_TIM_GET_FLAG(&timer_ts_handle, TIM_FLAG_CC4) &&
+        __HAL_TIM_GET_IT_SOURCE(&timer_ts_handle, TIM_IT_CC4)) {
+        timer_ts_rtc_event(
+            HAL_TIM_ReadCapturedValue(&timer_ts_handle, TIM_CHANNEL_4));
+    }
+}
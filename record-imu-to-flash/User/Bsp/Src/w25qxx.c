@@ -0,0 +1,367 @@
+/**
+ * @file    w25qxx.c
+ * @author  Deadline039
+ * @brief   W25Qxx系列SPI Flash驱动
+ * @version 1.0
+ * @date    2026-10-17
+ * @note    编程和擦除命令发出后立即返回, 不等待芯片忙结束;
+ *          每条命令发出前会先等待上一次操作完成. 这样CPU可以在芯片
+ *          编程/擦除期间继续准备下一页数据.
+ *          W25Q256容量超过16M, 初始化时切换到4字节地址模式.
+ *
+ *          每条命令作为一个事务提交到SPI总线队列, 和总线上的其他设备
+ *          交替执行. 阻塞读取按`W25QXX_READ_CHUNK`分段, 高优先级事务可以
+ *          在段之间插入; DMA读取使用低优先级, 在后台进行.
+ */
+
+#include "w25qxx.h"
+
+/* 指令表 */
+#define W25X_WRITE_ENABLE       0x06
+#define W25X_READ_STATUS_REG1   0x05
+#define W25X_READ_STATUS_REG2   0x35
+#define W25X_READ_STATUS_REG3   0x15
+#define W25X_READ_DATA          0x03
+#define W25X_PAGE_PROGRAM       0x02
+#define W25X_SECTOR_ERASE       0x20
+#define W25X_ERASE_SUSPEND      0x75
+#define W25X_RELEASE_POWER_DOWN 0xAB
+#define W25X_MANUFACT_DEVICE_ID 0x90
+#define W25X_ENABLE_4BYTE_ADDR  0xB7
+
+#define W25X_SR1_BUSY           0x01 /* 状态寄存器1 BUSY位 */
+#define W25X_SR2_SUS            0x80 /* 状态寄存器2 SUS位 */
+#define W25X_SR3_ADS            0x01 /* 状态寄存器3 ADS位 */
+
+/* 阻塞读取时单个事务的最大长度 */
+#define W25QXX_READ_CHUNK       1024U
+
+/**
+ * @brief 初始化事务, 填入片选和时钟设置
+ *
+ * @param dev W25Qxx设备
+ * @param trans 事务
+ * @param cmd 指令
+ */
+static void w25qxx_trans_init(w25qxx_t *dev, spi_trans_t *trans,
+                              uint8_t cmd) {
+    trans->cs_port = dev->cs_port;
+    trans->cs_pin = dev->cs_pin;
+    trans->mode = W25QXX_SPI_MODE;
+    trans->prio = SPI_BUS_PRIO_NORMAL;
+    trans->cmd[0] = cmd;
+    trans->cmd_len = 1;
+    trans->tx_data = NULL;
+    trans->rx_data = NULL;
+    trans->data_len = 0;
+    trans->callback = NULL;
+    trans->arg = NULL;
+    trans->state = SPI_TRANS_IDLE;
+}
+
+/**
+ * @brief 在指令后面加上地址
+ *
+ * @param dev W25Qxx设备
+ * @param trans 事务
+ * @param addr 地址
+ */
+static void w25qxx_trans_addr(w25qxx_t *dev, spi_trans_t *trans,
+                              uint32_t addr) {
+    if (dev->id == W25Q256) {
+        trans->cmd[trans->cmd_len++] = (uint8_t)(addr >> 24);
+    }
+    trans->cmd[trans->cmd_len++] = (uint8_t)(addr >> 16);
+    trans->cmd[trans->cmd_len++] = (uint8_t)(addr >> 8);
+    trans->cmd[trans->cmd_len++] = (uint8_t)addr;
+}
+
+/**
+ * @brief 发送一条单字节指令
+ *
+ * @param dev W25Qxx设备
+ * @param cmd 指令
+ */
+static void w25qxx_send_cmd(w25qxx_t *dev, uint8_t cmd) {
+    spi_trans_t trans;
+
+    w25qxx_trans_init(dev, &trans, cmd);
+    spi_bus_transfer(dev->bus, &trans);
+}
+
+/**
+ * @brief 读状态寄存器
+ *
+ * @param dev W25Qxx设备
+ * @param cmd 读状态寄存器指令
+ * @return 寄存器值, 在中断中调用且总线忙时返回0xFF
+ */
+static uint8_t w25qxx_read_sr(w25qxx_t *dev, uint8_t cmd) {
+    spi_trans_t trans;
+    uint8_t res;
+
+    w25qxx_trans_init(dev, &trans, cmd);
+    trans.rx_data = &res;
+    trans.data_len = 1;
+    if (spi_bus_transfer(dev->bus, &trans) != 0) {
+        return 0xFF;
+    }
+
+    return res;
+}
+
+/**
+ * @brief 等待本设备的DMA读取完成
+ *
+ * @param dev W25Qxx设备
+ * @note 编程和擦除前调用, 避免排队中的读取在芯片忙时执行
+ */
+static void w25qxx_wait_dma(w25qxx_t *dev) {
+    while ((dev->dma_trans.state == SPI_TRANS_QUEUED) ||
+           (dev->dma_trans.state == SPI_TRANS_RUNNING))
+        ;
+}
+
+/**
+ * @brief 初始化W25Qxx
+ *
+ * @param dev W25Qxx设备, 需先填好SPI总线和片选引脚, 并打开片选GPIO时钟
+ * @return 初始化结果
+ *  @retval 0 成功
+ *  @retval 1 未识别到芯片
+ */
+uint8_t w25qxx_init(w25qxx_t *dev) {
+    GPIO_InitTypeDef gpio_init_struct = {.Mode = GPIO_MODE_OUTPUT_PP,
+                                         .Pull = GPIO_PULLUP,
+                                         .Speed = GPIO_SPEED_FREQ_HIGH};
+    gpio_init_struct.Pin = dev->cs_pin;
+    HAL_GPIO_Init(dev->cs_port, &gpio_init_struct);
+    HAL_GPIO_WritePin(dev->cs_port, dev->cs_pin, GPIO_PIN_SET);
+
+    dev->erasing = 0;
+    dev->dma_trans.state = SPI_TRANS_IDLE;
+
+    /* 芯片可能处于掉电模式, 先唤醒 */
+    w25qxx_send_cmd(dev, W25X_RELEASE_POWER_DOWN);
+
+    uint8_t id[2];
+    spi_trans_t trans;
+    w25qxx_trans_init(dev, &trans, W25X_MANUFACT_DEVICE_ID);
+    trans.cmd[1] = 0x00;
+    trans.cmd[2] = 0x00;
+    trans.cmd[3] = 0x00;
+    trans.cmd_len = 4;
+    trans.rx_data = id;
+    trans.data_len = sizeof(id);
+    spi_bus_transfer(dev->bus, &trans);
+
+    dev->id = (uint16_t)((id[0] << 8) | id[1]);
+    if ((dev->id < W25Q16) || (dev->id > W25Q256)) {
+        dev->capacity = 0;
+        return 1;
+    }
+    /* 设备ID低字节为容量的以2为底对数减1 */
+    dev->capacity = 1UL << ((dev->id & 0xFF) + 1);
+
+    if (dev->id == W25Q256) {
+        if ((w25qxx_read_sr(dev, W25X_READ_STATUS_REG3) & W25X_SR3_ADS) == 0) {
+            w25qxx_send_cmd(dev, W25X_ENABLE_4BYTE_ADDR);
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief 芯片是否正在编程或擦除
+ *
+ * @param dev W25Qxx设备
+ * @return 0-空闲, 1-忙
+ */
+uint8_t w25qxx_is_busy(w25qxx_t *dev) {
+    if (w25qxx_read_sr(dev, W25X_READ_STATUS_REG1) & W25X_SR1_BUSY) {
+        return 1;
+    }
+
+    dev->erasing = 0;
+    return 0;
+}
+
+/**
+ * @brief 等待芯片空闲
+ *
+ * @param dev W25Qxx设备
+ */
+void w25qxx_wait_busy(w25qxx_t *dev) {
+    while (w25qxx_is_busy(dev))
+        ;
+}
+
+/**
+ * @brief 读取数据
+ *
+ * @param dev W25Qxx设备
+ * @param addr 起始地址
+ * @param buf 接收缓冲区
+ * @param len 读取长度, 可以跨页跨扇区
+ */
+void w25qxx_read(w25qxx_t *dev, uint32_t addr, void *buf, uint32_t len) {
+    uint8_t *ptr = (uint8_t *)buf;
+    spi_trans_t trans;
+    uint32_t once;
+
+    w25qxx_wait_busy(dev);
+
+    while (len) {
+        once = (len > W25QXX_READ_CHUNK) ? W25QXX_READ_CHUNK : len;
+
+        w25qxx_trans_init(dev, &trans, W25X_READ_DATA);
+        w25qxx_trans_addr(dev, &trans, addr);
+        trans.rx_data = ptr;
+        trans.data_len = (uint16_t)once;
+        spi_bus_transfer(dev->bus, &trans);
+
+        addr += once;
+        ptr += once;
+        len -= once;
+    }
+}
+
+/**
+ * @brief DMA读取完成, 转发给`w25qxx_read_dma_callback`
+ *
+ * @param trans 事务
+ */
+static void w25qxx_dma_done(spi_trans_t *trans) {
+    w25qxx_read_dma_callback((w25qxx_t *)trans->arg);
+}
+
+/**
+ * @brief DMA读取数据, 提交到总线队列后立即返回
+ *
+ * @param dev W25Qxx设备
+ * @param addr 起始地址
+ * @param buf 接收缓冲区, 完成前不能使用
+ * @param len 读取长度, 不超过65535
+ * @return 提交结果
+ *  @retval 0 已提交, 完成后调用`w25qxx_read_dma_callback`
+ *  @retval 1 上一次DMA读取未完成或芯片忙, 没有提交
+ * @note 以低优先级执行. 可以在中断中调用, 不会等待
+ */
+uint8_t w25qxx_read_dma(w25qxx_t *dev, uint32_t addr, void *buf,
+                        uint32_t len) {
+    spi_trans_t *trans = &dev->dma_trans;
+
+    if ((trans->state == SPI_TRANS_QUEUED) ||
+        (trans->state == SPI_TRANS_RUNNING) || w25qxx_is_busy(dev)) {
+        return 1;
+    }
+
+    w25qxx_trans_init(dev, trans, W25X_READ_DATA);
+    w25qxx_trans_addr(dev, trans, addr);
+    trans->prio = SPI_BUS_PRIO_LOW;
+    trans->rx_data = buf;
+    trans->data_len = (uint16_t)len;
+    trans->callback = w25qxx_dma_done;
+    trans->arg = dev;
+
+    return spi_bus_submit(dev->bus, trans);
+}
+
+/**
+ * @brief DMA读取完成回调, 在中断中调用
+ *
+ * @param dev W25Qxx设备
+ * @note 可以在回调中发起下一次DMA读取
+ */
+__weak void w25qxx_read_dma_callback(w25qxx_t *dev) {
+    UNUSED(dev);
+}
+
+/**
+ * @brief 页编程, 发出命令后立即返回
+ *
+ * @param dev W25Qxx设备
+ * @param addr 起始地址
+ * @param data 要写入的数据
+ * @param len 数据长度, 不能超过本页剩余长度
+ * @note 目标区域必须已擦除. 对同一页用相同数据重复编程是安全的,
+ *       因为编程只能把1变为0
+ */
+void w25qxx_program_page(w25qxx_t *dev, uint32_t addr, const void *data,
+                         uint32_t len) {
+    spi_trans_t trans;
+
+    assert_param(len <= W25QXX_PAGE_SIZE - (addr % W25QXX_PAGE_SIZE));
+
+    w25qxx_wait_dma(dev);
+    w25qxx_wait_busy(dev);
+    w25qxx_send_cmd(dev, W25X_WRITE_ENABLE);
+
+    w25qxx_trans_init(dev, &trans, W25X_PAGE_PROGRAM);
+    w25qxx_trans_addr(dev, &trans, addr);
+    trans.tx_data = data;
+    trans.data_len = (uint16_t)len;
+    spi_bus_transfer(dev->bus, &trans);
+}
+
+/**
+ * @brief 擦除扇区, 发出命令后立即返回
+ *
+ * @param dev W25Qxx设备
+ * @param addr 扇区内任意地址
+ * @note 擦除一个扇区典型时间45ms, 最长400ms
+ */
+void w25qxx_erase_sector(w25qxx_t *dev, uint32_t addr) {
+    spi_trans_t trans;
+
+    w25qxx_wait_dma(dev);
+    w25qxx_wait_busy(dev);
+    w25qxx_send_cmd(dev, W25X_WRITE_ENABLE);
+
+    /* 先置位, 命令发送中被打断时也会当作擦除处理 */
+    dev->erasing = 1;
+
+    w25qxx_trans_init(dev, &trans, W25X_SECTOR_ERASE);
+    w25qxx_trans_addr(dev, &trans, addr & ~(W25QXX_SECTOR_SIZE - 1));
+    spi_bus_transfer(dev->bus, &trans);
+}
+
+/**
+ * @brief 暂停正在进行的擦除
+ *
+ * @param dev W25Qxx设备
+ * @return 是否暂停了擦除
+ *  @retval 0 没有正在进行的擦除
+ *  @retval 1 已暂停, 此时可以编程其他扇区
+ * @note 暂停后不再恢复, 被暂停的扇区内容不确定, 需要重新擦除.
+ *       暂停生效最多需要20us
+ */
+uint8_t w25qxx_suspend_erase(w25qxx_t *dev) {
+    if (!dev->erasing || !w25qxx_is_busy(dev)) {
+        return 0;
+    }
+
+    w25qxx_send_cmd(dev, W25X_ERASE_SUSPEND);
+    while ((w25qxx_read_sr(dev, W25X_READ_STATUS_REG2) & W25X_SR2_SUS) == 0) {
+        if (!w25qxx_is_busy(dev)) {
+            /* 擦除恰好在暂停前完成 */
+            return 0;
+        }
+    }
+    dev->erasing = 0;
+
+    return 1;
+}
+
+/**
+ * @brief 强制结束总线上正在传输的事务, 清空总线队列
+ *
+ * @param dev W25Qxx设备
+ * @note 只在高优先级中断中打断了主循环的Flash操作时使用, 之后在该中断中
+ *       以查询方式访问Flash. 编程命令若在字节边界被结束, 芯片仍会执行
+ *       已收到部分的编程
+ */
+void w25qxx_abort(w25qxx_t *dev) {
+    spi_bus_abort(dev->bus);
+}
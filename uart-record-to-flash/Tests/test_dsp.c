@@ -0,0 +1,281 @@
+/**
+ * @file    test_dsp.c
+ * @author  Deadline039
+ * @brief   定点DSP库的主机测试
+ * @version 1.0
+ * @date    2026-10-17
+ * @note    主机上编译的是C实现(同F103). 用逐个采样直接按定义计算的参考实现
+ *          对比, 输出必须逐位相同. 系数和输入包含-32768等边界值,
+ *          输入随机分成多段调用, FIR原地计算, 向量运算的地址随机不对齐.
+ *          M4上的SMLALD/QADD16与C实现的语义相同, 由`dsp_model_*`验证
+ */
+
+#include "test.h"
+
+#include "dsp.h"
+
+#include <string.h>
+
+#define TEST_ROUNDS  20000
+#define TEST_LEN_MAX 300
+#define TEST_TAP_MAX 64
+
+static uint32_t seed = 0x05D50066;
+
+/**
+ * @brief 随机Q15, 偶尔取边界值
+ */
+static q15_t rand_q15(void) {
+    uint32_t r = host_rand(&seed);
+
+    switch (r & 15) {
+        case 0: {
+            return INT16_MIN;
+        }
+
+        case 1: {
+            return INT16_MAX;
+        }
+
+        case 2: {
+            return (q15_t)((int32_t)(r >> 16) % 8 - 4);
+        }
+
+        default: {
+            return (q15_t)(r >> 16);
+        }
+    }
+}
+
+/**
+ * @brief 饱和到Q15
+ */
+static q15_t ref_sat(q63_t x) {
+    return (x > INT16_MAX) ? INT16_MAX : (x < INT16_MIN) ? INT16_MIN : (q15_t)x;
+}
+
+/**
+ * @brief 舍入后饱和, 按向负无穷取整的除法计算, 不依赖右移的实现
+ */
+static q15_t ref_round(q63_t acc, uint32_t shift) {
+    q63_t d = (q63_t)1 << shift, q = acc + d / 2;
+
+    return ref_sat((q >= 0) ? q / d : -((-q + d - 1) / d));
+}
+
+/**
+ * @brief SMLALD的定义: 两组16位有符号乘积加到64位累加器
+ */
+static q63_t dsp_model_smlald(uint32_t x, uint32_t y, q63_t acc) {
+    return acc + (q63_t)(int16_t)(x & 0xFFFF) * (int16_t)(y & 0xFFFF) +
+           (q63_t)(int16_t)(x >> 16) * (int16_t)(y >> 16);
+}
+
+/**
+ * @brief QADD16的定义: 两组16位有符号饱和加法
+ */
+static uint32_t dsp_model_qadd16(uint32_t x, uint32_t y) {
+    uint32_t lo = (uint16_t)ref_sat((int16_t)(x & 0xFFFF) +
+                                    (int16_t)(y & 0xFFFF));
+    uint32_t hi = (uint16_t)ref_sat((int16_t)(x >> 16) + (int16_t)(y >> 16));
+
+    return (hi << 16) | lo;
+}
+
+/**
+ * @brief 点积和饱和加法, 与指令模型对比
+ */
+static void test_vector(void) {
+    static q15_t a[TEST_LEN_MAX + 1], b[TEST_LEN_MAX + 1];
+    static q15_t out[TEST_LEN_MAX + 1], ref[TEST_LEN_MAX + 1];
+    uint32_t n = host_rand(&seed) % TEST_LEN_MAX, off = host_rand(&seed) & 1;
+    q63_t acc = 0;
+
+    for (uint32_t i = 0; i <= n; ++i) {
+        a[i] = rand_q15();
+        b[i] = rand_q15();
+    }
+
+    for (uint32_t i = 0; i + 1 < n; i += 2) {
+        uint32_t x = (uint16_t)a[off + i] | ((uint32_t)(uint16_t)a[off + i + 1]
+                                             << 16);
+        uint32_t y = (uint16_t)b[off + i] | ((uint32_t)(uint16_t)b[off + i + 1]
+                                             << 16);
+        uint32_t s = dsp_model_qadd16(x, y);
+
+        acc = dsp_model_smlald(x, y, acc);
+        ref[i] = (q15_t)(s & 0xFFFF);
+        ref[i + 1] = (q15_t)(s >> 16);
+    }
+    if (n & 1) {
+        acc += (q63_t)a[off + n - 1] * b[off + n - 1];
+        ref[n - 1] = ref_sat((q63_t)a[off + n - 1] + b[off + n - 1]);
+    }
+
+    TEST_CHECK(dsp_dot_q15(&a[off], &b[off], n) == acc, "dot, n = %u",
+               (unsigned int)n);
+    dsp_add_q15(&a[off], &b[off], out, n);
+    TEST_CHECK(memcmp(out, ref, n * sizeof(q15_t)) == 0, "add, n = %u",
+               (unsigned int)n);
+}
+
+/**
+ * @brief 把输入随机分段处理
+ *
+ * @param n 长度
+ * @param[out] chunk 每段长度
+ * @return 段数
+ */
+static uint32_t split(uint32_t n, uint32_t *chunk) {
+    uint32_t num = 0;
+
+    while (n != 0) {
+        uint32_t len = 1 + host_rand(&seed) % ((n < 40) ? n : 40);
+
+        chunk[num++] = len;
+        n -= len;
+    }
+
+    return num;
+}
+
+/**
+ * @brief FIR和抽取
+ */
+static void test_fir(void) {
+    static q15_t coeffs[TEST_TAP_MAX], state[2 * TEST_TAP_MAX];
+    static q15_t in[TEST_LEN_MAX], out[TEST_LEN_MAX], ref[TEST_LEN_MAX];
+    static uint32_t chunk[TEST_LEN_MAX];
+    uint32_t taps = 1 + host_rand(&seed) % TEST_TAP_MAX;
+    uint32_t n = 1 + host_rand(&seed) % TEST_LEN_MAX;
+    uint32_t factor = 1 + host_rand(&seed) % 8, num, pos = 0, got = 0;
+    dsp_fir_q15_t fir;
+    dsp_decimate_q15_t dec;
+
+    for (uint32_t k = 0; k < taps; ++k) {
+        coeffs[k] = rand_q15();
+    }
+    for (uint32_t i = 0; i < n; ++i) {
+        q63_t acc = 0;
+
+        in[i] = rand_q15();
+        for (uint32_t k = 0; (k < taps) && (k <= i); ++k) {
+            acc += (q63_t)coeffs[k] * in[i - k];
+        }
+        ref[i] = ref_round(acc, 15);
+    }
+
+    dsp_fir_q15_init(&fir, coeffs, state, (uint16_t)taps);
+    num = split(n, chunk);
+    memcpy(out, in, sizeof(out));
+    for (uint32_t c = 0; c < num; ++c) {
+        /* 原地计算 */
+        dsp_fir_q15(&fir, &out[pos], &out[pos], chunk[c]);
+        pos += chunk[c];
+    }
+    TEST_CHECK(memcmp(out, ref, n * sizeof(q15_t)) == 0,
+               "fir, %u taps, n = %u", (unsigned int)taps, (unsigned int)n);
+
+    dsp_decimate_q15_init(&dec, coeffs, state, (uint16_t)taps,
+                          (uint16_t)factor);
+    num = split(n, chunk);
+    pos = 0;
+    for (uint32_t c = 0; c < num; ++c) {
+        got += dsp_decimate_q15(&dec, &in[pos], &out[got], chunk[c]);
+        pos += chunk[c];
+    }
+    TEST_CHECK(got == n / factor, "decimate gave %u outputs",
+               (unsigned int)got);
+    for (uint32_t i = 0; i < got; ++i) {
+        TEST_CHECK(out[i] == ref[(i + 1) * factor - 1],
+                   "decimate, %u taps, factor %u, output %u",
+                   (unsigned int)taps, (unsigned int)factor, (unsigned int)i);
+    }
+}
+
+/**
+ * @brief 级联双二阶滤波
+ */
+static void test_biquad(void) {
+    static q15_t coeffs[6 * 4], state[4 * 4];
+    static q15_t in[TEST_LEN_MAX], out[TEST_LEN_MAX], ref[TEST_LEN_MAX];
+    static uint32_t chunk[TEST_LEN_MAX];
+    q15_t s[4][4] = {{0}};
+    uint32_t stages = 1 + host_rand(&seed) % 4, shift = host_rand(&seed) % 3;
+    uint32_t n = 1 + host_rand(&seed) % TEST_LEN_MAX, num, pos = 0;
+    dsp_biquad_q15_t iir;
+
+    for (uint32_t k = 0; k < stages * 6; ++k) {
+        coeffs[k] = (k % 6 == 1) ? 0 : rand_q15();
+    }
+    for (uint32_t i = 0; i < n; ++i) {
+        q15_t x = in[i] = rand_q15();
+
+        for (uint32_t k = 0; k < stages; ++k) {
+            const q15_t *c = &coeffs[k * 6];
+            q63_t acc = (q63_t)c[0] * x + (q63_t)c[2] * s[k][0] +
+                        (q63_t)c[3] * s[k][1] + (q63_t)c[4] * s[k][2] +
+                        (q63_t)c[5] * s[k][3];
+            q15_t y = ref_round(acc, 15 - shift);
+
+            s[k][1] = s[k][0];
+            s[k][0] = x;
+            s[k][3] = s[k][2];
+            s[k][2] = y;
+            x = y;
+        }
+        ref[i] = x;
+    }
+
+    dsp_biquad_q15_init(&iir, coeffs, state, (uint8_t)stages, (uint8_t)shift);
+    num = split(n, chunk);
+    for (uint32_t c = 0; c < num; ++c) {
+        dsp_biquad_q15(&iir, &in[pos], &out[pos], chunk[c]);
+        pos += chunk[c];
+    }
+    TEST_CHECK(memcmp(out, ref, n * sizeof(q15_t)) == 0,
+               "biquad, %u stages, shift %u, n = %u", (unsigned int)stages,
+               (unsigned int)shift, (unsigned int)n);
+}
+
+/**
+ * @brief 滑动平均
+ */
+static void test_mavg(void) {
+    static q15_t buf[TEST_TAP_MAX];
+    static q15_t in[TEST_LEN_MAX], out[TEST_LEN_MAX], ref[TEST_LEN_MAX];
+    static uint32_t chunk[TEST_LEN_MAX];
+    uint32_t len = 1 + host_rand(&seed) % TEST_TAP_MAX;
+    uint32_t n = 1 + host_rand(&seed) % TEST_LEN_MAX, num, pos = 0;
+    dsp_mavg_q15_t mavg;
+
+    for (uint32_t i = 0; i < n; ++i) {
+        int32_t sum = 0;
+
+        in[i] = rand_q15();
+        for (uint32_t k = 0; (k < len) && (k <= i); ++k) {
+            sum += in[i - k];
+        }
+        ref[i] = (q15_t)(sum / (int32_t)len);
+    }
+
+    dsp_mavg_q15_init(&mavg, buf, (uint16_t)len);
+    num = split(n, chunk);
+    for (uint32_t c = 0; c < num; ++c) {
+        dsp_mavg_q15(&mavg, &in[pos], &out[pos], chunk[c]);
+        pos += chunk[c];
+    }
+    TEST_CHECK(memcmp(out, ref, n * sizeof(q15_t)) == 0,
+               "mavg, len %u, n = %u", (unsigned int)len, (unsigned int)n);
+}
+
+int main(void) {
+    for (uint32_t r = 0; (r < TEST_ROUNDS) && (test_failed < 10); ++r) {
+        test_vector();
+        test_fir();
+        test_biquad();
+        test_mavg();
+    }
+
+    return test_report("dsp");
+}
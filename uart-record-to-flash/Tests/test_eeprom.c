@@ -0,0 +1,379 @@
+/**
+ * @file    test_eeprom.c
+ * @author  Deadline039
+ * @brief   片内Flash模拟EEPROM的主机测试
+ * @version 1.0
+ * @date    2026-10-17
+ * @note    HAL的Flash编程和擦除函数换成按芯片规则操作映射的Flash:
+ *          按半字编程, 只能写已擦除的半字或写0, 擦除按页. 随机写入不同长度
+ *          的值, 与内存中的副本比较, 经过多次整理, 并重新初始化检查保存的
+ *          内容. 之后在第N次编程或擦除时模拟掉电: 编程只清除了部分位,
+ *          擦除只完成了一部分, 其余字也可能有部分位被置1. 重新初始化后
+ *          每个确认写入的值都必须读到, 掉电时正在写的键只能是旧值或新值.
+ *          另外随机让编程返回错误, 写入失败时旧值不能丢
+ */
+
+#include "test.h"
+
+#include "eeprom.h"
+
+#include <setjmp.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* 随机写入的次数 */
+#define TEST_WRITES     200000
+/* 模拟掉电的次数 */
+#define TEST_CUTS       5000
+/* 写入的最大长度, 所有键的最新值要能放进一页 */
+#define TEST_LEN_MAX    48
+
+static const uint32_t flash_page_addr[2] = {EEPROM_PAGE0_ADDR,
+                                            EEPROM_PAGE1_ADDR};
+
+static struct {
+    uint8_t locked;       /* Flash已上锁 */
+    uint32_t countdown;   /* 再编程或擦除几次后掉电, 0为不掉电 */
+    uint8_t erase_only;   /* 只对擦除计数, 在整理中掉电 */
+    uint32_t error_rate;  /* 编程返回错误的概率, 1/n, 0为不出错 */
+    uint32_t programs;    /* 编程次数 */
+    uint32_t erases;      /* 擦除次数 */
+    jmp_buf power_cut;    /* 掉电后回到测试 */
+} flash;
+
+/**
+ * @brief 内存中的副本
+ */
+static struct {
+    uint16_t len;               /* 值的长度, 0xFFFF表示没有写过 */
+    uint8_t data[TEST_LEN_MAX]; /* 值 */
+} model[EEPROM_KEY_NUM];
+
+static uint32_t seed = 0x0A450053;
+
+/**
+ * @brief 地址所在的页
+ *
+ * @param addr 地址
+ * @return 页序号, -1表示不在EEPROM的页中
+ */
+static int flash_page_of(uint32_t addr) {
+    for (int p = 0; p < 2; ++p) {
+        if ((addr >= flash_page_addr[p]) &&
+            (addr < flash_page_addr[p] + EEPROM_PAGE_SIZE)) {
+            return p;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief 编程或擦除前计数, 到达时掉电
+ *
+ * @return 1表示这次操作中掉电
+ */
+static uint8_t flash_cut(uint8_t erase) {
+    if (flash.erase_only && !erase) {
+        return 0;
+    }
+    return (flash.countdown != 0) && (--flash.countdown == 0);
+}
+
+HAL_StatusTypeDef HAL_FLASH_Unlock(void) {
+    flash.locked = 0;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_FLASH_Lock(void) {
+    flash.locked = 1;
+    return HAL_OK;
+}
+
+/**
+ * @brief 编程一个半字
+ *
+ * @param half 地址
+ * @param data 数据
+ * @return 编程结果
+ *  @retval 0 成功
+ *  @retval 1 半字没有擦除, 也不是写0
+ */
+static uint8_t flash_program_half(__IO uint16_t *half, uint16_t data) {
+    if ((*half != 0xFFFF) && (data != 0x0000)) {
+        return 1;
+    }
+    *half &= data;
+    return 0;
+}
+
+HAL_StatusTypeDef HAL_FLASH_Program(uint32_t type, uint32_t addr,
+                                    uint64_t data) {
+    __IO uint16_t *half = (__IO uint16_t *)addr;
+    uint16_t value[2] = {(uint16_t)data, (uint16_t)(data >> 16)};
+    uint32_t i;
+
+    TEST_CHECK(!flash.locked, "program while locked");
+    TEST_CHECK(type == FLASH_TYPEPROGRAM_WORD, "program type %u",
+               (unsigned int)type);
+    TEST_CHECK((flash_page_of(addr) >= 0) && ((addr & 3) == 0),
+               "program outside the pages at 0x%08X", (unsigned int)addr);
+    if (flash.locked || (flash_page_of(addr) < 0)) {
+        return HAL_ERROR;
+    }
+
+    flash.programs++;
+    if (flash_cut(0)) {
+        /* 第一个半字可能已经写完, 正在写的半字只清除了一部分位 */
+        i = host_rand(&seed) % 2;
+        if ((i == 1) && (half[0] == 0xFFFF)) {
+            half[0] = value[0];
+        }
+        if (half[i] == 0xFFFF) {
+            half[i] &= value[i] | (uint16_t)host_rand(&seed);
+        }
+        longjmp(flash.power_cut, 1);
+    }
+    if ((flash.error_rate != 0) && (host_rand(&seed) % flash.error_rate == 0)) {
+        /* 出错时可能一位也没有写, 也可能写了一部分 */
+        if ((host_rand(&seed) % 2 == 0) && (half[0] == 0xFFFF)) {
+            half[0] &= value[0] | (uint16_t)host_rand(&seed);
+        }
+        return HAL_ERROR;
+    }
+
+    /* 驱动只编程已擦除的位置, 写没有擦除的半字是错误 */
+    for (i = 0; i < 2; ++i) {
+        if (flash_program_half(&half[i], value[i]) != 0) {
+            TEST_CHECK(0, "program of a used halfword at 0x%08X",
+                       (unsigned int)(addr + i * 2));
+            return HAL_ERROR;
+        }
+    }
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_FLASHEx_Erase(FLASH_EraseInitTypeDef *init,
+                                    uint32_t *page_error) {
+    int page = flash_page_of(init->PageAddress);
+    uint32_t *p, cut;
+
+    TEST_CHECK(!flash.locked, "erase while locked");
+    TEST_CHECK((init->TypeErase == FLASH_TYPEERASE_PAGES) &&
+                   (init->NbPages == EEPROM_PAGE_SIZE / FLASH_PAGE_SIZE),
+               "erase type %u, %u pages", (unsigned int)init->TypeErase,
+               (unsigned int)init->NbPages);
+    TEST_CHECK((page >= 0) && (init->PageAddress == flash_page_addr[page]),
+               "erase of 0x%08X", (unsigned int)init->PageAddress);
+    if (flash.locked || (page < 0)) {
+        *page_error = init->PageAddress;
+        return HAL_ERROR;
+    }
+
+    flash.erases++;
+    p = (uint32_t *)flash_page_addr[page];
+    if (flash_cut(1)) {
+        /* 前面一部分擦除完成, 之后的字随机有一些位被置1 */
+        cut = host_rand(&seed) % (EEPROM_PAGE_SIZE / 4);
+        for (uint32_t i = 0; i < EEPROM_PAGE_SIZE / 4; ++i) {
+            if (i < cut) {
+                p[i] = 0xFFFFFFFF;
+            } else if ((i == cut) || (host_rand(&seed) % 16 == 0)) {
+                p[i] |= host_rand(&seed);
+            }
+        }
+        longjmp(flash.power_cut, 1);
+    }
+
+    memset(p, 0xFF, EEPROM_PAGE_SIZE);
+    *page_error = 0xFFFFFFFF;
+    return HAL_OK;
+}
+
+/**
+ * @brief 产生一个随机的值
+ *
+ * @param[out] data 值
+ * @return 长度
+ */
+static uint16_t random_value(uint8_t *data) {
+    uint16_t len = (uint16_t)(host_rand(&seed) % (TEST_LEN_MAX + 1));
+
+    /* 大部分值很短, 和实际的配置参数相近 */
+    if (host_rand(&seed) % 4 != 0) {
+        len %= 16;
+    }
+    for (uint16_t i = 0; i < len; ++i) {
+        data[i] = (uint8_t)host_rand(&seed);
+    }
+    return len;
+}
+
+/**
+ * @brief 读出每个键, 和副本比较
+ *
+ * @param when 出错时打印的阶段
+ */
+static void check_all(const char *when) {
+    uint8_t buf[TEST_LEN_MAX + 1];
+
+    for (uint16_t k = 0; k < EEPROM_KEY_NUM; ++k) {
+        if (model[k].len == 0xFFFF) {
+            TEST_CHECK(eeprom_read(k, buf, 0) != 0, "%s: key %u appeared", when,
+                       k);
+            continue;
+        }
+        TEST_CHECK((eeprom_read(k, buf, model[k].len) == 0) &&
+                       (memcmp(buf, model[k].data, model[k].len) == 0),
+                   "%s: key %u lost or wrong", when, k);
+        TEST_CHECK(eeprom_read(k, buf, model[k].len + 1) != 0,
+                   "%s: key %u read with the wrong length", when, k);
+    }
+}
+
+/**
+ * @brief 随机写入, 不掉电, 有时编程返回错误
+ *
+ */
+static void test_writes(void) {
+    uint8_t data[TEST_LEN_MAX];
+    uint8_t buf[TEST_LEN_MAX];
+    uint32_t generation_erases;
+    uint16_t key, len;
+
+    memset((void *)EEPROM_PAGE0_ADDR, 0xFF, EEPROM_PAGE_SIZE);
+    memset((void *)EEPROM_PAGE1_ADDR, 0xFF, EEPROM_PAGE_SIZE);
+    for (uint16_t k = 0; k < EEPROM_KEY_NUM; ++k) {
+        model[k].len = 0xFFFF;
+    }
+
+    flash.locked = 1;
+    TEST_CHECK(eeprom_init() == 0, "init of blank flash failed");
+    check_all("blank");
+    TEST_CHECK(eeprom_write(EEPROM_KEY_NUM, data, 1) != 0,
+               "accepted key %u", EEPROM_KEY_NUM);
+    TEST_CHECK(eeprom_write(0, data, EEPROM_VALUE_MAX + 1) != 0,
+               "accepted %u bytes", EEPROM_VALUE_MAX + 1);
+
+    generation_erases = flash.erases;
+    for (uint32_t i = 0; i < TEST_WRITES; ++i) {
+        key = (uint16_t)(host_rand(&seed) % EEPROM_KEY_NUM);
+        len = random_value(data);
+        flash.error_rate = (i < TEST_WRITES / 2) ? 0 : 500;
+
+        if (eeprom_write(key, data, len) == 0) {
+            model[key].len = len;
+            memcpy(model[key].data, data, len);
+        } else {
+            TEST_CHECK(flash.error_rate != 0, "write %u failed", (unsigned)i);
+        }
+        TEST_CHECK(flash.locked, "flash left unlocked");
+
+        key = (uint16_t)(host_rand(&seed) % EEPROM_KEY_NUM);
+        if (model[key].len != 0xFFFF) {
+            TEST_CHECK((eeprom_read(key, buf, model[key].len) == 0) &&
+                           (memcmp(buf, model[key].data, model[key].len) == 0),
+                       "key %u wrong after %u writes", key, (unsigned)i);
+        }
+
+        /* 偶尔重新上电 */
+        if (host_rand(&seed) % 5000 == 0) {
+            flash.error_rate = 0;
+            TEST_CHECK(eeprom_init() == 0, "re-init failed");
+            check_all("re-init");
+        }
+
+        if (test_failed > 20) {
+            return;
+        }
+    }
+    flash.error_rate = 0;
+
+    TEST_CHECK(eeprom_init() == 0, "re-init failed");
+    check_all("final re-init");
+    /* 每次整理擦除一次, 这么多次写入必须整理过多次 */
+    TEST_CHECK(flash.erases - generation_erases > 10, "only %u erases",
+               (unsigned int)(flash.erases - generation_erases));
+    printf("%u writes, %u programs, %u erases\r\n", TEST_WRITES,
+           (unsigned int)flash.programs, (unsigned int)flash.erases);
+}
+
+/**
+ * @brief 掉电后重新上电, 初始化本身也可能掉电
+ *
+ * @param cut_rate 初始化中掉电的最大操作数
+ */
+static void power_up(uint32_t cut_rate) {
+    for (;;) {
+        flash.locked = 1;
+        flash.countdown = 1 + host_rand(&seed) % cut_rate;
+        if (setjmp(flash.power_cut) == 0) {
+            TEST_CHECK(eeprom_init() == 0, "init after power cut failed");
+            flash.countdown = 0;
+            return;
+        }
+    }
+}
+
+/**
+ * @brief 在随机的编程或擦除中掉电
+ *
+ */
+static void test_power_cut(void) {
+    static uint8_t data[TEST_LEN_MAX];
+    static volatile uint16_t key, len;
+    static uint32_t n, applied, dropped;
+    uint8_t buf[TEST_LEN_MAX];
+
+    for (n = 0; n < TEST_CUTS; ++n) {
+        /* 多数在几条记录内掉电, 有时写到整理, 有时在整理的擦除中掉电 */
+        flash.countdown = 1 + host_rand(&seed) % ((n % 8 == 0) ? 20000 : 40);
+        flash.erase_only = (n % 8 == 1);
+        if (flash.erase_only) {
+            flash.countdown = 1 + n / 8 % 2;
+        }
+        key = 0xFFFF;
+
+        if (setjmp(flash.power_cut) == 0) {
+            for (;;) {
+                key = (uint16_t)(host_rand(&seed) % EEPROM_KEY_NUM);
+                len = random_value(data);
+                TEST_CHECK(eeprom_write(key, data, len) == 0, "write failed");
+                model[key].len = len;
+                memcpy(model[key].data, data, len);
+            }
+        }
+
+        flash.erase_only = 0;
+        power_up(40);
+
+        /* 正在写的键是旧值或新值 */
+        if (key != 0xFFFF) {
+            if ((eeprom_read(key, buf, len) == 0) &&
+                (memcmp(buf, data, len) == 0)) {
+                if ((model[key].len != len) ||
+                    (memcmp(model[key].data, data, len) != 0)) {
+                    applied++;
+                }
+                model[key].len = len;
+                memcpy(model[key].data, data, len);
+            } else {
+                dropped++;
+            }
+        }
+        check_all("power cut");
+
+        if (test_failed > 20) {
+            return;
+        }
+    }
+
+    printf("%u power cuts, in-flight write kept %u, dropped %u\r\n", TEST_CUTS,
+           (unsigned int)applied, (unsigned int)dropped);
+}
+
+int main(void) {
+    test_writes();
+    test_power_cut();
+
+    return test_report("eeprom");
+}
@@ -0,0 +1,401 @@
+/**
+ * @file    test_pvd.c
+ * @author  Deadline039
+ * @brief   掉电刷写测试
+ * @version 1.0
+ * @date    2026-10-17
+ * @note    记录器, Flash日志, W25Qxx驱动和备份域使用固件源文件, SPI总线换成
+ *          w25q_sim.c中的模拟芯片. 串口持续收到数据, 在随机位置调用PVD
+ *          中断: 任意一个SPI事务开始时(可能打断DMA预读, 编程, 擦除和等待
+ *          芯片空闲), 或主循环从FIFO读取数据时. 关中断时推迟到开中断后.
+ *          中断结束当前的SPI事务, 被结束的页编程只写入随机长度的一部分.
+ *
+ *          中断停在等待电压恢复时检查:
+ *          - 芯片空闲, 没有发出擦除, 编程的页数不超过预算
+ *          - 日志中的页都有效, 序号连续, 触发时暂存页中的数据已写入
+ *          - 日志中的串口数据和收到的数据前一部分相同, 没有丢失或重复;
+ *            只有掉电刷写的页数用完时FIFO中才能有剩余的数据
+ *          每次测试在子进程中运行, 都从空白芯片开始.
+ *          make test_pvd ARGS="次数 [种子]"
+ */
+
+#include "test.h"
+
+#include "recorder.h"
+#include "ring_fifo.h"
+#include "rtc.h"
+#include "w25q_sim.h"
+
+#include <setjmp.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+/* 默认的测试次数 */
+#define TEST_TRIALS     200
+/* 触发位置的范围(次数), 按2的幂随机选上限, 挂载后很快触发的更多 */
+#define TEST_PVD_BITS   13
+/* 挂载后最多运行的时间(ms) */
+#define TEST_STEPS_MAX  20000
+/* 每毫秒最多收到的字节数, 偶尔一次收到一整个FIFO */
+#define TEST_BYTES_MS   184
+#define TEST_BURST_RATE 64
+/* 串口FIFO大小 */
+#define TEST_FIFO_SIZE  4096
+/* 收到的数据, 按最多运行的时间 */
+#define TEST_STREAM_MAX (TEST_STEPS_MAX * TEST_FIFO_SIZE)
+/* 每次测试最多打印的错误数 */
+#define TEST_MSG_MAX    10
+
+/* 触发位置 */
+#define PVD_AT_READ      0 /* 从FIFO读取 */
+#define PVD_AT_SPI       1 /* SPI事务 */
+#define PVD_AT_PROGRAM   2 /* 页编程的事务 */
+#define PVD_AT_NUM       3
+
+/**
+ * @brief 各次测试共享的结果
+ */
+typedef struct {
+    uint32_t failed;    /*!< 失败次数 */
+    uint32_t trials;    /*!< 测试次数 */
+    uint32_t fired[PVD_AT_NUM]; /*!< 在各个位置触发的次数 */
+    uint32_t deferred;  /*!< 关中断时挂起的次数 */
+    uint32_t aborted;   /*!< 结束了页编程的次数 */
+    uint32_t suspended; /*!< 暂停了擦除的次数 */
+    uint32_t exhausted; /*!< 刷写页数用完的次数 */
+    uint32_t max_pages; /*!< 掉电后最多编程的页数 */
+    uint64_t max_time;  /*!< 掉电后最长的时间(ns) */
+} pvd_result_t;
+
+UART_HandleTypeDef usart1_handle = {.Instance = USART1};
+spi_bus_t spi1_bus;
+
+static pvd_result_t *result;
+static uint32_t seed;
+static jmp_buf parked;
+
+/* 串口接收FIFO, 和收到的全部数据 */
+static uint8_t fifo_buf[TEST_FIFO_SIZE];
+static ring_fifo_t *fifo;
+static uint8_t stream[TEST_STREAM_MAX];
+static uint32_t stream_len;
+
+/* 第几次到达触发位置时触发, 关中断时挂起到开中断 */
+static uint8_t pvd_at;
+static uint32_t pvd_countdown;
+static uint8_t pvd_pending;
+static uint8_t pvd_fired;
+static FILE *report;
+
+/* 触发时的状态 */
+static struct {
+    uint64_t time;     /*!< 时间 */
+    uint64_t programs; /*!< 编程次数 */
+    uint64_t erases;   /*!< 擦除次数 */
+    uint64_t aborts;   /*!< 结束的编程 */
+    uint64_t suspends; /*!< 暂停的擦除 */
+    uint32_t seq;      /*!< 暂存页的序号 */
+    uint32_t len;      /*!< 暂存页的数据长度 */
+    uint8_t data[FLASH_LOG_DATA_SIZE]; /*!< 暂存页的数据 */
+} snap;
+
+/**
+ * @brief 检查条件, 不满足时记一次失败, 只打印前几条
+ */
+#define PVD_CHECK(cond, ...)                                                  \
+    do {                                                                      \
+        if (!(cond)) {                                                        \
+            if (result->failed++ < TEST_MSG_MAX) {                            \
+                fprintf(report, "%s:%d: ", __FILE__, __LINE__);               \
+                fprintf(report, __VA_ARGS__);                                 \
+                fprintf(report, "\r\n");                                      \
+            }                                                                 \
+        }                                                                     \
+    } while (0)
+
+uint32_t HAL_GetTick(void) {
+    return (uint32_t)(w25q_sim_time / 1000000);
+}
+
+void HAL_Delay(uint32_t delay) {
+    w25q_sim_advance((uint64_t)delay * 1000000);
+}
+
+struct tm *rtc_get_time(void) {
+    static struct tm now = {.tm_year = 126, .tm_mon = 9, .tm_mday = 17};
+
+    return &now;
+}
+
+void pvd_init(uint32_t level) {
+    UNUSED(level);
+}
+
+/**
+ * @brief 中断等待电压恢复时回到测试
+ *
+ * @return 不返回
+ */
+uint8_t pvd_is_low(void) {
+    longjmp(parked, 1);
+}
+
+/**
+ * @brief 执行PVD中断
+ *
+ */
+static void pvd_fire(void) {
+    flash_log_t *log = recorder_get_log();
+
+    pvd_pending = 0;
+    pvd_fired = 1;
+    snap.time = w25q_sim_time;
+    snap.programs = w25q_sim_stats.programs;
+    snap.erases = w25q_sim_stats.erases;
+    snap.aborts = w25q_sim_stats.aborts;
+    snap.suspends = w25q_sim_stats.suspends;
+    snap.seq = log->seq;
+    snap.len = log->buf_len;
+    memcpy(snap.data, log->page.data, snap.len);
+
+    HAL_PWR_PVDCallback();
+    PVD_CHECK(0, "PVD handler returned");
+}
+
+/**
+ * @brief 到达一个可以触发的位置
+ *
+ * @param at 触发位置
+ */
+static void pvd_point(uint8_t at) {
+    if (pvd_fired || pvd_pending || (at != pvd_at) ||
+        (pvd_countdown == 0) || (--pvd_countdown != 0)) {
+        return;
+    }
+
+    result->fired[at]++;
+    pvd_pending = 1;
+    if (host_get_primask() == 0) {
+        pvd_fire();
+    } else {
+        result->deferred++;
+    }
+}
+
+void host_irq_unmasked(void) {
+    if (pvd_pending) {
+        pvd_fire();
+    }
+}
+
+void w25q_sim_command_callback(spi_trans_t *trans) {
+    pvd_point(PVD_AT_SPI);
+    if (trans->cmd[0] == 0x02) {
+        pvd_point(PVD_AT_PROGRAM);
+    }
+}
+
+uint32_t uart_dmarx_read(UART_HandleTypeDef *huart, void *buf, size_t len) {
+    UNUSED(huart);
+
+    /* 读出之后, 提交到暂存页之前 */
+    len = ring_fifo_read(fifo, buf, (uint32_t)len);
+    pvd_point(PVD_AT_READ);
+    return len;
+}
+
+void uart_dmarx_idle_callback(UART_HandleTypeDef *huart) {
+    UNUSED(huart);
+}
+
+/**
+ * @brief 中断停下后检查日志
+ *
+ */
+static void pvd_verify(void) {
+    static flash_log_page_t page;
+    flash_log_t *log = recorder_get_log();
+    recorder_parser_t parser;
+    record_hdr_t hdr;
+    const uint8_t *data;
+    uint32_t offset = 0, last_seq = 0, staged = 0;
+    uint32_t pages = (uint32_t)(w25q_sim_stats.programs - snap.programs -
+                                (w25q_sim_stats.aborts - snap.aborts));
+    uint64_t time = w25q_sim_time - snap.time;
+
+    PVD_CHECK(!w25q_sim_busy(0), "flash still busy when parked");
+    PVD_CHECK(w25q_sim_stats.erases == snap.erases, "erase issued after PVD");
+    PVD_CHECK(w25q_sim_stats.violations == 0,
+              "%u commands the chip would ignore",
+              (unsigned int)w25q_sim_stats.violations);
+
+    /* 预算按每页(编程时间 + 传输时间)计算, 被打断的页重新编程占一页,
+       被结束的编程不计 */
+    PVD_CHECK(pages <= RECORDER_PVD_FLUSH_PAGES + 1,
+              "%u pages programmed after PVD", (unsigned int)pages);
+    if (pages > result->max_pages) {
+        result->max_pages = pages;
+    }
+    if (time > result->max_time) {
+        result->max_time = time;
+    }
+    result->aborted += (w25q_sim_stats.aborts != snap.aborts);
+    result->suspended += (w25q_sim_stats.suspends != snap.suspends);
+
+    for (uint32_t p = log->tail; p != log->head; p = (p + 1) % log->page_num) {
+        if (flash_log_read_page(log, p, &page) != 0) {
+            PVD_CHECK(0, "page %u is invalid", (unsigned int)p);
+            continue;
+        }
+        PVD_CHECK((last_seq == 0) || (page.hdr.seq == last_seq + 1),
+                  "page %u seq %u after seq %u", (unsigned int)p,
+                  (unsigned int)page.hdr.seq, (unsigned int)last_seq);
+        last_seq = page.hdr.seq;
+
+        if ((page.hdr.seq == snap.seq) && (page.hdr.len >= snap.len) &&
+            (memcmp(page.data, snap.data, snap.len) == 0)) {
+            staged = 1;
+        }
+
+        recorder_parse_init(&parser, &page);
+        while ((data = recorder_parse(&parser, &hdr)) != NULL) {
+            if (hdr.type == RECORD_TYPE_SESSION) {
+                continue;
+            }
+            PVD_CHECK((offset + hdr.len <= stream_len) &&
+                          (memcmp(data, stream + offset, hdr.len) == 0),
+                      "page %u has %u bytes not received at offset %u",
+                      (unsigned int)p, (unsigned int)hdr.len,
+                      (unsigned int)offset);
+            offset += hdr.len;
+        }
+        PVD_CHECK(parser.offset == parser.len,
+                  "page %u has a broken record at %u", (unsigned int)p,
+                  (unsigned int)parser.offset);
+    }
+    PVD_CHECK(log->buf_len == 0, "%u bytes left in the staging page",
+              (unsigned int)log->buf_len);
+    PVD_CHECK((snap.len == 0) || staged,
+              "staging page seq %u with %u bytes not written",
+              (unsigned int)snap.seq, (unsigned int)snap.len);
+
+    /* FIFO中的数据只有在刷写页数用完时才能留下 */
+    if (offset != stream_len) {
+        PVD_CHECK((log->seq - snap.seq >= RECORDER_PVD_FLUSH_PAGES) ||
+                      (log->head == log->emergency_end),
+                  "%u bytes left in the FIFO after %u pages",
+                  (unsigned int)(stream_len - offset),
+                  (unsigned int)(log->seq - snap.seq));
+        result->exhausted++;
+    }
+}
+
+/**
+ * @brief 一次测试, 在子进程中运行
+ *
+ */
+static void pvd_trial(void) {
+    uint32_t len;
+
+    /* 固件的打印不输出 */
+    report = fdopen(dup(STDOUT_FILENO), "w");
+    setvbuf(report, NULL, _IOLBF, 0);
+    if (freopen("/dev/null", "w", stdout) == NULL) {
+        exit(2);
+    }
+
+    if (w25q_sim_attach(0, W25QXX_CS_GPIO_PORT, W25QXX_CS_GPIO_PIN, W25Q16,
+                        NULL) != 0) {
+        exit(2);
+    }
+    w25q_sim_seed = host_rand(&seed);
+    w25q_sim_power_on();
+
+    if (setjmp(parked) != 0) {
+        pvd_verify();
+        return;
+    }
+
+    backup_init();
+    fifo = ring_fifo_init(fifo_buf, sizeof(fifo_buf), RF_TYPE_STREAM);
+    recorder_init();
+    pvd_at = host_rand(&seed) % PVD_AT_NUM;
+    pvd_countdown = 1 + host_rand(&seed) %
+                            (1U << (host_rand(&seed) % (TEST_PVD_BITS + 1)));
+
+    for (uint32_t step = 0; step < TEST_STEPS_MAX; ++step) {
+        len = 0;
+        if (host_rand(&seed) % TEST_BURST_RATE == 0) {
+            len = TEST_FIFO_SIZE;
+        } else if (host_rand(&seed) % 4 != 0) {
+            len = host_rand(&seed) % TEST_BYTES_MS;
+        }
+        for (uint32_t i = 0; i < len; ++i) {
+            stream[stream_len + i] = (uint8_t)host_rand(&seed);
+        }
+        stream_len += ring_fifo_write(fifo, stream + stream_len, len);
+
+        recorder_poll();
+        w25q_sim_advance(1000000);
+    }
+
+    PVD_CHECK(0, "PVD never triggered");
+}
+
+int main(int argc, char *argv[]) {
+    uint32_t trials = TEST_TRIALS;
+    int status;
+
+    report = stdout;
+    seed = 0x7A2E0051;
+    if (argc > 1) {
+        trials = (uint32_t)strtoul(argv[1], NULL, 0);
+    }
+    if (argc > 2) {
+        seed = (uint32_t)strtoul(argv[2], NULL, 0);
+    }
+
+    result = mmap(NULL, sizeof(pvd_result_t), PROT_READ | PROT_WRITE,
+                  MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (result == MAP_FAILED) {
+        return 2;
+    }
+    memset(result, 0, sizeof(*result));
+
+    for (uint32_t n = 0; (n < trials) && (result->failed == 0); ++n) {
+        seed = host_rand(&seed);
+        if (fork() == 0) {
+            pvd_trial();
+            exit(0);
+        }
+        if ((wait(&status) < 0) || !WIFEXITED(status) ||
+            (WEXITSTATUS(status) != 0)) {
+            PVD_CHECK(0, "trial %u crashed", (unsigned int)n);
+        }
+        result->trials++;
+        if (result->failed != 0) {
+            printf("trial %u failed\r\n", (unsigned int)n);
+        }
+    }
+
+    printf("%u trials, fired %u times reading the FIFO, %u in SPI "
+           "commands, %u in page programs\r\n",
+           (unsigned int)result->trials,
+           (unsigned int)result->fired[PVD_AT_READ],
+           (unsigned int)result->fired[PVD_AT_SPI],
+           (unsigned int)result->fired[PVD_AT_PROGRAM]);
+    printf("%u deferred until interrupts were enabled\r\n",
+           (unsigned int)result->deferred);
+    printf("%u programs aborted, %u erases suspended, %u out of budget\r\n",
+           (unsigned int)result->aborted, (unsigned int)result->suspended,
+           (unsigned int)result->exhausted);
+    printf("at most %u pages and %.2f ms after PVD\r\n",
+           (unsigned int)result->max_pages, (double)result->max_time / 1e6);
+
+    test_failed = result->failed;
+    return test_report("test_pvd");
+}
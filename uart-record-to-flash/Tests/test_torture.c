@@ -0,0 +1,604 @@
+/**
+ * @file    test_torture.c
+ * @author  Deadline039
+ * @brief   存储栈的掉电一致性测试
+ * @version 1.0
+ * @date    2026-10-17
+ * @note    串口FIFO, 记录器的暂存页, Flash日志, W25Qxx驱动和备份域使用
+ *          固件源文件, SPI总线换成w25q_sim.c中的模拟芯片, 芯片内容在文件中.
+ *
+ *          每次上电在一个子进程中运行, 都从同一个初始状态开始, 和复位后
+ *          RAM重新初始化一样; 芯片文件和备份域在两次上电之间保留.
+ *          上电后挂载日志, 等待编程完成后检查:
+ *          - 编程已完成的页都在日志范围内, 内容和写入时相同
+ *          - 日志范围内读到的有效页都是写入过的内容, 序号连续, 记录完整
+ *          - 掉电前同步到备份域的暂存页数据已写回Flash
+ *          之后串口持续收到数据, 在本次上电的第N个SPI事务前掉电, 正在进行的
+ *          编程和擦除只完成一部分. N在各次上电中按固定步长取遍
+ *          1 ~ `TEST_CUT_SPAN`, 覆盖挂载, 编程, 擦除和等待芯片空闲中的每个位置.
+ *
+ *          每个CPU核运行一个进程, 各自使用一片芯片, 一半进程用板载芯片,
+ *          一半用W25Q16, 更快写满一圈. 出错的进程停止并保留芯片文件.
+ *          make test_torture ARGS="上电次数 [种子] [进程数]"
+ */
+
+#include "test.h"
+
+#include "recorder.h"
+#include "ring_fifo.h"
+#include "rtc.h"
+#include "w25q_sim.h"
+
+#include <setjmp.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+/* 默认的上电次数, 所有进程合计 */
+#define TEST_SESSIONS    1000
+/* 掉电位置的范围(事务数), 和步长互质, 连续`TEST_CUT_SPAN`次上电
+   覆盖范围内的每个位置 */
+#define TEST_CUT_SPAN    100000
+#define TEST_CUT_STRIDE  7919
+/* 一次上电最多运行的时间(ms), 超过说明没有访问Flash */
+#define TEST_STEPS_MAX   600000
+/* 串口波特率, 每毫秒最多收到的字节数 */
+#define TEST_BAUD        921600
+#define TEST_BYTES_MS    (TEST_BAUD / 10 / 1000)
+/* 串口FIFO大小 */
+#define TEST_FIFO_SIZE   4096
+/* 平均每多少毫秒收满一次FIFO, 连续写入多页, 多片时几片同时在编程 */
+#define TEST_BURST_RATE  64
+/* 一次上电中最多记录的备份域数据 */
+#define TEST_ACK_MAX     1024
+/* 一次上电中最多编程的页数 */
+#define TEST_ISSUED_MAX  4096
+/* 每个进程最多打印的错误数 */
+#define TEST_MSG_MAX     10
+
+/* 备份域, 两次上电之间保留 */
+#define TEST_BACKUP_BASE BKP_BASE
+#define TEST_BACKUP_SIZE sizeof(BKP_TypeDef)
+
+/* 页的状态 */
+#define PAGE_BLANK       0 /* 没有编程过 */
+#define PAGE_ISSUED      1 /* 已发出编程命令 */
+#define PAGE_DONE        2 /* 编程已完成 */
+#define PAGE_TORN        3 /* 编程时掉电 */
+#define PAGE_ERASED      4 /* 已发出擦除命令, 擦除可能没有完成 */
+
+/**
+ * @brief 每页的记录, 按日志页号排列
+ */
+typedef struct {
+    uint64_t hash;  /*!< 最后一次编程的内容 */
+    uint32_t seq;   /*!< 最后一次编程的页序号 */
+    uint8_t state;  /*!< 页的状态 */
+    uint8_t dirty;  /*!< 上次检查后编程或擦除过 */
+    uint8_t valid;  /*!< 上次检查时是有效页 */
+} shadow_page_t;
+
+/**
+ * @brief 进程内各次上电共享的状态
+ */
+typedef struct {
+    uint32_t failed;   /*!< 失败次数 */
+    uint32_t sessions; /*!< 上电次数 */
+    uint32_t boot_cut; /*!< 挂载中掉电的次数 */
+    uint32_t torn;     /*!< 编程中掉电的次数 */
+    uint32_t erasing;  /*!< 擦除中掉电的次数 */
+    uint64_t pages;    /*!< 检查的有效页数 */
+    uint64_t bytes;    /*!< 串口收到的字节数 */
+    uint64_t acked;    /*!< 复位后确认写回的备份域数据 */
+    uint64_t commands; /*!< SPI事务数 */
+
+    /* 同步到备份域的暂存页数据, 下次上电时检查 */
+    uint32_t ack_num;
+    struct {
+        uint32_t seq;  /*!< 页序号 */
+        uint32_t len;  /*!< 数据长度 */
+        uint64_t hash; /*!< 数据 */
+    } ack[TEST_ACK_MAX];
+
+    uint8_t backup[TEST_BACKUP_SIZE]; /*!< 掉电时的备份域 */
+} torture_state_t;
+
+UART_HandleTypeDef usart1_handle = {.Instance = USART1};
+spi_bus_t spi1_bus;
+
+static torture_state_t *state;
+static shadow_page_t *shadow;
+static uint32_t page_num;
+static FILE *report;
+static uint32_t seed;
+
+/* 本次上电中编程的页 */
+static uint32_t issued[TEST_ISSUED_MAX];
+static uint32_t issued_num;
+static uint8_t mounted;
+
+/* 串口接收FIFO */
+static uint8_t fifo_buf[TEST_FIFO_SIZE];
+static ring_fifo_t *fifo;
+
+/**
+ * @brief 检查条件, 不满足时记一次失败, 只打印前几条
+ */
+#define TORTURE_CHECK(cond, ...)                                              \
+    do {                                                                      \
+        if (!(cond)) {                                                        \
+            if (state->failed++ < TEST_MSG_MAX) {                             \
+                fprintf(report, "%s:%d: ", __FILE__, __LINE__);               \
+                fprintf(report, __VA_ARGS__);                                 \
+                fprintf(report, "\r\n");                                      \
+            }                                                                 \
+        }                                                                     \
+    } while (0)
+
+/**
+ * @brief FNV-1a散列
+ *
+ * @param data 数据
+ * @param len 长度
+ * @return 散列值
+ */
+static uint64_t hash64(const void *data, uint32_t len) {
+    const uint8_t *p = (const uint8_t *)data;
+    uint64_t h = 0xCBF29CE484222325ULL;
+
+    while (len--) {
+        h = (h ^ *p++) * 0x100000001B3ULL;
+    }
+    return h;
+}
+
+/**
+ * @brief 芯片地址转换为日志页号
+ *
+ * @param chip 芯片序号
+ * @param addr 地址
+ * @return 页号
+ */
+static uint32_t torture_page(uint32_t chip, uint32_t addr) {
+    return ((addr - RECORDER_LOG_BASE) / W25QXX_PAGE_SIZE) *
+               FLASH_LOG_CHIP_NUM +
+           chip;
+}
+
+void w25q_sim_program_callback(uint32_t chip, uint32_t addr,
+                               const uint8_t *data, uint32_t len) {
+    shadow_page_t *s = &shadow[torture_page(chip, addr)];
+    flash_log_page_hdr_t hdr;
+
+    TORTURE_CHECK((addr % W25QXX_PAGE_SIZE == 0) && (len >= sizeof(hdr)),
+                  "program of %u bytes at 0x%08X", (unsigned int)len,
+                  (unsigned int)addr);
+    memcpy(&hdr, data, sizeof(hdr));
+
+    s->hash = hash64(data, len);
+    s->seq = hdr.seq;
+    s->state = PAGE_ISSUED;
+    s->dirty = 1;
+    if (issued_num < TEST_ISSUED_MAX) {
+        issued[issued_num++] = torture_page(chip, addr);
+    }
+}
+
+void w25q_sim_erase_callback(uint32_t chip, uint32_t addr) {
+    for (uint32_t i = 0; i < W25QXX_SECTOR_SIZE; i += W25QXX_PAGE_SIZE) {
+        shadow[torture_page(chip, addr + i)].state = PAGE_ERASED;
+        shadow[torture_page(chip, addr + i)].dirty = 1;
+    }
+}
+
+void w25q_sim_cut_callback(uint32_t chip, uint32_t addr, uint8_t erase) {
+    if (erase) {
+        state->erasing++;
+    } else {
+        shadow[torture_page(chip, addr)].state = PAGE_TORN;
+        state->torn++;
+    }
+}
+
+/**
+ * @brief 已发出的编程都已完成
+ *
+ * @note 挂载后等待芯片空闲, 和掉电后调用. 掉电时正在进行的编程已由
+ *       `w25q_sim_cut_callback`标记
+ */
+static void torture_settle(void) {
+    for (uint32_t i = 0; i < issued_num; ++i) {
+        if (shadow[issued[i]].state == PAGE_ISSUED) {
+            shadow[issued[i]].state = PAGE_DONE;
+        }
+    }
+    issued_num = 0;
+}
+
+uint32_t HAL_GetTick(void) {
+    return (uint32_t)(w25q_sim_time / 1000000);
+}
+
+void HAL_Delay(uint32_t delay) {
+    w25q_sim_advance((uint64_t)delay * 1000000);
+}
+
+struct tm *rtc_get_time(void) {
+    static struct tm now = {.tm_year = 126, .tm_mon = 9, .tm_mday = 17};
+
+    return &now;
+}
+
+void pvd_init(uint32_t level) {
+    UNUSED(level);
+}
+
+uint8_t pvd_is_low(void) {
+    return 1;
+}
+
+uint32_t uart_dmarx_read(UART_HandleTypeDef *huart, void *buf, size_t len) {
+    UNUSED(huart);
+
+    return ring_fifo_read(fifo, buf, (uint32_t)len);
+}
+
+void uart_dmarx_idle_callback(UART_HandleTypeDef *huart) {
+    UNUSED(huart);
+}
+
+/**
+ * @brief 记录备份域中的暂存页数据, 复位后应当写回Flash
+ *
+ */
+static void torture_ack(void) {
+    static uint8_t buf[FLASH_LOG_JOURNAL_DATA_SIZE];
+    flash_log_journal_t journal;
+    uint32_t i;
+
+    backup_read(0, &journal, sizeof(journal));
+    if ((journal.len == 0) || (journal.len > sizeof(buf))) {
+        return;
+    }
+    backup_read(sizeof(journal), buf, journal.len);
+
+    for (i = 0; i < state->ack_num; ++i) {
+        if (state->ack[i].seq == journal.seq) {
+            break;
+        }
+    }
+    if (i == state->ack_num) {
+        if (i == TEST_ACK_MAX) {
+            return;
+        }
+        state->ack_num++;
+    }
+    state->ack[i].seq = journal.seq;
+    state->ack[i].len = journal.len;
+    state->ack[i].hash = hash64(buf, journal.len);
+}
+
+/**
+ * @brief 检查一页有效页
+ *
+ * @param p 页号
+ * @param page 读出的页
+ */
+static void torture_check_page(uint32_t p, const flash_log_page_t *page) {
+    shadow_page_t *s = &shadow[p];
+    recorder_parser_t parser;
+    record_hdr_t hdr;
+    uint32_t i;
+
+    TORTURE_CHECK((s->state != PAGE_BLANK) &&
+                      (hash64(page, sizeof(page->hdr) + page->hdr.len) ==
+                       s->hash) &&
+                      (page->hdr.seq == s->seq),
+                  "page %u seq %u was never written", (unsigned int)p,
+                  (unsigned int)page->hdr.seq);
+
+    recorder_parse_init(&parser, page);
+    while (recorder_parse(&parser, &hdr) != NULL)
+        ;
+    TORTURE_CHECK(parser.offset == parser.len,
+                  "page %u has a broken record at %u", (unsigned int)p,
+                  (unsigned int)parser.offset);
+
+    for (i = 0; i < state->ack_num; ++i) {
+        if ((state->ack[i].seq == page->hdr.seq) &&
+            (state->ack[i].len <= page->hdr.len) &&
+            (hash64(page->data, state->ack[i].len) == state->ack[i].hash)) {
+            state->ack[i] = state->ack[--state->ack_num];
+            state->acked++;
+            break;
+        }
+    }
+}
+
+/**
+ * @brief 挂载后检查整个日志
+ *
+ */
+static void torture_verify(void) {
+    static flash_log_page_t page;
+    flash_log_t *log = recorder_get_log();
+    uint32_t num = (log->head + page_num - log->tail) % page_num;
+    uint32_t last_seq = 0;
+    shadow_page_t *s;
+    uint32_t p;
+
+    /* 日志范围内的页 */
+    for (uint32_t i = 0; i < num; ++i) {
+        p = (log->tail + i) % page_num;
+        s = &shadow[p];
+
+        if (s->dirty) {
+            s->valid = (flash_log_read_page(log, p, &page) == 0);
+            s->dirty = 0;
+            if (s->valid) {
+                torture_check_page(p, &page);
+                state->pages++;
+            }
+        }
+
+        TORTURE_CHECK(s->valid || (s->state != PAGE_DONE),
+                      "page %u seq %u lost", (unsigned int)p,
+                      (unsigned int)s->seq);
+        if (!s->valid) {
+            continue;
+        }
+        /* 编程被打断的页不占用序号 */
+        TORTURE_CHECK((last_seq == 0) || (s->seq == last_seq + 1),
+                      "page %u seq %u after seq %u", (unsigned int)p,
+                      (unsigned int)s->seq, (unsigned int)last_seq);
+        last_seq = s->seq;
+    }
+    TORTURE_CHECK((last_seq == 0) || (log->seq == last_seq + 1),
+                  "next seq %u after seq %u", (unsigned int)log->seq,
+                  (unsigned int)last_seq);
+
+    /* 日志范围外不能有编程完成的页 */
+    for (uint32_t i = num; i < page_num; ++i) {
+        p = (log->tail + i) % page_num;
+        TORTURE_CHECK(shadow[p].state != PAGE_DONE,
+                      "page %u seq %u outside the log (tail %u, head %u)",
+                      (unsigned int)p, (unsigned int)shadow[p].seq,
+                      (unsigned int)log->tail, (unsigned int)log->head);
+    }
+
+    for (uint32_t i = 0; i < state->ack_num; ++i) {
+        TORTURE_CHECK(0, "%u bytes of seq %u in the backup domain lost",
+                      (unsigned int)state->ack[i].len,
+                      (unsigned int)state->ack[i].seq);
+    }
+    state->ack_num = 0;
+}
+
+/**
+ * @brief 上电后运行, 直到掉电
+ *
+ */
+static void torture_run(void) {
+    uint8_t data[2 * TEST_BYTES_MS];
+    uint32_t len, left;
+
+    for (uint32_t step = 0; step < TEST_STEPS_MAX; ++step) {
+        /* 有时空闲, 有时连续收到数据, 偶尔一次收满FIFO */
+        left = 0;
+        if (host_rand(&seed) % TEST_BURST_RATE == 0) {
+            left = TEST_FIFO_SIZE;
+        } else if (host_rand(&seed) % 4 != 0) {
+            left = host_rand(&seed) % sizeof(data);
+        }
+        while (left != 0) {
+            len = (left < sizeof(data)) ? left : sizeof(data);
+            for (uint32_t i = 0; i < len; ++i) {
+                data[i] = (uint8_t)host_rand(&seed);
+            }
+            len = ring_fifo_write(fifo, data, len);
+            state->bytes += len;
+            left = (len != 0) ? left - len : 0;
+        }
+
+        recorder_poll();
+        torture_ack();
+        w25q_sim_advance(1000000);
+    }
+
+    TORTURE_CHECK(0, "no power cut within %u ms", TEST_STEPS_MAX);
+}
+
+/**
+ * @brief 一次上电, 在子进程中运行
+ *
+ * @param cut 在第几个SPI事务前掉电
+ */
+static void torture_session(uint32_t cut) {
+    static jmp_buf power_cut;
+    uint32_t left;
+
+    w25q_sim_power_on();
+    memcpy((void *)TEST_BACKUP_BASE, state->backup, TEST_BACKUP_SIZE);
+    w25q_sim_stats.commands = 0;
+
+    if (setjmp(power_cut) == 0) {
+        w25q_sim_cut_at(cut, &power_cut);
+
+        backup_init();
+        fifo = ring_fifo_init(fifo_buf, sizeof(fifo_buf), RF_TYPE_STREAM);
+        recorder_init();
+        mounted = 1;
+
+        /* 检查时不掉电 */
+        left = w25q_sim_cut_at(0, NULL);
+        flash_log_sync(recorder_get_log());
+        torture_settle();
+        torture_verify();
+        w25q_sim_cut_at(left, &power_cut);
+
+        torture_run();
+    } else if (!mounted) {
+        state->boot_cut++;
+    }
+
+    torture_settle();
+    TORTURE_CHECK(w25q_sim_stats.violations == 0,
+                  "%u commands the chip would ignore",
+                  (unsigned int)w25q_sim_stats.violations);
+    state->commands += w25q_sim_stats.commands;
+    memcpy(state->backup, (void *)TEST_BACKUP_BASE, TEST_BACKUP_SIZE);
+}
+
+/**
+ * @brief 一个进程, 使用一片芯片反复上电
+ *
+ * @param worker 进程序号
+ * @param workers 进程数
+ * @param sessions 本进程的上电次数
+ * @param[out] result 结果, 在共享内存中
+ * @return 0-通过, 1-失败
+ */
+static int torture_worker(uint32_t worker, uint32_t workers, uint32_t sessions,
+                          torture_state_t *result) {
+    uint16_t id = (worker % 2) ? W25Q16 : W25Q64;
+    char path[FLASH_LOG_CHIP_NUM][128];
+    const char *dir = getenv("TMPDIR");
+    GPIO_TypeDef *cs_port[2] = {W25QXX_CS_GPIO_PORT, W25QXX_CS2_GPIO_PORT};
+    uint16_t cs_pin[2] = {W25QXX_CS_GPIO_PIN, W25QXX_CS2_GPIO_PIN};
+    uint32_t cut;
+    pid_t pid;
+    int status;
+
+    state = result;
+    seed ^= (worker + 1) * 0x9E3779B9U;
+    w25q_sim_seed ^= seed;
+    w25q_sim_clock = 18000000;
+
+    for (uint32_t i = 0; i < FLASH_LOG_CHIP_NUM; ++i) {
+        snprintf(path[i], sizeof(path[i]), "%s/torture_%d_%u.bin",
+                 dir ? dir : "/tmp", (int)getpid(), (unsigned int)i);
+        if (w25q_sim_attach(i, cs_port[i], cs_pin[i], id, path[i]) != 0) {
+            return 1;
+        }
+    }
+    page_num = ((1UL << ((id & 0xFF) + 1)) - RECORDER_LOG_BASE) /
+               W25QXX_PAGE_SIZE * FLASH_LOG_CHIP_NUM;
+    shadow = mmap(NULL, page_num * sizeof(shadow_page_t),
+                  PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (shadow == MAP_FAILED) {
+        return 1;
+    }
+
+    /* 固件的打印不输出 */
+    report = fdopen(dup(STDOUT_FILENO), "w");
+    setvbuf(report, NULL, _IOLBF, 0);
+    if (freopen("/dev/null", "w", stdout) == NULL) {
+        return 1;
+    }
+
+    for (uint32_t n = 0; (n < sessions) && (state->failed == 0); ++n) {
+        cut = 1 + (uint32_t)((uint64_t)(n * workers + worker) *
+                             TEST_CUT_STRIDE % TEST_CUT_SPAN);
+        seed = host_rand(&seed);
+        w25q_sim_seed = host_rand(&seed);
+
+        pid = fork();
+        if (pid == 0) {
+            torture_session(cut);
+            exit(0);
+        }
+        if ((pid < 0) || (waitpid(pid, &status, 0) != pid) ||
+            !WIFEXITED(status) || (WEXITSTATUS(status) != 0)) {
+            TORTURE_CHECK(0, "session %u crashed", (unsigned int)n);
+        }
+        state->sessions++;
+
+        if (state->failed != 0) {
+            fprintf(report,
+                    "worker %u failed in session %u, cut at %u, "
+                    "image kept in %s\r\n",
+                    (unsigned int)worker, (unsigned int)n, (unsigned int)cut,
+                    path[0]);
+        }
+    }
+
+    for (uint32_t i = 0; i < FLASH_LOG_CHIP_NUM; ++i) {
+        w25q_sim_detach(i, state->failed != 0);
+    }
+    return state->failed != 0;
+}
+
+int main(int argc, char *argv[]) {
+    uint32_t sessions = TEST_SESSIONS;
+    uint32_t workers = (uint32_t)sysconf(_SC_NPROCESSORS_ONLN);
+    torture_state_t *result, total = {0};
+    struct timespec start, end;
+    int status;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    seed = 0x7A2E0054;
+    if (argc > 1) {
+        sessions = (uint32_t)strtoul(argv[1], NULL, 0);
+    }
+    if (argc > 2) {
+        seed = (uint32_t)strtoul(argv[2], NULL, 0);
+    }
+    if (argc > 3) {
+        workers = (uint32_t)strtoul(argv[3], NULL, 0);
+    }
+    if (workers == 0) {
+        workers = 1;
+    }
+
+    result = mmap(NULL, workers * sizeof(torture_state_t),
+                  PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (result == MAP_FAILED) {
+        return 2;
+    }
+    memset(result, 0, workers * sizeof(torture_state_t));
+
+    for (uint32_t w = 0; w < workers; ++w) {
+        if (fork() == 0) {
+            exit(torture_worker(w, workers,
+                                sessions / workers + (w < sessions % workers),
+                                &result[w]));
+        }
+    }
+    for (uint32_t w = 0; w < workers; ++w) {
+        if ((wait(&status) < 0) || !WIFEXITED(status) ||
+            (WEXITSTATUS(status) != 0)) {
+            test_failed++;
+        }
+    }
+
+    for (uint32_t w = 0; w < workers; ++w) {
+        total.sessions += result[w].sessions;
+        total.boot_cut += result[w].boot_cut;
+        total.torn += result[w].torn;
+        total.erasing += result[w].erasing;
+        total.pages += result[w].pages;
+        total.bytes += result[w].bytes;
+        total.acked += result[w].acked;
+        total.commands += result[w].commands;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    printf("%u power cuts with %u chip(s) on %u cores in %.1f s: "
+           "%u while mounting, %u while programming, %u while erasing\r\n",
+           (unsigned int)total.sessions, (unsigned int)FLASH_LOG_CHIP_NUM,
+           (unsigned int)workers,
+           (double)(end.tv_sec - start.tv_sec) +
+               (double)(end.tv_nsec - start.tv_nsec) / 1e9,
+           (unsigned int)total.boot_cut,
+           (unsigned int)total.torn, (unsigned int)total.erasing);
+    printf("%llu SPI commands, %llu bytes received, %llu pages checked, "
+           "%llu journal writes recovered\r\n",
+           (unsigned long long)total.commands,
+           (unsigned long long)total.bytes, (unsigned long long)total.pages,
+           (unsigned long long)total.acked);
+
+    return test_report("test_torture");
+}
@@ -10,5 +10,8 @@
 #define __INCLUDES_H
 
 #include "bsp.h"
+#include "playback.h"
+#include "query.h"
+#include "recorder.h"
 
 #endif /* __INCLUDES_H */
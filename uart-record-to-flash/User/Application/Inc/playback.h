@@ -0,0 +1,45 @@
+/**
+ * @file    playback.h
+ * @author  Deadline039
+ * @brief   串口记录回放
+ * @version 1.0
+ * @date    2026-10-17
+ */
+
+#ifndef __PLAYBACK_H
+#define __PLAYBACK_H
+
+#include "query.h"
+#include "timer.h"
+
+// <<< Use Configuration Wizard in Context Menu >>>
+
+//  <o> 回放缓冲的记录数 <2-16>
+//  <i> 每条占用一页数据长度的内存
+#define PLAYBACK_QUEUE_NUM      4
+
+//  <o> 每次轮询最多读取的页数
+//  <i> 限制每次轮询占用的时间, 回放时不影响记录
+#define PLAYBACK_PAGES_PER_POLL 4
+
+//  <o> 最多查找的上电次数
+#define PLAYBACK_SESSION_MAX    8
+
+//  <o> 迟到阈值(us)
+//  <i> 实际发送时间比原始时间晚超过该值的计为迟到
+#define PLAYBACK_LATE_US        100
+
+//  <o> 开始延时(us)
+//  <i> 第一条记录在缓冲区中准备好之后多久开始发送
+#define PLAYBACK_START_DELAY    1000
+
+// <<< end of configuration section >>>
+
+/* 回放使用的串口, 需要启用发送DMA */
+#define PLAYBACK_UART_HANDLE usart1_handle
+
+uint8_t playback_start(uint32_t session, uint32_t speed, uint8_t channels);
+void playback_stop(void);
+void playback_poll(void);
+
+#endif /* __PLAYBACK_H */
@@ -0,0 +1,122 @@
+/**
+ * @file    recorder.h
+ * @author  Deadline039
+ * @brief   串口数据记录
+ * @version 1.0
+ * @date    2026-10-17
+ */
+
+#ifndef __RECORDER_H
+#define __RECORDER_H
+
+#include "dod.h"
+#include "flash_log.h"
+#include "pvd.h"
+#include "uart.h"
+
+// <<< Use Configuration Wizard in Context Menu >>>
+
+//  <o> 日志区起始地址
+//  <i> 必须扇区(4K)对齐, 之前的空间留给其他用途
+#define RECORDER_LOG_BASE    0
+
+//  <q> 压缩记录头
+//  <i> 页内第一条之后的串口记录使用3字节记录头, 时间戳相对页内上一条记录
+//  <i> 按二阶差分编码, 占1到5字节. 完整记录头为8字节
+#define RECORDER_COMPACT_HDR 1
+
+// <e> 掉电刷写
+// ==================
+// <i> 电源跌落到PVD阈值时把缓冲区中的数据写入Flash
+
+#define RECORDER_USE_PVD  1
+
+#if (RECORDER_USE_PVD == 1)
+
+//  <o RECORDER_PVD_LEVEL> PVD阈值
+//      <PWR_PVDLEVEL_0=>2.2V
+//      <PWR_PVDLEVEL_1=>2.3V
+//      <PWR_PVDLEVEL_2=>2.4V
+//      <PWR_PVDLEVEL_3=>2.5V
+//      <PWR_PVDLEVEL_4=>2.6V
+//      <PWR_PVDLEVEL_5=>2.7V
+//      <PWR_PVDLEVEL_6=>2.8V
+//      <PWR_PVDLEVEL_7=>2.9V
+#define RECORDER_PVD_LEVEL       PWR_PVDLEVEL_7
+
+//  <o> 掉电时最多写入的页数
+//  <i> 每页编程典型0.7ms, 最长3ms. 需要保证3.3V跌落到阈值后,
+//  <i> 储能电容能维持(页数 + 1) * 3ms + 20us
+#define RECORDER_PVD_FLUSH_PAGES 4
+
+#endif /* RECORDER_USE_PVD == 1 */
+
+// </e>
+
+// <<< end of configuration section >>>
+
+/* 记录类型 */
+#define RECORD_TYPE_SESSION      0x00 /* 上电, 数据为RTC时间(time_t) */
+#define RECORD_TYPE_UART         0x01 /* 串口数据, 通道为串口号 */
+#define RECORD_TYPE_UART_COMPACT 0x02 /* 串口数据, 压缩记录头 */
+#define RECORD_TYPE_NUM          0x03 /* 记录类型数量 */
+
+/**
+ * @brief 记录头, 每条记录前都有
+ */
+typedef struct {
+    uint8_t type;    /*!< 记录类型 */
+    uint8_t channel; /*!< 通道 */
+    uint16_t len;    /*!< 数据长度, 不含记录头 */
+    uint32_t time;   /*!< 时间戳(ms) */
+} record_hdr_t;
+
+/**
+ * @brief 压缩记录头, 后面是时间戳的二阶差分编码, 补齐到整字节, 然后是数据
+ * @note 时间戳相对页内上一条记录, 所以不会是页内第一条记录. 一页的数据
+ *       不超过255字节, 长度用一个字节. 解析后按串口数据记录处理
+ */
+typedef struct {
+    uint8_t type;    /*!< 记录类型 */
+    uint8_t channel; /*!< 通道 */
+    uint8_t len;     /*!< 数据长度, 不含记录头和时间戳 */
+} record_compact_hdr_t;
+
+/**
+ * @brief 页内记录解析状态
+ */
+typedef struct {
+    const uint8_t *data; /*!< 页数据 */
+    uint32_t len;        /*!< 页数据长度 */
+    uint32_t offset;     /*!< 下一条记录的偏移 */
+    dod_t dod;           /*!< 时间戳解码状态 */
+} recorder_parser_t;
+
+/* 页摘要中的时间未知, 例如复位后写回的上次上电的数据 */
+#define RECORD_TIME_UNKNOWN 0xFFFFFFFF
+
+/**
+ * @brief 页摘要, 存放在日志页头中, 检索时用来跳过不相关的页
+ */
+typedef struct {
+    uint32_t time;    /*!< 页内第一条记录的RTC时间(s) */
+    uint32_t tick;    /*!< 页内第一条记录的时间戳(ms) */
+    uint16_t span;    /*!< 最后一条记录与第一条相差的时间(s), 向上取整 */
+    uint8_t types;    /*!< 页内记录类型的位图 */
+    uint8_t channels; /*!< 页内通道的位图, 通道号大于7的都记在bit7 */
+} record_meta_t;
+
+void recorder_init(void);
+void recorder_poll(void);
+uint8_t recorder_write(uint8_t type, uint8_t channel, const void *data,
+                       uint32_t len);
+uint8_t recorder_flush(void);
+
+void recorder_parse_init(recorder_parser_t *parser,
+                         const flash_log_page_t *page);
+const uint8_t *recorder_parse(recorder_parser_t *parser, record_hdr_t *hdr);
+
+void recorder_check(void);
+flash_log_t *recorder_get_log(void);
+
+#endif /* __RECORDER_H */
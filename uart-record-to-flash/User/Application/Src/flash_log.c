@@ -0,0 +1,848 @@
+/**
+ * @file    flash_log.c
+ * @author  Deadline039
+ * @brief   SPI Flash循环日志
+ * @version 1.0
+ * @date    2026-10-17
+ * @note    日志区按页追加写入, 写满后回到开头覆盖最旧的扇区.
+ *          每页带页头, 页头的CRC覆盖页头和数据, CRC正确即认为该页已提交,
+ *          编程被打断的页CRC不对, 挂载和读取时会被忽略.
+ *
+ *          进入一个新扇区时会立即发起下一个扇区的擦除(预擦除), 所以任何时候
+ *          正在擦除的扇区都不是当前写入的扇区, 掉电时可以暂停擦除,
+ *          把暂存页写入当前扇区.
+ *
+ *          使用两片Flash时, 偶数页在第一片, 奇数页在第二片, 两片的同一扇区
+ *          合起来作为日志的一个扇区. 编程命令发出后立即返回, 下一页写另一片
+ *          时不用等待上一页编程完成.
+ *
+ *          启用备份域日志时, 暂存页中已提交的数据和写入位置同步到备份域.
+ *          复位后先校验备份域中的写入位置, 和Flash一致时直接使用,
+ *          不再扫描日志区, 并把暂存页数据写回Flash.
+ *
+ *          连续读取相邻的页时认为是顺序读取, 之后的页用DMA读到预读缓冲区,
+ *          一页读完在中断中立即发起下一页, 读取方取数据时通常已经读好,
+ *          SPI时钟几乎不间断. 预读不会越过写入位置.
+ *
+ *          页头中有一段摘要, 写入Flash前由使用者根据页内数据填写,
+ *          检索时先只读页头, 用摘要判断是否需要读取整页.
+ */
+
+#include "flash_log.h"
+
+#include <stddef.h>
+#include <string.h>
+
+/**
+ * @brief 计算CRC16-CCITT
+ *
+ * @param crc 初值
+ * @param data 数据
+ * @param len 数据长度
+ * @return CRC
+ */
+static uint16_t flash_log_crc16(uint16_t crc, const uint8_t *data,
+                                uint32_t len) {
+    while (len--) {
+        crc ^= (uint16_t)(*data++) << 8;
+        for (uint8_t i = 0; i < 8; ++i) {
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021)
+                                 : (uint16_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+/**
+ * @brief 计算一页的CRC
+ *
+ * @param page 页
+ * @return CRC
+ */
+static uint16_t flash_log_page_crc(const flash_log_page_t *page) {
+    uint16_t crc = flash_log_crc16(0xFFFF, (const uint8_t *)&page->hdr,
+                                   offsetof(flash_log_page_hdr_t, crc));
+    crc = flash_log_crc16(crc, page->hdr.meta, sizeof(page->hdr.meta));
+    return flash_log_crc16(crc, page->data, page->hdr.len);
+}
+
+/**
+ * @brief 页号转换为Flash地址
+ *
+ * @param log 日志句柄
+ * @param page 页号
+ * @return 地址
+ */
+static inline uint32_t flash_log_page_addr(flash_log_t *log, uint32_t page) {
+    return log->base +
+           ((page % log->page_num) / FLASH_LOG_CHIP_NUM) * W25QXX_PAGE_SIZE;
+}
+
+/**
+ * @brief 页所在的Flash
+ *
+ * @param log 日志句柄
+ * @param page 页号
+ * @return Flash设备
+ */
+static inline w25qxx_t *flash_log_page_dev(flash_log_t *log, uint32_t page) {
+    return log->dev[(page % log->page_num) % FLASH_LOG_CHIP_NUM];
+}
+
+/**
+ * @brief 日志区扇区数
+ *
+ * @param log 日志句柄
+ * @return 扇区数
+ */
+static inline uint32_t flash_log_sector_num(flash_log_t *log) {
+    return log->page_num / FLASH_LOG_PAGES_PER_SECTOR;
+}
+
+#if (FLASH_LOG_READ_AHEAD > 0)
+
+/* 正在预读的日志, 同一时间只有一个DMA读取 */
+static flash_log_t *flash_log_ra_log;
+
+/**
+ * @brief 预读缓冲区未满且没有正在进行的读取时, 发起下一页的读取
+ *
+ * @param log 日志句柄
+ * @note 在主循环和DMA完成中断中调用
+ */
+static void flash_log_ra_issue(flash_log_t *log) {
+    uint32_t page, slot;
+
+    if (!log->ra_active || (log->ra_issued != log->ra_ready) ||
+        (log->ra_issued == FLASH_LOG_READ_AHEAD)) {
+        return;
+    }
+
+    page = (log->ra_page + log->ra_issued) % log->page_num;
+    if (page == log->head) {
+        return;
+    }
+    slot = (log->ra_start + log->ra_issued) % FLASH_LOG_READ_AHEAD;
+
+    /* 先计数, 发起后完成中断随时可能到来 */
+    log->ra_issued++;
+    if (w25qxx_read_dma(flash_log_page_dev(log, page),
+                        flash_log_page_addr(log, page), &log->ra_buf[slot],
+                        sizeof(flash_log_page_t)) != 0) {
+        log->ra_issued--;
+    }
+}
+
+/**
+ * @brief 停止预读, 等待正在进行的读取完成
+ *
+ * @param log 日志句柄
+ */
+static void flash_log_ra_stop(flash_log_t *log) {
+    log->ra_active = 0;
+    while (log->ra_issued != log->ra_ready)
+        ;
+
+    log->ra_issued = 0;
+    log->ra_ready = 0;
+    log->ra_start = 0;
+}
+
+/**
+ * @brief 读取一页, 顺序读取时从预读缓冲区取出并继续预读
+ *
+ * @param log 日志句柄
+ * @param page 页号
+ * @param[out] buf 页缓冲区
+ */
+static void flash_log_read_ahead(flash_log_t *log, uint32_t page,
+                                 flash_log_page_t *buf) {
+    uint8_t sequential = (page == (log->ra_last + 1) % log->page_num);
+
+    log->ra_last = page;
+
+    if (!sequential || (log->ra_active && (page != log->ra_page))) {
+        flash_log_ra_stop(log);
+        w25qxx_read(flash_log_page_dev(log, page),
+                    flash_log_page_addr(log, page), buf,
+                    sizeof(flash_log_page_t));
+        return;
+    }
+
+    if (!log->ra_active || (log->ra_issued == 0)) {
+        /* 刚开始顺序读取, 或预读因总线忙, 到达写入位置而没有发起 */
+        w25qxx_read(flash_log_page_dev(log, page),
+                    flash_log_page_addr(log, page), buf,
+                    sizeof(flash_log_page_t));
+
+        flash_log_ra_log = log;
+        log->ra_page = (page + 1) % log->page_num;
+        log->ra_start = 0;
+        log->ra_active = 1;
+        flash_log_ra_issue(log);
+        return;
+    }
+
+    while (log->ra_ready == 0)
+        ;
+    memcpy(buf, &log->ra_buf[log->ra_start], sizeof(flash_log_page_t));
+
+    __disable_irq();
+    log->ra_start = (log->ra_start + 1) % FLASH_LOG_READ_AHEAD;
+    log->ra_page = (log->ra_page + 1) % log->page_num;
+    log->ra_issued--;
+    log->ra_ready--;
+    __enable_irq();
+
+    flash_log_ra_issue(log);
+}
+
+/**
+ * @brief DMA读取完成, 接着读取下一页
+ *
+ * @param dev W25Qxx设备
+ */
+void w25qxx_read_dma_callback(w25qxx_t *dev) {
+    flash_log_t *log = flash_log_ra_log;
+
+    UNUSED(dev);
+
+    if (log == NULL) {
+        return;
+    }
+
+    log->ra_ready++;
+    flash_log_ra_issue(log);
+}
+
+#endif /* FLASH_LOG_READ_AHEAD > 0 */
+
+/**
+ * @brief 读取一页并校验
+ *
+ * @param log 日志句柄
+ * @param page 页号
+ * @param[out] buf 页缓冲区
+ * @return 校验结果
+ *  @retval 0 有效页
+ *  @retval 1 空页或损坏的页
+ * @note 按页号递增的顺序读取时自动预读, 预读的页在写入位置之前, 内容不会
+ *       再改变. 不要在中断中调用
+ */
+uint8_t flash_log_read_page(flash_log_t *log, uint32_t page,
+                            flash_log_page_t *buf) {
+#if (FLASH_LOG_READ_AHEAD > 0)
+    flash_log_read_ahead(log, page, buf);
+#else
+    w25qxx_read(flash_log_page_dev(log, page), flash_log_page_addr(log, page),
+                buf, sizeof(flash_log_page_t));
+#endif /* FLASH_LOG_READ_AHEAD > 0 */
+
+    if ((buf->hdr.seq == 0xFFFFFFFF) || (buf->hdr.len > FLASH_LOG_DATA_SIZE)) {
+        return 1;
+    }
+
+    return (flash_log_page_crc(buf) == buf->hdr.crc) ? 0 : 1;
+}
+
+/**
+ * @brief 只读取页头
+ *
+ * @param log 日志句柄
+ * @param page 页号
+ * @param[out] hdr 页头
+ * @return 读取结果
+ *  @retval 0 非空页
+ *  @retval 1 空页或页头无效
+ * @note 页头单独读取时无法校验, 摘要只用来跳过不需要的页,
+ *       页内数据仍以`flash_log_read_page`的校验为准
+ */
+uint8_t flash_log_read_hdr(flash_log_t *log, uint32_t page,
+                           flash_log_page_hdr_t *hdr) {
+    w25qxx_read(flash_log_page_dev(log, page), flash_log_page_addr(log, page),
+                hdr, sizeof(flash_log_page_hdr_t));
+
+    if ((hdr->seq == 0xFFFFFFFF) || (hdr->len > FLASH_LOG_DATA_SIZE)) {
+        return 1;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief 缓冲区是否全为0xFF
+ *
+ * @param buf 缓冲区
+ * @param len 长度
+ * @return 0-非空, 1-空
+ */
+static uint8_t flash_log_is_blank(const void *buf, uint32_t len) {
+    const uint8_t *ptr = (const uint8_t *)buf;
+    while (len--) {
+        if (*ptr++ != 0xFF) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+#if (FLASH_LOG_USE_JOURNAL == 1)
+
+/**
+ * @brief 计算备份域日志头的校验
+ *
+ * @param journal 备份域日志头
+ * @return 校验值
+ */
+static uint16_t flash_log_journal_check(const flash_log_journal_t *journal) {
+    return flash_log_crc16(0x4A4C, (const uint8_t *)journal,
+                           offsetof(flash_log_journal_t, len));
+}
+
+/**
+ * @brief 把写入位置同步到备份域
+ *
+ * @param log 日志句柄
+ * @note 不修改已同步的数据长度. 还在编程的页不算写入, 保存的是其中
+ *       最早一页的位置
+ */
+static void flash_log_journal_save(flash_log_t *log) {
+    flash_log_journal_t journal = {
+        .head = (log->head + log->page_num - log->journal_pending) %
+                log->page_num,
+        .tail = log->tail,
+        .seq = log->seq - log->journal_pending};
+
+    journal.check = flash_log_journal_check(&journal);
+    backup_write(0, &journal, offsetof(flash_log_journal_t, len));
+    backup_write(offsetof(flash_log_journal_t, check), &journal.check,
+                 sizeof(journal.check));
+}
+
+/**
+ * @brief 设置备份域中的暂存页数据长度
+ *
+ * @param len 数据长度
+ */
+static void flash_log_journal_set_len(uint16_t len) {
+    backup_write(offsetof(flash_log_journal_t, len), &len, sizeof(len));
+}
+
+/**
+ * @brief 页写入Flash后更新备份域
+ *
+ * @param log 日志句柄
+ * @note 先清除数据长度再更新写入位置. 中途复位时要么写入位置校验失败,
+ *       要么挂载时发现该页已经写入, 不会把同一份数据写两次
+ */
+static void flash_log_journal_flushed(flash_log_t *log) {
+    flash_log_journal_set_len(0);
+    flash_log_journal_save(log);
+}
+
+/**
+ * @brief 编程完成的页更新到备份域
+ *
+ * @param log 日志句柄
+ * @param keep 最多还有几页在编程, 更早的页等待编程完成.
+ *             `FLASH_LOG_CHIP_NUM`时不等待
+ * @return 更新结果
+ *  @retval 0 已更新或不需要更新
+ *  @retval 1 还有页在编程, 备份域中仍是最早一页的位置
+ * @note 编程完成前掉电, 该页可能只写入了一部分, 复位后要用备份域中的
+ *       数据重新写入, 所以编程完成后才能清除. 按编程的顺序确认
+ */
+static uint8_t flash_log_journal_settle(flash_log_t *log, uint32_t keep) {
+    w25qxx_t *dev;
+
+    if (!log->journal_pending) {
+        return 0;
+    }
+
+    while (log->journal_pending) {
+        dev = flash_log_page_dev(log, log->head + log->page_num -
+                                          log->journal_pending);
+        if (log->journal_pending > keep) {
+            w25qxx_wait_busy(dev);
+        } else if (w25qxx_is_busy(dev)) {
+            return 1;
+        }
+
+        log->journal_pending--;
+        flash_log_journal_flushed(log);
+    }
+
+    /* 编程期间提交的数据 */
+    if ((log->buf_len != 0) && (log->buf_len <= FLASH_LOG_JOURNAL_DATA_SIZE)) {
+        backup_write(sizeof(flash_log_journal_t), log->page.data,
+                     log->buf_len);
+        flash_log_journal_set_len((uint16_t)log->buf_len);
+    }
+    return 0;
+}
+
+/**
+ * @brief 把新提交的数据同步到备份域
+ *
+ * @param log 日志句柄
+ * @param offset 数据在暂存页中的偏移
+ * @param len 数据长度
+ * @note 先写数据再写长度. 备份域放不下时不再同步, 只保留之前完整的数据.
+ *       上一页还在编程时暂不同步, 下次预留空间时如果编程已完成从头同步.
+ *       不访问Flash, 可以在关中断时调用
+ */
+static void flash_log_journal_append(flash_log_t *log, uint32_t offset,
+                                     uint32_t len) {
+    if (log->journal_pending) {
+        return;
+    }
+
+    if (offset + len > FLASH_LOG_JOURNAL_DATA_SIZE) {
+        return;
+    }
+
+    backup_write(sizeof(flash_log_journal_t) + offset, log->page.data + offset,
+                 len);
+    flash_log_journal_set_len((uint16_t)(offset + len));
+}
+
+/**
+ * @brief 从备份域恢复写入位置和暂存页
+ *
+ * @param log 日志句柄
+ * @return 恢复结果
+ *  @retval 0 成功
+ *  @retval 1 备份域日志无效或与Flash中的内容不一致
+ */
+static uint8_t flash_log_journal_load(flash_log_t *log) {
+    flash_log_journal_t journal;
+    uint32_t prev;
+
+    backup_read(0, &journal, sizeof(journal));
+    if ((journal.check != flash_log_journal_check(&journal)) ||
+        (journal.head >= log->page_num) || (journal.tail >= log->page_num) ||
+        (journal.seq == 0) || (journal.len > FLASH_LOG_JOURNAL_DATA_SIZE)) {
+        return 1;
+    }
+
+    /* 上一页应当是序号为seq - 1的有效页 */
+    if (journal.seq > 1) {
+        prev = (journal.head + log->page_num - 1) % log->page_num;
+        for (uint32_t i = 0; i < FLASH_LOG_CHIP_NUM; ++i) {
+            if ((flash_log_read_page(log, prev, &log->page) == 0) ||
+                flash_log_is_blank(&log->page, sizeof(log->page))) {
+                break;
+            }
+            /* 上次挂载跳过的编程被打断的页, 每片最多一页 */
+            prev = (prev + log->page_num - 1) % log->page_num;
+        }
+        if ((flash_log_read_page(log, prev, &log->page) != 0) ||
+            (log->page.hdr.seq != journal.seq - 1)) {
+            return 1;
+        }
+    }
+
+    /* 复位前每片最多有一页在编程, 按编程的顺序检查. 不进入下一扇区,
+       下一扇区的开头会重新擦除 */
+    for (uint32_t i = 0; i < FLASH_LOG_CHIP_NUM; ++i) {
+        if ((i != 0) && (journal.head % FLASH_LOG_PAGES_PER_SECTOR == 0)) {
+            break;
+        }
+
+        if (flash_log_read_page(log, journal.head, &log->page) == 0) {
+            if (log->page.hdr.seq != journal.seq) {
+                return 1;
+            }
+            /* 复位发生在页写入之后, 备份域更新之前 */
+            journal.head = (journal.head + 1) % log->page_num;
+            journal.seq++;
+            journal.len = 0;
+        } else if (!flash_log_is_blank(&log->page, sizeof(log->page))) {
+            /* 编程被打断的页, 跳过 */
+            journal.head = (journal.head + 1) % log->page_num;
+        } else {
+            break;
+        }
+    }
+
+    log->head = journal.head;
+    log->tail = journal.tail;
+    log->seq = journal.seq;
+
+    backup_read(sizeof(flash_log_journal_t), log->page.data, journal.len);
+    log->buf_len = journal.len;
+
+    return 0;
+}
+
+#endif /* FLASH_LOG_USE_JOURNAL == 1 */
+
+/**
+ * @brief 擦除日志的一个扇区, 发出命令后立即返回
+ *
+ * @param log 日志句柄
+ * @param sector 扇区号
+ */
+static void flash_log_erase_sector(flash_log_t *log, uint32_t sector) {
+    for (uint32_t i = 0; i < FLASH_LOG_CHIP_NUM; ++i) {
+        w25qxx_erase_sector(log->dev[i],
+                            log->base + sector * W25QXX_SECTOR_SIZE);
+    }
+}
+
+/**
+ * @brief 预擦除指定扇区之后的扇区
+ *
+ * @param log 日志句柄
+ * @param sector 当前扇区
+ * @note 如果最旧的数据在被擦除的扇区中, 最旧页移到再下一个扇区
+ */
+static void flash_log_erase_ahead(flash_log_t *log, uint32_t sector) {
+    uint32_t sector_num = flash_log_sector_num(log);
+    uint32_t next = (sector + 1) % sector_num;
+
+#if (FLASH_LOG_USE_JOURNAL == 1)
+    /* 擦除前等待所有页编程完成, 不会等到擦除结束 */
+    flash_log_journal_settle(log, 0);
+#endif /* FLASH_LOG_USE_JOURNAL == 1 */
+
+    if ((log->tail / FLASH_LOG_PAGES_PER_SECTOR) == next &&
+        (log->tail != log->head)) {
+        log->tail = ((next + 1) % sector_num) * FLASH_LOG_PAGES_PER_SECTOR;
+    }
+
+    flash_log_erase_sector(log, next);
+    log->ahead_sector = next;
+
+#if (FLASH_LOG_USE_JOURNAL == 1)
+    flash_log_journal_save(log);
+#endif /* FLASH_LOG_USE_JOURNAL == 1 */
+}
+
+/**
+ * @brief 挂载时准备写入位置所在扇区, 并发起预擦除
+ *
+ * @param log 日志句柄
+ */
+static void flash_log_prepare_head(flash_log_t *log) {
+    uint32_t head_sector = log->head / FLASH_LOG_PAGES_PER_SECTOR;
+
+    if (log->head % FLASH_LOG_PAGES_PER_SECTOR == 0) {
+        /* 上一个扇区已写满, 当前扇区的预擦除可能没有完成, 重新擦除 */
+        if ((log->tail / FLASH_LOG_PAGES_PER_SECTOR == head_sector) &&
+            (log->tail != log->head)) {
+            log->tail = ((head_sector + 1) % flash_log_sector_num(log)) *
+                        FLASH_LOG_PAGES_PER_SECTOR;
+        }
+        flash_log_erase_sector(log, head_sector);
+    }
+    flash_log_erase_ahead(log, head_sector);
+}
+
+/**
+ * @brief 挂载日志, 扫描找到写入位置和最旧页
+ *
+ * @param log 日志句柄
+ */
+static void flash_log_mount(flash_log_t *log) {
+    uint32_t sector_num = flash_log_sector_num(log);
+    uint32_t best_sector = 0, best_seq = 0;
+    uint8_t found = 0;
+
+#if (FLASH_LOG_USE_JOURNAL == 1)
+    if (flash_log_journal_load(log) == 0) {
+        flash_log_prepare_head(log);
+        return;
+    }
+    flash_log_journal_set_len(0);
+#endif /* FLASH_LOG_USE_JOURNAL == 1 */
+
+    /* 扇区是按顺序写的, 先比较每个扇区第一页的序号 */
+    for (uint32_t s = 0; s < sector_num; ++s) {
+        if (flash_log_read_page(log, s * FLASH_LOG_PAGES_PER_SECTOR,
+                                &log->page) != 0) {
+            continue;
+        }
+        if (!found || (log->page.hdr.seq > best_seq)) {
+            found = 1;
+            best_sector = s;
+            best_seq = log->page.hdr.seq;
+        }
+    }
+
+    if (!found) {
+        /* 空日志 */
+        log->head = 0;
+        log->tail = 0;
+        log->seq = 1;
+        flash_log_prepare_head(log);
+        return;
+    }
+
+    /* 在最新的扇区中找最后一个非空页, 编程被打断的页也要跳过 */
+    uint32_t first = best_sector * FLASH_LOG_PAGES_PER_SECTOR;
+    uint32_t last_used = 0;
+    uint32_t max_seq = best_seq;
+
+    for (uint32_t p = 1; p < FLASH_LOG_PAGES_PER_SECTOR; ++p) {
+        if (flash_log_read_page(log, first + p, &log->page) == 0) {
+            if (log->page.hdr.seq > max_seq) {
+                max_seq = log->page.hdr.seq;
+            }
+            last_used = p;
+        } else if (!flash_log_is_blank(&log->page, sizeof(log->page))) {
+            last_used = p;
+        }
+    }
+
+    log->head = (first + last_used + 1) % log->page_num;
+    log->seq = max_seq + 1;
+
+    /* 下一个扇区的预擦除可能被打断, 之后的扇区开头为最旧的数据 */
+    uint32_t head_sector = log->head / FLASH_LOG_PAGES_PER_SECTOR;
+    uint32_t oldest = (head_sector + 2) % sector_num;
+    if ((flash_log_read_page(log, oldest * FLASH_LOG_PAGES_PER_SECTOR,
+                             &log->page) == 0) &&
+        (log->page.hdr.seq < log->seq)) {
+        log->tail = oldest * FLASH_LOG_PAGES_PER_SECTOR;
+    } else {
+        log->tail = 0;
+    }
+
+    flash_log_prepare_head(log);
+}
+
+/**
+ * @brief 初始化并挂载日志
+ *
+ * @param log 日志句柄
+ * @param dev Flash设备数组, 共`FLASH_LOG_CHIP_NUM`个, 需已初始化
+ * @param base 日志区在每片中的起始地址, 必须扇区对齐
+ * @param size 日志区在每片中的大小, 至少3个扇区
+ * @return 初始化结果
+ *  @retval 0 成功
+ *  @retval 1 参数错误
+ */
+uint8_t flash_log_init(flash_log_t *log, w25qxx_t *dev, uint32_t base,
+                       uint32_t size) {
+    if ((base % W25QXX_SECTOR_SIZE) || (size < 3 * W25QXX_SECTOR_SIZE)) {
+        return 1;
+    }
+
+    for (uint32_t i = 0; i < FLASH_LOG_CHIP_NUM; ++i) {
+        if (base + size > dev[i].capacity) {
+            return 1;
+        }
+        log->dev[i] = &dev[i];
+    }
+
+    log->base = base;
+    log->page_num = (size / W25QXX_SECTOR_SIZE) * FLASH_LOG_PAGES_PER_SECTOR;
+    log->buf_len = 0;
+    log->programming = 0;
+    log->emergency = 0;
+    log->ahead_sector = 0;
+    log->emergency_end = 0;
+
+#if (FLASH_LOG_USE_JOURNAL == 1)
+    log->journal_pending = 0;
+#endif /* FLASH_LOG_USE_JOURNAL == 1 */
+
+#if (FLASH_LOG_READ_AHEAD > 0)
+    log->ra_last = 0;
+    log->ra_issued = 0;
+    log->ra_ready = 0;
+    log->ra_active = 0;
+#endif /* FLASH_LOG_READ_AHEAD > 0 */
+
+    flash_log_mount(log);
+
+#if (FLASH_LOG_READ_AHEAD > 0)
+    /* 挂载时写入位置还不确定, 丢弃挂载时预读的页 */
+    flash_log_ra_stop(log);
+#endif /* FLASH_LOG_READ_AHEAD > 0 */
+
+    /* 复位前没有写入Flash的数据 */
+    flash_log_flush(log);
+
+    return 0;
+}
+
+/**
+ * @brief 暂存页剩余空间
+ *
+ * @param log 日志句柄
+ * @return 剩余字节数
+ */
+uint32_t flash_log_space(flash_log_t *log) {
+    return FLASH_LOG_DATA_SIZE - log->buf_len;
+}
+
+/**
+ * @brief 在暂存页中预留空间
+ *
+ * @param log 日志句柄
+ * @param len 需要的长度
+ * @return 可写入的地址, 写完后调用`flash_log_commit`; NULL表示长度超过一页
+ * @note 数据不会跨页, 当前页放不下时先把当前页写入Flash
+ */
+uint8_t *flash_log_reserve(flash_log_t *log, uint32_t len) {
+    if (len > FLASH_LOG_DATA_SIZE) {
+        return NULL;
+    }
+
+#if (FLASH_LOG_USE_JOURNAL == 1)
+    flash_log_journal_settle(log, FLASH_LOG_CHIP_NUM);
+#endif /* FLASH_LOG_USE_JOURNAL == 1 */
+
+    if (len > flash_log_space(log)) {
+        if (flash_log_flush(log) != 0) {
+            return NULL;
+        }
+    }
+
+    return log->page.data + log->buf_len;
+}
+
+/**
+ * @brief 提交预留空间中写好的数据
+ *
+ * @param log 日志句柄
+ * @param len 实际写入的长度
+ * @note 先写数据再提交长度, 掉电刷写时不会写出半条数据. 不访问Flash,
+ *       读取数据到提交可以放在关中断的区域中, 不会被掉电中断打断
+ */
+void flash_log_commit(flash_log_t *log, uint32_t len) {
+#if (FLASH_LOG_USE_JOURNAL == 1)
+    flash_log_journal_append(log, log->buf_len, len);
+#endif /* FLASH_LOG_USE_JOURNAL == 1 */
+
+    log->buf_len += len;
+}
+
+/**
+ * @brief 填写页摘要, 在页写入Flash之前调用
+ *
+ * @param log 日志句柄
+ * @param page 要写入的页, 页头中的序号和数据长度已经填好
+ * @note 默认把摘要填为全1. 掉电刷写时也会在中断中调用, 不要在其中等待
+ */
+__weak void flash_log_meta_callback(flash_log_t *log, flash_log_page_t *page) {
+    UNUSED(log);
+
+    memset(page->hdr.meta, 0xFF, sizeof(page->hdr.meta));
+}
+
+/**
+ * @brief 把暂存页写入Flash
+ *
+ * @param log 日志句柄
+ * @return 写入结果
+ *  @retval 0 成功或暂存页为空
+ *  @retval 1 掉电模式下下一扇区不可写, 数据未写入
+ */
+uint8_t flash_log_flush(flash_log_t *log) {
+    if (log->buf_len == 0) {
+        return 0;
+    }
+
+    if (log->emergency && (log->head == log->emergency_end)) {
+        return 1;
+    }
+
+    log->page.hdr.seq = log->seq;
+    log->page.hdr.len = (uint8_t)log->buf_len;
+    log->page.hdr.flags = log->emergency ? FLASH_LOG_FLAG_POWER_LOSS : 0;
+    flash_log_meta_callback(log, &log->page);
+    log->page.hdr.crc = flash_log_page_crc(&log->page);
+
+#if (FLASH_LOG_USE_JOURNAL == 1)
+    /* 复位后只能跳过每片一页编程被打断的页, 这一片上一页编程完成后
+       才能开始下一页. 多片时一片编程的同时可以写另一片 */
+    flash_log_journal_settle(log, FLASH_LOG_CHIP_NUM - 1);
+#endif /* FLASH_LOG_USE_JOURNAL == 1 */
+
+    /* 置位后暂存页内容不再改变, 掉电中断会重新发出同样的编程命令 */
+    log->programming = 1;
+    w25qxx_program_page(flash_log_page_dev(log, log->head),
+                        flash_log_page_addr(log, log->head), &log->page,
+                        sizeof(flash_log_page_hdr_t) + log->buf_len);
+
+    /* 和写入位置一起更新, 掉电中断中保存的写入位置不会越过这一页 */
+    __disable_irq();
+    log->head = (log->head + 1) % log->page_num;
+    log->seq++;
+    log->buf_len = 0;
+    log->programming = 0;
+#if (FLASH_LOG_USE_JOURNAL == 1)
+    log->journal_pending++;
+#endif /* FLASH_LOG_USE_JOURNAL == 1 */
+    __enable_irq();
+
+    if ((log->head % FLASH_LOG_PAGES_PER_SECTOR == 0) && !log->emergency) {
+        flash_log_erase_ahead(log, log->head / FLASH_LOG_PAGES_PER_SECTOR);
+    }
+
+    return 0;
+}
+
+/**
+ * @brief 等待所有Flash编程和擦除完成
+ *
+ * @param log 日志句柄
+ */
+void flash_log_sync(flash_log_t *log) {
+    for (uint32_t i = 0; i < FLASH_LOG_CHIP_NUM; ++i) {
+        w25qxx_wait_busy(log->dev[i]);
+    }
+
+#if (FLASH_LOG_USE_JOURNAL == 1)
+    flash_log_journal_settle(log, 0);
+#endif /* FLASH_LOG_USE_JOURNAL == 1 */
+}
+
+/**
+ * @brief 进入掉电刷写模式
+ *
+ * @param log 日志句柄
+ * @note 在掉电中断中调用. 结束被打断的SPI命令, 暂停预擦除,
+ *       如果打断了暂存页的编程, 重新编程该页. 之后可以继续用
+ *       `flash_log_reserve`/`flash_log_flush`写入, 不会再发起擦除.
+ */
+void flash_log_emergency_begin(flash_log_t *log) {
+    uint32_t sector = log->head / FLASH_LOG_PAGES_PER_SECTOR;
+    uint32_t next = (sector + 1) % flash_log_sector_num(log);
+    uint8_t suspended = 0;
+
+    log->emergency = 1;
+
+    for (uint32_t i = 0; i < FLASH_LOG_CHIP_NUM; ++i) {
+        w25qxx_abort(log->dev[i]);
+    }
+    for (uint32_t i = 0; i < FLASH_LOG_CHIP_NUM; ++i) {
+        suspended |= w25qxx_suspend_erase(log->dev[i]);
+    }
+
+    /* 下一扇区只有在预擦除已经完成时才可以写入 */
+    if (suspended || (log->ahead_sector != next)) {
+        log->emergency_end = next * FLASH_LOG_PAGES_PER_SECTOR;
+    } else {
+        log->emergency_end = ((next + 1) % flash_log_sector_num(log)) *
+                             FLASH_LOG_PAGES_PER_SECTOR;
+    }
+
+    if (log->programming) {
+        /* 编程可能已部分执行, 用相同内容重新编程是安全的 */
+        w25qxx_program_page(flash_log_page_dev(log, log->head),
+                            flash_log_page_addr(log, log->head), &log->page,
+                            sizeof(flash_log_page_hdr_t) + log->buf_len);
+        log->head = (log->head + 1) % log->page_num;
+        log->seq++;
+        log->buf_len = 0;
+        log->programming = 0;
+
+#if (FLASH_LOG_USE_JOURNAL == 1)
+        log->journal_pending++;
+#endif /* FLASH_LOG_USE_JOURNAL == 1 */
+    }
+}
@@ -18,16 +18,17 @@ void rtc_key_set_time(UART_HandleTypeDef *huart);
 int main(void) {
     bsp_init();
     rtc_key_set_time(&usart1_handle);
-
-    char local_time_buffer[50];
-    struct tm *now_time;
+    recorder_init();
 
     while (1) {
-        now_time = rtc_get_time();
-        strftime(local_time_buffer, sizeof(local_time_buffer),
-                 "%Y-%m-%d %H:%M:%S", now_time);
-        puts(local_time_buffer);
-        delay_ms(1000);
+        recorder_poll();
+        query_poll();
+        playback_poll();
+
+        /* 按下KEY1检查日志 */
+        if (key_scan(0) == KEY1_PRESS) {
+            recorder_check();
+        }
     }
 }
 
@@ -0,0 +1,478 @@
+/**
+ * @file    playback.c
+ * @author  Deadline039
+ * @brief   串口记录回放
+ * @version 1.0
+ * @date    2026-10-17
+ * @note    回放某一次上电期间记录的串口数据. 先只读页头, 用页摘要中的
+ *          记录类型找到各次上电的起始页, 再从选中的上电记录开始顺序读取,
+ *          串口记录放入缓冲区, 遇到下一条上电记录时结束.
+ *
+ *          每条记录按原始时间戳和倍速算出发送时间, 由微秒定时器的比较中断
+ *          启动串口DMA发送, 发送完成中断中设置下一条的定时. 主循环只负责
+ *          从Flash读取, 不影响发送时间. 记录实际发送时间和定时时间的差,
+ *          结束时输出平均和最大抖动. 记录的时间戳精度为1ms.
+ *
+ *          倍速较高时一条记录的发送时间可能超过和下一条的间隔,
+ *          下一条会在发送完成后立即发送, 计为迟到.
+ *
+ *          命令: play [n=N] [speed=N|max] [ch=N]
+ *                play stop
+ *          n为倒数第几次上电, 0为本次, 默认为1; speed默认为1倍速.
+ *          回放期间回放串口上的printf输出会混入回放数据.
+ */
+
+#include "playback.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @brief 回放状态
+ */
+typedef enum {
+    PLAYBACK_IDLE = 0U, /* 空闲 */
+    PLAYBACK_SEARCH,    /* 查找上电记录 */
+    PLAYBACK_PLAY,      /* 回放 */
+    PLAYBACK_REPORT     /* 结束, 等待输出结果 */
+} playback_state_t;
+
+/**
+ * @brief 缓冲区中的一条记录
+ */
+typedef struct {
+    uint32_t time;                     /*!< 时间戳(ms) */
+    uint16_t len;                      /*!< 数据长度 */
+    uint8_t data[FLASH_LOG_DATA_SIZE]; /*!< 数据 */
+} playback_chunk_t;
+
+/**
+ * @brief 回放句柄
+ */
+typedef struct {
+    __IO playback_state_t state; /*!< 状态 */
+    uint32_t session;            /*!< 倒数第几次上电 */
+    uint32_t speed;              /*!< 倍速, 0为尽快发送 */
+    uint8_t channels;            /*!< 通道位图 */
+
+    uint32_t page;                         /*!< 下一个读取的页 */
+    uint32_t end;                          /*!< 开始时的写入位置 */
+    uint32_t starts[PLAYBACK_SESSION_MAX]; /*!< 最近几次上电的起始页 */
+    uint32_t start_num;                    /*!< 找到的上电次数 */
+
+    flash_log_page_t buf;     /*!< 正在解析的页 */
+    recorder_parser_t parser; /*!< 页内记录解析状态 */
+    uint8_t decoding;         /*!< 页内还有记录没有解析 */
+    uint8_t started;          /*!< 已经读到选中的上电记录 */
+    __IO uint8_t eof;         /*!< 已读完这次上电的记录 */
+
+    playback_chunk_t queue[PLAYBACK_QUEUE_NUM]; /*!< 记录缓冲区 */
+    __IO uint32_t head;                         /*!< 主循环写入的位置 */
+    __IO uint32_t tail;                         /*!< 中断发送的位置 */
+    __IO uint8_t waiting; /*!< 发送完成时缓冲区为空, 等待主循环读取 */
+    __IO uint8_t done;    /*!< 全部发送完成 */
+
+    uint8_t timing;     /*!< 已确定时间基准 */
+    uint32_t base_us;   /*!< 第一条记录的发送时间(us) */
+    uint32_t base_tick; /*!< 第一条记录的时间戳(ms) */
+
+    __IO uint32_t chunks;     /*!< 发送的记录数 */
+    __IO uint32_t bytes;      /*!< 发送的字节数 */
+    __IO uint32_t late;       /*!< 迟到的记录数 */
+    __IO uint32_t dropped;    /*!< 串口忙没有发送的记录数 */
+    __IO uint64_t jitter_sum; /*!< 抖动绝对值之和(us) */
+    __IO uint32_t jitter_max; /*!< 最大抖动(us) */
+} playback_t;
+
+static playback_t playback;
+
+static void playback_next(void);
+
+/**
+ * @brief 类型或通道号对应的位
+ *
+ * @param n 通道号
+ * @return 位图中的位, 大于7的都对应bit7
+ */
+static inline uint8_t playback_bit(uint32_t n) {
+    return (uint8_t)(1U << (n < 7 ? n : 7));
+}
+
+/**
+ * @brief 开始发送缓冲区中的第一条记录
+ *
+ */
+static void playback_send(void) {
+    playback_chunk_t *chunk =
+        &playback.queue[playback.tail % PLAYBACK_QUEUE_NUM];
+
+    if (HAL_UART_Transmit_DMA(&PLAYBACK_UART_HANDLE, chunk->data,
+                              chunk->len) != HAL_OK) {
+        playback.dropped++;
+        playback.tail++;
+        playback_next();
+    }
+}
+
+/**
+ * @brief 设置下一条记录的发送时间
+ *
+ * @note 在中断中或关中断调用
+ */
+static void playback_next(void) {
+    playback_chunk_t *chunk;
+    uint32_t offset;
+
+    if (playback.head == playback.tail) {
+        if (playback.eof) {
+            playback.done = 1;
+        } else {
+            playback.waiting = 1;
+        }
+        return;
+    }
+
+    chunk = &playback.queue[playback.tail % PLAYBACK_QUEUE_NUM];
+    if (!playback.timing) {
+        playback.timing = 1;
+        playback.base_us = timer_us_now() + PLAYBACK_START_DELAY;
+        playback.base_tick = chunk->time;
+    }
+
+    if (playback.speed == 0) {
+        playback_send();
+        return;
+    }
+
+    offset = (uint32_t)((uint64_t)(chunk->time - playback.base_tick) * 1000 /
+                        playback.speed);
+    timer_us_schedule(playback.base_us + offset);
+}
+
+/**
+ * @brief 定时到达, 发送下一条记录
+ *
+ * @param error 实际时间与定时时间的差(us)
+ */
+void timer_us_callback(int32_t error) {
+    uint32_t jitter = (uint32_t)((error < 0) ? -error : error);
+
+    if (playback.state != PLAYBACK_PLAY) {
+        return;
+    }
+
+    playback.jitter_sum += jitter;
+    if (jitter > playback.jitter_max) {
+        playback.jitter_max = jitter;
+    }
+    if (error > PLAYBACK_LATE_US) {
+        playback.late++;
+    }
+
+    playback_send();
+}
+
+/**
+ * @brief 一条记录发送完成, 设置下一条的定时
+ *
+ * @param huart 串口句柄
+ */
+void uart_tx_done_callback(UART_HandleTypeDef *huart) {
+    playback_chunk_t *chunk;
+
+    if ((huart != &PLAYBACK_UART_HANDLE) ||
+        (playback.state != PLAYBACK_PLAY)) {
+        return;
+    }
+
+    chunk = &playback.queue[playback.tail % PLAYBACK_QUEUE_NUM];
+    playback.chunks++;
+    playback.bytes += chunk->len;
+    playback.tail++;
+
+    playback_next();
+}
+
+/**
+ * @brief 只读页头, 查找各次上电的起始页
+ *
+ * @param log 日志句柄
+ */
+static void playback_search(flash_log_t *log) {
+    flash_log_page_hdr_t hdr;
+    record_meta_t meta;
+    uint32_t index;
+
+    for (uint32_t n = 0; n < PLAYBACK_PAGES_PER_POLL; ++n) {
+        if (playback.page == playback.end) {
+            if ((playback.session >= playback.start_num) ||
+                (playback.session >= PLAYBACK_SESSION_MAX)) {
+                playback.state = PLAYBACK_REPORT;
+                return;
+            }
+
+            index = playback.start_num - 1 - playback.session;
+            playback.page = playback.starts[index % PLAYBACK_SESSION_MAX];
+            playback.end = log->head;
+            playback.state = PLAYBACK_PLAY;
+            return;
+        }
+
+        if (flash_log_read_hdr(log, playback.page, &hdr) == 0) {
+            memcpy(&meta, hdr.meta, sizeof(meta));
+            if (meta.types & playback_bit(RECORD_TYPE_SESSION)) {
+                playback.starts[playback.start_num % PLAYBACK_SESSION_MAX] =
+                    playback.page;
+                playback.start_num++;
+            }
+        }
+        playback.page = (playback.page + 1) % log->page_num;
+    }
+}
+
+/**
+ * @brief 顺序读取这次上电的串口记录, 放入缓冲区
+ *
+ * @param log 日志句柄
+ */
+static void playback_fill(flash_log_t *log) {
+    playback_chunk_t *chunk;
+    record_hdr_t hdr;
+    uint32_t pages = 0;
+    const uint8_t *data;
+
+    while (!playback.eof &&
+           (playback.head - playback.tail < PLAYBACK_QUEUE_NUM)) {
+        if (!playback.decoding) {
+            if (pages == PLAYBACK_PAGES_PER_POLL) {
+                break;
+            }
+            if (playback.page == playback.end) {
+                playback.eof = 1;
+                break;
+            }
+
+            pages++;
+            if (flash_log_read_page(log, playback.page, &playback.buf) == 0) {
+                recorder_parse_init(&playback.parser, &playback.buf);
+                playback.decoding = 1;
+            }
+            playback.page = (playback.page + 1) % log->page_num;
+            continue;
+        }
+
+        data = recorder_parse(&playback.parser, &hdr);
+        if (data == NULL) {
+            playback.decoding = 0;
+            continue;
+        }
+
+        if (hdr.type == RECORD_TYPE_SESSION) {
+            if (playback.started) {
+                playback.eof = 1;
+                break;
+            }
+            playback.started = 1;
+            continue;
+        }
+
+        if (!playback.started || (hdr.type != RECORD_TYPE_UART) ||
+            !(playback_bit(hdr.channel) & playback.channels)) {
+            continue;
+        }
+
+        chunk = &playback.queue[playback.head % PLAYBACK_QUEUE_NUM];
+        chunk->time = hdr.time;
+        chunk->len = hdr.len;
+        memcpy(chunk->data, data, hdr.len);
+        playback.head++;
+    }
+
+    /* 发送完成时缓冲区为空, 由主循环继续 */
+    __disable_irq();
+    if (playback.waiting &&
+        ((playback.head != playback.tail) || playback.eof)) {
+        playback.waiting = 0;
+        playback_next();
+    }
+    __enable_irq();
+
+    if (playback.done) {
+        playback.state = PLAYBACK_REPORT;
+    }
+}
+
+/**
+ * @brief 开始回放
+ *
+ * @param session 倒数第几次上电, 0为本次
+ * @param speed 倍速, 0为尽快发送
+ * @param channels 回放的通道位图
+ * @return 开始结果
+ *  @retval 0 成功
+ *  @retval 1 正在回放或日志未挂载
+ */
+uint8_t playback_start(uint32_t session, uint32_t speed, uint8_t channels) {
+    flash_log_t *log = recorder_get_log();
+
+    if ((playback.state != PLAYBACK_IDLE) || (log->page_num == 0)) {
+        return 1;
+    }
+
+    recorder_flush();
+
+    playback.start_num = 0;
+    playback.decoding = 0;
+    playback.started = 0;
+    playback.eof = 0;
+    playback.head = 0;
+    playback.tail = 0;
+    playback.waiting = 1;
+    playback.done = 0;
+    playback.timing = 0;
+    playback.chunks = 0;
+    playback.bytes = 0;
+    playback.late = 0;
+    playback.dropped = 0;
+    playback.jitter_sum = 0;
+    playback.jitter_max = 0;
+
+    playback.session = session;
+    playback.speed = speed;
+    playback.channels = channels;
+    playback.page = log->tail;
+    playback.end = log->head;
+    playback.state = PLAYBACK_SEARCH;
+
+    return 0;
+}
+
+/**
+ * @brief 停止回放
+ *
+ */
+void playback_stop(void) {
+    if (playback.state == PLAYBACK_SEARCH) {
+        playback.state = PLAYBACK_IDLE;
+        return;
+    }
+    if (playback.state != PLAYBACK_PLAY) {
+        return;
+    }
+
+    playback.state = PLAYBACK_REPORT;
+    timer_us_cancel();
+    HAL_UART_AbortTransmit(&PLAYBACK_UART_HANDLE);
+}
+
+/**
+ * @brief 输出回放结果
+ *
+ */
+static void playback_report(void) {
+    uint32_t jitter_avg = 0;
+    uint8_t res;
+
+    if ((playback.session >= playback.start_num) ||
+        (playback.session >= PLAYBACK_SESSION_MAX)) {
+        res = query_printf("Session %u not found, %u sessions in log. \r\n",
+                           (unsigned int)playback.session,
+                           (unsigned int)playback.start_num);
+    } else {
+        if (playback.chunks != 0) {
+            jitter_avg = (uint32_t)(playback.jitter_sum / playback.chunks);
+        }
+        res = query_printf("Playback done: %u chunks, %u bytes, %u late, "
+                           "%u dropped, jitter avg %u us, max %u us. \r\n",
+                           (unsigned int)playback.chunks,
+                           (unsigned int)playback.bytes,
+                           (unsigned int)playback.late,
+                           (unsigned int)playback.dropped,
+                           (unsigned int)jitter_avg,
+                           (unsigned int)playback.jitter_max);
+    }
+
+    if (res == 0) {
+        playback.state = PLAYBACK_IDLE;
+    }
+}
+
+/**
+ * @brief 查找和读取记录, 输出结果, 在主循环中调用
+ *
+ */
+void playback_poll(void) {
+    flash_log_t *log = recorder_get_log();
+
+    switch (playback.state) {
+        case PLAYBACK_SEARCH: {
+            playback_search(log);
+        } break;
+
+        case PLAYBACK_PLAY: {
+            playback_fill(log);
+        } break;
+
+        case PLAYBACK_REPORT: {
+            playback_report();
+        } break;
+
+        default: {
+        } break;
+    }
+}
+
+/**
+ * @brief 解析回放命令
+ *
+ * @param cmd 命令
+ * @return 0-不是回放命令, 1-已处理
+ */
+uint8_t query_command_callback(const char *cmd) {
+    char buf[64];
+    char *key, *val;
+    uint32_t session = 1, speed = 1;
+    uint8_t channels = 0;
+
+    strncpy(buf, cmd, sizeof(buf) - 1);
+    buf[sizeof(buf) - 1] = '\0';
+
+    key = strtok(buf, " ");
+    if ((key == NULL) || (strcmp(key, "play") != 0)) {
+        return 0;
+    }
+
+    while ((key = strtok(NULL, " ")) != NULL) {
+        if (strcmp(key, "stop") == 0) {
+            playback_stop();
+            return 1;
+        }
+
+        val = strchr(key, '=');
+        if (val == NULL) {
+            break;
+        }
+        *val++ = '\0';
+
+        if (strcmp(key, "n") == 0) {
+            session = strtoul(val, NULL, 0);
+        } else if (strcmp(key, "speed") == 0) {
+            speed = (strcmp(val, "max") == 0) ? 0 : strtoul(val, NULL, 0);
+        } else if (strcmp(key, "ch") == 0) {
+            channels |= playback_bit(strtoul(val, NULL, 0));
+        } else {
+            break;
+        }
+    }
+
+    if (key != NULL) {
+        query_printf("Usage: play [n=N] [speed=N|max] [ch=N], play stop\r\n");
+        return 1;
+    }
+
+    if (playback_start(session, speed, channels ? channels : 0xFF) != 0) {
+        query_printf("Playback busy or log not mounted. \r\n");
+    }
+
+    return 1;
+}
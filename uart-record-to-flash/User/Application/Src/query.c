@@ -0,0 +1,567 @@
+/**
+ * @file    query.c
+ * @author  Deadline039
+ * @brief   日志检索
+ * @version 1.0
+ * @date    2026-10-17
+ * @note    串口收到检索命令后, 从最旧页到检索开始时的写入位置逐页检查.
+ *          先只读页头, 用页摘要中的时间范围, 记录类型和通道跳过不可能有
+ *          结果的页, 其余的页读出整页后逐条检查记录, 结果通过串口DMA发送.
+ *
+ *          检索在主循环中进行, 每次轮询最多读取几页, 发送缓冲区未发完时
+ *          不再读取, 记录照常进行. 检索期间被覆盖的页直接跳到最旧页继续.
+ *
+ *          命令格式, 条件可以任意组合, 同一种条件可以出现多次:
+ *          find [type=N] [ch=N] [from=HH:MM[:SS]] [to=HH:MM[:SS]]
+ *               [hex=XXXX] [str=TEXT] [max=N]
+ *          stop
+ *          时间为当天的RTC时间. 字节序列只在一条记录内查找,
+ *          被分到两条记录中的不会找到. 时间未知的页不按时间过滤.
+ */
+
+#include "query.h"
+#include "rtc.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* 命令最大长度 */
+#define QUERY_CMD_MAX  96
+
+/* 一行结果的最大长度 */
+#define QUERY_LINE_MAX (64 + QUERY_DUMP_MAX * 3)
+
+/**
+ * @brief 检索状态
+ */
+typedef struct {
+    query_t cond;   /*!< 检索条件 */
+    uint8_t active; /*!< 是否正在检索 */
+    uint32_t page;  /*!< 下一个检查的页 */
+    uint32_t end;   /*!< 检索开始时的写入位置 */
+
+    flash_log_page_t buf;     /*!< 正在检查的页 */
+    record_meta_t meta;       /*!< 正在检查的页的摘要 */
+    recorder_parser_t parser; /*!< 页内记录解析状态 */
+    uint8_t decoding;         /*!< 页内还有记录没有检查 */
+
+    uint32_t pages;   /*!< 检查的页数 */
+    uint32_t skipped; /*!< 根据摘要跳过的页数 */
+    uint32_t matches; /*!< 输出的记录数 */
+
+    char line[QUERY_LINE_MAX]; /*!< 待发送的一行 */
+    uint32_t out_len;          /*!< 待发送的长度 */
+    uint32_t out_pos;          /*!< 已写入发送缓冲区的长度 */
+
+    char cmd[QUERY_CMD_MAX]; /*!< 正在接收的命令 */
+    uint32_t cmd_len;        /*!< 已接收的命令长度 */
+} query_state_t;
+
+static query_state_t query_state;
+
+/**
+ * @brief 类型或通道号对应的位
+ *
+ * @param n 类型或通道号
+ * @return 位图中的位, 大于7的都对应bit7
+ */
+static inline uint8_t query_bit(uint32_t n) {
+    return (uint8_t)(1U << (n < 7 ? n : 7));
+}
+
+/**
+ * @brief 把待发送的一行写入串口发送缓冲区
+ *
+ * @return 是否还有没有写入的数据
+ *  @retval 0 已全部写入
+ *  @retval 1 发送缓冲区忙, 下次轮询继续
+ */
+static uint8_t query_output(void) {
+    UART_HandleTypeDef *huart = &QUERY_UART_HANDLE;
+
+    if (query_state.out_pos == query_state.out_len) {
+        return 0;
+    }
+
+    /* DMA发送期间发送缓冲区不能写入 */
+    if (huart->gState != HAL_UART_STATE_READY) {
+        return 1;
+    }
+
+    query_state.out_pos +=
+        uart_dmatx_write(huart, query_state.line + query_state.out_pos,
+                         query_state.out_len - query_state.out_pos);
+    uart_dmatx_send(huart);
+
+    return (query_state.out_pos != query_state.out_len) ? 1 : 0;
+}
+
+/**
+ * @brief 在命令串口上输出一行
+ *
+ * @param __format 格式化字符串
+ * @return 输出结果
+ *  @retval 0 成功
+ *  @retval 1 上一行还没有写入发送缓冲区, 需要稍后再输出
+ */
+uint8_t query_printf(const char *__format, ...) {
+    va_list ap;
+    int len;
+
+    if (query_state.out_pos != query_state.out_len) {
+        return 1;
+    }
+
+    va_start(ap, __format);
+    len = vsnprintf(query_state.line, sizeof(query_state.line), __format, ap);
+    va_end(ap);
+
+    if (len < 0) {
+        return 0;
+    }
+
+    query_state.out_len = ((uint32_t)len < sizeof(query_state.line))
+                              ? (uint32_t)len
+                              : sizeof(query_state.line) - 1;
+    query_state.out_pos = 0;
+    query_output();
+
+    return 0;
+}
+
+/**
+ * @brief 解析当天的时间
+ *
+ * @param str 字符串, HH:MM或HH:MM:SS
+ * @param[out] time RTC时间(s)
+ * @return 解析结果
+ *  @retval 0 成功
+ *  @retval 1 格式错误
+ */
+static uint8_t query_parse_time(const char *str, uint32_t *time) {
+    struct tm tm = *rtc_get_time();
+    int hour, min, sec = 0;
+
+    if (sscanf(str, "%d:%d:%d", &hour, &min, &sec) < 2) {
+        return 1;
+    }
+
+    tm.tm_hour = hour;
+    tm.tm_min = min;
+    tm.tm_sec = sec;
+    *time = (uint32_t)mktime(&tm);
+
+    return 0;
+}
+
+/**
+ * @brief 解析十六进制字节序列
+ *
+ * @param str 字符串, 每个字节两位十六进制数
+ * @param[out] query 检索条件
+ * @return 解析结果
+ *  @retval 0 成功
+ *  @retval 1 格式错误或过长
+ */
+static uint8_t query_parse_hex(const char *str, query_t *query) {
+    uint32_t len = strlen(str);
+    char byte[3] = {0};
+    char *end;
+
+    if ((len == 0) || (len % 2) || (len / 2 > QUERY_PATTERN_MAX)) {
+        return 1;
+    }
+
+    for (uint32_t i = 0; i < len / 2; ++i) {
+        byte[0] = str[2 * i];
+        byte[1] = str[2 * i + 1];
+        query->pattern[i] = (uint8_t)strtoul(byte, &end, 16);
+        if (*end != '\0') {
+            return 1;
+        }
+    }
+    query->pattern_len = (uint8_t)(len / 2);
+
+    return 0;
+}
+
+/**
+ * @brief 解析检索命令
+ *
+ * @param cmd 命令, 格式见文件说明
+ * @param[out] query 检索条件
+ * @return 解析结果
+ *  @retval 0 成功
+ *  @retval 1 格式错误
+ */
+uint8_t query_parse(const char *cmd, query_t *query) {
+    char buf[QUERY_CMD_MAX];
+    char *key, *val;
+
+    strncpy(buf, cmd, sizeof(buf) - 1);
+    buf[sizeof(buf) - 1] = '\0';
+
+    key = strtok(buf, " ");
+    if ((key == NULL) || (strcmp(key, "find") != 0)) {
+        return 1;
+    }
+
+    memset(query, 0, sizeof(query_t));
+    query->to = 0xFFFFFFFF;
+
+    while ((key = strtok(NULL, " ")) != NULL) {
+        val = strchr(key, '=');
+        if (val == NULL) {
+            return 1;
+        }
+        *val++ = '\0';
+
+        if (strcmp(key, "type") == 0) {
+            query->types |= query_bit(strtoul(val, NULL, 0));
+        } else if (strcmp(key, "ch") == 0) {
+            query->channels |= query_bit(strtoul(val, NULL, 0));
+        } else if (strcmp(key, "from") == 0) {
+            if (query_parse_time(val, &query->from) != 0) {
+                return 1;
+            }
+        } else if (strcmp(key, "to") == 0) {
+            if (query_parse_time(val, &query->to) != 0) {
+                return 1;
+            }
+        } else if (strcmp(key, "hex") == 0) {
+            if (query_parse_hex(val, query) != 0) {
+                return 1;
+            }
+        } else if (strcmp(key, "str") == 0) {
+            if (strlen(val) > QUERY_PATTERN_MAX) {
+                return 1;
+            }
+            query->pattern_len = (uint8_t)strlen(val);
+            memcpy(query->pattern, val, query->pattern_len);
+        } else if (strcmp(key, "max") == 0) {
+            query->max = strtoul(val, NULL, 0);
+        } else {
+            return 1;
+        }
+    }
+
+    /* 没有指定的为全部 */
+    if (query->types == 0) {
+        query->types = 0xFF;
+    }
+    if (query->channels == 0) {
+        query->channels = 0xFF;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief 开始检索
+ *
+ * @param query 检索条件
+ * @return 开始结果
+ *  @retval 0 成功
+ *  @retval 1 日志未挂载
+ * @note 先把暂存页写入Flash, 检索到此时的写入位置为止
+ */
+uint8_t query_start(const query_t *query) {
+    flash_log_t *log = recorder_get_log();
+
+    if (log->page_num == 0) {
+        return 1;
+    }
+
+    recorder_flush();
+
+    query_state.cond = *query;
+    query_state.page = log->tail;
+    query_state.end = log->head;
+    query_state.decoding = 0;
+    query_state.pages = 0;
+    query_state.skipped = 0;
+    query_state.matches = 0;
+    query_state.active = 1;
+
+    return 0;
+}
+
+/**
+ * @brief 结束检索, 输出统计
+ *
+ */
+void query_stop(void) {
+    if (!query_state.active) {
+        return;
+    }
+
+    query_state.active = 0;
+    query_printf("Query done: %u pages, %u skipped, %u matches. \r\n",
+                 (unsigned int)query_state.pages,
+                 (unsigned int)query_state.skipped,
+                 (unsigned int)query_state.matches);
+}
+
+/**
+ * @brief 根据页摘要判断页内是否可能有结果
+ *
+ * @param cond 检索条件
+ * @param meta 页摘要
+ * @return 0-不可能有, 1-可能有
+ */
+static uint8_t query_match_meta(const query_t *cond,
+                                const record_meta_t *meta) {
+    if (!(meta->types & cond->types) || !(meta->channels & cond->channels)) {
+        return 0;
+    }
+
+    if (meta->time == RECORD_TIME_UNKNOWN) {
+        return 1;
+    }
+
+    return ((meta->time <= cond->to) && (meta->time + meta->span >= cond->from))
+               ? 1
+               : 0;
+}
+
+/**
+ * @brief 数据中是否包含字节序列
+ *
+ * @param data 数据
+ * @param len 数据长度
+ * @param pattern 字节序列
+ * @param pattern_len 字节序列长度
+ * @return 0-不包含, 1-包含
+ */
+static uint8_t query_search(const uint8_t *data, uint32_t len,
+                            const uint8_t *pattern, uint32_t pattern_len) {
+    for (uint32_t i = 0; i + pattern_len <= len; ++i) {
+        if ((data[i] == pattern[0]) &&
+            (memcmp(data + i, pattern, pattern_len) == 0)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief 检查一条记录
+ *
+ * @param cond 检索条件
+ * @param hdr 记录头
+ * @param data 记录数据
+ * @param time 记录的RTC时间(s)
+ * @return 0-不满足, 1-满足
+ */
+static uint8_t query_match_record(const query_t *cond, const record_hdr_t *hdr,
+                                  const uint8_t *data, uint32_t time) {
+    if (!(query_bit(hdr->type) & cond->types) ||
+        !(query_bit(hdr->channel) & cond->channels)) {
+        return 0;
+    }
+
+    if ((time != RECORD_TIME_UNKNOWN) &&
+        ((time < cond->from) || (time > cond->to))) {
+        return 0;
+    }
+
+    if ((cond->pattern_len != 0) &&
+        !query_search(data, hdr->len, cond->pattern, cond->pattern_len)) {
+        return 0;
+    }
+
+    return 1;
+}
+
+/**
+ * @brief 输出一条记录
+ *
+ * @param hdr 记录头
+ * @param data 记录数据
+ * @param time 记录的RTC时间(s)
+ */
+static void query_print_record(const record_hdr_t *hdr, const uint8_t *data,
+                               uint32_t time) {
+    char *line = query_state.line;
+    uint32_t size = sizeof(query_state.line) - 2;
+    uint32_t len = 0;
+    time_t rtc_time = (time_t)time;
+
+    if (time != RECORD_TIME_UNKNOWN) {
+        len = strftime(line, size, "%Y-%m-%d %H:%M:%S", localtime(&rtc_time));
+    } else {
+        len = snprintf(line, size, "unknown time");
+    }
+
+    len += snprintf(line + len, size - len, " T%u C%u %ums L%u:",
+                    (unsigned int)hdr->type, (unsigned int)hdr->channel,
+                    (unsigned int)hdr->time, (unsigned int)hdr->len);
+
+    for (uint32_t i = 0; (i < hdr->len) && (i < QUERY_DUMP_MAX); ++i) {
+        len += snprintf(line + len, size - len, " %02X", data[i]);
+    }
+    if (hdr->len > QUERY_DUMP_MAX) {
+        len += snprintf(line + len, size - len, " ...");
+    }
+
+    line[len++] = '\r';
+    line[len++] = '\n';
+
+    query_state.out_len = len;
+    query_state.out_pos = 0;
+    query_output();
+}
+
+/**
+ * @brief 检查页内的下一条满足条件的记录
+ *
+ * @return 0-页内已检查完, 1-输出了一条记录
+ */
+static uint8_t query_decode(void) {
+    record_meta_t *meta = &query_state.meta;
+    record_hdr_t hdr;
+    uint32_t time;
+    const uint8_t *data;
+
+    while ((data = recorder_parse(&query_state.parser, &hdr)) != NULL) {
+        time = RECORD_TIME_UNKNOWN;
+        if (meta->time != RECORD_TIME_UNKNOWN) {
+            time = meta->time + (hdr.time - meta->tick) / 1000;
+        }
+
+        if (query_match_record(&query_state.cond, &hdr, data, time)) {
+            query_state.matches++;
+            query_print_record(&hdr, data, time);
+            return 1;
+        }
+    }
+
+    query_state.decoding = 0;
+    return 0;
+}
+
+/**
+ * @brief 检查下一页, 摘要符合条件时读出整页
+ *
+ * @param log 日志句柄
+ */
+static void query_check_page(flash_log_t *log) {
+    flash_log_page_hdr_t hdr;
+    uint32_t page = query_state.page;
+    uint32_t used = (log->head + log->page_num - log->tail) % log->page_num;
+
+    /* 检索期间最旧的页被覆盖了 */
+    if ((page + log->page_num - log->tail) % log->page_num >= used) {
+        page = log->tail;
+    }
+    query_state.page = (page + 1) % log->page_num;
+    query_state.pages++;
+
+    if (flash_log_read_hdr(log, page, &hdr) != 0) {
+        return;
+    }
+
+    memcpy(&query_state.meta, hdr.meta, sizeof(record_meta_t));
+    if (!query_match_meta(&query_state.cond, &query_state.meta)) {
+        query_state.skipped++;
+        return;
+    }
+
+    if (flash_log_read_page(log, page, &query_state.buf) != 0) {
+        return;
+    }
+    /* 页头读取后页可能已被覆盖, 以整页中的摘要为准 */
+    memcpy(&query_state.meta, query_state.buf.hdr.meta, sizeof(record_meta_t));
+    recorder_parse_init(&query_state.parser, &query_state.buf);
+    query_state.decoding = 1;
+}
+
+/**
+ * @brief 其他模块的命令, 在检索命令之前处理
+ *
+ * @param cmd 命令
+ * @return 0-不是该模块的命令, 1-已处理
+ */
+__weak uint8_t query_command_callback(const char *cmd) {
+    UNUSED(cmd);
+    return 0;
+}
+
+/**
+ * @brief 接收命令, 收到一行后执行
+ *
+ */
+static void query_read_cmd(void) {
+    query_t query;
+    char c;
+
+    while (uart_dmarx_read(&QUERY_UART_HANDLE, &c, 1)) {
+        if ((c != '\r') && (c != '\n')) {
+            if (query_state.cmd_len < sizeof(query_state.cmd) - 1) {
+                query_state.cmd[query_state.cmd_len++] = c;
+            }
+            continue;
+        }
+
+        if (query_state.cmd_len == 0) {
+            continue;
+        }
+        query_state.cmd[query_state.cmd_len] = '\0';
+        query_state.cmd_len = 0;
+
+        if (query_command_callback(query_state.cmd) != 0) {
+            return;
+        }
+
+        if (strcmp(query_state.cmd, "stop") == 0) {
+            query_stop();
+        } else if (query_parse(query_state.cmd, &query) != 0) {
+            query_printf("Usage: find [type=N] [ch=N] [from=HH:MM[:SS]] "
+                         "[to=HH:MM[:SS]] [hex=XX] [str=S] [max=N]\r\n");
+        } else if (query_start(&query) != 0) {
+            query_printf("Log not mounted. \r\n");
+        }
+        /* 一次只执行一条命令, 输出发完再接收下一条 */
+        return;
+    }
+}
+
+/**
+ * @brief 接收命令并进行检索, 在主循环中调用
+ *
+ */
+void query_poll(void) {
+    flash_log_t *log = recorder_get_log();
+
+    /* 上一行还没有写入发送缓冲区 */
+    if (query_output() != 0) {
+        return;
+    }
+
+    query_read_cmd();
+
+    for (uint32_t n = 0; query_state.active && (n < QUERY_PAGES_PER_POLL);) {
+        if (query_state.decoding) {
+            if (query_decode() != 0) {
+                if ((query_state.cond.max != 0) &&
+                    (query_state.matches >= query_state.cond.max)) {
+                    query_state.decoding = 0;
+                    query_state.page = query_state.end;
+                }
+                /* 发送完再检查下一条 */
+                return;
+            }
+            continue;
+        }
+
+        if (query_state.page == query_state.end) {
+            query_stop();
+            return;
+        }
+
+        query_check_page(log);
+        n++;
+    }
+}
@@ -0,0 +1,466 @@
+/**
+ * @file    recorder.c
+ * @author  Deadline039
+ * @brief   串口数据记录
+ * @version 1.0
+ * @date    2026-10-17
+ * @note    串口DMA接收的数据直接读到日志暂存页中, 每次读取的数据作为一条
+ *          记录, 前面加上记录头. 一条记录不会跨页.
+ *
+ *          掉电刷写: PVD中断优先级最高, 可以打断主循环中的Flash操作.
+ *          中断中停止串口接收, 暂停预擦除, 把FIFO中剩余的数据和暂存页
+ *          写入Flash, 之后等待电压恢复或芯片复位.
+ *
+ *          压缩记录头: 页内第一条记录和非串口记录使用完整记录头, 之后的
+ *          串口记录时间戳相对于页内上一条记录. 完整记录头重新开始差分,
+ *          所以每页可以单独解析.
+ */
+
+#include "recorder.h"
+#include "rtc.h"
+
+#include <stdio.h>
+#include <string.h>
+
+/* 数据太短时不单独占一条记录, 先写入当前页 */
+#define RECORDER_MIN_CHUNK 16
+
+extern void uart_dmarx_idle_callback(UART_HandleTypeDef *huart);
+
+/**
+ * @brief 记录的串口
+ */
+typedef struct {
+    UART_HandleTypeDef *huart; /*!< 串口句柄 */
+    uint8_t channel;           /*!< 记录中的通道号 */
+} recorder_port_t;
+
+static recorder_port_t recorder_ports[] = {
+    {&usart1_handle, 1},
+};
+
+#define RECORDER_PORT_NUM (sizeof(recorder_ports) / sizeof(recorder_ports[0]))
+
+static w25qxx_t flash_dev[FLASH_LOG_CHIP_NUM] = {
+    {.bus = &spi1_bus,
+     .cs_port = W25QXX_CS_GPIO_PORT,
+     .cs_pin = W25QXX_CS_GPIO_PIN},
+#if (FLASH_LOG_CHIP_NUM == 2)
+    {.bus = &spi1_bus,
+     .cs_port = W25QXX_CS2_GPIO_PORT,
+     .cs_pin = W25QXX_CS2_GPIO_PIN},
+#endif /* FLASH_LOG_CHIP_NUM == 2 */
+};
+static flash_log_t log_handle;
+static uint8_t recorder_ready;
+
+/* 本次上电的RTC时间和对应的时间戳, 用来计算页摘要中的时间 */
+static uint32_t recorder_session_time = RECORD_TIME_UNKNOWN;
+static uint32_t recorder_session_tick;
+
+/* 暂存页中上一条记录之后的时间戳编码状态 */
+static dod_t recorder_dod;
+static uint8_t recorder_dod_valid;
+
+/**
+ * @brief 初始化Flash和日志, 写入上电记录
+ *
+ */
+void recorder_init(void) {
+    W25QXX_CS_GPIO_ENABLE();
+#if (FLASH_LOG_CHIP_NUM == 2)
+    W25QXX_CS2_GPIO_ENABLE();
+#endif /* FLASH_LOG_CHIP_NUM == 2 */
+
+    for (uint32_t i = 0; i < FLASH_LOG_CHIP_NUM; ++i) {
+        if (w25qxx_init(&flash_dev[i]) != 0) {
+            printf("W25Qxx %u not found. \r\n", (unsigned int)i);
+            return;
+        }
+    }
+
+    if (flash_log_init(&log_handle, flash_dev, RECORDER_LOG_BASE,
+                       flash_dev[0].capacity - RECORDER_LOG_BASE) != 0) {
+        printf("Flash log init failed. \r\n");
+        return;
+    }
+
+    printf("Flash log mounted, head: %u, tail: %u. \r\n",
+           (unsigned int)log_handle.head, (unsigned int)log_handle.tail);
+
+    recorder_ready = 1;
+    /* 复位后写回的暂存页中的记录不作为压缩记录头的基准 */
+    recorder_dod_valid = 0;
+
+    time_t now = mktime(rtc_get_time());
+    recorder_session_time = (uint32_t)now;
+    recorder_session_tick = HAL_GetTick();
+    recorder_write(RECORD_TYPE_SESSION, 0, &now, sizeof(now));
+
+#if (RECORDER_USE_PVD == 1)
+    pvd_init(RECORDER_PVD_LEVEL);
+#endif /* RECORDER_USE_PVD == 1 */
+}
+
+/**
+ * @brief 写入一条记录
+ *
+ * @param type 记录类型
+ * @param channel 通道
+ * @param data 数据
+ * @param len 数据长度
+ * @return 写入结果
+ *  @retval 0 成功
+ *  @retval 1 未初始化或记录超过一页
+ */
+uint8_t recorder_write(uint8_t type, uint8_t channel, const void *data,
+                       uint32_t len) {
+    record_hdr_t hdr = {.type = type,
+                        .channel = channel,
+                        .len = (uint16_t)len,
+                        .time = HAL_GetTick()};
+    uint8_t *ptr;
+
+    if (!recorder_ready) {
+        return 1;
+    }
+
+    ptr = flash_log_reserve(&log_handle, sizeof(hdr) + len);
+    if (ptr == NULL) {
+        return 1;
+    }
+
+    /* 暂存页中的记录不一定对齐 */
+    memcpy(ptr, &hdr, sizeof(hdr));
+    memcpy(ptr + sizeof(hdr), data, len);
+    flash_log_commit(&log_handle, sizeof(hdr) + len);
+
+    dod_init(&recorder_dod, hdr.time);
+    recorder_dod_valid = 1;
+
+    return 0;
+}
+
+/**
+ * @brief 从串口FIFO中读取一条记录到暂存页
+ *
+ * @param port 串口
+ * @return 读取的数据长度, 0表示没有数据或无法写入
+ */
+static uint32_t recorder_drain_port(recorder_port_t *port) {
+    record_hdr_t hdr;
+    record_compact_hdr_t compact;
+    uint32_t hdr_len = sizeof(hdr);
+    uint32_t space;
+    uint32_t len;
+    uint32_t primask;
+    uint8_t *ptr;
+
+    space = flash_log_space(&log_handle);
+    if (space < sizeof(hdr) + RECORDER_MIN_CHUNK) {
+        if (flash_log_flush(&log_handle) != 0) {
+            return 0;
+        }
+        space = flash_log_space(&log_handle);
+    }
+    ptr = flash_log_reserve(&log_handle, space);
+
+    /* 掉电中断也从FIFO读取并写入暂存页, 从读取到提交不能被打断,
+       否则已读出的数据会丢失. 这期间不访问Flash */
+    primask = __get_PRIMASK();
+    __disable_irq();
+
+    /* 读取前确定时间戳, 才能知道记录头的长度. 压缩记录头不更短时用完整记录头 */
+    hdr.time = HAL_GetTick();
+#if (RECORDER_COMPACT_HDR == 1)
+    if ((log_handle.buf_len != 0) && recorder_dod_valid) {
+        hdr_len = sizeof(compact) + (dod_cost(&recorder_dod, hdr.time) + 7) / 8;
+    }
+#endif /* RECORDER_COMPACT_HDR == 1 */
+
+    len = uart_dmarx_read(port->huart, ptr + hdr_len, space - hdr_len);
+    if (len == 0) {
+        __set_PRIMASK(primask);
+        return 0;
+    }
+
+    if (hdr_len == sizeof(hdr)) {
+        hdr.type = RECORD_TYPE_UART;
+        hdr.channel = port->channel;
+        hdr.len = (uint16_t)len;
+        memcpy(ptr, &hdr, sizeof(hdr));
+        dod_init(&recorder_dod, hdr.time);
+        recorder_dod_valid = 1;
+    } else {
+        compact.type = RECORD_TYPE_UART_COMPACT;
+        compact.channel = port->channel;
+        compact.len = (uint8_t)len;
+        memcpy(ptr, &compact, sizeof(compact));
+        dod_set_buffer(&recorder_dod, ptr + sizeof(compact),
+                       hdr_len - sizeof(compact));
+        dod_put(&recorder_dod, hdr.time);
+    }
+    flash_log_commit(&log_handle, hdr_len + len);
+    __set_PRIMASK(primask);
+
+    return len;
+}
+
+/**
+ * @brief 把串口收到的数据写入日志, 在主循环中调用
+ *
+ */
+void recorder_poll(void) {
+    if (!recorder_ready) {
+        return;
+    }
+
+    for (uint32_t i = 0; i < RECORDER_PORT_NUM; ++i) {
+        while (recorder_drain_port(&recorder_ports[i]))
+            ;
+    }
+}
+
+/**
+ * @brief 开始解析一页中的记录
+ *
+ * @param[out] parser 解析状态
+ * @param page 页, 页头中的数据长度有效
+ */
+void recorder_parse_init(recorder_parser_t *parser,
+                         const flash_log_page_t *page) {
+    parser->data = page->data;
+    parser->len = page->hdr.len;
+    parser->offset = 0;
+}
+
+/**
+ * @brief 解析下一条记录
+ *
+ * @param parser 解析状态
+ * @param[out] hdr 记录头, 压缩记录头还原为串口数据记录
+ * @return 记录数据, NULL表示页内没有更多记录. 此时偏移不等于页数据长度
+ *         说明记录不完整或类型错误
+ */
+const uint8_t *recorder_parse(recorder_parser_t *parser, record_hdr_t *hdr) {
+    const uint8_t *ptr = parser->data + parser->offset;
+    uint32_t left = parser->len - parser->offset;
+    record_compact_hdr_t compact;
+
+    if (left < sizeof(compact)) {
+        return NULL;
+    }
+
+    if (ptr[0] != RECORD_TYPE_UART_COMPACT) {
+        if (left < sizeof(*hdr)) {
+            return NULL;
+        }
+        memcpy(hdr, ptr, sizeof(*hdr));
+        if ((hdr->type >= RECORD_TYPE_NUM) ||
+            (sizeof(*hdr) + hdr->len > left)) {
+            return NULL;
+        }
+
+        dod_init(&parser->dod, hdr->time);
+        parser->offset += sizeof(*hdr) + hdr->len;
+        return ptr + sizeof(*hdr);
+    }
+
+    /* 压缩记录头之前必须有完整记录头作为时间戳的基准 */
+    if (parser->offset == 0) {
+        return NULL;
+    }
+
+    memcpy(&compact, ptr, sizeof(compact));
+    ptr += sizeof(compact);
+    left -= sizeof(compact);
+    dod_set_buffer(&parser->dod, (void *)ptr, left);
+    if (dod_get(&parser->dod, &hdr->time) != 0) {
+        return NULL;
+    }
+    ptr += dod_size(&parser->dod);
+    left -= dod_size(&parser->dod);
+    if (compact.len > left) {
+        return NULL;
+    }
+
+    hdr->type = RECORD_TYPE_UART;
+    hdr->channel = compact.channel;
+    hdr->len = compact.len;
+    parser->offset = (uint32_t)(ptr - parser->data) + compact.len;
+    return ptr;
+}
+
+/**
+ * @brief 根据页内的记录填写页摘要
+ *
+ * @param log 日志句柄
+ * @param page 要写入的页
+ * @note 复位后写回的暂存页在写入上电记录之前写入, 时间记为未知
+ */
+void flash_log_meta_callback(flash_log_t *log, flash_log_page_t *page) {
+    record_meta_t meta = {.time = RECORD_TIME_UNKNOWN};
+    recorder_parser_t parser;
+    record_hdr_t hdr;
+    uint32_t records = 0;
+    uint32_t last = 0;
+
+    UNUSED(log);
+
+    recorder_parse_init(&parser, page);
+    while (recorder_parse(&parser, &hdr) != NULL) {
+        if (records++ == 0) {
+            meta.tick = hdr.time;
+        }
+        last = hdr.time;
+        meta.types |= (uint8_t)(1U << (hdr.type < 7 ? hdr.type : 7));
+        meta.channels |= (uint8_t)(1U << (hdr.channel < 7 ? hdr.channel : 7));
+    }
+
+    last = (last - meta.tick + 999) / 1000;
+    meta.span = (last > 0xFFFF) ? 0xFFFF : (uint16_t)last;
+
+    if (recorder_session_time != RECORD_TIME_UNKNOWN) {
+        meta.time = recorder_session_time +
+                    (meta.tick - recorder_session_tick) / 1000;
+    }
+
+    memcpy(page->hdr.meta, &meta, sizeof(meta));
+}
+
+/**
+ * @brief 把暂存页写入Flash
+ *
+ * @return 写入结果
+ *  @retval 0 成功
+ *  @retval 1 日志未挂载或写入失败
+ */
+uint8_t recorder_flush(void) {
+    if (!recorder_ready) {
+        return 1;
+    }
+
+    return flash_log_flush(&log_handle);
+}
+
+/**
+ * @brief 检查日志一致性, 打印结果
+ *
+ * @note 先把暂存页写入Flash, 然后从最旧页读到最新页, 检查页校验,
+ *       页序号是否连续, 页内记录是否完整. 断电测试后用来确认已写入的数据
+ *       没有损坏. 读取整个日志区需要几秒, 期间不记录数据.
+ *       最后打印读取速度, 用来确认预读是否让SPI时钟保持连续
+ */
+void recorder_check(void) {
+    static flash_log_page_t page;
+    uint32_t pages = 0, torn = 0, power_loss = 0, seq_error = 0;
+    uint32_t records = 0, bad_records = 0;
+    uint32_t last_seq = 0;
+    uint32_t bytes, clock;
+    spi_bus_stats_t stats;
+    recorder_parser_t parser;
+    record_hdr_t hdr;
+
+    if (!recorder_ready) {
+        return;
+    }
+
+    recorder_flush();
+    flash_log_sync(&log_handle);
+    /* 开始新的总线统计周期 */
+    spi_bus_get_stats(log_handle.dev[0]->bus, &stats);
+
+    for (uint32_t p = log_handle.tail; p != log_handle.head;
+         p = (p + 1) % log_handle.page_num) {
+        if (flash_log_read_page(&log_handle, p, &page) != 0) {
+            torn++;
+            continue;
+        }
+
+        pages++;
+        if (page.hdr.flags & FLASH_LOG_FLAG_POWER_LOSS) {
+            power_loss++;
+        }
+        /* 编程被打断的页不占用序号, 有效页的序号总是连续的 */
+        if ((last_seq != 0) && (page.hdr.seq != last_seq + 1)) {
+            seq_error++;
+        }
+        last_seq = page.hdr.seq;
+
+        recorder_parse_init(&parser, &page);
+        while (recorder_parse(&parser, &hdr) != NULL) {
+            records++;
+        }
+        if (parser.offset != parser.len) {
+            bad_records++;
+        }
+    }
+
+    printf("Log check: %u pages, %u torn, %u power loss, %u seq errors, "
+           "%u records, %u bad records. \r\n",
+           (unsigned int)pages, (unsigned int)torn, (unsigned int)power_loss,
+           (unsigned int)seq_error, (unsigned int)records,
+           (unsigned int)bad_records);
+
+    /* 读取速度和SPI时钟, 总线占用率 */
+    spi_bus_get_stats(log_handle.dev[0]->bus, &stats);
+    bytes = (pages + torn) * W25QXX_PAGE_SIZE;
+    clock = spi_get_clock(log_handle.dev[0]->bus->hspi);
+    if (stats.period != 0) {
+        printf("Read %u KB/s, SPI clock %u KHz, bus usage %u.%u%%, "
+               "%u transactions. \r\n",
+               (unsigned int)(bytes / stats.period * 1000 / 1024),
+               (unsigned int)(clock / 1000), (unsigned int)(stats.usage / 10),
+               (unsigned int)(stats.usage % 10), (unsigned int)stats.trans);
+    }
+}
+
+/**
+ * @brief 获取日志句柄, 用于读取
+ *
+ * @return 日志句柄
+ */
+flash_log_t *recorder_get_log(void) {
+    return &log_handle;
+}
+
+#if (RECORDER_USE_PVD == 1)
+
+/**
+ * @brief 掉电回调, 把缓冲区中的数据写入Flash
+ *
+ */
+void HAL_PWR_PVDCallback(void) {
+    uint32_t start_seq;
+
+    if (!recorder_ready) {
+        return;
+    }
+
+    /* 停止接收, 把DMA缓冲区中还没有进入FIFO的数据取出来 */
+    for (uint32_t i = 0; i < RECORDER_PORT_NUM; ++i) {
+        __HAL_UART_DISABLE(recorder_ports[i].huart);
+        uart_dmarx_idle_callback(recorder_ports[i].huart);
+    }
+
+    flash_log_emergency_begin(&log_handle);
+    start_seq = log_handle.seq;
+
+    /* 每次读取最多写满一页, 留一页给最后的刷写 */
+    for (uint32_t i = 0; i < RECORDER_PORT_NUM; ++i) {
+        while (log_handle.seq - start_seq < RECORDER_PVD_FLUSH_PAGES - 1) {
+            if (recorder_drain_port(&recorder_ports[i]) == 0) {
+                break;
+            }
+        }
+    }
+    flash_log_flush(&log_handle);
+    flash_log_sync(&log_handle);
+
+    /* 电压恢复时复位重新挂载, 否则等待掉电 */
+    while (pvd_is_low())
+        ;
+    NVIC_SystemReset();
+}
+
+#endif /* RECORDER_USE_PVD == 1 */
@@ -0,0 +1,21 @@
+/**
+ * @file    backup.h
+ * @author  Deadline039
+ * @brief   备份域存储(备份寄存器)
+ * @version 1.0
+ * @date    2026-10-17
+ */
+
+#ifndef __BACKUP_H
+#define __BACKUP_H
+
+#include "stm32f1xx_hal.h"
+
+/* 可用的备份寄存器容量, DR2 ~ DR42, 每个16位. DR1留给RTC */
+#define BACKUP_SIZE 82U
+
+void backup_init(void);
+void backup_read(uint32_t offset, void *buf, uint32_t len);
+void backup_write(uint32_t offset, const void *data, uint32_t len);
+
+#endif /* __BACKUP_H */
@@ -15,11 +15,18 @@
 
 #include "stm32f1xx_hal.h"
 
+#include "backup.h"
 #include "delay.h"
+#include "eeprom.h"
 #include "key.h"
 #include "led.h"
+#include "pvd.h"
 #include "rtc.h"
+#include "spi.h"
+#include "spi_bus.h"
+#include "timer.h"
 #include "uart.h"
+#include "w25qxx.h"
 
 void bsp_init(void);
 
@@ -0,0 +1,56 @@
+/**
+ * @file    dod.h
+ * @author  Deadline039
+ * @brief   时间戳二阶差分编码
+ * @version 1.0
+ * @date    2026-10-17
+ * @note    每个时间戳与上一个的间隔, 再减去上一个间隔, 得到二阶差分,
+ *          按大小用变长前缀码写入位流, 从低位开始填入字节:
+ *          - 0: 二阶差分为0, 1位
+ *          - 10 + 7位: [-64, 63], 9位
+ *          - 110 + 9位: [-256, 255], 12位
+ *          - 1110 + 12位: [-2048, 2047], 16位
+ *          - 1111 + 32位: 其他, 36位
+ *          差分在32位无符号数中计算, 时间戳回绕时也能逐位还原.
+ *          第一个时间戳相对于初始化时给的基准, 间隔按0计算.
+ *          等间隔采样每个时间戳1位, 间隔不规则的也只需要2到5字节
+ */
+
+#ifndef __DOD_H
+#define __DOD_H
+
+#include <stdint.h>
+
+/* 一个时间戳最多占用的位数 */
+#define DOD_MAX_BITS 36
+
+/**
+ * @brief 编解码状态
+ */
+typedef struct {
+    uint8_t *buf;   /*!< 位流缓冲区 */
+    uint32_t size;  /*!< 缓冲区大小 */
+    uint32_t pos;   /*!< 已写入或读取的位数 */
+    uint32_t prev;  /*!< 上一个时间戳 */
+    uint32_t delta; /*!< 上一个间隔 */
+} dod_t;
+
+void dod_init(dod_t *dod, uint32_t base);
+void dod_set_buffer(dod_t *dod, void *buf, uint32_t size);
+
+uint32_t dod_cost(const dod_t *dod, uint32_t time);
+uint32_t dod_bits(int32_t dod);
+uint8_t dod_put(dod_t *dod, uint32_t time);
+uint8_t dod_get(dod_t *dod, uint32_t *time);
+
+/**
+ * @brief 位流已使用的字节数
+ *
+ * @param dod 编解码状态
+ * @return 字节数, 最后一个字节不满时也算上
+ */
+static inline uint32_t dod_size(const dod_t *dod) {
+    return (dod->pos + 7) / 8;
+}
+
+#endif /* __DOD_H */
@@ -0,0 +1,90 @@
+/**
+ * @file    dsp.h
+ * @author  Deadline039
+ * @brief   Q15定点信号处理
+ * @version 1.0
+ * @date    2026-10-17
+ * @note    每个输出采样的周期数, 按指令数估算:
+ *          - 点积, FIR: M4约1.5周期每抽头, M3约5周期每抽头, 另加约20周期
+ *          - 双二阶: M4约20周期每级, M3约30周期每级
+ *          - 滑动平均: 约20周期, 含一次除法
+ *          - 抽取: 每factor个输入算一次FIR, 其余输入约8周期
+ */
+
+#ifndef __DSP_H
+#define __DSP_H
+
+#include <stdint.h>
+
+#if (defined(__ARM_FEATURE_DSP) && (__ARM_FEATURE_DSP == 1))
+#include "cmsis_compiler.h"
+#endif /* __ARM_FEATURE_DSP == 1 */
+
+typedef int16_t q15_t; /* 1.15定点数 */
+typedef int32_t q31_t; /* 1.31定点数 */
+typedef int64_t q63_t; /* 1.63定点数, 也用作乘加的累加器 */
+
+/**
+ * @brief FIR滤波器
+ */
+typedef struct {
+    const q15_t *coeffs; /*!< 系数, coeffs[0]对应最新的输入 */
+    q15_t *state;        /*!< 延迟线, 长度为2 * num_taps */
+    uint16_t num_taps;   /*!< 抽头数 */
+    uint16_t pos;        /*!< 最新输入在延迟线中的位置 */
+} dsp_fir_q15_t;
+
+/**
+ * @brief FIR抽取器, 每factor个输入输出一个
+ */
+typedef struct {
+    dsp_fir_q15_t fir; /*!< 抗混叠滤波器 */
+    uint16_t factor;   /*!< 抽取倍数 */
+    uint16_t phase;    /*!< 距离下一个输出还需的输入数 */
+} dsp_decimate_q15_t;
+
+/**
+ * @brief 级联双二阶IIR滤波器, 直接I型
+ * @note 每级系数为{b0, 0, b1, b2, a1, a2}, 已乘以2^-shift;
+ *       y = b0 * x + b1 * x1 + b2 * x2 + a1 * y1 + a2 * y2,
+ *       a1, a2和MATLAB等设计工具的符号相反
+ */
+typedef struct {
+    const q15_t *coeffs; /*!< 系数, 每级6个 */
+    q15_t *state;        /*!< 状态, 每级{x1, x2, y1, y2} */
+    uint8_t num_stages;  /*!< 级数 */
+    uint8_t shift;       /*!< 系数缩小的位数, 输出时补回 */
+} dsp_biquad_q15_t;
+
+/**
+ * @brief 滑动平均
+ */
+typedef struct {
+    q15_t *buf;   /*!< 窗口内的输入 */
+    int32_t sum;  /*!< 窗口内输入的和 */
+    uint16_t len; /*!< 窗口长度 */
+    uint16_t pos; /*!< 最早的输入的位置 */
+} dsp_mavg_q15_t;
+
+q63_t dsp_dot_q15(const q15_t *a, const q15_t *b, uint32_t n);
+void dsp_add_q15(const q15_t *a, const q15_t *b, q15_t *out, uint32_t n);
+
+void dsp_fir_q15_init(dsp_fir_q15_t *fir, const q15_t *coeffs, q15_t *state,
+                      uint16_t num_taps);
+void dsp_fir_q15(dsp_fir_q15_t *fir, const q15_t *in, q15_t *out, uint32_t n);
+
+void dsp_decimate_q15_init(dsp_decimate_q15_t *dec, const q15_t *coeffs,
+                           q15_t *state, uint16_t num_taps, uint16_t factor);
+uint32_t dsp_decimate_q15(dsp_decimate_q15_t *dec, const q15_t *in,
+                          q15_t *out, uint32_t n);
+
+void dsp_biquad_q15_init(dsp_biquad_q15_t *iir, const q15_t *coeffs,
+                         q15_t *state, uint8_t num_stages, uint8_t shift);
+void dsp_biquad_q15(dsp_biquad_q15_t *iir, const q15_t *in, q15_t *out,
+                    uint32_t n);
+
+void dsp_mavg_q15_init(dsp_mavg_q15_t *mavg, q15_t *buf, uint16_t len);
+void dsp_mavg_q15(dsp_mavg_q15_t *mavg, const q15_t *in, q15_t *out,
+                  uint32_t n);
+
+#endif /* __DSP_H */
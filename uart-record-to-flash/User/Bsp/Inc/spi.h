@@ -0,0 +1,87 @@
+/**
+ * @file    spi.h
+ * @author  Deadline039
+ * @brief   STM32F103 SPI驱动
+ * @version 1.0
+ * @date    2026-10-17
+ */
+
+#ifndef __SPI_H
+#define __SPI_H
+
+#include "stm32f1xx_hal.h"
+
+// <<< Use Configuration Wizard in Context Menu >>>
+
+// <e> 启用SPI1
+// ==================
+
+#define SPI1_ENABLE 1
+
+#if (SPI1_ENABLE == 1)
+
+extern SPI_HandleTypeDef spi1_handle;
+
+/* SPI1 SCK GPIO */
+#define SPI1_SCK_GPIO_PORT      GPIOA
+#define SPI1_SCK_GPIO_ENABLE()  __HAL_RCC_GPIOA_CLK_ENABLE()
+#define SPI1_SCK_GPIO_PIN       GPIO_PIN_5
+/* SPI1 MISO GPIO */
+#define SPI1_MISO_GPIO_PORT     GPIOA
+#define SPI1_MISO_GPIO_ENABLE() __HAL_RCC_GPIOA_CLK_ENABLE()
+#define SPI1_MISO_GPIO_PIN      GPIO_PIN_6
+/* SPI1 MOSI GPIO */
+#define SPI1_MOSI_GPIO_PORT     GPIOA
+#define SPI1_MOSI_GPIO_ENABLE() __HAL_RCC_GPIOA_CLK_ENABLE()
+#define SPI1_MOSI_GPIO_PIN      GPIO_PIN_7
+
+//  <e> 使用DMA
+//  <i> 接收使用DMA1通道2, 发送使用DMA1通道3
+//  <i> 和串口3的DMA通道相同, 不能同时使用
+#define SPI1_USE_DMA            1
+
+#if (SPI1_USE_DMA == 1)
+
+//  <o SPI1_DMA_PRIORITY> SPI1 DMA优先级
+//      <DMA_PRIORITY_LOW=>低
+//      <DMA_PRIORITY_MEDIUM=>中
+//      <DMA_PRIORITY_HIGH=>高
+//      <DMA_PRIORITY_VERY_HIGH=>非常高
+#define SPI1_DMA_PRIORITY   DMA_PRIORITY_MEDIUM
+//  <o> SPI1 DMA中断抢占优先级
+//  <i> 中断中会开始总线队列中的下一个事务, 不要高于串口DMA中断
+#define SPI1_DMA_IT_PREEMPT 1
+//  <o> SPI1 DMA中断子优先级
+#define SPI1_DMA_IT_SUB     0
+
+#endif /* SPI1_USE_DMA == 1 */
+
+//  </e>
+
+#endif /* SPI1_ENABLE == 1 */
+
+// </e>
+
+//  <o> SPI阻塞传输超时时间(ms)
+#define SPI_TIMEOUT 1000
+
+// <<< end of configuration section >>>
+
+void spi_init(SPI_HandleTypeDef *hspi, uint32_t clk_polarity,
+              uint32_t clk_phase, uint32_t baud_rate_prescaler);
+void spi_set_speed(SPI_HandleTypeDef *hspi, uint32_t baud_rate_prescaler);
+
+uint8_t spi_read_write_byte(SPI_HandleTypeDef *hspi, uint8_t data);
+HAL_StatusTypeDef spi_transmit(SPI_HandleTypeDef *hspi, const void *data,
+                               uint32_t len);
+HAL_StatusTypeDef spi_receive(SPI_HandleTypeDef *hspi, void *buf,
+                              uint32_t len);
+HAL_StatusTypeDef spi_transmit_dma(SPI_HandleTypeDef *hspi, const void *data,
+                                   uint16_t len);
+HAL_StatusTypeDef spi_receive_dma(SPI_HandleTypeDef *hspi, void *buf,
+                                  uint16_t len);
+uint32_t spi_get_clock(SPI_HandleTypeDef *hspi);
+
+void spi_abort(SPI_HandleTypeDef *hspi);
+
+#endif /* __SPI_H */
@@ -0,0 +1,40 @@
+/**
+ * @file    timer.h
+ * @author  Deadline039
+ * @brief   微秒定时器
+ * @version 1.0
+ * @date    2026-10-17
+ */
+
+#ifndef __TIMER_H
+#define __TIMER_H
+
+#include "stm32f1xx_hal.h"
+
+// <<< Use Configuration Wizard in Context Menu >>>
+
+//  <o> 定时器中断抢占优先级
+#define TIMER_US_IT_PREEMPT 1
+//  <o> 定时器中断子优先级
+#define TIMER_US_IT_SUB     0
+
+//  <o> 最短提前量(us)
+//  <i> 距离定时时间小于该值时来不及设置比较值, 立即触发
+#define TIMER_US_MIN_LEAD   5
+
+// <<< end of configuration section >>>
+
+/* 使用的定时器, 16位, 用比较通道1定时 */
+#define TIMER_US_INSTANCE     TIM5
+#define TIMER_US_IRQn         TIM5_IRQn
+#define TIMER_US_IRQHandler   TIM5_IRQHandler
+#define TIMER_US_CLK_ENABLE() __HAL_RCC_TIM5_CLK_ENABLE()
+
+void timer_us_init(void);
+uint32_t timer_us_now(void);
+
+void timer_us_schedule(uint32_t target);
+void timer_us_cancel(void);
+void timer_us_callback(int32_t error);
+
+#endif /* __TIMER_H */
@@ -280,7 +280,7 @@ extern UART_HandleTypeDef usart3_handle;
 // <e> 启用串口4
 // ==================
 
-#define UART4_ENABLE 0
+#define UART4_ENABLE 1
 
 #if (UART4_ENABLE == 1)
 
@@ -292,7 +292,7 @@ extern UART_HandleTypeDef uart4_handle;
 #if (UART4_USE_DMA_TX == 1)
 
 //  <o> 发送缓冲区大小
-#define UART4_TX_BUF_SIZE       128
+#define UART4_TX_BUF_SIZE       256
 
 //  <o UART4_DMA_TX_PRIORITY> 串口4 DMA发送优先级
 //      <DMA_PRIORITY_LOW=>低
@@ -317,7 +317,7 @@ extern UART_HandleTypeDef uart4_handle;
 //  <o> 接收缓冲区大小
 #define UART4_RX_BUF_SIZE       256
 //  <o> 接收fifo大小(必须为2的幂次方)
-#define UART4_RX_FIFO_SZIE      2048
+#define UART4_RX_FIFO_SZIE      256
 
 //  <o UART4_DMA_RX_PRIORITY> 串口4 DMA接收优先级
 //      <DMA_PRIORITY_LOW=>低
@@ -397,4 +397,6 @@ uint32_t uart_dmatx_send(UART_HandleTypeDef *huart);
 
 uint32_t uart_dmarx_read(UART_HandleTypeDef *huart, void *buf, size_t len);
 
+void uart_tx_done_callback(UART_HandleTypeDef *huart);
+
 #endif /* __UART_H */
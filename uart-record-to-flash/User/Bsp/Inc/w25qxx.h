@@ -0,0 +1,69 @@
+/**
+ * @file    w25qxx.h
+ * @author  Deadline039
+ * @brief   W25Qxx系列SPI Flash驱动
+ * @version 1.0
+ * @date    2026-10-17
+ */
+
+#ifndef __W25QXX_H
+#define __W25QXX_H
+
+#include "spi_bus.h"
+
+/* 板载W25Q64片选 */
+#define W25QXX_CS_GPIO_PORT      GPIOA
+#define W25QXX_CS_GPIO_ENABLE()  __HAL_RCC_GPIOA_CLK_ENABLE()
+#define W25QXX_CS_GPIO_PIN       GPIO_PIN_2
+
+/* 扩展的第二片W25Qxx片选, 和第一片共用SPI */
+#define W25QXX_CS2_GPIO_PORT     GPIOA
+#define W25QXX_CS2_GPIO_ENABLE() __HAL_RCC_GPIOA_CLK_ENABLE()
+#define W25QXX_CS2_GPIO_PIN      GPIO_PIN_4
+
+/* 芯片ID */
+#define W25Q16                   0xEF14
+#define W25Q32                   0xEF15
+#define W25Q64                   0xEF16
+#define W25Q128                  0xEF17
+#define W25Q256                  0xEF18
+
+#define W25QXX_PAGE_SIZE         256U  /* 页大小, 一次编程最多写入一页 */
+#define W25QXX_SECTOR_SIZE       4096U /* 扇区大小, 最小擦除单位 */
+
+/* SPI时钟设置: 模式3, 4分频 */
+#define W25QXX_SPI_MODE                                                        \
+    (SPI_POLARITY_HIGH | SPI_PHASE_2EDGE | SPI_BAUDRATEPRESCALER_4)
+
+/**
+ * @brief W25Qxx设备
+ */
+typedef struct {
+    spi_bus_t *bus;        /*!< 挂载的SPI总线 */
+    GPIO_TypeDef *cs_port; /*!< 片选端口 */
+    uint16_t cs_pin;       /*!< 片选引脚 */
+
+    uint16_t id;       /*!< 芯片ID, 初始化时读取 */
+    uint32_t capacity; /*!< 容量(byte) */
+
+    __IO uint8_t erasing;  /*!< 是否发起了擦除且尚未确认完成 */
+    spi_trans_t dma_trans; /*!< DMA读取事务 */
+} w25qxx_t;
+
+uint8_t w25qxx_init(w25qxx_t *dev);
+
+void w25qxx_read(w25qxx_t *dev, uint32_t addr, void *buf, uint32_t len);
+uint8_t w25qxx_read_dma(w25qxx_t *dev, uint32_t addr, void *buf,
+                        uint32_t len);
+void w25qxx_read_dma_callback(w25qxx_t *dev);
+void w25qxx_program_page(w25qxx_t *dev, uint32_t addr, const void *data,
+                         uint32_t len);
+void w25qxx_erase_sector(w25qxx_t *dev, uint32_t addr);
+
+uint8_t w25qxx_is_busy(w25qxx_t *dev);
+void w25qxx_wait_busy(w25qxx_t *dev);
+
+uint8_t w25qxx_suspend_erase(w25qxx_t *dev);
+void w25qxx_abort(w25qxx_t *dev);
+
+#endif /* __W25QXX_H */
@@ -0,0 +1,92 @@
+/**
+ * @file    backup.c
+ * @author  Deadline039
+ * @brief   备份域存储(备份寄存器)
+ * @version 1.0
+ * @date    2026-10-17
+ * @note    F103没有备份SRAM, 用备份数据寄存器代替. 大容量产品有42个16位
+ *          寄存器, DR1被RTC用作时钟源标志, 这里使用DR2 ~ DR42.
+ *          备份寄存器由VBAT供电, 复位和看门狗不会清除
+ */
+
+#include "backup.h"
+
+/**
+ * @brief 获取备份寄存器地址
+ *
+ * @param index 寄存器序号, 0对应DR2
+ * @return 寄存器地址
+ * @note DR1 ~ DR10和DR11 ~ DR42的地址不连续
+ */
+static inline __IO uint32_t *backup_reg(uint32_t index) {
+    if (index < 9) {
+        return &BKP->DR2 + index;
+    }
+    return &BKP->DR11 + (index - 9);
+}
+
+/**
+ * @brief 备份寄存器初始化
+ *
+ */
+void backup_init(void) {
+    __HAL_RCC_PWR_CLK_ENABLE();
+    __HAL_RCC_BKP_CLK_ENABLE();
+    HAL_PWR_EnableBkUpAccess();
+}
+
+/**
+ * @brief 读备份寄存器
+ *
+ * @param offset 偏移地址(byte)
+ * @param buf 接收缓冲区
+ * @param len 读取长度
+ */
+void backup_read(uint32_t offset, void *buf, uint32_t len) {
+    uint8_t *ptr = (uint8_t *)buf;
+
+    assert_param(offset + len <= BACKUP_SIZE);
+
+    for (uint32_t i = offset; i < offset + len; ++i) {
+        *ptr++ = (uint8_t)(*backup_reg(i / 2) >> ((i % 2) * 8));
+    }
+}
+
+/**
+ * @brief 写备份寄存器
+ *
+ * @param offset 偏移地址(byte)
+ * @param data 要写入的数据
+ * @param len 数据长度
+ * @note 按16位寄存器写入, 同一个寄存器中的两个字节同时更新
+ */
+void backup_write(uint32_t offset, const void *data, uint32_t len) {
+    const uint8_t *ptr = (const uint8_t *)data;
+    __IO uint32_t *reg;
+    uint32_t value;
+
+    assert_param(offset + len <= BACKUP_SIZE);
+
+    while (len) {
+        reg = backup_reg(offset / 2);
+
+        if ((offset % 2 == 0) && (len >= 2)) {
+            value = ptr[0] | (ptr[1] << 8);
+            ptr += 2;
+            offset += 2;
+            len -= 2;
+        } else if (offset % 2 == 0) {
+            value = (*reg & 0xFF00) | ptr[0];
+            ptr++;
+            offset++;
+            len--;
+        } else {
+            value = (*reg & 0x00FF) | (ptr[0] << 8);
+            ptr++;
+            offset++;
+            len--;
+        }
+
+        *reg = value;
+    }
+}
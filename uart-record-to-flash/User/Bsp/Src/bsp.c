@@ -56,9 +56,17 @@ void bsp_init(void) {
     delay_init(72);
     uart_init(&usart1_handle, 115200, UART_WORDLENGTH_8B, UART_STOPBITS_1,
               UART_PARITY_NONE, UART_HWCONTROL_NONE, UART_MODE_TX_RX);
+    uart_init(&uart4_handle, 115200, UART_WORDLENGTH_8B, UART_STOPBITS_1,
+              UART_PARITY_NONE, UART_HWCONTROL_NONE, UART_MODE_TX_RX);
     led_init();
     key_init();
     rtc_init();
+    backup_init();
+    eeprom_init();
+    spi_init(&spi1_handle, SPI_POLARITY_HIGH, SPI_PHASE_2EDGE,
+             SPI_BAUDRATEPRESCALER_4);
+    spi_bus_init(&spi1_bus);
+    timer_us_init();
 }
 
 #ifdef USE_FULL_ASSERT
@@ -0,0 +1,409 @@
+/**
+ * @file    eeprom.c
+ * @author  Deadline039
+ * @brief   用片内Flash模拟EEPROM
+ * @version 1.0
+ * @date    2026-10-17
+ * @note    两页轮流使用. 写入时在当前页末尾追加一条记录, 同一个键的新记录
+ *          覆盖旧记录; 当前页写满时把每个键的最新记录复制到另一页(整理),
+ *          然后擦除当前页.
+ *
+ *          页开头是页头(代数和代数取反), 整理时最后写页头, 两页都有效时
+ *          代数大的为当前页. 每条记录最后写校验, 校验不对的记录被忽略.
+ *          内存中保存每个键最新记录的地址, 读取时直接从Flash拷贝.
+ *
+ *          擦除和编程期间CPU不能从Flash取指, 中断也会被推迟.
+ */
+
+#include "eeprom.h"
+
+#include <string.h>
+
+#define EEPROM_ERASED           0xFFFFFFFFU
+
+/* 页头长度: 代数和代数取反 */
+#define EEPROM_HDR_SIZE         8U
+
+/* 记录长度: 键和数据长度, 数据(按字对齐), 校验 */
+#define EEPROM_RECORD_SIZE(len) (4U + (((uint32_t)(len) + 3U) & ~3U) + 4U)
+
+static const uint32_t eeprom_page_addr[2] = {EEPROM_PAGE0_ADDR,
+                                             EEPROM_PAGE1_ADDR};
+
+static uint32_t eeprom_index[EEPROM_KEY_NUM]; /* 每个键最新记录的地址 */
+static uint8_t eeprom_active;                 /* 当前页 */
+static uint32_t eeprom_generation;            /* 当前页的代数 */
+static uint32_t eeprom_write_addr;            /* 下一条记录的地址 */
+
+/**
+ * @brief 读取Flash中的一个字
+ *
+ * @param addr 地址
+ * @return 数据
+ */
+static inline uint32_t eeprom_read_word(uint32_t addr) {
+    return *(__IO uint32_t *)addr;
+}
+
+/**
+ * @brief 计算记录的校验
+ *
+ * @param hdr 键和数据长度
+ * @param data 数据
+ * @param len 数据长度
+ * @return CRC16
+ */
+static uint16_t eeprom_record_crc(uint32_t hdr, const uint8_t *data,
+                                  uint16_t len) {
+    uint16_t crc = 0xFFFF;
+    uint8_t byte;
+
+    for (uint32_t i = 0; i < 4U + len; ++i) {
+        byte = (i < 4) ? (uint8_t)(hdr >> (i * 8)) : data[i - 4];
+        crc ^= (uint16_t)byte << 8;
+        for (uint8_t j = 0; j < 8; ++j) {
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021)
+                                 : (uint16_t)(crc << 1);
+        }
+    }
+
+    return crc;
+}
+
+/**
+ * @brief 解锁Flash并清除之前的错误标志
+ *
+ */
+static inline void eeprom_unlock(void) {
+    HAL_FLASH_Unlock();
+    __HAL_FLASH_CLEAR_FLAG(FLASH_FLAG_EOP | FLASH_FLAG_PGERR |
+                           FLASH_FLAG_WRPERR);
+}
+
+/**
+ * @brief 擦除一页, 已经是空页时不擦除
+ *
+ * @param page 页序号
+ * @return 擦除结果
+ *  @retval 0 成功
+ *  @retval 1 失败
+ */
+static uint8_t eeprom_erase_page(uint8_t page) {
+    HAL_StatusTypeDef res = HAL_OK;
+    FLASH_EraseInitTypeDef erase_init = {0};
+    uint32_t page_error;
+    uint32_t addr = eeprom_page_addr[page];
+
+    while (eeprom_read_word(addr) == EEPROM_ERASED) {
+        addr += 4;
+        if (addr == eeprom_page_addr[page] + EEPROM_PAGE_SIZE) {
+            return 0;
+        }
+    }
+
+    erase_init.TypeErase = FLASH_TYPEERASE_PAGES;
+    erase_init.PageAddress = eeprom_page_addr[page];
+    erase_init.NbPages = EEPROM_PAGE_SIZE / FLASH_PAGE_SIZE;
+
+    eeprom_unlock();
+    res = HAL_FLASHEx_Erase(&erase_init, &page_error);
+    HAL_FLASH_Lock();
+
+    return (res == HAL_OK) ? 0 : 1;
+}
+
+/**
+ * @brief 编程一个字, 调用前需调用`eeprom_unlock`
+ *
+ * @param addr 地址
+ * @param data 数据
+ * @return 编程结果
+ *  @retval 0 成功
+ *  @retval 1 失败
+ */
+static inline uint8_t eeprom_program_word(uint32_t addr, uint32_t data) {
+    return (HAL_FLASH_Program(FLASH_TYPEPROGRAM_WORD, addr, data) == HAL_OK)
+               ? 0
+               : 1;
+}
+
+/**
+ * @brief 写入页头
+ *
+ * @param page 页序号
+ * @param generation 代数
+ * @return 写入结果
+ *  @retval 0 成功
+ *  @retval 1 失败
+ */
+static uint8_t eeprom_program_hdr(uint8_t page, uint32_t generation) {
+    uint8_t res;
+
+    eeprom_unlock();
+    res = eeprom_program_word(eeprom_page_addr[page], generation);
+    if (res == 0) {
+        res = eeprom_program_word(eeprom_page_addr[page] + 4, ~generation);
+    }
+    HAL_FLASH_Lock();
+
+    return res;
+}
+
+/**
+ * @brief 写入一条记录
+ *
+ * @param addr 记录地址
+ * @param key 键
+ * @param data 数据
+ * @param len 数据长度
+ * @return 写入结果
+ *  @retval 0 成功
+ *  @retval 1 失败
+ * @note 最后写入校验, 中途掉电的记录校验不对
+ */
+static uint8_t eeprom_program_record(uint32_t addr, uint16_t key,
+                                     const void *data, uint16_t len) {
+    const uint8_t *ptr = (const uint8_t *)data;
+    uint32_t hdr = key | ((uint32_t)len << 16);
+    uint32_t word;
+    uint8_t res;
+
+    eeprom_unlock();
+
+    res = eeprom_program_word(addr, hdr);
+    addr += 4;
+
+    for (uint32_t i = 0; (i < len) && (res == 0); i += 4) {
+        word = EEPROM_ERASED;
+        memcpy(&word, ptr + i, (len - i < 4) ? (len - i) : 4);
+        res = eeprom_program_word(addr, word);
+        addr += 4;
+    }
+
+    if (res == 0) {
+        res = eeprom_program_word(addr, eeprom_record_crc(hdr, ptr, len));
+    }
+
+    HAL_FLASH_Lock();
+
+    return res;
+}
+
+/**
+ * @brief 扫描当前页, 建立索引
+ *
+ */
+static void eeprom_scan(void) {
+    uint32_t addr = eeprom_page_addr[eeprom_active] + EEPROM_HDR_SIZE;
+    uint32_t end = eeprom_page_addr[eeprom_active] + EEPROM_PAGE_SIZE;
+    uint32_t hdr, size;
+    uint16_t key, len;
+
+    memset(eeprom_index, 0, sizeof(eeprom_index));
+
+    while (addr + 4 <= end) {
+        hdr = eeprom_read_word(addr);
+        if (hdr == EEPROM_ERASED) {
+            break;
+        }
+
+        key = (uint16_t)hdr;
+        len = (uint16_t)(hdr >> 16);
+        size = EEPROM_RECORD_SIZE(len);
+        if ((key >= EEPROM_KEY_NUM) || (len > EEPROM_VALUE_MAX) ||
+            (addr + size > end)) {
+            /* 记录头损坏, 找不到下一条记录, 下次写入时整理 */
+            addr = end;
+            break;
+        }
+
+        if (eeprom_read_word(addr + size - 4) ==
+            eeprom_record_crc(hdr, (const uint8_t *)(addr + 4), len)) {
+            eeprom_index[key] = addr;
+        }
+        addr += size;
+    }
+
+    eeprom_write_addr = addr;
+}
+
+/**
+ * @brief 整理到另一页, 同时写入一条新记录
+ *
+ * @param key 键
+ * @param data 数据
+ * @param len 数据长度
+ * @return 整理结果
+ *  @retval 0 成功
+ *  @retval 1 所有数据一页放不下或者Flash操作失败
+ */
+static uint8_t eeprom_compact(uint16_t key, const void *data, uint16_t len) {
+    uint32_t new_index[EEPROM_KEY_NUM] = {0};
+    uint8_t next = !eeprom_active;
+    uint32_t addr = eeprom_page_addr[next] + EEPROM_HDR_SIZE;
+    uint32_t total = EEPROM_HDR_SIZE + EEPROM_RECORD_SIZE(len);
+    uint16_t old_len;
+
+    for (uint16_t k = 0; k < EEPROM_KEY_NUM; ++k) {
+        if ((k != key) && eeprom_index[k]) {
+            old_len = (uint16_t)(eeprom_read_word(eeprom_index[k]) >> 16);
+            total += EEPROM_RECORD_SIZE(old_len);
+        }
+    }
+    if (total > EEPROM_PAGE_SIZE) {
+        return 1;
+    }
+
+    if (eeprom_erase_page(next) != 0) {
+        return 1;
+    }
+
+    for (uint16_t k = 0; k < EEPROM_KEY_NUM; ++k) {
+        if ((k == key) || (eeprom_index[k] == 0)) {
+            continue;
+        }
+        old_len = (uint16_t)(eeprom_read_word(eeprom_index[k]) >> 16);
+        if (eeprom_program_record(addr, k, (const void *)(eeprom_index[k] + 4),
+                                  old_len) != 0) {
+            return 1;
+        }
+        new_index[k] = addr;
+        addr += EEPROM_RECORD_SIZE(old_len);
+    }
+
+    if (eeprom_program_record(addr, key, data, len) != 0) {
+        return 1;
+    }
+    new_index[key] = addr;
+    addr += EEPROM_RECORD_SIZE(len);
+
+    /* 最后写页头, 之前掉电时旧页仍然有效 */
+    if (eeprom_program_hdr(next, eeprom_generation + 1) != 0) {
+        return 1;
+    }
+
+    memcpy(eeprom_index, new_index, sizeof(eeprom_index));
+    eeprom_active = next;
+    eeprom_generation++;
+    eeprom_write_addr = addr;
+
+    eeprom_erase_page(!next);
+
+    return 0;
+}
+
+/**
+ * @brief 初始化, 找到当前页并建立索引
+ *
+ * @return 初始化结果
+ *  @retval 0 成功
+ *  @retval 1 Flash操作失败
+ */
+uint8_t eeprom_init(void) {
+    uint32_t generation[2];
+    uint8_t valid[2];
+
+    for (uint8_t p = 0; p < 2; ++p) {
+        generation[p] = eeprom_read_word(eeprom_page_addr[p]);
+        valid[p] = (generation[p] != EEPROM_ERASED) &&
+                   (eeprom_read_word(eeprom_page_addr[p] + 4) ==
+                    ~generation[p]);
+    }
+
+    if (!valid[0] && !valid[1]) {
+        /* 第一次使用, 格式化 */
+        if ((eeprom_erase_page(0) != 0) || (eeprom_program_hdr(0, 1) != 0)) {
+            return 1;
+        }
+
+        generation[0] = 1;
+        eeprom_active = 0;
+    } else if (valid[0] && valid[1]) {
+        /* 整理完成后旧页还没有擦除 */
+        eeprom_active = (generation[1] > generation[0]) ? 1 : 0;
+    } else {
+        eeprom_active = valid[1] ? 1 : 0;
+    }
+    eeprom_generation = generation[eeprom_active];
+
+    /* 另一页可能有整理到一半的数据 */
+    if (eeprom_erase_page(!eeprom_active) != 0) {
+        return 1;
+    }
+
+    eeprom_scan();
+
+    return 0;
+}
+
+/**
+ * @brief 读取一个键的值
+ *
+ * @param key 键
+ * @param[out] buf 接收缓冲区
+ * @param len 值的长度, 必须和写入时相同
+ * @return 读取结果
+ *  @retval 0 成功
+ *  @retval 1 键不存在或长度不同
+ */
+uint8_t eeprom_read(uint16_t key, void *buf, uint16_t len) {
+    if ((key >= EEPROM_KEY_NUM) || (eeprom_index[key] == 0)) {
+        return 1;
+    }
+
+    if ((eeprom_read_word(eeprom_index[key]) >> 16) != len) {
+        return 1;
+    }
+
+    memcpy(buf, (const void *)(eeprom_index[key] + 4), len);
+
+    return 0;
+}
+
+/**
+ * @brief 写入一个键的值
+ *
+ * @param key 键
+ * @param data 数据
+ * @param len 数据长度, 不超过`EEPROM_VALUE_MAX`
+ * @return 写入结果
+ *  @retval 0 成功
+ *  @retval 1 参数错误, 空间不足或Flash操作失败
+ * @note 值没有变化时不写入. 当前页写满时会整理, 需要擦除一页
+ */
+uint8_t eeprom_write(uint16_t key, const void *data, uint16_t len) {
+    uint32_t hdr = key | ((uint32_t)len << 16);
+    uint32_t size = EEPROM_RECORD_SIZE(len);
+
+    if ((key >= EEPROM_KEY_NUM) || (len > EEPROM_VALUE_MAX)) {
+        return 1;
+    }
+
+    if (eeprom_index[key] &&
+        ((eeprom_read_word(eeprom_index[key]) >> 16) == len) &&
+        (memcmp((const void *)(eeprom_index[key] + 4), data, len) == 0)) {
+        return 0;
+    }
+
+    if (eeprom_write_addr + size >
+        eeprom_page_addr[eeprom_active] + EEPROM_PAGE_SIZE) {
+        return eeprom_compact(key, data, len);
+    }
+
+    if (eeprom_program_record(eeprom_write_addr, key, data, len) == 0) {
+        eeprom_index[key] = eeprom_write_addr;
+        eeprom_write_addr += size;
+        return 0;
+    }
+
+    /* 写入失败: 记录头完整时跳过这条记录; 记录头没有写入时这个位置还能用,
+     * 否则扫描在这里停下, 之后的记录都会丢失; 记录头写坏时扫描找不到
+     * 下一条记录, 下次写入时整理 */
+    if (eeprom_read_word(eeprom_write_addr) == hdr) {
+        eeprom_write_addr += size;
+    } else if (eeprom_read_word(eeprom_write_addr) != EEPROM_ERASED) {
+        eeprom_write_addr = eeprom_page_addr[eeprom_active] + EEPROM_PAGE_SIZE;
+    }
+
+    return 1;
+}
@@ -0,0 +1,49 @@
+/**
+ * @file    pvd.c
+ * @author  Deadline039
+ * @brief   可编程电压监测器(PVD)
+ * @version 1.0
+ * @date    2026-10-17
+ * @note    VDD跌落到阈值以下时PVD输出置1, 在EXTI16上产生上升沿.
+ *          中断配置为最高抢占优先级, 掉电处理在`HAL_PWR_PVDCallback`中实现
+ */
+
+#include "pvd.h"
+
+/**
+ * @brief PVD初始化
+ *
+ * @param level 检测阈值
+ *  @arg `PWR_PVDLEVEL_0` ~ `PWR_PVDLEVEL_7`, 对应2.2V ~ 2.9V
+ */
+void pvd_init(uint32_t level) {
+    PWR_PVDTypeDef pvd_config = {0};
+
+    __HAL_RCC_PWR_CLK_ENABLE();
+
+    pvd_config.PVDLevel = level;
+    pvd_config.Mode = PWR_PVD_MODE_IT_RISING; /* VDD低于阈值时触发 */
+    HAL_PWR_ConfigPVD(&pvd_config);
+
+    HAL_NVIC_SetPriority(PVD_IRQn, 0, 0);
+    HAL_NVIC_EnableIRQ(PVD_IRQn);
+
+    HAL_PWR_EnablePVD();
+}
+
+/**
+ * @brief VDD是否低于阈值
+ *
+ * @return 0-电压正常, 1-低于阈值
+ */
+uint8_t pvd_is_low(void) {
+    return __HAL_PWR_GET_FLAG(PWR_FLAG_PVDO) ? 1 : 0;
+}
+
+/**
+ * @brief PVD中断服务函数
+ *
+ */
+void PVD_IRQHandler(void) {
+    HAL_PWR_PVD_IRQHandler();
+}
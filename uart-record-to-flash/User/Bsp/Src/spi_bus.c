@@ -0,0 +1,366 @@
+/**
+ * @file    spi_bus.c
+ * @author  Deadline039
+ * @brief   SPI总线事务队列
+ * @version 1.0
+ * @date    2026-10-17
+ * @note    多个设备共用一个SPI时, 每次访问作为一个事务提交到总线队列.
+ *          总线空闲时提交的事务立即开始; 否则排队, 由上一个事务的DMA
+ *          完成中断发起下一个, 事务之间没有CPU参与的空闲时间.
+ *          每个事务带自己的片选和时钟设置, 开始前按需切换.
+ *
+ *          命令阶段通常只有几个字节, 查询方式发送; 数据较长时用DMA.
+ *          总线占用时间用DWT周期计数器统计.
+ */
+
+#include "spi_bus.h"
+
+#if (SPI1_ENABLE == 1)
+spi_bus_t spi1_bus = {.hspi = &spi1_handle};
+#endif /* SPI1_ENABLE == 1 */
+
+/* 事务可以设置的CR1位 */
+#define SPI_BUS_MODE_MASK (SPI_CR1_CPOL | SPI_CR1_CPHA | SPI_CR1_BR)
+
+/**
+ * @brief 根据SPI句柄查找总线
+ *
+ * @param hspi SPI句柄
+ * @return 总线, 没有找到返回NULL
+ */
+static spi_bus_t *spi_bus_find(SPI_HandleTypeDef *hspi) {
+#if (SPI1_ENABLE == 1)
+    if (hspi == &spi1_handle) {
+        return &spi1_bus;
+    }
+#endif /* SPI1_ENABLE == 1 */
+
+    return NULL;
+}
+
+/**
+ * @brief 总线空闲时取出优先级最高的事务, 作为当前事务
+ *
+ * @param bus 总线
+ * @return 要开始的事务, 总线忙或队列为空时返回NULL
+ */
+static spi_trans_t *spi_bus_next(spi_bus_t *bus) {
+    spi_trans_t *trans = NULL;
+    uint32_t primask = __get_PRIMASK();
+
+    __disable_irq();
+    if (bus->current == NULL) {
+        for (uint32_t i = 0; i < SPI_BUS_PRIO_NUM; ++i) {
+            trans = bus->head[i];
+            if (trans != NULL) {
+                bus->head[i] = trans->next;
+                if (bus->head[i] == NULL) {
+                    bus->tail[i] = NULL;
+                }
+                trans->state = SPI_TRANS_RUNNING;
+                bus->current = trans;
+                break;
+            }
+        }
+    }
+    __set_PRIMASK(primask);
+
+    return trans;
+}
+
+/**
+ * @brief 开始一个事务
+ *
+ * @param bus 总线
+ * @param trans 事务
+ * @param polling 是否强制用查询方式传输
+ * @return 开始结果
+ *  @retval 0 已传输完成
+ *  @retval 1 DMA传输中, 完成后在中断中结束事务
+ *  @retval 2 传输出错
+ */
+static uint8_t spi_bus_start(spi_bus_t *bus, spi_trans_t *trans,
+                             uint8_t polling) {
+    SPI_HandleTypeDef *hspi = bus->hspi;
+    HAL_StatusTypeDef res = HAL_OK;
+
+    bus->trans_start = DWT->CYCCNT;
+
+    if ((hspi->Instance->CR1 & SPI_BUS_MODE_MASK) != trans->mode) {
+        __HAL_SPI_DISABLE(hspi);
+        MODIFY_REG(hspi->Instance->CR1, SPI_BUS_MODE_MASK, trans->mode);
+        hspi->Init.CLKPolarity = trans->mode & SPI_CR1_CPOL;
+        hspi->Init.CLKPhase = trans->mode & SPI_CR1_CPHA;
+        hspi->Init.BaudRatePrescaler = trans->mode & SPI_CR1_BR;
+        __HAL_SPI_ENABLE(hspi);
+    }
+
+    HAL_GPIO_WritePin(trans->cs_port, trans->cs_pin, GPIO_PIN_RESET);
+
+    if (trans->cmd_len) {
+        res = spi_transmit(hspi, trans->cmd, trans->cmd_len);
+    }
+    if ((res != HAL_OK) || (trans->data_len == 0)) {
+        return (res == HAL_OK) ? 0 : 2;
+    }
+
+    if (!polling && (trans->data_len >= SPI_BUS_DMA_MIN) &&
+        (hspi->hdmarx != NULL) && (hspi->hdmatx != NULL)) {
+        if (trans->rx_data != NULL) {
+            res = spi_receive_dma(hspi, trans->rx_data, trans->data_len);
+        } else {
+            res = spi_transmit_dma(hspi, trans->tx_data, trans->data_len);
+        }
+        return (res == HAL_OK) ? 1 : 2;
+    }
+
+    if (trans->rx_data != NULL) {
+        res = spi_receive(hspi, trans->rx_data, trans->data_len);
+    } else {
+        res = spi_transmit(hspi, trans->tx_data, trans->data_len);
+    }
+
+    return (res == HAL_OK) ? 0 : 2;
+}
+
+/**
+ * @brief 结束当前事务, 拉高片选, 调用回调
+ *
+ * @param bus 总线
+ * @param trans 事务
+ * @param state 结束状态
+ */
+static void spi_bus_finish(spi_bus_t *bus, spi_trans_t *trans,
+                           spi_trans_state_t state) {
+    HAL_GPIO_WritePin(trans->cs_port, trans->cs_pin, GPIO_PIN_SET);
+
+    bus->busy_cycles += DWT->CYCCNT - bus->trans_start;
+    bus->trans_count++;
+    bus->byte_count += trans->cmd_len + trans->data_len;
+
+    /* 先释放总线再回调, 回调中可以提交新的事务 */
+    bus->current = NULL;
+    trans->state = state;
+    if (trans->callback != NULL) {
+        trans->callback(trans);
+    }
+}
+
+/**
+ * @brief 依次执行队列中的事务, 直到有事务开始DMA传输或队列为空
+ *
+ * @param bus 总线
+ * @param trans 第一个事务, 必须已经是当前事务
+ */
+static void spi_bus_run(spi_bus_t *bus, spi_trans_t *trans) {
+    uint8_t res;
+
+    while (trans != NULL) {
+        res = spi_bus_start(bus, trans, 0);
+        if (res == 1) {
+            return;
+        }
+        spi_bus_finish(bus, trans, res ? SPI_TRANS_ERROR : SPI_TRANS_DONE);
+        trans = spi_bus_next(bus);
+    }
+}
+
+/**
+ * @brief 初始化总线, 打开DWT周期计数器
+ *
+ * @param bus 总线, SPI需已初始化
+ */
+void spi_bus_init(spi_bus_t *bus) {
+    for (uint32_t i = 0; i < SPI_BUS_PRIO_NUM; ++i) {
+        bus->head[i] = NULL;
+        bus->tail[i] = NULL;
+    }
+    bus->current = NULL;
+
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    bus->busy_cycles = 0;
+    bus->trans_count = 0;
+    bus->byte_count = 0;
+    bus->window_start = HAL_GetTick();
+}
+
+/**
+ * @brief 提交事务, 立即返回
+ *
+ * @param bus 总线
+ * @param trans 事务, 完成前不能修改或释放
+ * @return 提交结果
+ *  @retval 0 成功
+ *  @retval 1 参数错误或事务已在队列中
+ * @note 可以在中断中调用. 总线空闲时在调用者中开始传输
+ */
+uint8_t spi_bus_submit(spi_bus_t *bus, spi_trans_t *trans) {
+    uint32_t primask;
+
+    if ((trans->prio >= SPI_BUS_PRIO_NUM) ||
+        (trans->cmd_len > SPI_BUS_CMD_MAX) ||
+        (trans->state == SPI_TRANS_QUEUED) ||
+        (trans->state == SPI_TRANS_RUNNING)) {
+        return 1;
+    }
+
+    trans->next = NULL;
+    trans->state = SPI_TRANS_QUEUED;
+
+    primask = __get_PRIMASK();
+    __disable_irq();
+    if (bus->tail[trans->prio] == NULL) {
+        bus->head[trans->prio] = trans;
+    } else {
+        bus->tail[trans->prio]->next = trans;
+    }
+    bus->tail[trans->prio] = trans;
+    __set_PRIMASK(primask);
+
+    spi_bus_run(bus, spi_bus_next(bus));
+
+    return 0;
+}
+
+/**
+ * @brief 执行事务, 等待完成
+ *
+ * @param bus 总线
+ * @param trans 事务
+ * @return 传输结果
+ *  @retval 0 成功
+ *  @retval 1 传输出错, 或在中断中调用时总线忙
+ * @note 在中断中调用时无法等待DMA完成中断, 总线空闲时插队以查询方式
+ *       执行, 总线忙时直接返回
+ */
+uint8_t spi_bus_transfer(spi_bus_t *bus, spi_trans_t *trans) {
+    uint32_t primask;
+    uint8_t res;
+
+    if (__get_IPSR() == 0) {
+        if (spi_bus_submit(bus, trans) != 0) {
+            return 1;
+        }
+        while ((trans->state == SPI_TRANS_QUEUED) ||
+               (trans->state == SPI_TRANS_RUNNING))
+            ;
+        return (trans->state == SPI_TRANS_DONE) ? 0 : 1;
+    }
+
+    primask = __get_PRIMASK();
+    __disable_irq();
+    if (bus->current != NULL) {
+        __set_PRIMASK(primask);
+        return 1;
+    }
+    trans->state = SPI_TRANS_RUNNING;
+    bus->current = trans;
+    __set_PRIMASK(primask);
+
+    res = spi_bus_start(bus, trans, 1);
+    spi_bus_finish(bus, trans, res ? SPI_TRANS_ERROR : SPI_TRANS_DONE);
+
+    /* 插队期间可能有新的事务提交 */
+    spi_bus_run(bus, spi_bus_next(bus));
+
+    return (trans->state == SPI_TRANS_DONE) ? 0 : 1;
+}
+
+/**
+ * @brief 终止正在传输的事务, 清空队列
+ *
+ * @param bus 总线
+ * @note 只在高优先级中断中使用, 被终止的事务状态为`SPI_TRANS_ERROR`,
+ *       不调用回调
+ */
+void spi_bus_abort(spi_bus_t *bus) {
+    spi_trans_t *trans = bus->current;
+
+    if (trans != NULL) {
+        spi_abort(bus->hspi);
+        HAL_GPIO_WritePin(trans->cs_port, trans->cs_pin, GPIO_PIN_SET);
+        trans->state = SPI_TRANS_ERROR;
+        bus->current = NULL;
+    }
+
+    for (uint32_t i = 0; i < SPI_BUS_PRIO_NUM; ++i) {
+        for (trans = bus->head[i]; trans != NULL; trans = trans->next) {
+            trans->state = SPI_TRANS_ERROR;
+        }
+        bus->head[i] = NULL;
+        bus->tail[i] = NULL;
+    }
+}
+
+/**
+ * @brief 获取上次调用以来的总线统计, 并开始新的统计周期
+ *
+ * @param bus 总线
+ * @param[out] stats 统计结果
+ */
+void spi_bus_get_stats(spi_bus_t *bus, spi_bus_stats_t *stats) {
+    uint32_t now = HAL_GetTick();
+    uint64_t total;
+    uint32_t primask;
+
+    primask = __get_PRIMASK();
+    __disable_irq();
+    stats->period = now - bus->window_start;
+    stats->trans = bus->trans_count;
+    stats->bytes = bus->byte_count;
+    total = (uint64_t)stats->period * (SystemCoreClock / 1000);
+    stats->usage = total ? (uint32_t)(bus->busy_cycles * 1000 / total) : 0;
+
+    bus->busy_cycles = 0;
+    bus->trans_count = 0;
+    bus->byte_count = 0;
+    bus->window_start = now;
+    __set_PRIMASK(primask);
+}
+
+/**
+ * @brief DMA传输结束, 结束当前事务并开始下一个
+ *
+ * @param hspi SPI句柄
+ * @param state 结束状态
+ */
+static void spi_bus_dma_done(SPI_HandleTypeDef *hspi,
+                             spi_trans_state_t state) {
+    spi_bus_t *bus = spi_bus_find(hspi);
+
+    if ((bus == NULL) || (bus->current == NULL)) {
+        return;
+    }
+
+    spi_bus_finish(bus, bus->current, state);
+    spi_bus_run(bus, spi_bus_next(bus));
+}
+
+/**
+ * @brief SPI DMA发送完成回调
+ *
+ * @param hspi SPI句柄
+ */
+void HAL_SPI_TxCpltCallback(SPI_HandleTypeDef *hspi) {
+    spi_bus_dma_done(hspi, SPI_TRANS_DONE);
+}
+
+/**
+ * @brief SPI DMA接收完成回调
+ *
+ * @param hspi SPI句柄
+ */
+void HAL_SPI_RxCpltCallback(SPI_HandleTypeDef *hspi) {
+    spi_bus_dma_done(hspi, SPI_TRANS_DONE);
+}
+
+/**
+ * @brief SPI传输出错回调
+ *
+ * @param hspi SPI句柄
+ */
+void HAL_SPI_ErrorCallback(SPI_HandleTypeDef *hspi) {
+    spi_bus_dma_done(hspi, SPI_TRANS_ERROR);
+}
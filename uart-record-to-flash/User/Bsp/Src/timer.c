@@ -0,0 +1,165 @@
+/**
+ * @file    timer.c
+ * @author  Deadline039
+ * @brief   微秒定时器
+ * @version 1.0
+ * @date    2026-10-17
+ * @note    定时器以1MHz自由计数, 溢出中断扩展为32位的微秒时间.
+ *          定时时间在一个计数周期内时, 把低16位写入比较寄存器,
+ *          计数到达时由比较中断调用`timer_us_callback`, 不受主循环影响.
+ */
+
+#include "timer.h"
+
+#include <assert.h>
+
+static TIM_HandleTypeDef timer_us_handle = {.Instance = TIMER_US_INSTANCE};
+
+static __IO uint32_t timer_us_high;   /* 时间的高16位, 每次溢出加0x10000 */
+static __IO uint32_t timer_us_target; /* 定时时间 */
+static __IO uint8_t timer_us_armed;   /* 是否正在定时 */
+
+/**
+ * @brief 初始化定时器, 开始计时
+ *
+ */
+void timer_us_init(void) {
+    HAL_StatusTypeDef res = HAL_OK;
+    uint32_t clock = HAL_RCC_GetPCLK1Freq();
+
+    /* APB1分频时定时器时钟为PCLK1的2倍 */
+    if ((RCC->CFGR & RCC_CFGR_PPRE1) != RCC_HCLK_DIV1) {
+        clock *= 2;
+    }
+
+    TIMER_US_CLK_ENABLE();
+
+    timer_us_handle.Init.Prescaler = clock / 1000000 - 1;
+    timer_us_handle.Init.CounterMode = TIM_COUNTERMODE_UP;
+    timer_us_handle.Init.Period = 0xFFFF;
+    timer_us_handle.Init.ClockDivision = TIM_CLOCKDIVISION_DIV1;
+    timer_us_handle.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_DISABLE;
+    res = HAL_TIM_Base_Init(&timer_us_handle);
+#ifdef DEBUG
+    assert(res == HAL_OK);
+#endif /* DEBUG */
+
+    HAL_NVIC_SetPriority(TIMER_US_IRQn, TIMER_US_IT_PREEMPT, TIMER_US_IT_SUB);
+    HAL_NVIC_EnableIRQ(TIMER_US_IRQn);
+
+    res = HAL_TIM_Base_Start_IT(&timer_us_handle);
+#ifdef DEBUG
+    assert(res == HAL_OK);
+#endif /* DEBUG */
+}
+
+/**
+ * @brief 获取当前时间
+ *
+ * @return 时间(us), 约71分钟回绕一次
+ */
+uint32_t timer_us_now(void) {
+    uint32_t primask = __get_PRIMASK();
+    uint32_t high, cnt;
+
+    __disable_irq();
+    high = timer_us_high;
+    cnt = __HAL_TIM_GET_COUNTER(&timer_us_handle);
+    /* 已经溢出, 但溢出中断还没有处理 */
+    if (__HAL_TIM_GET_FLAG(&timer_us_handle, TIM_FLAG_UPDATE) &&
+        (cnt < 0x8000)) {
+        high += 0x10000;
+    }
+    __set_PRIMASK(primask);
+
+    return high + cnt;
+}
+
+/**
+ * @brief 定时时间在一个计数周期内时设置比较值
+ *
+ * @note 关中断或在定时器中断中调用
+ */
+static void timer_us_arm(void) {
+    int32_t remain = (int32_t)(timer_us_target - timer_us_now());
+
+    if (remain < TIMER_US_MIN_LEAD) {
+        /* 来不及设置比较值, 直接产生比较事件 */
+        __HAL_TIM_ENABLE_IT(&timer_us_handle, TIM_IT_CC1);
+        HAL_TIM_GenerateEvent(&timer_us_handle, TIM_EVENTSOURCE_CC1);
+        return;
+    }
+
+    if (remain < 0x10000 - TIMER_US_MIN_LEAD) {
+        __HAL_TIM_SET_COMPARE(&timer_us_handle, TIM_CHANNEL_1,
+                              timer_us_target & 0xFFFF);
+        __HAL_TIM_CLEAR_FLAG(&timer_us_handle, TIM_FLAG_CC1);
+        __HAL_TIM_ENABLE_IT(&timer_us_handle, TIM_IT_CC1);
+    }
+    /* 否则等溢出中断中再设置 */
+}
+
+/**
+ * @brief 在指定时间调用`timer_us_callback`
+ *
+ * @param target 时间(us), 和`timer_us_now`的差不能超过35分钟
+ * @note 同一时间只有一个定时, 会取消之前的定时. 可以在中断中调用,
+ *       时间已经过去时立即触发
+ */
+void timer_us_schedule(uint32_t target) {
+    uint32_t primask = __get_PRIMASK();
+
+    __disable_irq();
+    __HAL_TIM_DISABLE_IT(&timer_us_handle, TIM_IT_CC1);
+    timer_us_target = target;
+    timer_us_armed = 1;
+    timer_us_arm();
+    __set_PRIMASK(primask);
+}
+
+/**
+ * @brief 取消定时
+ *
+ */
+void timer_us_cancel(void) {
+    uint32_t primask = __get_PRIMASK();
+
+    __disable_irq();
+    __HAL_TIM_DISABLE_IT(&timer_us_handle, TIM_IT_CC1);
+    timer_us_armed = 0;
+    __set_PRIMASK(primask);
+}
+
+/**
+ * @brief 定时到达回调
+ *
+ * @param error 实际时间与定时时间的差(us), 负数为提前
+ * @note 在定时器中断中调用
+ */
+__weak void timer_us_callback(int32_t error) {
+    UNUSED(error);
+}
+
+/**
+ * @brief 定时器中断服务函数
+ *
+ */
+void TIMER_US_IRQHandler(void) {
+    if (__HAL_TIM_GET_FLAG(&timer_us_handle, TIM_FLAG_UPDATE)) {
+        __HAL_TIM_CLEAR_FLAG(&timer_us_handle, TIM_FLAG_UPDATE);
+        timer_us_high += 0x10000;
+
+        if (timer_us_armed &&
+            !__HAL_TIM_GET_IT_SOURCE(&timer_us_handle, TIM_IT_CC1)) {
+            timer_us_arm();
+        }
+    }
+
+    if (__HAL_TIM_GET_FLAG(&timer_us_handle, TIM_FLAG_CC1) &&
+        __HAL_TIM_GET_IT_SOURCE(&timer_us_handle, TIM_IT_CC1)) {
+        __HAL_TIM_CLEAR_FLAG(&timer_us_handle, TIM_FLAG_CC1);
+        __HAL_TIM_DISABLE_IT(&timer_us_handle, TIM_IT_CC1);
+        timer_us_armed = 0;
+        timer_us_callback((int32_t)(timer_us_now() - timer_us_target));
+    }
+}
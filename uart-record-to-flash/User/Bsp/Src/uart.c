@@ -397,6 +397,16 @@ void HAL_UART_ErrorCallback(UART_HandleTypeDef *huart) {
     }
 }
 
+/**
+ * @brief 发送完成回调, 给直接用DMA发送自己缓冲区的模块使用
+ *
+ * @param huart 串口句柄
+ * @note 在中断中调用
+ */
+__weak void uart_tx_done_callback(UART_HandleTypeDef *huart) {
+    UNUSED(huart);
+}
+
 #if (USE_HAL_UART_REGISTER_CALLBACKS == 0)
 
 /**
@@ -408,6 +418,7 @@ void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart) {
     if (huart->hdmatx != NULL) {
         uart_dmatx_clear_tc_flag(huart);
     }
+    uart_tx_done_callback(huart);
 }
 
 /**